@@ -0,0 +1,72 @@
+/*
+ * Boot Trace Module Implementation
+ */
+
+#include "boot_trace.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_rtc_time.h"
+
+static const char *TAG = "BOOT";
+
+static const char *const STAGE_NAMES[BOOT_STAGE_COUNT] = {
+    [BOOT_STAGE_APP_MAIN]      = "app_main",
+    [BOOT_STAGE_USB_INSTALLED] = "usb installed",
+    [BOOT_STAGE_INPUT_ARMED]   = "inputs armed",
+    [BOOT_STAGE_LED_READY]     = "led ready",
+    [BOOT_STAGE_NFC_READY]     = "nfc ready",
+    [BOOT_STAGE_USB_MOUNTED]   = "usb mounted",
+    [BOOT_STAGE_MOUNT_REPORT]  = "mount report taken",
+};
+
+static uint32_t s_stage_us[BOOT_STAGE_COUNT];
+static uint32_t s_reset_us = 0;         // power-on reset -> app_main
+static bool s_logged = false;
+
+void boot_trace_mark(boot_stage_t stage)
+{
+    if (stage >= BOOT_STAGE_COUNT) return;
+    if (stage == BOOT_STAGE_APP_MAIN && s_reset_us == 0 && esp_reset_reason() == ESP_RST_POWERON) {
+        s_reset_us = (uint32_t)esp_rtc_get_time_us();
+    }
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    uint32_t unset = 0;
+    // First writer wins; `now` is never 0 this late in boot.
+    __atomic_compare_exchange_n(&s_stage_us[stage], &unset, now ? now : 1, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+uint32_t boot_trace_get_us(boot_stage_t stage)
+{
+    return stage < BOOT_STAGE_COUNT ? __atomic_load_n(&s_stage_us[stage], __ATOMIC_RELAXED) : 0;
+}
+
+uint32_t boot_trace_get_reset_us(void)
+{
+    return s_reset_us;
+}
+
+bool boot_trace_log_once(void)
+{
+    if (s_logged) return true;
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        if (boot_trace_get_us(i) == 0) return false;
+    }
+    s_logged = true;
+
+    // One timeline per boot; it is what the boot-time budget is read from,
+    // so keep it when the release profile turns the default level down.
+    esp_log_level_set(TAG, ESP_LOG_INFO);
+    if (s_reset_us != 0) {
+        ESP_LOGI(TAG, "%8.1f ms  power-on reset -> app_main (ROM + bootloader)", s_reset_us / 1000.0);
+    }
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        ESP_LOGI(TAG, "%8.1f ms  %s", boot_trace_get_us(i) / 1000.0, STAGE_NAMES[i]);
+    }
+    uint32_t mounted = boot_trace_get_us(BOOT_STAGE_USB_MOUNTED);
+    uint32_t taken = boot_trace_get_us(BOOT_STAGE_MOUNT_REPORT);
+    ESP_LOGI(TAG, "Time to first report after mount: %.1f ms (%.1f ms after mount)",
+             taken / 1000.0, (taken - mounted) / 1000.0);
+    return true;
+}
@@ -0,0 +1,60 @@
+/*
+ * Boot Trace Module
+ * Timestamps of each bring-up stage, from reset to the host taking the
+ * key-state report the firmware sends once it is mounted.
+ */
+
+#ifndef _BOOT_TRACE_H_
+#define _BOOT_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Stages in rough critical-path order. LED and NFC come up in the background
+// and may land anywhere after INPUT_ARMED.
+typedef enum {
+    BOOT_STAGE_APP_MAIN = 0,        // app_main entered
+    BOOT_STAGE_USB_INSTALLED,       // TinyUSB driver installed
+    BOOT_STAGE_INPUT_ARMED,         // GPIO interrupts live, events can be reported
+    BOOT_STAGE_LED_READY,           // LED task running (background)
+    BOOT_STAGE_NFC_READY,           // RC522 probed and scanning, or given up (background)
+    BOOT_STAGE_USB_MOUNTED,         // host finished enumeration
+    BOOT_STAGE_MOUNT_REPORT,        // host took the report sent on mount (first report after mount)
+    BOOT_STAGE_COUNT
+} boot_stage_t;
+
+/**
+ * Record that a stage was reached. Only the first call per stage counts.
+ * Safe from any task.
+ */
+void boot_trace_mark(boot_stage_t stage);
+
+/**
+ * Microseconds from reset (esp_timer epoch; excludes the ROM/2nd-stage
+ * bootloader) to the stage, or 0 if not reached yet
+ */
+uint32_t boot_trace_get_us(boot_stage_t stage);
+
+/**
+ * Microseconds from power-on reset to app_main, ROM and bootloader
+ * included. Read from the RTC timer, so only as good as the RTC slow clock
+ * (±5 % on the internal RC). 0 after any other kind of reset: the RTC timer
+ * then still counts from an earlier power-on.
+ */
+uint32_t boot_trace_get_reset_us(void);
+
+/**
+ * Log the whole timeline once every stage has been reached.
+ * Returns true once it has been logged.
+ */
+bool boot_trace_log_once(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BOOT_TRACE_H_ */
@@ -0,0 +1,271 @@
+/*
+ * Event Log Module Implementation
+ * Bounded multi-producer / single-consumer ring. A producer reserves entries
+ * by advancing the head with a CAS, fills them, then publishes the first
+ * entry's sequence number with a release store. The drain task consumes in
+ * order, copies an event out, frees its entries, and only then formats it.
+ * A producer preempted between reserve and publish just holds the drain back
+ * until it resumes; nothing is lost or torn.
+ */
+
+#include <string.h>
+#include "event_log.h"
+#include "input_handler.h"
+#include "telemetry.h"
+#include "health.h"
+#include "mem_report.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "EVT";
+
+#define EVLOG_DEPTH         CONFIG_COSMO_EVLOG_DEPTH
+#define EVLOG_DRAIN_MS      50
+#define EVLOG_TASK_STACK    (3 * 1024)
+#define EVLOG_TASK_PRIO     CONFIG_COSMO_PRIO_EVLOG
+#define EVLOG_TASK_CORE     CONFIG_COSMO_CORE_BG
+
+_Static_assert((EVLOG_DEPTH & (EVLOG_DEPTH - 1)) == 0, "event log depth must be a power of two");
+
+typedef struct {
+    uint32_t seq;                   // index + 1 once published
+    uint32_t t_us;                  // low 32 bits of esp_timer_get_time()
+    uint16_t id;
+    uint16_t a0;
+    union {
+        uint32_t a[2];
+        uint8_t bytes[8];
+    };
+} evlog_entry_t;
+
+#define EVLOG_BYTES_PER_ENTRY   sizeof(((evlog_entry_t *)0)->bytes)
+
+static evlog_entry_t s_ring[EVLOG_DEPTH];
+static uint32_t s_head = 0;         // next index to reserve (producers)
+static uint32_t s_tail = 0;         // next index to consume (drain task)
+static uint32_t s_dropped = 0;
+
+static StaticTask_t s_task_tcb;
+static StackType_t s_task_stack[EVLOG_TASK_STACK];
+static TaskHandle_t s_task = NULL;
+
+static const char *const INPUT_NAMES[] = {
+    [INPUT_EVENT_BUTTON_PRESS]     = "BTN -> ENTER (pressed)",
+    [INPUT_EVENT_BUTTON_RELEASE]   = "BTN -> ENTER (released)",
+    [INPUT_EVENT_ENC1_CW]          = "ENC1 CW -> UP",
+    [INPUT_EVENT_ENC1_CCW]         = "ENC1 CCW -> DOWN",
+    [INPUT_EVENT_ENC1_SW_PRESS]    = "ENC1 SW -> F1 (pressed)",
+    [INPUT_EVENT_ENC1_SW_RELEASE]  = "ENC1 SW -> F1 (released)",
+    [INPUT_EVENT_ENC2_CW]          = "ENC2 CW -> RIGHT",
+    [INPUT_EVENT_ENC2_CCW]         = "ENC2 CCW -> LEFT",
+    [INPUT_EVENT_ENC2_SW_PRESS]    = "ENC2 SW -> F2 (pressed)",
+    [INPUT_EVENT_ENC2_SW_RELEASE]  = "ENC2 SW -> F2 (released)",
+};
+
+// Claim n consecutive entries, or count a drop if they do not fit.
+static bool reserve(uint32_t n, uint32_t *first)
+{
+    uint32_t head = __atomic_load_n(&s_head, __ATOMIC_RELAXED);
+    do {
+        // Acquire pairs with the drain's release: the entries were copied out
+        // before we see them as free.
+        uint32_t tail = __atomic_load_n(&s_tail, __ATOMIC_ACQUIRE);
+        if (head - tail + n > EVLOG_DEPTH) {
+            __atomic_fetch_add(&s_dropped, 1, __ATOMIC_RELAXED);
+            telemetry_count(TELEM_EVLOG_DROPPED);
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&s_head, &head, head + n, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    *first = head;
+    return true;
+}
+
+static inline evlog_entry_t *entry_at(uint32_t index)
+{
+    return &s_ring[index & (EVLOG_DEPTH - 1)];
+}
+
+void evlog_put(evlog_id_t id, uint16_t a0, uint32_t a1, uint32_t a2)
+{
+    uint32_t index;
+    if (!reserve(1, &index)) return;
+    evlog_entry_t *e = entry_at(index);
+    e->t_us = (uint32_t)esp_timer_get_time();
+    e->id = id;
+    e->a0 = a0;
+    e->a[0] = a1;
+    e->a[1] = a2;
+    __atomic_store_n(&e->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+// Entries a byte payload of len bytes spans (at least the first one).
+static inline uint32_t entries_for(size_t len)
+{
+    return len <= EVLOG_BYTES_PER_ENTRY ? 1 : (len + EVLOG_BYTES_PER_ENTRY - 1) / EVLOG_BYTES_PER_ENTRY;
+}
+
+void evlog_put_bytes(evlog_id_t id, const void *data, size_t len)
+{
+    if (len > EVLOG_TEXT_MAX) len = EVLOG_TEXT_MAX;
+    uint32_t n = entries_for(len);
+    uint32_t index;
+    if (!reserve(n, &index)) return;
+
+    const uint8_t *src = data;
+    for (uint32_t i = 0; i < n; i++) {
+        evlog_entry_t *e = entry_at(index + i);
+        size_t off = i * EVLOG_BYTES_PER_ENTRY;
+        size_t chunk = len - off < EVLOG_BYTES_PER_ENTRY ? len - off : EVLOG_BYTES_PER_ENTRY;
+        e->id = i == 0 ? id : EVLOG_CONT;
+        e->a0 = i == 0 ? (uint16_t)len : 0;
+        memcpy(e->bytes, src + off, chunk);
+    }
+    // Continuations carry no sequence number of their own: the drain only
+    // reaches them through the first entry, whose release covers them.
+    evlog_entry_t *first = entry_at(index);
+    first->t_us = (uint32_t)esp_timer_get_time();
+    __atomic_store_n(&first->seq, index + 1, __ATOMIC_RELEASE);
+}
+
+/********* Drain task ***************/
+
+typedef struct {
+    int64_t time_us;
+    uint16_t id;
+    uint16_t a0;
+    uint32_t a[2];
+    uint8_t bytes[EVLOG_TEXT_MAX + 1];  // NUL-terminated copy for byte events
+} evlog_event_t;
+
+// Copy the oldest published event out and free its entries.
+static bool take_event(evlog_event_t *ev)
+{
+    uint32_t tail = s_tail;
+    evlog_entry_t *e = entry_at(tail);
+    if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+        return false;
+    }
+
+    // Widen the 32-bit stamp against a clock read after the publish.
+    int64_t now = esp_timer_get_time();
+    ev->time_us = now - (uint32_t)((uint32_t)now - e->t_us);
+    ev->id = e->id;
+    ev->a0 = e->a0;
+    ev->a[0] = e->a[0];
+    ev->a[1] = e->a[1];
+
+    uint32_t n = 1;
+    if (ev->id == EVLOG_NFC_TAG || ev->id == EVLOG_NFC_PAYLOAD || ev->id == EVLOG_NFC_TYPING) {
+        size_t len = ev->a0 <= EVLOG_TEXT_MAX ? ev->a0 : EVLOG_TEXT_MAX;
+        n = entries_for(len);
+        for (uint32_t i = 0; i < n; i++) {
+            memcpy(ev->bytes + i * EVLOG_BYTES_PER_ENTRY, entry_at(tail + i)->bytes, EVLOG_BYTES_PER_ENTRY);
+        }
+        ev->bytes[len] = '\0';
+    }
+
+    __atomic_store_n(&s_tail, tail + n, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void print_event(const evlog_event_t *ev)
+{
+    unsigned long s = (unsigned long)(ev->time_us / 1000000);
+    unsigned long us = (unsigned long)(ev->time_us % 1000000);
+
+    switch (ev->id) {
+    case EVLOG_INPUT:
+        if (ev->a0 < sizeof(INPUT_NAMES) / sizeof(INPUT_NAMES[0]) && INPUT_NAMES[ev->a0] != NULL) {
+            ESP_LOGI(TAG, "%lu.%06lu %s", s, us, INPUT_NAMES[ev->a0]);
+        } else {
+            ESP_LOGI(TAG, "%lu.%06lu input event %u", s, us, ev->a0);
+        }
+        break;
+    case EVLOG_NFC_TAG: {
+        char hex[EVLOG_TEXT_MAX * 2 + 1];
+        char *p = hex;
+        for (uint16_t i = 0; i < ev->a0 && i < EVLOG_TEXT_MAX; i++) {
+            p += sprintf(p, "%02X", ev->bytes[i]);
+        }
+        *p = '\0';
+        ESP_LOGI(TAG, "%lu.%06lu tag detected: UID=%s", s, us, hex);
+        break;
+    }
+    case EVLOG_NFC_PAYLOAD:
+        ESP_LOGI(TAG, "%lu.%06lu tag payload \"%s\"", s, us, (const char *)ev->bytes);
+        break;
+    case EVLOG_NFC_NO_PAYLOAD:
+        ESP_LOGI(TAG, "%lu.%06lu tag has no NDEF Text record, falling back to UID", s, us);
+        break;
+    case EVLOG_NFC_TYPING:
+        ESP_LOGI(TAG, "%lu.%06lu NFC -> typing '%s\\n'", s, us, (const char *)ev->bytes);
+        break;
+    case EVLOG_NFC_SUPERSEDED:
+        ESP_LOGI(TAG, "%lu.%06lu NFC string superseded after %u chars, erasing", s, us, ev->a0);
+        break;
+    case EVLOG_NFC_READ_ABORTED:
+        ESP_LOGI(TAG, "%lu.%06lu tag left mid-read after %u chars, erasing and typing the UID", s, us, ev->a0);
+        break;
+    case EVLOG_NFC_INDEX_HIT:
+        ESP_LOGI(TAG, "%lu.%06lu tag listed in the UID index, pages not read", s, us);
+        break;
+    case EVLOG_HEALTH_SLO_MISS:
+        ESP_LOGW(TAG, "%lu.%06lu %s latency %lu us, objective %lu us", s, us,
+                 health_slo_name((health_slo_t)ev->a0), (unsigned long)ev->a[0], (unsigned long)ev->a[1]);
+        break;
+    case EVLOG_HEALTH_STALL:
+        ESP_LOGW(TAG, "%lu.%06lu %s task stuck, no progress for %lu ms", s, us,
+                 health_task_name((health_task_t)ev->a0), (unsigned long)ev->a[0]);
+        break;
+    case EVLOG_HEALTH_RECOVERED:
+        ESP_LOGW(TAG, "%lu.%06lu %s task recovered after %lu ms", s, us,
+                 health_task_name((health_task_t)ev->a0), (unsigned long)ev->a[0]);
+        break;
+    default:
+        ESP_LOGI(TAG, "%lu.%06lu event %u (%u, 0x%08lx, 0x%08lx)", s, us, ev->id, ev->a0,
+                 (unsigned long)ev->a[0], (unsigned long)ev->a[1]);
+        break;
+    }
+}
+
+static void evlog_task(void *arg)
+{
+    static evlog_event_t ev;        // only this task touches it
+    uint32_t dropped_seen = 0;
+
+    while (1) {
+        while (take_event(&ev)) {
+            print_event(&ev);
+        }
+        uint32_t dropped = __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+        if (dropped != dropped_seen) {
+            ESP_LOGW(TAG, "%lu events dropped, ring full", (unsigned long)(dropped - dropped_seen));
+            dropped_seen = dropped;
+        }
+        vTaskDelay(pdMS_TO_TICKS(EVLOG_DRAIN_MS));
+    }
+}
+
+esp_err_t evlog_start(void)
+{
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+    // Events are part of the production console output; keep them visible
+    // when the default log level is turned down.
+    esp_log_level_set(TAG, ESP_LOG_INFO);
+
+    s_task = xTaskCreateStaticPinnedToCore(evlog_task, "evlog", EVLOG_TASK_STACK, NULL,
+                                           EVLOG_TASK_PRIO, s_task_stack, &s_task_tcb,
+                                           EVLOG_TASK_CORE);
+    if (s_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create event log task");
+        return ESP_FAIL;
+    }
+    mem_report_add_static(MEM_MOD_DIAG, sizeof(s_ring) + sizeof(s_task_tcb) + sizeof(s_task_stack));
+    return ESP_OK;
+}
@@ -0,0 +1,63 @@
+/*
+ * Event Log Module
+ * Deferred binary logging for the hot paths. Producers write an event ID
+ * and a few raw arguments into a lock-free ring; a low-priority task drains
+ * the ring and does all formatting and console output later.
+ */
+
+#ifndef _EVENT_LOG_H_
+#define _EVENT_LOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Event IDs. Arguments are stored raw and only interpreted by the drain task.
+typedef enum {
+    EVLOG_INPUT = 1,                // a0 = input_event_type_t
+    EVLOG_NFC_TAG,                  // bytes = UID
+    EVLOG_NFC_PAYLOAD,              // bytes = NDEF Text payload of the tag just logged
+    EVLOG_NFC_NO_PAYLOAD,           // no usable Text record, the UID will be typed
+    EVLOG_NFC_TYPING,               // bytes = string handed to the typer, without '\n'
+    EVLOG_NFC_SUPERSEDED,           // a0 = characters typed before the abort
+    EVLOG_NFC_READ_ABORTED,         // a0 = characters typed before the tag left mid-read
+    EVLOG_HEALTH_SLO_MISS,          // a0 = health_slo_t, a1 = sample us, a2 = objective us
+    EVLOG_HEALTH_STALL,             // a0 = health_task_t, a1 = ms since its last beat
+    EVLOG_HEALTH_RECOVERED,         // a0 = health_task_t, a1 = ms it was stuck
+    EVLOG_NFC_INDEX_HIT,            // a0 = ID length; the tag's UID is in the UID index, no pages read
+    EVLOG_CONT,                     // next 8 bytes of the entry before it
+} evlog_id_t;
+
+// Longer byte payloads are truncated; one spans at most 8 ring entries.
+#define EVLOG_TEXT_MAX      64
+
+/**
+ * Record an event with one 16-bit and two 32-bit arguments.
+ * Lock-free and non-blocking, safe from any task on either core. When the
+ * ring is full the event is dropped and counted.
+ */
+void evlog_put(evlog_id_t id, uint16_t a0, uint32_t a1, uint32_t a2);
+
+/**
+ * Record an event carrying raw bytes (a string, a UID) instead of arguments.
+ * The bytes go into consecutive ring entries taken in one reservation, so
+ * text from two producers never interleaves. a0 holds the byte count, capped
+ * at EVLOG_TEXT_MAX.
+ */
+void evlog_put_bytes(evlog_id_t id, const void *data, size_t len);
+
+/**
+ * Start the drain task. Events put before this are kept and printed once
+ * it runs, as long as the ring did not fill up in between.
+ */
+esp_err_t evlog_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _EVENT_LOG_H_ */
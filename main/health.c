@@ -0,0 +1,282 @@
+/*
+ * Health Monitor Implementation
+ * A beat is one relaxed store of a millisecond timestamp, so the watched
+ * tasks pay nothing measurable; a latency sample costs one load unless it
+ * misses its objective. Everything else happens on the monitor task, which
+ * runs above the NFC tasks on the background core and looks every 100 ms.
+ *
+ * The TinyUSB task is a library task and cannot beat by itself: the
+ * monitor posts a deferred call into its event queue and counts it busy
+ * until the call runs. Only one probe is ever in flight.
+ */
+
+#include <string.h>
+#include "health.h"
+#include "telemetry_log.h"
+#include "event_log.h"
+#include "led_indicator.h"
+#include "mem_report.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "device/usbd_pvt.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "HEALTH";
+
+#define HEALTH_STALL_MS         CONFIG_COSMO_HEALTH_STALL_MS
+#define HEALTH_RESTART_MS       CONFIG_COSMO_HEALTH_RESTART_MS
+#define HEALTH_CHECK_MS         100
+#define HEALTH_SLO_ALERT_MS     3000    // how long the LED shows a latency miss
+#define HEALTH_LOG_FLUSH_MS     100     // let the console catch up before restarting
+#define HEALTH_TASK_STACK       (3 * 1024)
+#define HEALTH_TASK_PRIO        CONFIG_COSMO_PRIO_HEALTH
+#define HEALTH_TASK_CORE        CONFIG_COSMO_CORE_BG
+
+_Static_assert(HEALTH_RESTART_MS == 0 || HEALTH_RESTART_MS > HEALTH_STALL_MS,
+               "restart must come after the stall is flagged");
+_Static_assert(TLOG_CAUSE_STALL + HEALTH_TASK_COUNT <= 0xFF, "restart cause overflows its byte");
+
+// Amber while a latency objective was missed recently, fast red while a
+// task is stuck.
+static const led_pattern_t LED_SLO_MISS = {
+    .type = LED_PATTERN_BLINK, .red = 255, .green = 120, .blue = 0,
+    .period_ms = 500, .duration_ms = HEALTH_SLO_ALERT_MS,
+};
+static const led_pattern_t LED_STALL = {
+    .type = LED_PATTERN_BLINK, .red = 255, .green = 0, .blue = 0,
+    .period_ms = 200,
+};
+
+static const char *const TASK_NAMES[HEALTH_TASK_COUNT] = {
+    [HEALTH_TASK_INPUT]         = "input",
+    [HEALTH_TASK_USB]           = "usb",
+    [HEALTH_TASK_NFC_SCAN]      = "nfc_scan",
+    [HEALTH_TASK_NFC_DISPATCH]  = "nfc_dispatch",
+};
+
+static const char *const SLO_NAMES[HEALTH_SLO_COUNT] = {
+    [HEALTH_SLO_INPUT]          = "input",
+    [HEALTH_SLO_NFC_FIRST_CHAR] = "nfc_first_char",
+};
+
+// Last beat per task in ms since boot, 0 = idle.
+static uint32_t s_beat_ms[HEALTH_TASK_COUNT];
+
+// Monitor task only, except s_stalled which anyone may read.
+static uint32_t s_stalled = 0;
+static uint32_t s_stalled_from_ms[HEALTH_TASK_COUNT];
+static uint32_t s_slo_alert_until_ms = 0;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static health_stats_t s_stats = {
+    .slo_us = {
+        [HEALTH_SLO_INPUT]          = CONFIG_COSMO_HEALTH_SLO_INPUT_MS * 1000,
+        [HEALTH_SLO_NFC_FIRST_CHAR] = CONFIG_COSMO_HEALTH_SLO_NFC_FIRST_MS * 1000,
+    },
+    .stall_ms = HEALTH_STALL_MS,
+    .restart_ms = HEALTH_RESTART_MS,
+};
+static bool s_slo_missed = false;       // since the monitor last looked
+
+static StaticTask_t s_task_tcb;
+static StackType_t s_task_stack[HEALTH_TASK_STACK];
+static TaskHandle_t s_task = NULL;
+
+static uint32_t now_ms(void)
+{
+    uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+    return ms != 0 ? ms : 1;        // 0 means idle
+}
+
+void health_beat(health_task_t task)
+{
+    __atomic_store_n(&s_beat_ms[task], now_ms(), __ATOMIC_RELAXED);
+}
+
+void health_idle(health_task_t task)
+{
+    __atomic_store_n(&s_beat_ms[task], 0, __ATOMIC_RELAXED);
+}
+
+static int slo_for_stage(telemetry_stage_t stage)
+{
+    switch (stage) {
+    case TELEM_LAT_INPUT:           return HEALTH_SLO_INPUT;
+    case TELEM_LAT_NFC_FIRST_CHAR:  return HEALTH_SLO_NFC_FIRST_CHAR;
+    default:                        return -1;
+    }
+}
+
+// Caller holds s_lock.
+static void record_locked(health_event_t kind, unsigned id, uint32_t value)
+{
+    s_stats.last_kind = (uint32_t)kind << 8 | id;
+    s_stats.last_value = value;
+    s_stats.last_uptime_ms = now_ms();
+}
+
+void health_latency(telemetry_stage_t stage, uint32_t us)
+{
+    int slo = slo_for_stage(stage);
+    if (slo < 0) return;
+    uint32_t limit = __atomic_load_n(&s_stats.slo_us[slo], __ATOMIC_RELAXED);
+    if (limit == 0 || us <= limit) return;
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.misses[slo]++;
+    if (us > s_stats.worst_us[slo]) s_stats.worst_us[slo] = us;
+    record_locked(HEALTH_EVENT_SLO_MISS, slo, us);
+    portEXIT_CRITICAL(&s_lock);
+
+    telemetry_count(TELEM_HEALTH_SLO_MISSES);
+    evlog_put(EVLOG_HEALTH_SLO_MISS, (uint16_t)slo, us, limit);
+    __atomic_store_n(&s_slo_missed, true, __ATOMIC_RELAXED);
+}
+
+void health_set_slos(const uint32_t slo_us[HEALTH_SLO_COUNT])
+{
+    portENTER_CRITICAL(&s_lock);
+    memcpy(s_stats.slo_us, slo_us, sizeof(s_stats.slo_us));
+    memset(s_stats.misses, 0, sizeof(s_stats.misses));
+    memset(s_stats.worst_us, 0, sizeof(s_stats.worst_us));
+    memset(s_stats.stalls, 0, sizeof(s_stats.stalls));
+    s_stats.last_kind = HEALTH_EVENT_NONE;
+    s_stats.last_value = 0;
+    s_stats.last_uptime_ms = 0;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Objectives: input %lu us, first char %lu us",
+             (unsigned long)slo_us[HEALTH_SLO_INPUT], (unsigned long)slo_us[HEALTH_SLO_NFC_FIRST_CHAR]);
+}
+
+uint32_t health_stalled_mask(void)
+{
+    return __atomic_load_n(&s_stalled, __ATOMIC_RELAXED);
+}
+
+void health_get_stats(health_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+const char *health_task_name(health_task_t task)
+{
+    return task < HEALTH_TASK_COUNT ? TASK_NAMES[task] : "?";
+}
+
+const char *health_slo_name(health_slo_t slo)
+{
+    return slo < HEALTH_SLO_COUNT ? SLO_NAMES[slo] : "?";
+}
+
+// Runs on the TinyUSB task.
+static void usb_probe_cb(void *param)
+{
+    (void)param;
+    health_idle(HEALTH_TASK_USB);
+}
+
+static void usb_probe(void)
+{
+    if (__atomic_load_n(&s_beat_ms[HEALTH_TASK_USB], __ATOMIC_RELAXED) != 0) {
+        return;     // the last one has not run yet
+    }
+    health_beat(HEALTH_TASK_USB);
+    usbd_defer_func(usb_probe_cb, NULL, false);
+}
+
+static void restart_stuck(health_task_t task, uint32_t stuck_ms)
+{
+    ESP_LOGE(TAG, "%s task stuck for %lu ms - restarting", TASK_NAMES[task], (unsigned long)stuck_ms);
+    vTaskDelay(pdMS_TO_TICKS(HEALTH_LOG_FLUSH_MS));
+    tlog_set_restart_cause((tlog_cause_t)(TLOG_CAUSE_STALL + task));
+    esp_restart();
+}
+
+static void check_task(health_task_t task, uint32_t now)
+{
+    uint32_t bit = 1u << task;
+    uint32_t beat = __atomic_load_n(&s_beat_ms[task], __ATOMIC_RELAXED);
+    uint32_t quiet_ms = beat != 0 ? now - beat : 0;
+
+    if (quiet_ms >= HEALTH_STALL_MS) {
+        if (!(s_stalled & bit)) {
+            s_stalled_from_ms[task] = beat;
+            __atomic_fetch_or(&s_stalled, bit, __ATOMIC_RELAXED);
+            portENTER_CRITICAL(&s_lock);
+            s_stats.stalls[task]++;
+            record_locked(HEALTH_EVENT_STALL, task, quiet_ms);
+            portEXIT_CRITICAL(&s_lock);
+            telemetry_count(TELEM_HEALTH_STALLS);
+            evlog_put(EVLOG_HEALTH_STALL, (uint16_t)task, quiet_ms, 0);
+        }
+        if (HEALTH_RESTART_MS != 0 && quiet_ms >= HEALTH_RESTART_MS) {
+            restart_stuck(task, quiet_ms);
+        }
+    } else if (s_stalled & bit) {
+        uint32_t stuck_ms = now - s_stalled_from_ms[task];
+        __atomic_fetch_and(&s_stalled, ~bit, __ATOMIC_RELAXED);
+        portENTER_CRITICAL(&s_lock);
+        record_locked(HEALTH_EVENT_RECOVERED, task, stuck_ms);
+        portEXIT_CRITICAL(&s_lock);
+        evlog_put(EVLOG_HEALTH_RECOVERED, (uint16_t)task, stuck_ms, 0);
+    }
+}
+
+static void update_led(bool was_stalled, uint32_t now)
+{
+    bool stalled = s_stalled != 0;
+    bool missed = __atomic_exchange_n(&s_slo_missed, false, __ATOMIC_RELAXED);
+
+    if (stalled) {
+        if (!was_stalled) led_indicator_play(LED_LAYER_ALERT, &LED_STALL);
+        return;
+    }
+    if (was_stalled) {
+        led_indicator_clear(LED_LAYER_ALERT);
+        s_slo_alert_until_ms = 0;
+    }
+    // A steady stream of misses re-arms the pattern once it has run out
+    // rather than restarting it every check.
+    if (missed && (int32_t)(now - s_slo_alert_until_ms) >= 0) {
+        led_indicator_play(LED_LAYER_ALERT, &LED_SLO_MISS);
+        s_slo_alert_until_ms = now + HEALTH_SLO_ALERT_MS;
+    }
+}
+
+static void health_task(void *arg)
+{
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(HEALTH_CHECK_MS));
+        uint32_t now = now_ms();
+        bool was_stalled = s_stalled != 0;
+        for (int t = 0; t < HEALTH_TASK_COUNT; t++) {
+            check_task((health_task_t)t, now);
+        }
+        update_led(was_stalled, now);
+        usb_probe();
+    }
+}
+
+esp_err_t health_start(void)
+{
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+    s_task = xTaskCreateStaticPinnedToCore(health_task, "health", HEALTH_TASK_STACK, NULL,
+                                           HEALTH_TASK_PRIO, s_task_stack, &s_task_tcb,
+                                           HEALTH_TASK_CORE);
+    if (s_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create health monitor task");
+        return ESP_FAIL;
+    }
+    mem_report_add_static(MEM_MOD_DIAG, sizeof(s_task_tcb) + sizeof(s_task_stack));
+    ESP_LOGI(TAG, "Stall after %u ms, restart after %u ms; objectives: input %u ms, first char %u ms",
+             HEALTH_STALL_MS, HEALTH_RESTART_MS,
+             CONFIG_COSMO_HEALTH_SLO_INPUT_MS, CONFIG_COSMO_HEALTH_SLO_NFC_FIRST_MS);
+    return ESP_OK;
+}
@@ -0,0 +1,105 @@
+/*
+ * Health Monitor
+ * Watches the tasks a knob turn or a tag depends on, and the latency of the
+ * two paths a user feels against service-level objectives. A miss shows on
+ * the LED alert layer and goes into the event log, the telemetry counters
+ * and a HID feature report; a task that stays stuck restarts the device.
+ */
+
+#ifndef _HEALTH_H_
+#define _HEALTH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "telemetry.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Watched tasks. A task is stuck when it has work in hand (it beat and has
+// not gone idle since) and has not beaten again for the stall time.
+typedef enum {
+    HEALTH_TASK_INPUT = 0,          // input_handler_task: beats on every wake-up, never idle
+    HEALTH_TASK_USB,                // TinyUSB task: answers a probe the monitor posts
+    HEALTH_TASK_NFC_SCAN,           // rc522 scanner: from tag arrival until it is read
+    HEALTH_TASK_NFC_DISPATCH,       // NFC typing: beats on every report it types
+    HEALTH_TASK_COUNT
+} health_task_t;
+
+// Latency objectives, each on one telemetry stage. The order is the wire
+// layout of the health report, so only ever append.
+typedef enum {
+    HEALTH_SLO_INPUT = 0,           // TELEM_LAT_INPUT: knob / button edge -> HID report
+    HEALTH_SLO_NFC_FIRST_CHAR,      // TELEM_LAT_NFC_FIRST_CHAR: tag detected -> first character
+    HEALTH_SLO_COUNT
+} health_slo_t;
+
+// What the last recorded violation was (health_stats_t.last_kind).
+typedef enum {
+    HEALTH_EVENT_NONE = 0,
+    HEALTH_EVENT_SLO_MISS,          // id = health_slo_t, value = sample in us
+    HEALTH_EVENT_STALL,             // id = health_task_t, value = ms without a beat when flagged
+    HEALTH_EVENT_RECOVERED,         // id = health_task_t, value = ms it was stuck in total
+} health_event_t;
+
+// Read out over HID, 15 little-endian words.
+typedef struct {
+    uint32_t slo_us[HEALTH_SLO_COUNT];      // objective, 0 = not checked
+    uint32_t misses[HEALTH_SLO_COUNT];      // samples over it
+    uint32_t worst_us[HEALTH_SLO_COUNT];    // slowest of those
+    uint32_t stalls[HEALTH_TASK_COUNT];     // times each task was flagged stuck
+    uint32_t stall_ms;                      // flagged after this long without a beat
+    uint32_t restart_ms;                    // restart after this long, 0 = never
+    uint32_t last_kind;                     // last violation: health_event_t << 8 | id
+    uint32_t last_value;
+    uint32_t last_uptime_ms;
+} health_stats_t;
+
+#define HEALTH_STATS_WORDS  (sizeof(health_stats_t) / 4)
+
+/**
+ * Start the monitor task. Tasks may beat before this; nothing is checked
+ * until it runs.
+ */
+esp_err_t health_start(void);
+
+/**
+ * The calling task is making progress on work it has in hand
+ * Lock-free, safe from any task.
+ */
+void health_beat(health_task_t task);
+
+/**
+ * The calling task is done with its work and about to wait for more; it is
+ * not expected to beat until then
+ */
+void health_idle(health_task_t task);
+
+/**
+ * Check one latency sample against its stage's objective, if it has one.
+ * Called by telemetry_latency() for every sample (task context only).
+ */
+void health_latency(telemetry_stage_t stage, uint32_t us);
+
+/**
+ * Replace the objectives (us, 0 = off) and clear the statistics
+ */
+void health_set_slos(const uint32_t slo_us[HEALTH_SLO_COUNT]);
+
+/**
+ * Bitmask of the tasks flagged stuck right now (bit = health_task_t)
+ */
+uint32_t health_stalled_mask(void);
+
+void health_get_stats(health_stats_t *out);
+
+const char *health_task_name(health_task_t task);
+const char *health_slo_name(health_slo_t slo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HEALTH_H_ */
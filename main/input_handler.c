@@ -1,18 +1,27 @@
 /*
  * Input Handler Module Implementation
- * Uses GPIO interrupts + FreeRTOS queue for power-efficient input handling
+ * GPIO interrupts feed a single-producer / single-consumer ring: the ISR
+ * fills the slot at the head and publishes it with one atomic store, the
+ * input task drains from the tail. The task sleeps on its notification word
+ * and is only notified when the ring goes from empty to non-empty, so an
+ * edge arriving mid-burst costs the ISR no kernel call at all. A full ring
+ * drops the edge, counts it, and asks the task to resynchronize the lines
+ * from their pin levels once it has caught up.
  */
 
 #include <string.h>
 #include "input_handler.h"
+#include "telemetry.h"
+#include "mem_report.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "esp_sleep.h"
 #include "esp_system.h"  // for esp_restart()
+#include "telemetry_log.h"
+#include "health.h"
 
 static const char *TAG = "INPUT";
 
@@ -38,14 +47,44 @@ static const char *TAG = "INPUT";
                          (1ULL << GPIO_ENC1_A) | (1ULL << GPIO_ENC1_B) | (1ULL << GPIO_ENC1_SW) | \
                          (1ULL << GPIO_ENC2_A) | (1ULL << GPIO_ENC2_B) | (1ULL << GPIO_ENC2_SW))
 
-// Largest GPIO number used (for debounce table sizing)
-#define GPIO_MAX_USED   43
-
-// Event queue size (should handle burst of encoder events)
-#define EVENT_QUEUE_SIZE 32
-
-// Debounce time in microseconds
-#define DEBOUNCE_US 2000
+// Edges the ISR can buffer while the input task is busy
+#define ISR_RING_DEPTH      CONFIG_COSMO_INPUT_RING_DEPTH
+
+_Static_assert((ISR_RING_DEPTH & (ISR_RING_DEPTH - 1)) == 0, "input ring depth must be a power of two");
+
+#define INPUT_TASK_STACK    (3 * 1024)
+#define INPUT_TASK_PRIO     CONFIG_COSMO_PRIO_INPUT
+#define INPUT_TASK_CORE     CONFIG_COSMO_CORE_RT
+
+// Debounce profile per kind of contact (menuconfig → Cosmo Radio → Input debounce)
+#if CONFIG_COSMO_DEBOUNCE_BUTTON_NONE
+#define BUTTON_DEBOUNCE     INPUT_DEBOUNCE_NONE
+#elif CONFIG_COSMO_DEBOUNCE_BUTTON_INTEGRATOR
+#define BUTTON_DEBOUNCE     INPUT_DEBOUNCE_INTEGRATOR
+#else
+#define BUTTON_DEBOUNCE     INPUT_DEBOUNCE_WINDOW
+#endif
+
+#if CONFIG_COSMO_DEBOUNCE_SWITCH_NONE
+#define SWITCH_DEBOUNCE     INPUT_DEBOUNCE_NONE
+#elif CONFIG_COSMO_DEBOUNCE_SWITCH_WINDOW
+#define SWITCH_DEBOUNCE     INPUT_DEBOUNCE_WINDOW
+#else
+#define SWITCH_DEBOUNCE     INPUT_DEBOUNCE_INTEGRATOR
+#endif
+
+#if CONFIG_COSMO_DEBOUNCE_ENCODER_WINDOW
+#define ENCODER_DEBOUNCE    INPUT_DEBOUNCE_WINDOW
+#elif CONFIG_COSMO_DEBOUNCE_ENCODER_INTEGRATOR
+#define ENCODER_DEBOUNCE    INPUT_DEBOUNCE_INTEGRATOR
+#else
+#define ENCODER_DEBOUNCE    INPUT_DEBOUNCE_NONE
+#endif
+
+// Input task notification bits
+#define NOTIFY_EDGE         (1u << 0)   // ring went non-empty
+#define NOTIFY_SETTLE       (1u << 1)   // an integrator deadline passed
+#define NOTIFY_OVERFLOW     (1u << 2)   // the ISR dropped an edge
 
 // Long press duration for forced restart (15 seconds in microseconds)
 #define FORCE_RESTART_HOLD_US (15 * 1000000)
@@ -54,174 +93,411 @@ static const char *TAG = "INPUT";
 typedef struct {
     uint8_t gpio_num;
     uint8_t level;
-    int64_t timestamp;
+    int64_t timestamp;          // esp_timer time of the edge
 } gpio_isr_event_t;
 
-// Module state
-static QueueHandle_t s_gpio_evt_queue = NULL;
+// Per-line debounce state. Written by the input task only; stats are also
+// read and reset from other tasks under s_stats_lock.
+typedef struct {
+    uint8_t gpio;
+    input_debounce_t mode;
+    uint32_t time_us;
+    int64_t last_edge_us;       // previous raw edge
+    int64_t last_accept_us;     // window: last edge let through
+    uint32_t pending_edges;     // integrator: edges since the level last settled
+    input_edge_stats_t stats;
+} line_state_t;
+
+// Quadrature decoder for one encoder. Positions count CW from the detent:
+// 0 = 11 (detent), 1 = 10, 2 = 00 (halfway), 3 = 01.
+typedef struct {
+    input_line_t line_a;
+    input_line_t line_b;
+    input_event_type_t cw;
+    input_event_type_t ccw;
+    uint8_t pos;
+    int8_t last_dir;            // direction of the last emitted detent or arrival, 0 = none yet
+    bool emitted;               // this detent cycle already produced an event
+    bool passed_half;           // reached 00 since leaving the detent
+} encoder_t;
+
+// Module state. Task and ring live in module-owned storage, not the heap.
+// The ring is touched from the IRAM ISR, so it must stay in internal RAM.
+static DRAM_ATTR gpio_isr_event_t s_isr_ring[ISR_RING_DEPTH];
+static DRAM_ATTR uint32_t s_isr_head = 0;      // next slot to fill (ISR only)
+static DRAM_ATTR uint32_t s_isr_tail = 0;      // next slot to drain (input task only)
+static DRAM_ATTR bool s_isr_overflow = false;  // an edge was dropped since the last resync
+static StaticTask_t s_input_task_tcb;
+static StackType_t s_input_task_stack[INPUT_TASK_STACK];
+static bool s_initialized = false;
 static TaskHandle_t s_input_task = NULL;
+static esp_timer_handle_t s_settle_timer = NULL;
 static input_event_callback_t s_callback = NULL;
 static volatile int64_t s_last_activity_time = 0;
 static volatile bool s_running = false;
 
-// Encoder state tracking (for detent detection)
-static uint8_t s_enc1_state = 0;
-static uint8_t s_enc2_state = 0;
-static int s_btn_last = 1;          // Pull-up, 1 = released
-static int s_enc1_sw_last = 1;
-static int s_enc2_sw_last = 1;
+static line_state_t s_lines[INPUT_LINE_COUNT] = {
+    [INPUT_LINE_BUTTON]  = { .gpio = GPIO_BUTTON,  .mode = BUTTON_DEBOUNCE,  .time_us = CONFIG_COSMO_DEBOUNCE_BUTTON_US },
+    [INPUT_LINE_ENC1_A]  = { .gpio = GPIO_ENC1_A,  .mode = ENCODER_DEBOUNCE, .time_us = CONFIG_COSMO_DEBOUNCE_ENCODER_US },
+    [INPUT_LINE_ENC1_B]  = { .gpio = GPIO_ENC1_B,  .mode = ENCODER_DEBOUNCE, .time_us = CONFIG_COSMO_DEBOUNCE_ENCODER_US },
+    [INPUT_LINE_ENC1_SW] = { .gpio = GPIO_ENC1_SW, .mode = SWITCH_DEBOUNCE,  .time_us = CONFIG_COSMO_DEBOUNCE_SWITCH_US },
+    [INPUT_LINE_ENC2_A]  = { .gpio = GPIO_ENC2_A,  .mode = ENCODER_DEBOUNCE, .time_us = CONFIG_COSMO_DEBOUNCE_ENCODER_US },
+    [INPUT_LINE_ENC2_B]  = { .gpio = GPIO_ENC2_B,  .mode = ENCODER_DEBOUNCE, .time_us = CONFIG_COSMO_DEBOUNCE_ENCODER_US },
+    [INPUT_LINE_ENC2_SW] = { .gpio = GPIO_ENC2_SW, .mode = SWITCH_DEBOUNCE,  .time_us = CONFIG_COSMO_DEBOUNCE_SWITCH_US },
+};
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static encoder_t s_enc1 = { .line_a = INPUT_LINE_ENC1_A, .line_b = INPUT_LINE_ENC1_B,
+                            .cw = INPUT_EVENT_ENC1_CW, .ccw = INPUT_EVENT_ENC1_CCW };
+static encoder_t s_enc2 = { .line_a = INPUT_LINE_ENC2_A, .line_b = INPUT_LINE_ENC2_B,
+                            .cw = INPUT_EVENT_ENC2_CW, .ccw = INPUT_EVENT_ENC2_CCW };
+
+// Last accepted level of each line (pull-up, 1 = released / high)
+static uint8_t s_level[INPUT_LINE_COUNT] = { 1, 1, 1, 1, 1, 1, 1 };
 
 // Button press timestamp for force restart detection
 static int64_t s_btn_press_time = 0;
 
-// Last ISR time for each GPIO (for software debounce, indexed by gpio_num).
-// Sized to cover the largest GPIO number we attach an ISR to.
-static int64_t s_last_isr_time[GPIO_MAX_USED + 1] = {0};
-
-// ISR handler - minimal work, just queue the event
-// Note: Keep this as simple as possible to avoid watchdog issues
+// ISR handler - minimal work, just record the edge. The edge is stamped here
+// (esp_timer_get_time() is IRAM-resident and ISR-safe) so debouncing and the
+// edge statistics see the line's own timing, not the ring's.
+//
+// All pins share the one GPIO ISR, which never nests with itself, so this is
+// the ring's only producer.
 static void IRAM_ATTR gpio_isr_handler(void *arg)
 {
     uint32_t gpio_num = (uint32_t)arg;
+    uint32_t head = s_isr_head;
+    uint32_t notify = 0;
+
+    // Acquire pairs with the task's release of the tail: a slot is reused
+    // only after it has been copied out.
+    if (head - __atomic_load_n(&s_isr_tail, __ATOMIC_ACQUIRE) >= ISR_RING_DEPTH) {
+        telemetry_count(TELEM_INPUT_ISR_DROPPED);
+        if (!__atomic_load_n(&s_isr_overflow, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&s_isr_overflow, true, __ATOMIC_RELAXED);
+            notify = NOTIFY_OVERFLOW;
+        }
+    } else {
+        gpio_isr_event_t *evt = &s_isr_ring[head & (ISR_RING_DEPTH - 1)];
+        evt->gpio_num = gpio_num;
+        evt->level = gpio_get_level(gpio_num);
+        evt->timestamp = esp_timer_get_time();
+        // Publish, then look at the tail: together with the task storing the
+        // tail before it re-reads the head, either the task sees this entry
+        // or we see it caught up and wake it.
+        __atomic_store_n(&s_isr_head, head + 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&s_isr_tail, __ATOMIC_SEQ_CST) == head) {
+            notify = NOTIFY_EDGE;
+        }
+    }
 
-    // Don't call esp_timer_get_time() in ISR - can cause watchdog issues
-    // Debounce will be handled in the task instead
-    gpio_isr_event_t evt = {
-        .gpio_num = gpio_num,
-        .level = gpio_get_level(gpio_num),
-        .timestamp = 0  // Will be set in task
-    };
+    TaskHandle_t task = s_input_task;
+    if (notify != 0 && task != NULL) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        xTaskNotifyFromISR(task, notify, eSetBits, &xHigherPriorityTaskWoken);
+        if (xHigherPriorityTaskWoken) {
+            portYIELD_FROM_ISR();
+        }
+    }
+}
 
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    xQueueSendFromISR(s_gpio_evt_queue, &evt, &xHigherPriorityTaskWoken);
+// The integrator's deadline passed: wake the input task so settling is
+// handled there like any edge. Not routed through the ring, which has the
+// ISR as its only producer.
+static void settle_timer_cb(void *arg)
+{
+    TaskHandle_t task = s_input_task;
+    if (task != NULL) {
+        xTaskNotify(task, NOTIFY_SETTLE, eSetBits);
+    }
+}
 
-    if (xHigherPriorityTaskWoken) {
-        portYIELD_FROM_ISR();
+static int line_of_gpio(uint8_t gpio)
+{
+    for (int i = 0; i < INPUT_LINE_COUNT; i++) {
+        if (s_lines[i].gpio == gpio) return i;
     }
+    return -1;
 }
 
-// Process encoder state change, return direction
-// Only triggers at detent position (state 11 -> next state)
-static input_event_type_t process_encoder(uint8_t new_clk, uint8_t new_dt,
-                                          uint8_t *state, bool is_enc1)
+static unsigned edge_bucket(uint32_t us)
 {
-    uint8_t new_state = (new_clk << 1) | new_dt;
+    unsigned k = 0;
+    for (uint32_t limit = 32; k < INPUT_EDGE_BUCKETS - 1 && us >= limit; limit <<= 1) {
+        k++;
+    }
+    return k;
+}
+
+static void record_edge(line_state_t *l, int64_t t)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    l->stats.edges++;
+    if (l->last_edge_us != 0 && t >= l->last_edge_us) {
+        int64_t d = t - l->last_edge_us;
+        uint32_t us = d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
+        if (l->stats.min_us == 0 || us < l->stats.min_us) l->stats.min_us = us;
+        l->stats.buckets[edge_bucket(us)]++;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    l->last_edge_us = t;
+}
+
+static void record_rejected(line_state_t *l, uint32_t n)
+{
+    if (n == 0) return;
+    portENTER_CRITICAL(&s_stats_lock);
+    l->stats.rejected += n;
+    portEXIT_CRITICAL(&s_stats_lock);
+    for (uint32_t i = 0; i < n; i++) {
+        telemetry_count(TELEM_INPUT_DEBOUNCED);
+    }
+}
 
-    if (new_state == *state) {
+// Advance a quadrature decoder to the A/B levels given. One detent is
+// emitted per cycle: on leaving the detent when continuing in the direction
+// of the last movement (no added latency on a spin, nor on the first turn
+// after boot), otherwise only at the halfway point, so chatter on the line
+// that just settled at the detent never looks like a reversal. Steps
+// skipping a state are taken as is.
+static input_event_type_t encoder_step(encoder_t *enc, uint8_t a, uint8_t b)
+{
+    static const uint8_t POS_OF_STATE[4] = { [0b11] = 0, [0b10] = 1, [0b00] = 2, [0b01] = 3 };
+    uint8_t pos = POS_OF_STATE[(a << 1) | b];
+    uint8_t diff = (pos - enc->pos) & 3;
+    if (diff == 0) {
         return INPUT_EVENT_NONE;
     }
 
+    int8_t dir = diff == 1 ? 1 : diff == 3 ? -1 : 0;
     input_event_type_t result = INPUT_EVENT_NONE;
+    bool emit = false;
 
-    // Trigger on leaving detent (state 11)
-    if (*state == 0b11) {
-        if (new_state == 0b10) {
-            result = is_enc1 ? INPUT_EVENT_ENC1_CW : INPUT_EVENT_ENC2_CW;
-        } else if (new_state == 0b01) {
-            result = is_enc1 ? INPUT_EVENT_ENC1_CCW : INPUT_EVENT_ENC2_CCW;
-        }
+    if (enc->pos == 0 && dir != 0 && !enc->emitted && (enc->last_dir == 0 || dir == enc->last_dir)) {
+        emit = true;
+    }
+    if (pos == 2) {
+        enc->passed_half = true;
+        if (!enc->emitted && dir != 0) emit = true;
+    }
+    if (emit) {
+        result = dir > 0 ? enc->cw : enc->ccw;
+        enc->emitted = true;
+        enc->last_dir = dir;
+    }
+    if (pos == 0 && enc->passed_half) {
+        // Back at a detent after a full cycle: the next one may emit again.
+        enc->emitted = false;
+        enc->passed_half = false;
+        if (dir != 0) enc->last_dir = dir;
     }
 
-    *state = new_state;
+    enc->pos = pos;
     return result;
 }
 
+static void encoder_sync(encoder_t *enc)
+{
+    uint8_t a = gpio_get_level(s_lines[enc->line_a].gpio);
+    uint8_t b = gpio_get_level(s_lines[enc->line_b].gpio);
+    s_level[enc->line_a] = a;
+    s_level[enc->line_b] = b;
+    enc->pos = (a && b) ? 0 : (a ? 1 : b ? 3 : 2);
+    enc->emitted = enc->pos != 0;
+    enc->passed_half = false;
+}
+
+static input_event_type_t switch_step(input_line_t line, uint8_t level,
+                                      input_event_type_t press, input_event_type_t release)
+{
+    if (level == s_level[line]) {
+        return INPUT_EVENT_NONE;
+    }
+    s_level[line] = level;
+    return level == 0 ? press : release;
+}
+
+// Feed one accepted level for a line into the state machines. Returns the
+// event it produced, if any.
+static input_event_type_t process_line(input_line_t line, uint8_t level)
+{
+    switch (line) {
+    case INPUT_LINE_BUTTON: {
+        input_event_type_t type = switch_step(line, level, INPUT_EVENT_BUTTON_PRESS,
+                                              INPUT_EVENT_BUTTON_RELEASE);
+        if (type == INPUT_EVENT_BUTTON_PRESS) {
+            s_btn_press_time = esp_timer_get_time();
+        } else if (type == INPUT_EVENT_BUTTON_RELEASE) {
+            s_btn_press_time = 0;
+        }
+        return type;
+    }
+    case INPUT_LINE_ENC1_SW:
+        return switch_step(line, level, INPUT_EVENT_ENC1_SW_PRESS, INPUT_EVENT_ENC1_SW_RELEASE);
+    case INPUT_LINE_ENC2_SW:
+        return switch_step(line, level, INPUT_EVENT_ENC2_SW_PRESS, INPUT_EVENT_ENC2_SW_RELEASE);
+    case INPUT_LINE_ENC1_A:
+    case INPUT_LINE_ENC1_B:
+    case INPUT_LINE_ENC2_A:
+    case INPUT_LINE_ENC2_B: {
+        encoder_t *enc = (line == INPUT_LINE_ENC1_A || line == INPUT_LINE_ENC1_B) ? &s_enc1 : &s_enc2;
+        s_level[line] = level;
+        if (s_lines[line].mode != INPUT_DEBOUNCE_NONE) {
+            // Filtered edges on the other line were never fed in; read it.
+            input_line_t other = line == enc->line_a ? enc->line_b : enc->line_a;
+            s_level[other] = gpio_get_level(s_lines[other].gpio);
+        }
+        return encoder_step(enc, s_level[enc->line_a], s_level[enc->line_b]);
+    }
+    default:
+        return INPUT_EVENT_NONE;
+    }
+}
+
+static void dispatch(input_event_type_t type)
+{
+    if (type == INPUT_EVENT_NONE) {
+        return;
+    }
+    input_event_t input_evt = {
+        .type = type,
+        .timestamp = xTaskGetTickCount(),
+        .time_us = esp_timer_get_time(),
+    };
+    telemetry_count(TELEM_INPUT_EVENT_BASE + type - 1);
+    if (s_callback != NULL) {
+        s_callback(&input_evt);
+    }
+}
+
+// Integrator lines whose level has been stable long enough are processed
+// now; the settle timer is re-armed for the earliest one still waiting.
+static void settle_lines(int64_t now)
+{
+    int64_t next = INT64_MAX;
+    for (int i = 0; i < INPUT_LINE_COUNT; i++) {
+        line_state_t *l = &s_lines[i];
+        if (l->mode != INPUT_DEBOUNCE_INTEGRATOR || l->pending_edges == 0) {
+            continue;
+        }
+        int64_t due = l->last_edge_us + l->time_us;
+        if (now < due) {
+            if (due < next) next = due;
+            continue;
+        }
+        input_event_type_t type = process_line(i, gpio_get_level(l->gpio));
+        record_rejected(l, l->pending_edges - (type != INPUT_EVENT_NONE ? 1 : 0));
+        l->pending_edges = 0;
+        dispatch(type);
+    }
+
+    esp_timer_stop(s_settle_timer);
+    if (next != INT64_MAX) {
+        esp_timer_start_once(s_settle_timer, next > now ? (uint64_t)(next - now) : 1);
+    }
+}
+
+static void on_edge(input_line_t line, const gpio_isr_event_t *evt)
+{
+    line_state_t *l = &s_lines[line];
+    int64_t t = evt->timestamp;
+    record_edge(l, t);
+
+    switch (l->mode) {
+    case INPUT_DEBOUNCE_NONE:
+        // The level sampled in the ISR, so the decoder sees every step in order.
+        dispatch(process_line(line, evt->level));
+        break;
+    case INPUT_DEBOUNCE_WINDOW:
+        if (l->last_accept_us != 0 && t - l->last_accept_us < l->time_us) {
+            record_rejected(l, 1);
+            break;
+        }
+        l->last_accept_us = t;
+        dispatch(process_line(line, gpio_get_level(l->gpio)));
+        break;
+    case INPUT_DEBOUNCE_INTEGRATOR:
+        l->pending_edges++;
+        settle_lines(esp_timer_get_time());
+        break;
+    }
+}
+
+// Process everything the ISR has published so far.
+static void drain_ring(void)
+{
+    uint32_t tail = s_isr_tail;
+    for (;;) {
+        // Pairs with the ISR's store of the head (see gpio_isr_handler).
+        uint32_t head = __atomic_load_n(&s_isr_head, __ATOMIC_SEQ_CST);
+        if (head == tail) {
+            return;
+        }
+        telemetry_max(TELEM_INPUT_QUEUE_HWM, head - tail);
+        while (tail != head) {
+            gpio_isr_event_t evt = s_isr_ring[tail & (ISR_RING_DEPTH - 1)];
+            __atomic_store_n(&s_isr_tail, ++tail, __ATOMIC_SEQ_CST);
+            health_beat(HEALTH_TASK_INPUT);     // a storm can keep us here for a while
+            int line = line_of_gpio(evt.gpio_num);
+            if (line >= 0) {
+                s_last_activity_time = evt.timestamp;
+                on_edge(line, &evt);
+            }
+        }
+    }
+}
+
+// Edges were lost to a full ring: take every line from its pin level. The
+// encoders restart at their current position; a switch whose press or
+// release went missing gets the event now, so no key is left stuck.
+static void resync_lines(void)
+{
+    __atomic_store_n(&s_isr_overflow, false, __ATOMIC_RELAXED);
+    telemetry_count(TELEM_INPUT_RESYNCS);
+    encoder_sync(&s_enc1);
+    encoder_sync(&s_enc2);
+    static const input_line_t SWITCHES[] = { INPUT_LINE_BUTTON, INPUT_LINE_ENC1_SW, INPUT_LINE_ENC2_SW };
+    for (size_t i = 0; i < sizeof(SWITCHES) / sizeof(SWITCHES[0]); i++) {
+        line_state_t *l = &s_lines[SWITCHES[i]];
+        if (l->mode == INPUT_DEBOUNCE_INTEGRATOR && l->pending_edges != 0) {
+            continue;       // the settle timer will read the pin anyway
+        }
+        dispatch(process_line(SWITCHES[i], gpio_get_level(l->gpio)));
+    }
+}
+
 // Input processing task
 static void input_handler_task(void *arg)
 {
-    gpio_isr_event_t evt;
-    input_event_t input_evt;
-
     ESP_LOGI(TAG, "Input task started");
 
-    // Initialize encoder states
-    s_enc1_state = (gpio_get_level(GPIO_ENC1_A) << 1) | gpio_get_level(GPIO_ENC1_B);
-    s_enc2_state = (gpio_get_level(GPIO_ENC2_A) << 1) | gpio_get_level(GPIO_ENC2_B);
-    s_btn_last = gpio_get_level(GPIO_BUTTON);
-    s_enc1_sw_last = gpio_get_level(GPIO_ENC1_SW);
-    s_enc2_sw_last = gpio_get_level(GPIO_ENC2_SW);
+    // Initialize line states
+    encoder_sync(&s_enc1);
+    encoder_sync(&s_enc2);
+    s_level[INPUT_LINE_BUTTON] = gpio_get_level(GPIO_BUTTON);
+    s_level[INPUT_LINE_ENC1_SW] = gpio_get_level(GPIO_ENC1_SW);
+    s_level[INPUT_LINE_ENC2_SW] = gpio_get_level(GPIO_ENC2_SW);
 
     s_running = true;
     s_last_activity_time = esp_timer_get_time();
 
-    while (s_running) {
-        // Wait for GPIO events with timeout (allows periodic wakeup for housekeeping)
-        if (xQueueReceive(s_gpio_evt_queue, &evt, pdMS_TO_TICKS(100))) {
-            int64_t now = esp_timer_get_time();
-
-            // Software debounce: ignore if too soon after last event on this pin
-            if ((now - s_last_isr_time[evt.gpio_num]) < DEBOUNCE_US) {
-                continue;  // Skip this event
-            }
-            s_last_isr_time[evt.gpio_num] = now;
-
-            input_evt.type = INPUT_EVENT_NONE;
-            input_evt.timestamp = xTaskGetTickCount();
-
-            // Update last activity time
-            s_last_activity_time = now;
-
-            // Process based on which GPIO triggered
-            if (evt.gpio_num == GPIO_BUTTON) {
-                int btn_level = gpio_get_level(GPIO_BUTTON);
-                if (btn_level == 0 && s_btn_last == 1) {
-                    s_btn_press_time = esp_timer_get_time();
-                    input_evt.type = INPUT_EVENT_BUTTON_PRESS;
-                    ESP_LOGD(TAG, "Button pressed");
-                } else if (btn_level == 1 && s_btn_last == 0) {
-                    s_btn_press_time = 0;
-                    input_evt.type = INPUT_EVENT_BUTTON_RELEASE;
-                    ESP_LOGD(TAG, "Button released");
-                }
-                s_btn_last = btn_level;
-            }
-            else if (evt.gpio_num == GPIO_ENC1_A || evt.gpio_num == GPIO_ENC1_B) {
-                uint8_t a = gpio_get_level(GPIO_ENC1_A);
-                uint8_t b = gpio_get_level(GPIO_ENC1_B);
-                input_evt.type = process_encoder(a, b, &s_enc1_state, true);
-                if (input_evt.type == INPUT_EVENT_ENC1_CW) {
-                    ESP_LOGD(TAG, "ENC1 CW");
-                } else if (input_evt.type == INPUT_EVENT_ENC1_CCW) {
-                    ESP_LOGD(TAG, "ENC1 CCW");
-                }
-            }
-            else if (evt.gpio_num == GPIO_ENC1_SW) {
-                int sw_level = gpio_get_level(GPIO_ENC1_SW);
-                if (sw_level == 0 && s_enc1_sw_last == 1) {
-                    input_evt.type = INPUT_EVENT_ENC1_SW_PRESS;
-                    ESP_LOGD(TAG, "ENC1 SW pressed");
-                } else if (sw_level == 1 && s_enc1_sw_last == 0) {
-                    input_evt.type = INPUT_EVENT_ENC1_SW_RELEASE;
-                    ESP_LOGD(TAG, "ENC1 SW released");
-                }
-                s_enc1_sw_last = sw_level;
-            }
-            else if (evt.gpio_num == GPIO_ENC2_A || evt.gpio_num == GPIO_ENC2_B) {
-                uint8_t a = gpio_get_level(GPIO_ENC2_A);
-                uint8_t b = gpio_get_level(GPIO_ENC2_B);
-                input_evt.type = process_encoder(a, b, &s_enc2_state, false);
-                if (input_evt.type == INPUT_EVENT_ENC2_CW) {
-                    ESP_LOGD(TAG, "ENC2 CW");
-                } else if (input_evt.type == INPUT_EVENT_ENC2_CCW) {
-                    ESP_LOGD(TAG, "ENC2 CCW");
-                }
-            }
-            else if (evt.gpio_num == GPIO_ENC2_SW) {
-                int sw_level = gpio_get_level(GPIO_ENC2_SW);
-                if (sw_level == 0 && s_enc2_sw_last == 1) {
-                    input_evt.type = INPUT_EVENT_ENC2_SW_PRESS;
-                    ESP_LOGD(TAG, "ENC2 SW pressed");
-                } else if (sw_level == 1 && s_enc2_sw_last == 0) {
-                    input_evt.type = INPUT_EVENT_ENC2_SW_RELEASE;
-                    ESP_LOGD(TAG, "ENC2 SW released");
-                }
-                s_enc2_sw_last = sw_level;
-            }
+    // Edges from before the handle was published were never notified.
+    s_input_task = xTaskGetCurrentTaskHandle();
+    drain_ring();
 
-            // Dispatch event if valid
-            if (input_evt.type != INPUT_EVENT_NONE && s_callback != NULL) {
-                s_callback(&input_evt);
-            }
+    while (s_running) {
+        // The timeout is a periodic wake-up for the force-restart check.
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(100));
+        health_beat(HEALTH_TASK_INPUT);
+
+        drain_ring();
+        if (__atomic_load_n(&s_isr_overflow, __ATOMIC_RELAXED)) {
+            resync_lines();
+        }
+        if (bits & NOTIFY_SETTLE) {
+            settle_lines(esp_timer_get_time());
         }
 
         // Check for force restart: button held for 15 seconds
@@ -232,26 +508,31 @@ static void input_handler_task(void *arg)
                 ESP_LOGW(TAG, "Button held for 15 seconds - forcing restart!");
                 // Small delay to ensure log is flushed
                 vTaskDelay(pdMS_TO_TICKS(100));
+                tlog_set_restart_cause(TLOG_CAUSE_FORCED_RESTART);
                 esp_restart();
             }
         }
     }
 
+    health_idle(HEALTH_TASK_INPUT);
     ESP_LOGI(TAG, "Input task stopped");
+    s_input_task = NULL;        // no more notifications to this TCB
     vTaskDelete(NULL);
 }
 
 esp_err_t input_handler_init(void)
 {
-    if (s_gpio_evt_queue != NULL) {
+    if (s_initialized) {
         ESP_LOGW(TAG, "Already initialized");
         return ESP_OK;
     }
+    s_initialized = true;
+    mem_report_add_static(MEM_MOD_INPUT, sizeof(s_isr_ring) + sizeof(s_input_task_tcb)
+                                       + sizeof(s_input_task_stack) + sizeof(s_lines));
 
-    // Create event queue
-    s_gpio_evt_queue = xQueueCreate(EVENT_QUEUE_SIZE, sizeof(gpio_isr_event_t));
-    if (s_gpio_evt_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to create event queue");
+    const esp_timer_create_args_t settle_args = { .callback = settle_timer_cb, .name = "input_settle" };
+    if (esp_timer_create(&settle_args, &s_settle_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create settle timer");
         return ESP_ERR_NO_MEM;
     }
 
@@ -297,6 +578,12 @@ esp_err_t input_handler_init(void)
              GPIO_ENC1_A, GPIO_ENC1_B, GPIO_ENC1_SW);
     ESP_LOGI(TAG, "  ENC2 (right): A=GPIO%d B=GPIO%d SW=GPIO%d",
              GPIO_ENC2_A, GPIO_ENC2_B, GPIO_ENC2_SW);
+    static const char *const MODE_NAMES[] = { "none", "window", "integrator" };
+    ESP_LOGI(TAG, "  Debounce: button %s %lu us, switches %s %lu us, encoders %s %lu us",
+             MODE_NAMES[BUTTON_DEBOUNCE], (unsigned long)CONFIG_COSMO_DEBOUNCE_BUTTON_US,
+             MODE_NAMES[SWITCH_DEBOUNCE], (unsigned long)CONFIG_COSMO_DEBOUNCE_SWITCH_US,
+             MODE_NAMES[ENCODER_DEBOUNCE], (unsigned long)CONFIG_COSMO_DEBOUNCE_ENCODER_US);
+    ESP_LOGI(TAG, "  ISR ring: %d edges", ISR_RING_DEPTH);
 
     return ESP_OK;
 }
@@ -313,8 +600,12 @@ void input_handler_start(void)
         return;
     }
 
-    xTaskCreate(input_handler_task, "input_handler", 3 * 1024, NULL,
-                configMAX_PRIORITIES - 3, &s_input_task);
+    // A stopped task has deleted itself well before a restart reuses its
+    // stack (input_handler_stop() waits for it).
+    s_input_task = xTaskCreateStaticPinnedToCore(input_handler_task, "input_handler", INPUT_TASK_STACK,
+                                                 NULL, INPUT_TASK_PRIO, s_input_task_stack,
+                                                 &s_input_task_tcb, INPUT_TASK_CORE);
+    mem_report_add_task(MEM_TASK_INPUT, s_input_task, INPUT_TASK_STACK);
 }
 
 void input_handler_stop(void)
@@ -347,3 +638,24 @@ void input_handler_reset_idle_timer(void)
 {
     s_last_activity_time = esp_timer_get_time();
 }
+
+void input_handler_read_edge_stats(input_line_t line, input_edge_stats_t *out)
+{
+    if (line >= INPUT_LINE_COUNT) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    portENTER_CRITICAL(&s_stats_lock);
+    *out = s_lines[line].stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+    out->profile = (uint32_t)s_lines[line].mode << 24 | (s_lines[line].time_us & 0xFFFFFF);
+}
+
+void input_handler_reset_edge_stats(void)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    for (int i = 0; i < INPUT_LINE_COUNT; i++) {
+        memset(&s_lines[i].stats, 0, sizeof(s_lines[i].stats));
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+}
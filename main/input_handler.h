@@ -34,11 +34,44 @@ typedef enum {
 typedef struct {
     input_event_type_t type;
     uint32_t timestamp;         // Tick count when event occurred
+    int64_t time_us;            // esp_timer time the edge was processed
 } input_event_t;
 
 // Callback function type for input events
 typedef void (*input_event_callback_t)(const input_event_t *event);
 
+// Physical input lines. The order is the wire layout of the edge reports,
+// so only ever append.
+typedef enum {
+    INPUT_LINE_BUTTON = 0,
+    INPUT_LINE_ENC1_A,
+    INPUT_LINE_ENC1_B,
+    INPUT_LINE_ENC1_SW,
+    INPUT_LINE_ENC2_A,
+    INPUT_LINE_ENC2_B,
+    INPUT_LINE_ENC2_SW,
+    INPUT_LINE_COUNT
+} input_line_t;
+
+// How a line's edges are filtered before they become events
+typedef enum {
+    INPUT_DEBOUNCE_NONE = 0,        // every edge (encoder lines: the decoder validates)
+    INPUT_DEBOUNCE_WINDOW,          // act on the first edge, ignore the next N us
+    INPUT_DEBOUNCE_INTEGRATOR,      // act once the level has been stable for N us
+} input_debounce_t;
+
+// Bucket k counts edge intervals below (32 us << k); the last bucket is open-ended.
+#define INPUT_EDGE_BUCKETS  11
+
+// Per-line edge statistics, timed at the interrupt
+typedef struct {
+    uint32_t edges;                 // raw edges seen
+    uint32_t rejected;              // edges the debounce profile did not turn into a transition
+    uint32_t min_us;                // shortest interval between two edges, 0 = none yet
+    uint32_t profile;               // input_debounce_t << 24 | its time in us
+    uint32_t buckets[INPUT_EDGE_BUCKETS];
+} input_edge_stats_t;
+
 /**
  * Initialize the input handler
  * Sets up GPIO interrupts and event queue
@@ -85,6 +118,16 @@ uint32_t input_handler_get_idle_time_ms(void);
  */
 void input_handler_reset_idle_timer(void);
 
+/**
+ * Copy one line's edge statistics (any task)
+ */
+void input_handler_read_edge_stats(input_line_t line, input_edge_stats_t *out);
+
+/**
+ * Zero the edge statistics of every line; profiles are kept
+ */
+void input_handler_reset_edge_stats(void);
+
 #ifdef __cplusplus
 }
 #endif
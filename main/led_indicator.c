@@ -1,23 +1,320 @@
 /*
  * LED Indicator Module Implementation
  * Uses ESP-IDF led_strip component for WS2812 control
+ *
+ * A single LED task owns the strip. It sleeps on its command queue, waking
+ * early only when a visible pattern needs a new frame or a layer's duration
+ * runs out. Each frame is composed into a local RGB buffer through a
+ * precomputed gamma + brightness table; frames identical to what the strip
+ * already shows are not sent, so a solid colour costs exactly one transfer.
  */
 
+#include <string.h>
+#include <math.h>
 #include "led_indicator.h"
 #include "led_strip.h"
+#include "telemetry.h"
+#include "mem_report.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "sdkconfig.h"
 
 static const char *TAG = "LED";
 
-// V4: onboard WS2812 RGB LED on ESP32-S3-DevKitC-1 (GPIO48).
+// V4: onboard WS2812 RGB LED on ESP32-S3-DevKitC-1 (GPIO48) by default.
 // No external LED in V4 — see CLAUDE.md GPIO Pin Assignments.
-#define LED_GPIO    48
+#define LED_GPIO    CONFIG_COSMO_LED_GPIO
 
-// Number of LEDs in strip (single LED)
-#define LED_COUNT   1
+// Number of LEDs in strip (1 = onboard LED; dial rings chain more)
+#define LED_COUNT   CONFIG_COSMO_LED_COUNT
+
+// Frame interval for FADE / PULSE animation (50 fps)
+#define LED_FRAME_MS        20
+#define LED_BENCH_FPS       60
+
+#define LED_QUEUE_SIZE      16
+#define LED_TASK_STACK      (3 * 1024)
+#define LED_TASK_PRIO       CONFIG_COSMO_PRIO_LED
+#define LED_TASK_CORE       CONFIG_COSMO_CORE_BG
+
+// RMT symbol memory: with DMA this is the DMA buffer (bigger = fewer
+// refills); without DMA it is the on-chip ping-pong block.
+#if CONFIG_COSMO_LED_RMT_DMA
+#define LED_RMT_DMA         true
+#define LED_RMT_MEM_SYMBOLS 1024
+#else
+#define LED_RMT_DMA         false
+#define LED_RMT_MEM_SYMBOLS 64
+#endif
+
+typedef enum {
+    LED_CMD_PLAY = 0,
+    LED_CMD_CLEAR,
+    LED_CMD_BRIGHTNESS,     // pattern.red carries the new brightness
+    LED_CMD_BENCH,          // pattern.period_ms carries the duration in seconds
+} led_cmd_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint8_t layer;
+    led_pattern_t pattern;
+} led_cmd_t;
+
+typedef struct {
+    bool active;
+    led_pattern_t pattern;
+    int64_t start_us;
+} led_layer_state_t;
 
 // LED strip handle
 static led_strip_handle_t s_led_strip = NULL;
+static QueueHandle_t s_cmd_queue = NULL;
+static TaskHandle_t s_led_task = NULL;
+static StaticQueue_t s_cmd_queue_buf;
+static uint8_t s_cmd_queue_storage[LED_QUEUE_SIZE * sizeof(led_cmd_t)];
+static StaticTask_t s_led_task_tcb;
+static StackType_t s_led_task_stack[LED_TASK_STACK];
+static volatile uint32_t s_dropped = 0;
+
+// Owned by the LED task.
+static led_layer_state_t s_layers[LED_LAYER_COUNT];
+static uint8_t s_lut[256];                      // gamma + global brightness
+static uint8_t s_frame[LED_COUNT * 3];          // composed, LUT-applied RGB
+static uint8_t s_shown[LED_COUNT * 3];          // what the strip displays
+static bool s_shown_valid = false;
+
+static led_frame_stats_t s_stats = {0};
+static uint64_t s_build_us_sum = 0;
+static uint64_t s_refresh_us_sum = 0;
+
+static void build_lut(uint8_t brightness)
+{
+    for (int i = 0; i < 256; i++) {
+#if CONFIG_COSMO_LED_GAMMA
+        float v = powf(i / 255.0f, 2.2f) * 255.0f;
+#else
+        float v = (float)i;
+#endif
+        s_lut[i] = (uint8_t)(v * brightness / 255.0f + 0.5f);
+    }
+}
+
+static uint8_t scale(uint8_t c, uint32_t k256)
+{
+    return (uint8_t)((c * k256) >> 8);
+}
+
+// Colour of `st` at time now_us; *next_us is lowered to when it next changes.
+static uint32_t render_layer(const led_layer_state_t *st, int64_t now_us, int64_t *next_us)
+{
+    const led_pattern_t *p = &st->pattern;
+    int64_t t_ms = (now_us - st->start_us) / 1000;
+    uint32_t period = p->period_ms ? p->period_ms : 1;
+    uint32_t k256 = 256;
+    int64_t next = INT64_MAX;
+
+    switch (p->type) {
+    case LED_PATTERN_SOLID:
+        break;
+    case LED_PATTERN_BLINK: {
+        uint32_t half = period / 2 ? period / 2 : 1;
+        int64_t phase = t_ms / half;
+        k256 = (phase & 1) ? 0 : 256;
+        next = st->start_us + (phase + 1) * half * 1000;
+        break;
+    }
+    case LED_PATTERN_FADE:
+        if (t_ms < (int64_t)period) {
+            k256 = (uint32_t)(t_ms * 256 / period);
+            next = now_us + LED_FRAME_MS * 1000;
+        }
+        break;
+    case LED_PATTERN_PULSE: {
+        uint32_t phase = (uint32_t)(t_ms % period);
+        uint32_t half = period / 2 ? period / 2 : 1;
+        k256 = phase < half ? phase * 256 / half : (period - phase) * 256 / half;
+        next = now_us + LED_FRAME_MS * 1000;
+        break;
+    }
+    }
+
+    if (next < *next_us) *next_us = next;
+    return ((uint32_t)scale(p->red, k256) << 16) | ((uint32_t)scale(p->green, k256) << 8)
+         | scale(p->blue, k256);
+}
+
+static void paint(const led_pattern_t *p, uint32_t rgb)
+{
+    uint32_t first = p->first < LED_COUNT ? p->first : LED_COUNT;
+    uint32_t count = p->count ? p->count : LED_COUNT - first;
+    if (count > LED_COUNT - first) count = LED_COUNT - first;
+
+    uint8_t r = s_lut[(rgb >> 16) & 0xFF], g = s_lut[(rgb >> 8) & 0xFF], b = s_lut[rgb & 0xFF];
+    for (uint8_t *px = &s_frame[first * 3], *end = px + count * 3; px < end; px += 3) {
+        px[0] = r;
+        px[1] = g;
+        px[2] = b;
+    }
+}
+
+// Send s_frame to the strip if it differs from what is shown. `t0_us` is
+// when frame building started, for the build-time counter.
+static void present(int64_t t0_us)
+{
+    s_stats.frames++;
+    bool changed = !s_shown_valid || memcmp(s_frame, s_shown, sizeof(s_frame)) != 0;
+    if (changed) {
+        for (uint32_t i = 0; i < LED_COUNT; i++) {
+            led_strip_set_pixel(s_led_strip, i, s_frame[i * 3], s_frame[i * 3 + 1], s_frame[i * 3 + 2]);
+        }
+    }
+
+    int64_t t1_us = esp_timer_get_time();
+    uint32_t build_us = (uint32_t)(t1_us - t0_us);
+    s_build_us_sum += build_us;
+    if (build_us > s_stats.build_us_max) s_stats.build_us_max = build_us;
+    s_stats.build_us_avg = (uint32_t)(s_build_us_sum / s_stats.frames);
+    if (!changed) return;
+
+    led_strip_refresh(s_led_strip);
+    memcpy(s_shown, s_frame, sizeof(s_frame));
+    s_shown_valid = true;
+
+    uint32_t refresh_us = (uint32_t)(esp_timer_get_time() - t1_us);
+    s_stats.refreshes++;
+    s_refresh_us_sum += refresh_us;
+    if (refresh_us > s_stats.refresh_us_max) s_stats.refresh_us_max = refresh_us;
+    s_stats.refresh_us_avg = (uint32_t)(s_refresh_us_sum / s_stats.refreshes);
+}
+
+// Expire finished layers, compose visible ones bottom-up, return when to wake.
+static TickType_t render(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_us = INT64_MAX;
+
+    memset(s_frame, 0, sizeof(s_frame));
+    for (int i = 0; i < LED_LAYER_COUNT; i++) {
+        led_layer_state_t *st = &s_layers[i];
+        if (!st->active) continue;
+
+        if (st->pattern.duration_ms) {
+            int64_t end_us = st->start_us + (int64_t)st->pattern.duration_ms * 1000;
+            if (now_us >= end_us) {
+                st->active = false;
+                continue;
+            }
+            if (end_us < next_us) next_us = end_us;
+        }
+        paint(&st->pattern, render_layer(st, now_us, &next_us));
+    }
+    present(now_us);
+
+    if (next_us == INT64_MAX) return portMAX_DELAY;
+    int64_t wait_ms = (next_us - esp_timer_get_time() + 999) / 1000;
+    return pdMS_TO_TICKS(wait_ms > 0 ? wait_ms : 1);
+}
+
+static void bench_tick(void *arg)
+{
+    xTaskNotifyGive((TaskHandle_t)arg);
+}
+
+// Animate every pixel (moving gradient, so every frame differs) at 60 fps,
+// paced by an esp_timer rather than the 100 Hz tick.
+static void run_benchmark(uint32_t seconds)
+{
+    esp_timer_handle_t timer;
+    esp_timer_create_args_t args = { .callback = bench_tick, .arg = s_led_task, .name = "led_bench" };
+    if (esp_timer_create(&args, &timer) != ESP_OK) return;
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_build_us_sum = s_refresh_us_sum = 0;
+
+    uint32_t frames = seconds * LED_BENCH_FPS;
+    int64_t start_us = esp_timer_get_time();
+    esp_timer_start_periodic(timer, 1000000 / LED_BENCH_FPS);
+    for (uint32_t f = 0; f < frames; f++) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t t0_us = esp_timer_get_time();
+        for (uint32_t i = 0; i < LED_COUNT; i++) {
+            uint8_t v = (uint8_t)(i * 7 + f * 3);
+            s_frame[i * 3] = s_lut[v];
+            s_frame[i * 3 + 1] = s_lut[(uint8_t)(v + 85)];
+            s_frame[i * 3 + 2] = s_lut[(uint8_t)(v + 170)];
+        }
+        present(t0_us);
+    }
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+
+    // Share of wall time spent in the whole present() path: frame build plus
+    // led_strip_refresh(), which also waits for the RMT transfer to finish.
+    // The build share alone is the part that is certainly CPU.
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    uint32_t build_permille = (uint32_t)(s_build_us_sum * 1000 / (uint64_t)elapsed_us);
+    uint32_t busy_permille = (uint32_t)((s_build_us_sum + s_refresh_us_sum) * 1000 / (uint64_t)elapsed_us);
+    ESP_LOGI(TAG, "Bench %u px @ %d fps (%s): %lu frames in %lld ms, build avg %lu / max %lu us, "
+             "refresh avg %lu / max %lu us, present path %lu.%lu%% of wall time (build %lu.%lu%%)",
+             LED_COUNT, LED_BENCH_FPS, LED_RMT_DMA ? "DMA" : "no DMA",
+             (unsigned long)s_stats.frames, (long long)(elapsed_us / 1000),
+             (unsigned long)s_stats.build_us_avg, (unsigned long)s_stats.build_us_max,
+             (unsigned long)s_stats.refresh_us_avg, (unsigned long)s_stats.refresh_us_max,
+             (unsigned long)(busy_permille / 10), (unsigned long)(busy_permille % 10),
+             (unsigned long)(build_permille / 10), (unsigned long)(build_permille % 10));
+    s_shown_valid = false;   // repaint the layers on the next render
+}
+
+static void led_task(void *arg)
+{
+    led_cmd_t cmd;
+    TickType_t wait = portMAX_DELAY;
+
+#if CONFIG_COSMO_LED_BENCH_AT_BOOT
+    run_benchmark(5);
+#endif
+
+    for (;;) {
+        if (xQueueReceive(s_cmd_queue, &cmd, wait) == pdTRUE) {
+            // Drain everything already queued before drawing: a burst of
+            // commands from a fast knob spin collapses into one frame.
+            do {
+                led_layer_state_t *st = &s_layers[cmd.layer];
+                switch (cmd.op) {
+                case LED_CMD_PLAY:
+                    st->pattern = cmd.pattern;
+                    st->start_us = esp_timer_get_time();
+                    st->active = true;
+                    break;
+                case LED_CMD_CLEAR:
+                    st->active = false;
+                    break;
+                case LED_CMD_BRIGHTNESS:
+                    build_lut(cmd.pattern.red);
+                    break;
+                case LED_CMD_BENCH:
+                    run_benchmark(cmd.pattern.period_ms);
+                    break;
+                }
+            } while (xQueueReceive(s_cmd_queue, &cmd, 0) == pdTRUE);
+        }
+        wait = render();
+    }
+}
+
+static void post(const led_cmd_t *cmd)
+{
+    if (s_cmd_queue == NULL || cmd->layer >= LED_LAYER_COUNT) {
+        return;
+    }
+    if (xQueueSend(s_cmd_queue, cmd, 0) != pdTRUE) {
+        s_dropped++;
+        telemetry_count(TELEM_LED_DROPPED);
+    }
+}
 
 esp_err_t led_indicator_init(void)
 {
@@ -41,43 +338,84 @@ esp_err_t led_indicator_init(void)
     led_strip_rmt_config_t rmt_config = {
         .clk_src = RMT_CLK_SRC_DEFAULT,
         .resolution_hz = 10 * 1000 * 1000,  // 10MHz
-        .mem_block_symbols = 64,
+        .mem_block_symbols = LED_RMT_MEM_SYMBOLS,
         .flags = {
-            .with_dma = false,
+            .with_dma = LED_RMT_DMA,
         },
     };
 
-    // Create LED strip object
+    // Create LED strip object. The library allocates the pixel buffer and
+    // RMT channel (plus the DMA buffer) once; charge that to this module.
+    size_t heap_mark = mem_report_heap_begin();
     esp_err_t ret = led_strip_new_rmt_device(&strip_config, &rmt_config, &s_led_strip);
+    mem_report_heap_end(MEM_MOD_LED, heap_mark);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create LED strip: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    // Start with LED off
-    led_indicator_off();
+    build_lut(CONFIG_COSMO_LED_BRIGHTNESS);
+
+    s_cmd_queue = xQueueCreateStatic(LED_QUEUE_SIZE, sizeof(led_cmd_t),
+                                     s_cmd_queue_storage, &s_cmd_queue_buf);
+    if (s_cmd_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create LED command queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_led_task = xTaskCreateStaticPinnedToCore(led_task, "led", LED_TASK_STACK, NULL, LED_TASK_PRIO,
+                                               s_led_task_stack, &s_led_task_tcb, LED_TASK_CORE);
+    if (s_led_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create LED task");
+        return ESP_ERR_NO_MEM;
+    }
+    mem_report_add_task(MEM_TASK_LED, s_led_task, LED_TASK_STACK);
+    mem_report_add_static(MEM_MOD_LED, sizeof(s_cmd_queue_buf) + sizeof(s_cmd_queue_storage)
+                                     + sizeof(s_led_task_tcb) + sizeof(s_led_task_stack)
+                                     + sizeof(s_layers) + sizeof(s_lut)
+                                     + sizeof(s_frame) + sizeof(s_shown));
 
-    ESP_LOGI(TAG, "LED indicator initialized on GPIO%d", LED_GPIO);
+    ESP_LOGI(TAG, "LED indicator initialized on GPIO%d (%d px, %s)",
+             LED_GPIO, LED_COUNT, LED_RMT_DMA ? "RMT DMA" : "RMT");
     return ESP_OK;
 }
 
-void led_indicator_set_rgb(uint8_t red, uint8_t green, uint8_t blue)
+void led_indicator_play(led_layer_t layer, const led_pattern_t *pattern)
 {
-    if (s_led_strip == NULL) {
-        return;
-    }
+    led_cmd_t cmd = { .op = LED_CMD_PLAY, .layer = (uint8_t)layer, .pattern = *pattern };
+    post(&cmd);
+}
 
-    led_strip_set_pixel(s_led_strip, 0, red, green, blue);
-    led_strip_refresh(s_led_strip);
+void led_indicator_clear(led_layer_t layer)
+{
+    led_cmd_t cmd = { .op = LED_CMD_CLEAR, .layer = (uint8_t)layer };
+    post(&cmd);
 }
 
-void led_indicator_off(void)
+void led_indicator_solid(led_layer_t layer, uint8_t red, uint8_t green, uint8_t blue)
 {
-    if (s_led_strip == NULL) {
-        return;
-    }
+    led_pattern_t p = { .type = LED_PATTERN_SOLID, .red = red, .green = green, .blue = blue };
+    led_indicator_play(layer, &p);
+}
+
+void led_indicator_flash(led_layer_t layer, uint8_t red, uint8_t green, uint8_t blue,
+                         uint16_t duration_ms)
+{
+    led_pattern_t p = {
+        .type = LED_PATTERN_SOLID, .red = red, .green = green, .blue = blue,
+        .duration_ms = duration_ms,
+    };
+    led_indicator_play(layer, &p);
+}
 
-    led_strip_clear(s_led_strip);
+void led_indicator_set_rgb(uint8_t red, uint8_t green, uint8_t blue)
+{
+    led_indicator_solid(LED_LAYER_IDLE, red, green, blue);
+}
+
+void led_indicator_off(void)
+{
+    led_indicator_clear(LED_LAYER_IDLE);
 }
 
 void led_indicator_red(void)
@@ -94,3 +432,25 @@ void led_indicator_blue(void)
 {
     led_indicator_set_rgb(0, 0, 255);
 }
+
+uint32_t led_indicator_get_dropped(void)
+{
+    return s_dropped;
+}
+
+void led_indicator_set_brightness(uint8_t brightness)
+{
+    led_cmd_t cmd = { .op = LED_CMD_BRIGHTNESS, .pattern = { .red = brightness } };
+    post(&cmd);
+}
+
+void led_indicator_benchmark(uint8_t seconds)
+{
+    led_cmd_t cmd = { .op = LED_CMD_BENCH, .pattern = { .period_ms = seconds } };
+    post(&cmd);
+}
+
+void led_indicator_get_frame_stats(led_frame_stats_t *out)
+{
+    *out = s_stats;
+}
@@ -1,6 +1,10 @@
 /*
  * LED Indicator Module
  * Controls WS2812 RGB LED for visual feedback
+ *
+ * All drawing happens on a dedicated LED task. Callers only post a small
+ * command to its queue, so hot input / NFC paths never wait on RMT output.
+ * Patterns live on priority layers; the highest active layer is shown.
  */
 
 #ifndef _LED_INDICATOR_H_
@@ -13,16 +17,83 @@
 extern "C" {
 #endif
 
+// Priority layers, lowest first. A higher layer hides everything below it
+// while active; clearing it reveals the next active layer underneath.
+typedef enum {
+    LED_LAYER_IDLE = 0,     // ambient / default
+    LED_LAYER_STATUS,       // boot, USB connect, provisioning mode
+    LED_LAYER_BUTTON,       // physical input feedback
+    LED_LAYER_NFC,          // tag typing / provisioning results
+    LED_LAYER_ALERT,        // health / fault indication
+    LED_LAYER_COUNT,
+} led_layer_t;
+
+typedef enum {
+    LED_PATTERN_SOLID = 0,  // constant colour
+    LED_PATTERN_BLINK,      // on / off, 50% duty, period_ms per cycle
+    LED_PATTERN_FADE,       // ramp from off to colour over period_ms, then hold
+    LED_PATTERN_PULSE,      // triangle "breathing", period_ms per cycle
+} led_pattern_type_t;
+
+typedef struct {
+    led_pattern_type_t type;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint16_t period_ms;     // ignored for SOLID
+    uint16_t duration_ms;   // layer clears itself after this; 0 = until cleared
+    uint16_t first;         // first pixel of the segment this pattern covers
+    uint16_t count;         // segment length; 0 = to the end of the strip
+} led_pattern_t;
+
+// Frame pipeline counters since boot (or since the last benchmark).
+typedef struct {
+    uint32_t frames;            // frames built
+    uint32_t refreshes;         // frames actually sent to the strip
+    uint32_t build_us_avg;      // compose + gamma/brightness LUT + copy, CPU time
+    uint32_t build_us_max;
+    uint32_t refresh_us_avg;    // led_strip_refresh wall time (DMA: CPU mostly idle)
+    uint32_t refresh_us_max;
+} led_frame_stats_t;
+
 /**
  * Initialize the LED indicator
- * Sets up RMT peripheral for WS2812 control on GP7
+ * Sets up RMT (optionally DMA) for a CONFIG_COSMO_LED_COUNT-pixel WS2812
+ * strip on CONFIG_COSMO_LED_GPIO and starts the LED task
  *
  * @return ESP_OK on success
  */
 esp_err_t led_indicator_init(void);
 
 /**
- * Set LED color (RGB)
+ * Show a pattern on a layer (replaces whatever that layer had)
+ * Non-blocking; safe from any task.
+ *
+ * @param layer   Priority layer
+ * @param pattern Pattern to play (copied)
+ */
+void led_indicator_play(led_layer_t layer, const led_pattern_t *pattern);
+
+/**
+ * Clear a layer, revealing the next active layer below it
+ *
+ * @param layer Priority layer
+ */
+void led_indicator_clear(led_layer_t layer);
+
+/**
+ * Solid colour on a layer — shorthand for led_indicator_play()
+ */
+void led_indicator_solid(led_layer_t layer, uint8_t red, uint8_t green, uint8_t blue);
+
+/**
+ * Solid colour on a layer for duration_ms, then the layer clears itself
+ */
+void led_indicator_flash(led_layer_t layer, uint8_t red, uint8_t green, uint8_t blue,
+                         uint16_t duration_ms);
+
+/**
+ * Set LED color (RGB) on the idle layer
  *
  * @param red   Red component (0-255)
  * @param green Green component (0-255)
@@ -31,24 +102,36 @@ esp_err_t led_indicator_init(void);
 void led_indicator_set_rgb(uint8_t red, uint8_t green, uint8_t blue);
 
 /**
- * Turn LED off
+ * Turn the idle layer off
  */
 void led_indicator_off(void);
 
 /**
- * Set LED to red (for button press indication)
+ * Set idle layer to red / green / blue
  */
 void led_indicator_red(void);
+void led_indicator_green(void);
+void led_indicator_blue(void);
 
 /**
- * Set LED to green
+ * Number of commands dropped because the LED queue was full
  */
-void led_indicator_green(void);
+uint32_t led_indicator_get_dropped(void);
 
 /**
- * Set LED to blue
+ * Set global brightness (0-255). Rebuilds the gamma/brightness table on the
+ * LED task; takes effect on the next frame.
  */
-void led_indicator_blue(void);
+void led_indicator_set_brightness(uint8_t brightness);
+
+/**
+ * Run the frame benchmark: animate every pixel at 60 fps for `seconds`, then
+ * log build / refresh times and the wall-time share of build + refresh.
+ * Layers are restored afterwards.
+ */
+void led_indicator_benchmark(uint8_t seconds);
+
+void led_indicator_get_frame_stats(led_frame_stats_t *out);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,151 @@
+/*
+ * Memory Report Module Implementation
+ * Bookkeeping only: every number is recorded at init or read on demand,
+ * nothing here allocates. Tasks are created from static storage, so reading
+ * the high-water mark of a task that just deleted itself gives a stale value
+ * at worst, never a dangling one.
+ */
+
+#include <stdbool.h>
+#include "mem_report.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "MEM";
+
+static const char *const MODULE_NAMES[MEM_MOD_COUNT] = {
+    [MEM_MOD_HID]   = "hid",
+    [MEM_MOD_INPUT] = "input",
+    [MEM_MOD_LED]   = "led",
+    [MEM_MOD_NFC]   = "nfc",
+    [MEM_MOD_DIAG]  = "diag",
+};
+
+static const char *const TASK_NAMES[MEM_TASK_COUNT] = {
+    [MEM_TASK_MAIN]         = "main",
+    [MEM_TASK_INPUT]        = "input_handler",
+    [MEM_TASK_LED]          = "led",
+    [MEM_TASK_NFC_DISPATCH] = "nfc_dispatch",
+    [MEM_TASK_NFC_SCHED]    = "nfc_sched",
+    [MEM_TASK_PERIPH_INIT]  = "periph_init",
+};
+
+typedef struct {
+    TaskHandle_t handle;            // NULL once the task has exited
+    uint32_t stack_bytes;
+    uint32_t exit_free;             // high-water mark taken at exit
+    bool registered;
+} task_slot_t;
+
+static uint32_t s_static_bytes[MEM_MOD_COUNT];
+static uint32_t s_heap_bytes[MEM_MOD_COUNT];
+static task_slot_t s_tasks[MEM_TASK_COUNT];
+static uint32_t s_steady_free = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void mem_report_add_static(mem_module_t mod, size_t bytes)
+{
+    if (mod >= MEM_MOD_COUNT) return;
+    portENTER_CRITICAL(&s_lock);
+    s_static_bytes[mod] += bytes;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void mem_report_add_task(mem_task_t id, TaskHandle_t task, size_t stack_bytes)
+{
+    if (id >= MEM_TASK_COUNT || task == NULL) return;
+    portENTER_CRITICAL(&s_lock);
+    s_tasks[id] = (task_slot_t){ .handle = task, .stack_bytes = stack_bytes, .registered = true };
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void mem_report_task_exit(mem_task_t id)
+{
+    if (id >= MEM_TASK_COUNT) return;
+    // Stack depth is in bytes on ESP-IDF (StackType_t is uint8_t).
+    uint32_t free_bytes = uxTaskGetStackHighWaterMark(NULL);
+    portENTER_CRITICAL(&s_lock);
+    s_tasks[id].exit_free = free_bytes;
+    s_tasks[id].handle = NULL;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+size_t mem_report_heap_begin(void)
+{
+    return heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+void mem_report_heap_end(mem_module_t mod, size_t begin)
+{
+    size_t now = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    if (mod >= MEM_MOD_COUNT || now >= begin) return;
+    portENTER_CRITICAL(&s_lock);
+    s_heap_bytes[mod] += begin - now;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void mem_report_mark_steady(void)
+{
+    s_steady_free = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+// Minimum free stack in bytes, or 0 for a slot never registered.
+static uint32_t task_free_bytes(mem_task_t id)
+{
+    portENTER_CRITICAL(&s_lock);
+    task_slot_t slot = s_tasks[id];
+    portEXIT_CRITICAL(&s_lock);
+    if (!slot.registered) return 0;
+    return slot.handle != NULL ? uxTaskGetStackHighWaterMark(slot.handle) : slot.exit_free;
+}
+
+void mem_report_log(void)
+{
+    uint32_t total_static = 0, total_heap = 0;
+    ESP_LOGI(TAG, "%-8s %8s %8s", "module", "static", "heap");
+    for (int m = 0; m < MEM_MOD_COUNT; m++) {
+        ESP_LOGI(TAG, "%-8s %8u %8u", MODULE_NAMES[m],
+                 (unsigned)s_static_bytes[m], (unsigned)s_heap_bytes[m]);
+        total_static += s_static_bytes[m];
+        total_heap += s_heap_bytes[m];
+    }
+    ESP_LOGI(TAG, "%-8s %8u %8u", "total", (unsigned)total_static, (unsigned)total_heap);
+
+    for (int t = 0; t < MEM_TASK_COUNT; t++) {
+        if (!s_tasks[t].registered) continue;
+        uint32_t free_bytes = task_free_bytes(t);
+        uint32_t size = s_tasks[t].stack_bytes;
+        ESP_LOGI(TAG, "stack %-14s %5u / %5u used (%u%%)%s", TASK_NAMES[t],
+                 (unsigned)(size - free_bytes), (unsigned)size,
+                 size ? (unsigned)((size - free_bytes) * 100 / size) : 0,
+                 s_tasks[t].handle == NULL ? ", exited" : "");
+    }
+
+    uint32_t free_now = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    ESP_LOGI(TAG, "heap free %u, min free %u, largest block %u (internal %u)",
+             (unsigned)free_now,
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+    if (s_steady_free != 0 && free_now < s_steady_free) {
+        ESP_LOGW(TAG, "heap dropped %u bytes since boot finished",
+                 (unsigned)(s_steady_free - free_now));
+    }
+}
+
+uint32_t mem_report_read(uint32_t *out)
+{
+    uint32_t present = 0;
+    out[0] = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    out[1] = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    out[2] = heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT);
+    out[3] = s_steady_free;
+    for (int t = 0; t < MEM_TASK_COUNT; t++) {
+        out[MEM_REPORT_HEAP_WORDS + t] = task_free_bytes(t);
+        if (s_tasks[t].registered) present |= 1u << t;
+    }
+    for (int m = 0; m < MEM_MOD_COUNT; m++) {
+        out[MEM_REPORT_HEAP_WORDS + MEM_TASK_COUNT + m] = s_static_bytes[m] + s_heap_bytes[m];
+    }
+    return present;
+}
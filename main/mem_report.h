@@ -0,0 +1,100 @@
+/*
+ * Memory Report Module
+ * Per-module RAM accounting: static storage each module owns, heap charged
+ * to it during init, and stack high-water marks of the firmware's tasks.
+ * Logged once after boot and readable over a HID feature report.
+ */
+
+#ifndef _MEM_REPORT_H_
+#define _MEM_REPORT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Modules RAM is charged to. The order is the wire layout of the memory
+// report, so only ever append.
+typedef enum {
+    MEM_MOD_HID = 0,                // app_main, HID state, typing pacing, TinyUSB
+    MEM_MOD_INPUT,
+    MEM_MOD_LED,                    // incl. led_strip / RMT driver
+    MEM_MOD_NFC,                    // incl. rc522 driver, scanner and its task
+    MEM_MOD_DIAG,                   // event log, telemetry log, health monitor
+    MEM_MOD_COUNT
+} mem_module_t;
+
+// Tasks whose stacks the firmware owns. Library tasks (TinyUSB, rc522
+// scanner) size their own stacks and are not listed.
+typedef enum {
+    MEM_TASK_MAIN = 0,
+    MEM_TASK_INPUT,
+    MEM_TASK_LED,
+    MEM_TASK_NFC_DISPATCH,
+    MEM_TASK_NFC_SCHED,
+    MEM_TASK_PERIPH_INIT,
+    MEM_TASK_COUNT
+} mem_task_t;
+
+/**
+ * Charge module-owned static storage (task stacks and TCBs, queue and
+ * semaphore buffers, scratch buffers) to a module. Call once from init.
+ */
+void mem_report_add_static(mem_module_t mod, size_t bytes);
+
+/**
+ * Register a task so its stack high-water mark is reported
+ *
+ * @param id          Report slot
+ * @param task        Handle returned by xTaskCreateStatic()
+ * @param stack_bytes Stack size the task was created with
+ */
+void mem_report_add_task(mem_task_t id, TaskHandle_t task, size_t stack_bytes);
+
+/**
+ * Take a final high-water reading for a task that is about to delete itself.
+ * Call from the task, right before vTaskDelete(NULL).
+ */
+void mem_report_task_exit(mem_task_t id);
+
+/**
+ * Free default-capability heap right now; pass to mem_report_heap_end() to
+ * charge whatever a library allocated in between to a module
+ */
+size_t mem_report_heap_begin(void);
+void mem_report_heap_end(mem_module_t mod, size_t begin);
+
+/**
+ * Remember free heap once boot is over. Any later drop from this mark is
+ * a runtime allocation, which the firmware is not supposed to make.
+ */
+void mem_report_mark_steady(void);
+
+/**
+ * Log per-module static / heap use, task stack headroom and heap state
+ */
+void mem_report_log(void);
+
+// Words of mem_report_read(), in order.
+#define MEM_REPORT_HEAP_WORDS   4   // free, min free, largest free block, free at steady mark
+#define MEM_REPORT_WORDS        (MEM_REPORT_HEAP_WORDS + MEM_TASK_COUNT + MEM_MOD_COUNT)
+
+/**
+ * Fill the memory report: heap words, then minimum free stack bytes per
+ * task (mem_task_t order), then total RAM (static + heap) per module
+ * (mem_module_t order). Never blocks.
+ *
+ * @param out   MEM_REPORT_WORDS words
+ * @return Bitmask of mem_task_t slots that have been registered
+ */
+uint32_t mem_report_read(uint32_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEM_REPORT_H_ */
@@ -0,0 +1,174 @@
+/*
+ * NDEF Text Record Parser / Encoder Implementation
+ *
+ * Bounds checks are written as "n > end - i" rather than "i + n > end":
+ * on the ESP32 size_t is 32 bits, and a 4-byte long-record length near
+ * 2^32 would otherwise wrap the sum and slip past the check.
+ */
+
+#include <string.h>
+#include "ndef_parser.h"
+
+// Bytes [i, i + n) are in the part of the window read so far. `i` can be
+// past `avail` after skipping a TLV or an ID field.
+static inline bool have(size_t i, size_t n, size_t avail)
+{
+    return i <= avail && n <= avail - i;
+}
+
+// Each check against the window or the message end comes before the check
+// that the byte is already in, so a partial window only ever defers.
+ndef_find_t ndef_find_text(const uint8_t *buf, size_t avail, size_t window, size_t max_text_len,
+                           size_t *text_off, size_t *text_len)
+{
+    size_t i = 0;
+    if (avail > window) avail = window;
+
+    while (i < window) {
+        if (!have(i, 1, avail)) return NDEF_FIND_MORE;
+        uint8_t tlv_tag = buf[i++];
+        if (tlv_tag == 0x00) {
+            continue;  // NULL TLV padding
+        }
+        if (tlv_tag == 0xFE) {
+            return NDEF_FIND_NONE;  // Terminator TLV — no NDEF found before this
+        }
+        if (i >= window) {
+            return NDEF_FIND_NONE;
+        }
+
+        // TLV length: 1 byte unless first byte is 0xFF, then it's 3 bytes (0xFF + uint16 BE).
+        size_t tlv_len;
+        if (!have(i, 1, avail)) return NDEF_FIND_MORE;
+        if (buf[i] == 0xFF) {
+            if (window - i < 3) return NDEF_FIND_NONE;
+            if (!have(i, 3, avail)) return NDEF_FIND_MORE;
+            tlv_len = ((size_t)buf[i + 1] << 8) | buf[i + 2];
+            i += 3;
+        } else {
+            tlv_len = buf[i];
+            i += 1;
+        }
+
+        if (tlv_len > window - i) {
+            // Lock/Memory-control TLVs running off the end are as bad as a
+            // truncated NDEF TLV: nothing parseable follows.
+            return NDEF_FIND_NONE;
+        }
+
+        if (tlv_tag != 0x03) {
+            // Lock-control / Memory-control TLVs etc — skip past their payload.
+            i += tlv_len;
+            continue;
+        }
+
+        // Found NDEF Message TLV. Parse its first record.
+        size_t msg_end = i + tlv_len;
+
+        if (i >= msg_end) return NDEF_FIND_NONE;
+        if (!have(i, 1, avail)) return NDEF_FIND_MORE;
+        uint8_t hdr = buf[i++];
+        bool sr = (hdr & 0x10) != 0;          // Short Record flag
+        bool il = (hdr & 0x08) != 0;          // ID Length present
+        uint8_t tnf = hdr & 0x07;
+        if (tnf != 0x01) return NDEF_FIND_NONE;   // Only Well-known type supported
+
+        if (i >= msg_end) return NDEF_FIND_NONE;
+        if (!have(i, 1, avail)) return NDEF_FIND_MORE;
+        uint8_t type_len = buf[i++];
+
+        size_t payload_len;
+        if (sr) {
+            if (i >= msg_end) return NDEF_FIND_NONE;
+            if (!have(i, 1, avail)) return NDEF_FIND_MORE;
+            payload_len = buf[i++];
+        } else {
+            if (msg_end - i < 4) return NDEF_FIND_NONE;
+            if (!have(i, 4, avail)) return NDEF_FIND_MORE;
+            uint32_t len32 = ((uint32_t)buf[i] << 24) | ((uint32_t)buf[i + 1] << 16)
+                           | ((uint32_t)buf[i + 2] << 8) | buf[i + 3];
+            payload_len = len32;
+            i += 4;
+        }
+
+        size_t id_len = 0;
+        if (il) {
+            if (i >= msg_end) return NDEF_FIND_NONE;
+            if (!have(i, 1, avail)) return NDEF_FIND_MORE;
+            id_len = buf[i++];
+        }
+
+        if (type_len != 1 || i >= msg_end) return NDEF_FIND_NONE;
+        if (!have(i, 1, avail)) return NDEF_FIND_MORE;
+        if (buf[i++] != 'T') return NDEF_FIND_NONE;   // Not a Text record
+
+        if (id_len > msg_end - i) return NDEF_FIND_NONE;
+        i += id_len;  // skip optional ID
+
+        if (payload_len < 1 || payload_len > msg_end - i) return NDEF_FIND_NONE;
+
+        // Text payload: [status][lang_code][text]
+        // status bit 7 = UTF-16 if set, bits 0..5 = lang_code length.
+        if (!have(i, 1, avail)) return NDEF_FIND_MORE;
+        uint8_t status = buf[i];
+        if (status & 0x80) return NDEF_FIND_NONE;     // UTF-16 not supported
+        size_t lang_len = status & 0x3F;
+        if (lang_len >= payload_len) return NDEF_FIND_NONE;
+
+        size_t len = payload_len - 1 - lang_len;
+        if (len > max_text_len) len = max_text_len;
+        if (len == 0) return NDEF_FIND_NONE;
+        *text_off = i + 1 + lang_len;
+        *text_len = len;
+        return NDEF_FIND_TEXT;
+    }
+
+    return NDEF_FIND_NONE;
+}
+
+bool ndef_parse_text(const uint8_t *buf, size_t buf_len,
+                     char *out_text, size_t max_text_len)
+{
+    size_t text_off, text_len;
+    if (ndef_find_text(buf, buf_len, buf_len, max_text_len, &text_off, &text_len) != NDEF_FIND_TEXT) {
+        return false;
+    }
+
+    // Stop at an embedded NUL so "true" always means a non-empty C string.
+    const uint8_t *nul = memchr(&buf[text_off], 0, text_len);
+    if (nul != NULL) text_len = (size_t)(nul - &buf[text_off]);
+
+    memcpy(out_text, &buf[text_off], text_len);
+    out_text[text_len] = '\0';
+    return text_len > 0;
+}
+
+size_t ndef_encode_text(const char *text, uint8_t *out, size_t out_cap)
+{
+    static const char lang[] = "en";
+    const size_t lang_len = sizeof(lang) - 1;
+    size_t text_len = strlen(text);
+    size_t payload_len = 1 + lang_len + text_len;   // status + lang + text
+    size_t record_len = 4 + payload_len;            // hdr, type_len, plen, 'T'
+
+    if (payload_len > 0xFF || record_len >= 0xFF) return 0;
+    size_t used = 2 + record_len + 1;               // NDEF TLV + Terminator
+    size_t padded = (used + 3) & ~(size_t)3;
+    if (padded > out_cap) return 0;
+
+    size_t i = 0;
+    out[i++] = 0x03;                                // NDEF Message TLV
+    out[i++] = (uint8_t)record_len;
+    out[i++] = 0xD1;                                // MB | ME | SR | TNF=well-known
+    out[i++] = 0x01;                                // type length
+    out[i++] = (uint8_t)payload_len;
+    out[i++] = 'T';
+    out[i++] = (uint8_t)lang_len;                   // status: UTF-8, lang length
+    memcpy(&out[i], lang, lang_len);
+    i += lang_len;
+    memcpy(&out[i], text, text_len);
+    i += text_len;
+    out[i++] = 0xFE;                                // Terminator TLV
+    memset(&out[i], 0, padded - i);
+    return padded;
+}
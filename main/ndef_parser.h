@@ -0,0 +1,76 @@
+/*
+ * NDEF Text Record Parser / Encoder
+ * Pure C, no ESP-IDF dependencies — also builds on the host for fuzzing and
+ * benchmarking (see test/ndef/).
+ */
+
+#ifndef _NDEF_PARSER_H_
+#define _NDEF_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Parse the first NDEF Text Record out of NTAG user-memory bytes (TLV-wrapped,
+ * starting at page 4).
+ *
+ * Supports the subset that `NFC Tools` and similar writer apps produce:
+ * well-known TNF, type 'T', UTF-8, short or long record, 1- or 3-byte TLV
+ * lengths. `buf` is untrusted; every length is bounds-checked against buf_len.
+ *
+ * @param buf          Raw tag bytes
+ * @param buf_len      Number of valid bytes in buf
+ * @param out_text     Receives the NUL-terminated text; must hold max_text_len + 1
+ * @param max_text_len Longer payloads are truncated to this many bytes
+ * @return true if a non-empty Text payload was written to out_text
+ */
+bool ndef_parse_text(const uint8_t *buf, size_t buf_len,
+                     char *out_text, size_t max_text_len);
+
+// ndef_find_text() result
+typedef enum {
+    NDEF_FIND_MORE = 0,             // the bytes so far do not decide it yet
+    NDEF_FIND_TEXT,                 // *text_off / *text_len locate the text
+    NDEF_FIND_NONE,                 // no usable Text record in the window
+} ndef_find_t;
+
+/**
+ * Incremental form of ndef_parse_text() for a window that is read piece by
+ * piece: `buf` holds the first `avail` of `window` bytes. Every length is
+ * checked against the whole window, so an answer other than NDEF_FIND_MORE
+ * is final and matches what ndef_parse_text(buf, window, ...) decides once
+ * all of it is in. That lets the reader use the text bytes as soon as they
+ * arrive, while the rest of the window is still being read.
+ *
+ * The text is [*text_off, *text_off + *text_len), already truncated to
+ * max_text_len. It ends early at a NUL byte; a NUL first means no text.
+ *
+ * @return NDEF_FIND_MORE until the record header is in
+ */
+ndef_find_t ndef_find_text(const uint8_t *buf, size_t avail, size_t window, size_t max_text_len,
+                           size_t *text_off, size_t *text_len);
+
+/**
+ * Encode `text` as a single-record NDEF message in an NDEF TLV, followed by a
+ * Terminator TLV — the layout ndef_parse_text() reads and NFC Tools writes:
+ *   03 <len> D1 01 <plen> 'T' 02 'e' 'n' <text...> FE
+ * Short record (text up to 252 bytes), UTF-8, language "en". The output is
+ * zero-padded to a whole number of 4-byte NTAG pages.
+ *
+ * @param text    NUL-terminated payload
+ * @param out     Destination, written from NTAG page 4 onwards
+ * @param out_cap Size of out in bytes
+ * @return number of bytes used (multiple of 4), or 0 if it does not fit
+ */
+size_t ndef_encode_text(const char *text, uint8_t *out, size_t out_cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NDEF_PARSER_H_ */
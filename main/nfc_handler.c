@@ -7,8 +7,21 @@
 #include <string.h>
 #include <stdbool.h>
 #include "nfc_handler.h"
+#include "ndef_parser.h"
+#include "nfc_provision.h"
+#include "input_handler.h"
+#include "telemetry.h"
+#include "event_log.h"
+#include "health.h"
+#include "uid_index.h"
+#include "mem_report.h"
+#include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "rc522.h"
 #include "driver/rc522_spi.h"
 #include "rc522_picc.h"
@@ -16,10 +29,29 @@
 
 static const char *TAG = "NFC";
 
-// Suppress duplicate detections of the same UID within this window.
-// RC522's heartbeat check can flicker when the card sits at the edge of the
-// RF field, which would otherwise type the same string multiple times.
-#define NFC_DEDUP_WINDOW_US (1500 * 1000)
+// Presence tracking (see Kconfig "Cosmo Radio > NFC"). RC522's heartbeat check
+// can flicker when the card sits at the edge of the RF field, and visitors swap
+// cards back and forth; each physical placement must fire the callback once.
+#define NFC_HEARTBEAT_US      ((int64_t)CONFIG_COSMO_NFC_POLL_INTERVAL_MS * 1000)
+#define NFC_DEPART_US         (NFC_HEARTBEAT_US * CONFIG_COSMO_NFC_DEPART_MISSES)
+#define NFC_HOLDOFF_US        ((int64_t)CONFIG_COSMO_NFC_HOLDOFF_MS * 1000)
+#define NFC_PRESENCE_SLOTS    CONFIG_COSMO_NFC_PRESENCE_SLOTS
+
+// Scanner -> dispatch handoff. One extra slot beyond the queue depth is the
+// one the dispatch task is currently typing from.
+#define NFC_QUEUE_DEPTH       CONFIG_COSMO_NFC_QUEUE_DEPTH
+#define NFC_SLOT_COUNT        (NFC_QUEUE_DEPTH + 1)
+#define NFC_DISPATCH_STACK    (3 * 1024)
+#define NFC_DISPATCH_PRIO     CONFIG_COSMO_PRIO_NFC_DISPATCH
+#define NFC_TASK_CORE         CONFIG_COSMO_CORE_BG        // dispatch and scheduler
+#define NFC_SCAN_PRIO         CONFIG_COSMO_PRIO_NFC_SCAN  // rc522 library task, unpinned
+
+// Adaptive scan scheduler (CONFIG_COSMO_NFC_ADAPTIVE_POLL). The rc522 library
+// polls at a fixed interval, so the scheduler duty-cycles it with
+// rc522_start / rc522_pause instead of changing the interval.
+#define NFC_SCHED_TICK_MS     20     // activity re-check granularity while paused
+#define NFC_SCHED_STACK       (2 * 1024)
+#define NFC_SCHED_PRIO        (NFC_DISPATCH_PRIO - 1)
 
 // V4 GPIO assignments — see CLAUDE.md "GPIO Pin Assignments" (J4 left-top 8P).
 #define NFC_SPI_HOST    SPI2_HOST
@@ -50,124 +82,363 @@ static rc522_driver_handle_t s_driver = NULL;
 static rc522_handle_t s_scanner = NULL;
 static nfc_tag_callback_t s_callback = NULL;
 
-// Last fired UID + timestamp, for de-duplication.
-static char s_last_uid[RC522_PICC_UID_SIZE_MAX * 2 + 1] = {0};
-static int64_t s_last_uid_time_us = 0;
-
-// Parse a single NDEF Text Record out of NTAG user-memory bytes (TLV-wrapped).
-// We only support the minimum subset that matches what `NFC Tools` and similar
-// writer apps produce: short-record, well-known TNF, type 'T', UTF-8.
-// Returns true and writes a NUL-terminated UTF-8 payload to out_text on success.
-static bool parse_ndef_text(const uint8_t *buf, size_t buf_len,
-                            char *out_text, size_t max_text_len)
+// NDEF area read from page 4: 12 pages = 48 bytes, which fits an NDEF Text
+// record with up to ~38 chars after TLV + header overhead. Read 16 bytes at
+// a time, and only as far as the text goes.
+#define NFC_NDEF_WINDOW       48
+
+// Where the scanner is with a slot's payload. Only the scanner writes it.
+typedef enum {
+    NFC_SLOT_READING = 0,   // text_len may still grow
+    NFC_SLOT_COMPLETE,      // text_len is the whole payload
+    NFC_SLOT_NO_TEXT,       // no usable Text record, text_len is 0
+    NFC_SLOT_ABORTED,       // a read failed after text was handed out
+} nfc_slot_state_t;
+
+// Fixed-size detection result. Slots live in a static pool; only their
+// indices travel through the free / ready queues, so nothing is allocated
+// or copied twice per scan. A slot is handed over as soon as the tag is
+// seen; the scanner then fills in the payload while the dispatch task is
+// already typing it. payload[0, text_len) is final once text_len covers it
+// (release store, after the bytes).
+typedef struct {
+    char payload[NFC_PAYLOAD_MAX_LEN + 1];
+    char uid_hex[RC522_PICC_UID_SIZE_MAX * 2 + 1];
+    int64_t detected_us;    // when the scanner saw the tag
+    int64_t queued_us;      // when it was handed to the dispatch task
+    uint8_t text_len;
+    uint8_t state;          // nfc_slot_state_t
+} nfc_tag_slot_t;
+
+static nfc_tag_slot_t s_slots[NFC_SLOT_COUNT];
+static QueueHandle_t s_free_slots = NULL;   // uint8_t slot indices
+static QueueHandle_t s_ready_slots = NULL;  // uint8_t slot indices, FIFO
+static StaticQueue_t s_free_slots_buf;
+static StaticQueue_t s_ready_slots_buf;
+static uint8_t s_free_slots_storage[NFC_SLOT_COUNT];
+static uint8_t s_ready_slots_storage[NFC_SLOT_COUNT];
+static TaskHandle_t s_dispatch_task = NULL;
+static StaticTask_t s_dispatch_task_tcb;
+static StackType_t s_dispatch_task_stack[NFC_DISPATCH_STACK];
+static volatile bool s_dispatch_busy = false;
+
+// Slot the dispatch task is typing from, and the next payload byte to hand
+// out. s_text_ready is given by the scanner whenever a slot's text grows or
+// its read ends; the typing pacer owns the task notification.
+static nfc_tag_slot_t *s_dispatch_slot = NULL;
+static uint8_t s_dispatch_pos = 0;
+static SemaphoreHandle_t s_text_ready = NULL;
+static StaticSemaphore_t s_text_ready_buf;
+
+// Supersede bookkeeping: the scanner bumps s_generation, the dispatch task
+// remembers which generation it is typing for.
+static volatile uint32_t s_generation = 0;
+static volatile uint32_t s_dispatch_generation = 0;
+
+// Written by the scanner and the dispatch task, read from the TinyUSB task.
+// depth is sampled under the lock too, so the two writers cannot store it
+// out of order.
+static nfc_queue_stats_t s_queue_stats = {0};
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Scanner run/pause bookkeeping, for duty cycle and detect-latency estimates.
+#if CONFIG_COSMO_NFC_ADAPTIVE_POLL
+static TaskHandle_t s_sched_task = NULL;
+static StaticTask_t s_sched_task_tcb;
+static StackType_t s_sched_task_stack[NFC_SCHED_STACK];
+#endif
+static bool s_scanner_running = false;
+static int64_t s_state_since_us = 0;     // when running/paused last flipped
+static int64_t s_last_gap_us = 0;        // length of the pause before the current burst
+static int64_t s_last_tag_us = 0;        // last tag arrive/leave, counts as activity
+static uint32_t s_period_ms = 0;         // current scan period, 0 = continuous
+static nfc_poll_stats_t s_poll_stats = {0};
+static int64_t s_latency_sum_us = 0;
+
+// Per-tag presence state, keyed by binary UID.
+//   ARRIVED  — fired the callback on this placement, still in the field
+//   PRESENT  — re-entered after a flicker; same placement, no new callback
+//   ABSENT   — left the field at lost_us; becomes departed once it has missed
+//              NFC_DEPART_US worth of heartbeats AND the hold-off has elapsed
+// A free slot has uid_len == 0. Only touched from the rc522 event task.
+typedef enum {
+    NFC_TAG_ARRIVED = 0,
+    NFC_TAG_PRESENT,
+    NFC_TAG_ABSENT,
+} nfc_tag_presence_t;
+
+typedef struct {
+    uint8_t uid_len;
+    uint8_t uid[RC522_PICC_UID_SIZE_MAX];
+    nfc_tag_presence_t state;
+    int64_t lost_us;       // when it last left the field (ABSENT only)
+    int64_t seen_us;       // last ACTIVE/IDLE transition, for LRU eviction
+} nfc_presence_entry_t;
+
+static nfc_presence_entry_t s_presence[NFC_PRESENCE_SLOTS];
+
+// Entry currently in the field. The rc522 scanner tracks a single PICC, and its
+// IDLE event is not guaranteed to still carry the UID, so leave() uses this.
+static nfc_presence_entry_t *s_in_field = NULL;
+
+static bool presence_departed(const nfc_presence_entry_t *e, int64_t now_us)
 {
-    size_t i = 0;
-
-    while (i < buf_len) {
-        uint8_t tlv_tag = buf[i++];
-        if (tlv_tag == 0x00) {
-            continue;  // NULL TLV padding
-        }
-        if (tlv_tag == 0xFE) {
-            return false;  // Terminator TLV — no NDEF found before this
-        }
-        if (i >= buf_len) {
-            return false;
-        }
+    if (e->state != NFC_TAG_ABSENT) return false;
+    int64_t gone_us = now_us - e->lost_us;
+    return gone_us >= NFC_DEPART_US && gone_us >= NFC_HOLDOFF_US;
+}
 
-        // TLV length: 1 byte unless first byte is 0xFF, then it's 3 bytes (0xFF + uint16 BE).
-        size_t tlv_len;
-        if (buf[i] == 0xFF) {
-            if (i + 3 > buf_len) return false;
-            tlv_len = (buf[i + 1] << 8) | buf[i + 2];
-            i += 3;
-        } else {
-            tlv_len = buf[i];
-            i += 1;
+static nfc_presence_entry_t *presence_find(const rc522_picc_uid_t *uid)
+{
+    for (int i = 0; i < NFC_PRESENCE_SLOTS; i++) {
+        nfc_presence_entry_t *e = &s_presence[i];
+        if (e->uid_len == uid->length && memcmp(e->uid, uid->value, uid->length) == 0) {
+            return e;
         }
+    }
+    return NULL;
+}
 
-        if (tlv_tag != 0x03) {
-            // Lock-control / Memory-control TLVs etc — skip past their payload.
-            i += tlv_len;
-            continue;
+// Pick a slot for a new UID: free first, then the longest-departed entry,
+// then the least recently seen one (only if every tracked tag is in the field).
+static nfc_presence_entry_t *presence_alloc(int64_t now_us)
+{
+    nfc_presence_entry_t *victim = NULL;
+    bool victim_departed = false;
+    for (int i = 0; i < NFC_PRESENCE_SLOTS; i++) {
+        nfc_presence_entry_t *e = &s_presence[i];
+        if (e->uid_len == 0) return e;
+        bool departed = presence_departed(e, now_us);
+        if (victim == NULL
+            || (departed && !victim_departed)
+            || (departed == victim_departed && e->seen_us < victim->seen_us)) {
+            victim = e;
+            victim_departed = departed;
         }
+    }
+    return victim;
+}
 
-        // Found NDEF Message TLV. Parse its first record.
-        if (i + tlv_len > buf_len) return false;
-        size_t msg_end = i + tlv_len;
+// Close the current placement: the in-field tag starts counting missed beats.
+static void presence_on_leave(int64_t now_us)
+{
+    if (s_in_field != NULL) {
+        s_in_field->state = NFC_TAG_ABSENT;
+        s_in_field->lost_us = now_us;
+        s_in_field->seen_us = now_us;
+        s_in_field = NULL;
+    }
+}
 
-        if (i >= msg_end) return false;
-        uint8_t hdr = buf[i++];
-        bool sr = (hdr & 0x10) != 0;          // Short Record flag
-        bool il = (hdr & 0x08) != 0;          // ID Length present
-        uint8_t tnf = hdr & 0x07;
-        if (tnf != 0x01) return false;        // Only Well-known type supported
+// Record that a tag entered the field. Returns true if this is a new physical
+// placement (callback should fire), false for flicker / hold-off re-entries.
+static bool presence_on_arrive(const rc522_picc_uid_t *uid, int64_t now_us)
+{
+    nfc_presence_entry_t *e = presence_find(uid);
+    if (s_in_field != NULL && s_in_field != e) {
+        presence_on_leave(now_us);  // missed an IDLE event; close the old placement
+    }
+    s_in_field = NULL;
 
-        if (i >= msg_end) return false;
-        uint8_t type_len = buf[i++];
+    if (e != NULL && !presence_departed(e, now_us)) {
+        e->state = NFC_TAG_PRESENT;
+        e->seen_us = now_us;
+        s_in_field = e;
+        return false;
+    }
 
-        size_t payload_len;
-        if (sr) {
-            if (i >= msg_end) return false;
-            payload_len = buf[i++];
-        } else {
-            if (i + 4 > msg_end) return false;
-            payload_len = ((size_t)buf[i] << 24) | ((size_t)buf[i + 1] << 16)
-                        | ((size_t)buf[i + 2] << 8) | buf[i + 3];
-            i += 4;
-        }
+    if (e == NULL) {
+        e = presence_alloc(now_us);
+        e->uid_len = uid->length;
+        memcpy(e->uid, uid->value, uid->length);
+    }
+    e->state = NFC_TAG_ARRIVED;
+    e->seen_us = now_us;
+    s_in_field = e;
+    return true;
+}
 
-        size_t id_len = 0;
-        if (il) {
-            if (i >= msg_end) return false;
-            id_len = buf[i++];
-        }
+static void slot_publish_text(nfc_tag_slot_t *slot, uint8_t len)
+{
+    __atomic_store_n(&slot->text_len, len, __ATOMIC_RELEASE);
+    xSemaphoreGive(s_text_ready);
+}
 
-        if (type_len != 1 || i >= msg_end) return false;
-        if (buf[i++] != 'T') return false;    // Not a Text record
+static void slot_finish(nfc_tag_slot_t *slot, nfc_slot_state_t state)
+{
+    __atomic_store_n(&slot->state, (uint8_t)state, __ATOMIC_RELEASE);
+    xSemaphoreGive(s_text_ready);
+}
 
-        i += id_len;  // skip optional ID
+// Read the NTAG user pages holding an NDEF Text payload into the slot, one
+// 16-byte READ at a time. Once the record header has been checked against
+// the whole window (ndef_find_text), the text bytes of every completed read
+// are published right away, so the dispatch task types them while the
+// following pages are fetched. Stops at the end of the text.
+static nfc_slot_state_t read_ndef_text(rc522_picc_t *picc, nfc_tag_slot_t *slot)
+{
+    // Static: only the rc522 event task reads tags, and its stack is sized
+    // by the library.
+    static uint8_t buf[NFC_NDEF_WINDOW];
+    size_t text_off = 0, text_len = 0;
+    bool found = false;
+    uint8_t copied = 0;
+
+    for (size_t avail = 0; avail < NFC_NDEF_WINDOW; ) {
+        uint8_t page_addr = 4 + (uint8_t)(avail / RC522_NXP_PAGE_SIZE);
+        health_beat(HEALTH_TASK_NFC_SCAN);
+        esp_err_t ret = rc522_nxp_read(s_scanner, picc, page_addr, &buf[avail]);
+        if (ret != ESP_OK) {
+            ESP_LOGD(TAG, "NDEF read failed at page %u: %s", page_addr, esp_err_to_name(ret));
+            telemetry_count(TELEM_NFC_READ_ERRORS);
+            if (copied == 0) return NFC_SLOT_NO_TEXT;
+            telemetry_count(TELEM_NFC_READ_ABORTS);
+            return NFC_SLOT_ABORTED;
+        }
+        avail += RC522_NXP_READ_SIZE;
+
+        if (!found) {
+            ndef_find_t r = ndef_find_text(buf, avail, NFC_NDEF_WINDOW, NFC_PAYLOAD_MAX_LEN,
+                                           &text_off, &text_len);
+            if (r == NDEF_FIND_MORE) continue;
+            if (r == NDEF_FIND_NONE) break;
+            found = true;
+        }
 
-        if (i + payload_len > msg_end || payload_len < 1) return false;
+        // Hand out what this read completed, up to an embedded NUL.
+        size_t end = text_off + text_len < avail ? text_off + text_len : avail;
+        uint8_t before = copied;
+        while (text_off + copied < end) {
+            char c = (char)buf[text_off + copied];
+            if (c == '\0') {
+                text_len = copied;
+                break;
+            }
+            slot->payload[copied++] = c;
+        }
+        if (copied != before) {
+            slot_publish_text(slot, copied);
+        }
+        if (copied == text_len) {
+            if (copied == 0) break;
+            slot->payload[copied] = '\0';
+            return NFC_SLOT_COMPLETE;
+        }
+    }
 
-        // Text payload: [status][lang_code][text]
-        // status bit 7 = UTF-16 if set, bits 0..5 = lang_code length.
-        uint8_t status = buf[i];
-        if (status & 0x80) return false;       // UTF-16 not supported
-        size_t lang_len = status & 0x3F;
-        if (1 + lang_len > payload_len) return false;
+    telemetry_count(TELEM_NDEF_PARSE_FAILS);
+    return NFC_SLOT_NO_TEXT;
+}
 
-        size_t text_off = i + 1 + lang_len;
-        size_t text_len = payload_len - 1 - lang_len;
-        if (text_len > max_text_len) text_len = max_text_len;
+// Estimate how long the tag sat in the field before we saw it, assuming it
+// arrived uniformly at random: half a poll interval while scanning, plus half
+// the preceding pause if it was caught by the first poll of a burst. The
+// upper bound (whole pause + one interval) feeds max_detect_latency_ms.
+static void poll_record_detection(int64_t now_us)
+{
+    const int64_t poll_us = NFC_HEARTBEAT_US;
+    int64_t est_us = poll_us / 2;
+    int64_t bound_us = poll_us;
+    if (s_last_gap_us > 0 && now_us - s_state_since_us <= 2 * poll_us) {
+        est_us += s_last_gap_us / 2;
+        bound_us += s_last_gap_us;
+    }
+    s_latency_sum_us += est_us;
+    s_poll_stats.detections++;
+    s_poll_stats.mean_detect_latency_ms = (uint32_t)(s_latency_sum_us / s_poll_stats.detections / 1000);
+    if (bound_us / 1000 > s_poll_stats.max_detect_latency_ms) {
+        s_poll_stats.max_detect_latency_ms = (uint32_t)(bound_us / 1000);
+    }
+}
 
-        memcpy(out_text, &buf[text_off], text_len);
-        out_text[text_len] = '\0';
-        return text_len > 0;
+// Scanner side: claim a free slot according to the busy policy. Never blocks.
+// Returns false if the tag should be dropped.
+static bool handoff_acquire(uint8_t *idx)
+{
+#if CONFIG_COSMO_NFC_BUSY_DROP
+    if (s_dispatch_busy || uxQueueMessagesWaiting(s_ready_slots) > 0) {
+        portENTER_CRITICAL(&s_stats_lock);
+        s_queue_stats.dropped++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        telemetry_count(TELEM_NFC_DROPPED);
+        ESP_LOGW(TAG, "Tag dropped: previous string still typing");
+        return false;
+    }
+#elif CONFIG_COSMO_NFC_BUSY_SUPERSEDE
+    // Abort the string being typed and recycle everything still pending.
+    if (s_dispatch_busy) {
+        s_generation++;
+        portENTER_CRITICAL(&s_stats_lock);
+        s_queue_stats.superseded++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        telemetry_count(TELEM_NFC_SUPERSEDED);
+    }
+    uint8_t stale;
+    while (xQueueReceive(s_ready_slots, &stale, 0) == pdTRUE) {
+        xQueueSend(s_free_slots, &stale, 0);
+        portENTER_CRITICAL(&s_stats_lock);
+        s_queue_stats.superseded++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        telemetry_count(TELEM_NFC_SUPERSEDED);
+    }
+#endif
+    if (xQueueReceive(s_free_slots, idx, 0) != pdTRUE) {
+        portENTER_CRITICAL(&s_stats_lock);
+        s_queue_stats.dropped++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        telemetry_count(TELEM_NFC_DROPPED);
+        ESP_LOGW(TAG, "Tag dropped: handoff queue full (%d pending)", NFC_QUEUE_DEPTH);
+        return false;
     }
+    return true;
+}
 
-    return false;
+static void handoff_publish(uint8_t idx)
+{
+    // Cannot fail: a slot only exists outside the free queue if there is room
+    // for it in the ready queue (NFC_SLOT_COUNT = depth + the one in flight).
+    s_slots[idx].queued_us = esp_timer_get_time();
+    xQueueSend(s_ready_slots, &idx, 0);
+    portENTER_CRITICAL(&s_stats_lock);
+    s_queue_stats.enqueued++;
+    uint8_t depth = (uint8_t)uxQueueMessagesWaiting(s_ready_slots);
+    s_queue_stats.depth = depth;
+    if (depth > s_queue_stats.high_water) {
+        s_queue_stats.high_water = depth;
+    }
+    portEXIT_CRITICAL(&s_stats_lock);
+    telemetry_max(TELEM_NFC_QUEUE_HWM, depth);
 }
 
-// Read enough NTAG user pages to (usually) cover an NDEF Text payload of
-// length up to NFC_PAYLOAD_MAX_LEN, then parse. Returns true on success.
-static bool try_read_ndef_text(rc522_picc_t *picc, char *out_text, size_t max_text_len)
+// Consumer side: runs the (possibly slow) user callback off the scanner task.
+static void nfc_dispatch_task(void *arg)
 {
-    // 12 pages = 48 bytes — fits an NDEF Text record with up to ~38 chars
-    // after TLV + header overhead. Three sequential 16-byte reads from page 4.
-    enum { NDEF_BUF_LEN = 48 };
-    uint8_t buf[NDEF_BUF_LEN];
-
-    for (size_t off = 0; off < NDEF_BUF_LEN; off += RC522_NXP_READ_SIZE) {
-        uint8_t page_addr = 4 + (uint8_t)(off / RC522_NXP_PAGE_SIZE);
-        esp_err_t ret = rc522_nxp_read(s_scanner, picc, page_addr, &buf[off]);
-        if (ret != ESP_OK) {
-            ESP_LOGD(TAG, "NDEF read failed at page %u: %s", page_addr, esp_err_to_name(ret));
-            return false;
+    uint8_t idx;
+    for (;;) {
+        if (xQueueReceive(s_ready_slots, &idx, portMAX_DELAY) != pdTRUE) {
+            continue;
         }
-    }
+        portENTER_CRITICAL(&s_stats_lock);
+        s_queue_stats.depth = (uint8_t)uxQueueMessagesWaiting(s_ready_slots);
+        portEXIT_CRITICAL(&s_stats_lock);
+
+        nfc_tag_slot_t *slot = &s_slots[idx];
+        telemetry_latency(TELEM_LAT_NFC_QUEUE, slot->queued_us);
+        s_dispatch_generation = s_generation;
+        s_dispatch_busy = true;
+        s_dispatch_slot = slot;
+        s_dispatch_pos = 0;
+        int64_t start_us = esp_timer_get_time();
+        health_beat(HEALTH_TASK_NFC_DISPATCH);
+        if (s_callback) {
+            s_callback(slot->uid_hex, slot->detected_us);
+        }
+        health_idle(HEALTH_TASK_NFC_DISPATCH);
+        telemetry_latency(TELEM_LAT_NFC_TYPE, start_us);
+        s_dispatch_busy = false;
 
-    return parse_ndef_text(buf, NDEF_BUF_LEN, out_text, max_text_len);
+        xQueueSend(s_free_slots, &idx, 0);
+    }
 }
 
 static void on_picc_state_changed(void *arg, esp_event_base_t base, int32_t event_id, void *data)
@@ -176,44 +447,167 @@ static void on_picc_state_changed(void *arg, esp_event_base_t base, int32_t even
     rc522_picc_t *picc = event->picc;
 
     if (picc->state == RC522_PICC_STATE_ACTIVE) {
+        if (picc->uid.length == 0 || picc->uid.length > RC522_PICC_UID_SIZE_MAX) {
+            return;
+        }
+
+        // De-duplicate on the binary UID: a tag that is still (or again, after a
+        // flicker) in the field is the same placement, not a fresh scan.
+        int64_t now_us = esp_timer_get_time();
+        s_last_tag_us = now_us;
+        if (!presence_on_arrive(&picc->uid, now_us)) {
+            ESP_LOGD(TAG, "Tag re-entered before departing, suppressed");
+            telemetry_count(TELEM_NFC_CACHE_HITS);
+            return;
+        }
+        poll_record_detection(now_us);
+
+        // Provisioning mode writes the card instead of typing it.
+        if (nfc_provision_is_active()) {
+            health_beat(HEALTH_TASK_NFC_SCAN);
+            nfc_provision_handle_tag(s_scanner, picc);
+            health_idle(HEALTH_TASK_NFC_SCAN);
+            return;
+        }
+
+        uint8_t idx;
+        if (!handoff_acquire(&idx)) {
+            return;
+        }
+        nfc_tag_slot_t *slot = &s_slots[idx];
+        evlog_put_bytes(EVLOG_NFC_TAG, picc->uid.value, picc->uid.length);
+
         // Continuous uppercase hex, no separators. Buffer fits worst case (10 bytes -> 20 hex + NUL).
-        char uid_hex[RC522_PICC_UID_SIZE_MAX * 2 + 1];
-        char *p = uid_hex;
+        char *p = slot->uid_hex;
         for (uint8_t i = 0; i < picc->uid.length; i++) {
             p += sprintf(p, "%02X", picc->uid.value[i]);
         }
         *p = '\0';
-
-        // De-duplicate: same UID within the dedup window is a heartbeat flicker, not a fresh scan.
-        int64_t now_us = esp_timer_get_time();
-        if (strcmp(uid_hex, s_last_uid) == 0 && (now_us - s_last_uid_time_us) < NFC_DEDUP_WINDOW_US) {
-            ESP_LOGD(TAG, "Tag re-detected within dedup window: UID=%s, suppressed", uid_hex);
-            s_last_uid_time_us = now_us;  // refresh window so steady contact stays suppressed
+        slot->detected_us = now_us;
+        slot->text_len = 0;
+        slot->state = NFC_SLOT_READING;
+        telemetry_count(TELEM_NFC_READS);
+
+        // A card listed in the UID index types its listed ID, whatever its
+        // pages hold: the slot goes over complete and no page is read.
+        const char *listed;
+        uint8_t listed_len;
+        if (uid_index_lookup(picc->uid.value, picc->uid.length, &listed, &listed_len)) {
+            memcpy(slot->payload, listed, listed_len);
+            slot->payload[listed_len] = '\0';
+            slot->text_len = listed_len;
+            slot->state = NFC_SLOT_COMPLETE;
+            handoff_publish(idx);
+            telemetry_count(TELEM_NFC_INDEX_HITS);
+            telemetry_latency(TELEM_LAT_NFC_READ, now_us);
+            evlog_put(EVLOG_NFC_INDEX_HIT, listed_len, 0, 0);
+            evlog_put_bytes(EVLOG_NFC_PAYLOAD, slot->payload, listed_len);
             return;
         }
-        strncpy(s_last_uid, uid_hex, sizeof(s_last_uid) - 1);
-        s_last_uid[sizeof(s_last_uid) - 1] = '\0';
-        s_last_uid_time_us = now_us;
-
-        // Try to read an NDEF Text payload from the tag. Falls back to NULL on
-        // any parse/read failure — main app then types the UID as a debug aid.
-        char payload[NFC_PAYLOAD_MAX_LEN + 1];
-        const char *payload_arg = NULL;
-        if (try_read_ndef_text(picc, payload, NFC_PAYLOAD_MAX_LEN)) {
-            payload_arg = payload;
-            ESP_LOGI(TAG, "Tag detected: UID=%s payload=\"%s\"", uid_hex, payload);
-        } else {
-            ESP_LOGI(TAG, "Tag detected: UID=%s (no NDEF Text record, falling back to UID)", uid_hex);
-        }
 
-        if (s_callback) {
-            s_callback(payload_arg, uid_hex);
+        // Hand the tag over first and read its NDEF Text payload into the
+        // slot afterwards, so the first characters are typed while the
+        // later pages are still on their way. Any parse/read failure ends
+        // in NO_TEXT — main app then types the UID as a debug aid.
+        handoff_publish(idx);
+        nfc_slot_state_t state = read_ndef_text(picc, slot);
+        slot_finish(slot, state);
+        health_idle(HEALTH_TASK_NFC_SCAN);
+        telemetry_latency(TELEM_LAT_NFC_READ, now_us);
+        if (state == NFC_SLOT_COMPLETE) {
+            evlog_put_bytes(EVLOG_NFC_PAYLOAD, slot->payload, slot->text_len);
+        } else if (state == NFC_SLOT_NO_TEXT) {
+            evlog_put(EVLOG_NFC_NO_PAYLOAD, 0, 0, 0);
         }
     } else if (picc->state == RC522_PICC_STATE_IDLE && event->old_state >= RC522_PICC_STATE_ACTIVE) {
+        s_last_tag_us = esp_timer_get_time();
+        presence_on_leave(s_last_tag_us);
         ESP_LOGD(TAG, "Tag removed");
     }
 }
 
+#if CONFIG_COSMO_NFC_ADAPTIVE_POLL
+static void scanner_set_running(bool run)
+{
+    if (run == s_scanner_running) return;
+
+    int64_t now_us = esp_timer_get_time();
+    int64_t spent_us = now_us - s_state_since_us;
+    if (s_scanner_running) {
+        s_poll_stats.running_ms += (uint32_t)(spent_us / 1000);
+        rc522_pause(s_scanner);
+    } else {
+        s_poll_stats.paused_ms += (uint32_t)(spent_us / 1000);
+        s_last_gap_us = spent_us;
+        rc522_start(s_scanner);
+    }
+    s_scanner_running = run;
+    s_state_since_us = now_us;
+}
+
+// Scan period for the current activity level: 0 (continuous) for the hold
+// window after activity, then a linear ramp up to the idle period.
+static uint32_t poll_period_for_idle(uint32_t idle_ms)
+{
+    if (idle_ms <= CONFIG_COSMO_NFC_ACTIVE_HOLD_MS) return 0;
+    uint32_t into_decay = idle_ms - CONFIG_COSMO_NFC_ACTIVE_HOLD_MS;
+    if (into_decay >= CONFIG_COSMO_NFC_DECAY_MS) return CONFIG_COSMO_NFC_IDLE_PERIOD_MS;
+    uint32_t period = (uint32_t)((uint64_t)CONFIG_COSMO_NFC_IDLE_PERIOD_MS * into_decay
+                                 / CONFIG_COSMO_NFC_DECAY_MS);
+    return period <= CONFIG_COSMO_NFC_BURST_MS ? 0 : period;
+}
+
+uint32_t nfc_handler_get_idle_time_ms(void)
+{
+    uint32_t idle_ms = input_handler_get_idle_time_ms();
+    uint32_t tag_idle_ms = (uint32_t)((esp_timer_get_time() - s_last_tag_us) / 1000);
+    return tag_idle_ms < idle_ms ? tag_idle_ms : idle_ms;
+}
+
+// Must keep scanning regardless of idle time: a tag is (or just was) in the
+// field — pausing would read as missed heartbeats — or we are provisioning.
+static bool scanner_pinned(void)
+{
+    return s_in_field != NULL || nfc_provision_is_active();
+}
+
+static void nfc_sched_task(void *arg)
+{
+    for (;;) {
+        uint32_t prev_period_ms = s_period_ms;
+        s_period_ms = poll_period_for_idle(nfc_handler_get_idle_time_ms());
+        if ((prev_period_ms == 0) != (s_period_ms == 0)) {
+            nfc_poll_stats_t st;
+            nfc_handler_get_poll_stats(&st);
+            ESP_LOGI(TAG, "Scan %s — duty %u.%u%%, detect latency mean %lu ms / max %lu ms (%lu tags)",
+                     s_period_ms ? "duty-cycling (idle)" : "continuous (active)",
+                     st.duty_permille / 10, st.duty_permille % 10,
+                     (unsigned long)st.mean_detect_latency_ms,
+                     (unsigned long)st.max_detect_latency_ms, (unsigned long)st.detections);
+        }
+        if (s_period_ms == 0 || scanner_pinned()) {
+            scanner_set_running(true);
+            vTaskDelay(pdMS_TO_TICKS(NFC_SCHED_TICK_MS * 5));
+            continue;
+        }
+
+        // One burst, then pause for the rest of the period — but re-check
+        // often so a knob turn switches to continuous scanning immediately.
+        scanner_set_running(true);
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_COSMO_NFC_BURST_MS));
+        if (scanner_pinned()) continue;
+
+        scanner_set_running(false);
+        int64_t wake_us = esp_timer_get_time()
+                        + (int64_t)(s_period_ms - CONFIG_COSMO_NFC_BURST_MS) * 1000;
+        while (esp_timer_get_time() < wake_us
+               && poll_period_for_idle(nfc_handler_get_idle_time_ms()) != 0) {
+            vTaskDelay(pdMS_TO_TICKS(NFC_SCHED_TICK_MS));
+        }
+    }
+}
+#endif
+
 esp_err_t nfc_handler_init(void)
 {
     if (s_scanner != NULL) {
@@ -221,6 +615,32 @@ esp_err_t nfc_handler_init(void)
         return ESP_OK;
     }
 
+    s_free_slots = xQueueCreateStatic(NFC_SLOT_COUNT, sizeof(uint8_t),
+                                      s_free_slots_storage, &s_free_slots_buf);
+    s_ready_slots = xQueueCreateStatic(NFC_SLOT_COUNT, sizeof(uint8_t),
+                                       s_ready_slots_storage, &s_ready_slots_buf);
+    if (s_free_slots == NULL || s_ready_slots == NULL) {
+        ESP_LOGE(TAG, "Failed to create handoff queues");
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint8_t i = 0; i < NFC_SLOT_COUNT; i++) {
+        xQueueSend(s_free_slots, &i, 0);
+    }
+    s_text_ready = xSemaphoreCreateBinaryStatic(&s_text_ready_buf);
+
+    mem_report_add_static(MEM_MOD_NFC, sizeof(s_slots) + sizeof(s_presence)
+                                     + sizeof(s_free_slots_buf) + sizeof(s_free_slots_storage)
+                                     + sizeof(s_ready_slots_buf) + sizeof(s_ready_slots_storage)
+                                     + sizeof(s_text_ready_buf)
+                                     + sizeof(s_dispatch_task_tcb) + sizeof(s_dispatch_task_stack)
+#if CONFIG_COSMO_NFC_ADAPTIVE_POLL
+                                     + sizeof(s_sched_task_tcb) + sizeof(s_sched_task_stack)
+#endif
+                          );
+
+    // The rc522 library allocates its driver, scanner, event loop and scanner
+    // task once here; charge that to this module (if NFC comes up at all).
+    size_t heap_mark = mem_report_heap_begin();
     esp_err_t ret = rc522_spi_create(&s_driver_config, &s_driver);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "rc522_spi_create failed: %s", esp_err_to_name(ret));
@@ -233,8 +653,13 @@ esp_err_t nfc_handler_init(void)
         return ret;
     }
 
-    rc522_config_t scanner_config = { .driver = s_driver };
+    rc522_config_t scanner_config = {
+        .driver = s_driver,
+        .poll_interval_ms = CONFIG_COSMO_NFC_POLL_INTERVAL_MS,
+        .task_priority = NFC_SCAN_PRIO,
+    };
     ret = rc522_create(&scanner_config, &s_scanner);
+    mem_report_heap_end(MEM_MOD_NFC, heap_mark);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "rc522_create failed: %s", esp_err_to_name(ret));
         return ret;
@@ -263,5 +688,104 @@ esp_err_t nfc_handler_start(void)
         ESP_LOGE(TAG, "nfc_handler_init must be called first");
         return ESP_ERR_INVALID_STATE;
     }
-    return rc522_start(s_scanner);
+
+    if (s_dispatch_task == NULL) {
+        s_dispatch_task = xTaskCreateStaticPinnedToCore(nfc_dispatch_task, "nfc_dispatch",
+                                                        NFC_DISPATCH_STACK, NULL, NFC_DISPATCH_PRIO,
+                                                        s_dispatch_task_stack, &s_dispatch_task_tcb,
+                                                        NFC_TASK_CORE);
+        if (s_dispatch_task == NULL) {
+            ESP_LOGE(TAG, "Failed to create dispatch task");
+            return ESP_ERR_NO_MEM;
+        }
+        mem_report_add_task(MEM_TASK_NFC_DISPATCH, s_dispatch_task, NFC_DISPATCH_STACK);
+    }
+
+    esp_err_t ret = rc522_start(s_scanner);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    s_scanner_running = true;
+    s_state_since_us = esp_timer_get_time();
+    s_last_tag_us = s_state_since_us;
+
+#if CONFIG_COSMO_NFC_ADAPTIVE_POLL
+    if (s_sched_task == NULL) {
+        s_sched_task = xTaskCreateStaticPinnedToCore(nfc_sched_task, "nfc_sched", NFC_SCHED_STACK, NULL,
+                                                     NFC_SCHED_PRIO, s_sched_task_stack,
+                                                     &s_sched_task_tcb, NFC_TASK_CORE);
+        if (s_sched_task == NULL) {
+            ESP_LOGW(TAG, "Failed to create scan scheduler — polling continuously");
+        } else {
+            mem_report_add_task(MEM_TASK_NFC_SCHED, s_sched_task, NFC_SCHED_STACK);
+        }
+    }
+#endif
+    return ESP_OK;
+}
+
+nfc_text_t nfc_handler_next_char(char *c)
+{
+    nfc_tag_slot_t *slot = s_dispatch_slot;
+    if (slot == NULL) {
+        return NFC_TEXT_NONE;
+    }
+    for (;;) {
+        // State before length: a final state implies the final length.
+        uint8_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+        uint8_t len = __atomic_load_n(&slot->text_len, __ATOMIC_ACQUIRE);
+        if (state == NFC_SLOT_ABORTED) {
+            return NFC_TEXT_ABORTED;
+        }
+        if (s_dispatch_pos < len) {
+            *c = slot->payload[s_dispatch_pos++];
+            return NFC_TEXT_CHAR;
+        }
+        if (state == NFC_SLOT_COMPLETE) {
+            return NFC_TEXT_END;
+        }
+        if (state == NFC_SLOT_NO_TEXT) {
+            return NFC_TEXT_NONE;
+        }
+        // The scanner always finishes the slot it handed over, so this ends.
+        xSemaphoreTake(s_text_ready, portMAX_DELAY);
+    }
+}
+
+bool nfc_handler_char_ready(void)
+{
+    nfc_tag_slot_t *slot = s_dispatch_slot;
+    if (slot == NULL) {
+        return true;
+    }
+    uint8_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+    return state != NFC_SLOT_READING || s_dispatch_pos < __atomic_load_n(&slot->text_len, __ATOMIC_ACQUIRE);
+}
+
+bool nfc_handler_is_superseded(void)
+{
+    return s_dispatch_generation != s_generation;
+}
+
+void nfc_handler_get_queue_stats(nfc_queue_stats_t *out)
+{
+    portENTER_CRITICAL(&s_stats_lock);
+    *out = s_queue_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+void nfc_handler_get_poll_stats(nfc_poll_stats_t *out)
+{
+    *out = s_poll_stats;
+
+    // Fold in the time spent in the current state so the duty cycle is live.
+    uint32_t current_ms = (uint32_t)((esp_timer_get_time() - s_state_since_us) / 1000);
+    if (s_scanner_running) {
+        out->running_ms += current_ms;
+    } else {
+        out->paused_ms += current_ms;
+    }
+    uint32_t total_ms = out->running_ms + out->paused_ms;
+    out->duty_permille = total_ms ? (uint16_t)((uint64_t)out->running_ms * 1000 / total_ms) : 1000;
+    out->period_ms = s_period_ms;
 }
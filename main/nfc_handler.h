@@ -2,12 +2,15 @@
  * NFC Handler Module
  * RC522 SPI scanner integration for NTAG / Mifare tag detection.
  * Reads NDEF Text Record payload when present; falls back to UID on parse failure.
+ * The payload is streamed to the consumer while later pages are still read.
  */
 
 #ifndef _NFC_HANDLER_H_
 #define _NFC_HANDLER_H_
 
 #include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,17 +20,74 @@ extern "C" {
 // Keep small enough that HID typing latency stays under ~1s.
 #define NFC_PAYLOAD_MAX_LEN 32
 
-// Invoked when a tag is detected.
-//   payload: NDEF Text Record content, NULL-terminated, or NULL if no parseable
-//            Text record was found on the tag.
-//   uid_hex: always non-NULL; the card's UID as continuous uppercase hex.
-// Both buffers are owned by the caller — copy if you need them past the callback.
-typedef void (*nfc_tag_callback_t)(const char *payload, const char *uid_hex);
+// nfc_handler_next_char() result
+typedef enum {
+    NFC_TEXT_CHAR = 0,      // *c is the next payload character
+    NFC_TEXT_END,           // the whole payload has been handed out
+    NFC_TEXT_NONE,          // no parseable Text record; nothing was handed out
+    NFC_TEXT_ABORTED,       // the tag left mid-read: the characters handed out are void
+} nfc_text_t;
+
+// Invoked when a tag is detected, before its NDEF area has been read.
+//   uid_hex:     the card's UID as continuous uppercase hex, owned by the caller.
+//   detected_us: esp_timer time the scanner saw the tag, for end-to-end latency.
+// Pull the Text payload with nfc_handler_next_char(): each character is
+// available as soon as the page holding it has been read and the record
+// header checked, so typing overlaps the rest of the read.
+// Runs on the NFC dispatch task, never on the rc522 scanner task, so it may
+// block (e.g. type the string over HID) without stalling tag detection.
+typedef void (*nfc_tag_callback_t)(const char *uid_hex, int64_t detected_us);
+
+// Handoff queue counters (scanner -> dispatch task). Monotonic since boot.
+typedef struct {
+    uint32_t enqueued;      // tags handed to the dispatch task
+    uint32_t dropped;       // tags discarded by the busy policy or a full queue
+    uint32_t superseded;    // tags aborted mid-typing or flushed while pending
+    uint8_t  depth;         // tags currently pending
+    uint8_t  high_water;    // max pending seen
+} nfc_queue_stats_t;
+
+// Adaptive scan scheduler counters. Latencies are estimates: the true
+// arrival time of a tag is unobservable, so each detection is credited half
+// a poll interval plus half of any scanner pause just before it.
+typedef struct {
+    uint32_t running_ms;            // total time the scanner was polling
+    uint32_t paused_ms;             // total time it was duty-cycled off
+    uint16_t duty_permille;         // running / (running + paused), 0..1000
+    uint32_t period_ms;             // current scan period, 0 = continuous
+    uint32_t detections;            // new placements seen
+    uint32_t mean_detect_latency_ms;
+    uint32_t max_detect_latency_ms; // upper bound, worst single detection
+} nfc_poll_stats_t;
 
 esp_err_t nfc_handler_init(void);
 void nfc_handler_set_callback(nfc_tag_callback_t cb);
 esp_err_t nfc_handler_start(void);
 
+/**
+ * Next character of the tag being dispatched, blocking while the scanner is
+ * still reading the page that holds it. Only from the tag callback.
+ *
+ * @param c  Receives the character when NFC_TEXT_CHAR is returned
+ * @return   NFC_TEXT_CHAR until the payload ends or the read fails
+ */
+nfc_text_t nfc_handler_next_char(char *c);
+
+// True if nfc_handler_next_char() would return without waiting for the
+// scanner. Lets the typer decide whether to hold a key for the next one.
+bool nfc_handler_char_ready(void);
+
+// True once a newer tag has superseded the one currently being dispatched
+// (CONFIG_COSMO_NFC_BUSY_SUPERSEDE only). Poll between characters from the
+// callback and stop typing early when it flips.
+bool nfc_handler_is_superseded(void);
+
+void nfc_handler_get_queue_stats(nfc_queue_stats_t *out);
+void nfc_handler_get_poll_stats(nfc_poll_stats_t *out);
+
+// Milliseconds since the last knob / button input or tag arrival / departure
+uint32_t nfc_handler_get_idle_time_ms(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,326 @@
+/*
+ * NFC Provisioning Mode Implementation
+ *
+ * The ID list is main/provision_list.txt, embedded at build time: one ID per
+ * line, blank lines and '#' comments ignored. Entries are walked in place in
+ * flash; nothing is copied to RAM.
+ *
+ * Per card: read the current 48-byte NDEF window, skip the card if it already
+ * holds a list ID, write only the pages that differ (page 4 — the TLV length —
+ * last, so an interrupted write never looks like a valid shorter record),
+ * then read back and re-parse to verify.
+ *
+ * Only the rc522 event task touches the list cursor and the session
+ * counters. nfc_provision_enter() / _exit() may run on any task, often while
+ * a card is being written, so they only post the request under s_lock; the
+ * scanner starts the new session at its next card, and publishes its
+ * counters after every card for nfc_provision_get_stats().
+ */
+
+#include <string.h>
+#include "nfc_provision.h"
+#include "nfc_handler.h"
+#include "ndef_parser.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "picc/rc522_nxp.h"
+
+static const char *TAG = "NFC_PROV";
+
+extern const char provision_list_start[] asm("_binary_provision_list_txt_start");
+extern const char provision_list_end[]   asm("_binary_provision_list_txt_end");
+
+// Same window nfc_handler reads; an encoded NFC_PAYLOAD_MAX_LEN ID fits in it.
+#define PROV_NDEF_WINDOW  48
+#define PROV_FIRST_PAGE   4
+
+// Requested mode, shared; guarded by s_lock. Every enter starts a new session.
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_active = false;
+static uint32_t s_session = 0;
+static uint32_t s_list_len = 0;
+static int64_t s_session_start_us = 0;
+static nfc_provision_stats_t s_published = {0};
+
+static nfc_provision_callback_t s_callback = NULL;
+
+// Scanner-side session state, rc522 event task only.
+static uint32_t s_running_session = 0;
+static nfc_provision_stats_t s_stats = {0};
+static const char *s_cursor = NULL;     // next list entry
+static int64_t s_running_start_us = 0;
+
+// Working buffers for one card. Only the rc522 event task provisions, so a
+// single static copy keeps them off that task's library-sized stack.
+static struct {
+    char id[NFC_PAYLOAD_MAX_LEN + 1];
+    char existing[NFC_PAYLOAD_MAX_LEN + 1];
+    uint8_t current[PROV_NDEF_WINDOW];
+    uint8_t target[PROV_NDEF_WINDOW];
+    uint8_t readback[PROV_NDEF_WINDOW];
+} s_work;
+
+// Advance `p` to the next list entry. Returns its length (0 = end of list)
+// and leaves *p on the entry's first character.
+static size_t list_next(const char **p)
+{
+    const char *end = provision_list_end;
+    const char *s = *p;
+    while (s < end && *s != '\0') {
+        const char *line = s;
+        while (s < end && *s != '\n' && *s != '\0') s++;
+        const char *eol = s;
+        if (s < end && *s == '\n') s++;
+
+        while (line < eol && (*line == ' ' || *line == '\t')) line++;
+        while (eol > line && (eol[-1] == ' ' || eol[-1] == '\t' || eol[-1] == '\r')) eol--;
+        if (line == eol || *line == '#') continue;
+
+        *p = line;
+        return (size_t)(eol - line);
+    }
+    *p = end;
+    return 0;
+}
+
+static size_t list_skip_entry(const char **p, size_t len)
+{
+    *p += len;
+    return list_next(p);
+}
+
+static bool list_contains(const char *text)
+{
+    size_t text_len = strlen(text);
+    const char *p = provision_list_start;
+    for (size_t len = list_next(&p); len > 0; len = list_skip_entry(&p, len)) {
+        if (len == text_len && memcmp(p, text, len) == 0) return true;
+    }
+    return false;
+}
+
+static void update_rates(void)
+{
+    uint32_t attempts = s_stats.written + s_stats.failed;
+    s_stats.error_rate = attempts ? (float)s_stats.failed / (float)attempts : 0.0f;
+    float minutes = (float)(esp_timer_get_time() - s_running_start_us) / 60e6f;
+    s_stats.cards_per_min = minutes > 0 ? (float)s_stats.written / minutes : 0.0f;
+}
+
+static bool read_window(rc522_handle_t scanner, rc522_picc_t *picc, uint8_t *buf)
+{
+    for (size_t off = 0; off < PROV_NDEF_WINDOW; off += RC522_NXP_READ_SIZE) {
+        uint8_t page = PROV_FIRST_PAGE + (uint8_t)(off / RC522_NXP_PAGE_SIZE);
+        if (rc522_nxp_read(scanner, picc, page, &buf[off]) != ESP_OK) return false;
+    }
+    return true;
+}
+
+static bool write_page(rc522_handle_t scanner, rc522_picc_t *picc, uint8_t page, const uint8_t *data)
+{
+    s_stats.page_writes++;
+    esp_err_t ret = rc522_nxp_write(scanner, picc, page, data);
+    if (ret != ESP_OK) {
+        s_stats.page_write_errors++;
+        ESP_LOGW(TAG, "Write page %u failed: %s", page, esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
+static void finish(nfc_provision_result_t result, const char *id)
+{
+    update_rates();
+    portENTER_CRITICAL(&s_lock);
+    // A card still in flight when the host restarted the session must not
+    // overwrite the new session's counters.
+    if (s_session == s_running_session) {
+        s_published = s_stats;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (s_callback) {
+        s_callback(result, id);
+    }
+}
+
+// Leave the mode at the end of the list, unless a new session was requested
+// meanwhile. Returns false in that case.
+static bool end_session(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool current = s_session == s_running_session;
+    if (current) {
+        s_active = false;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return current;
+}
+
+void nfc_provision_handle_tag(rc522_handle_t scanner, rc522_picc_t *picc)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool active = s_active;
+    uint32_t session = s_session;
+    uint32_t list_len = s_list_len;
+    int64_t start_us = s_session_start_us;
+    portEXIT_CRITICAL(&s_lock);
+    if (!active) return;
+
+    if (session != s_running_session) {
+        s_running_session = session;
+        memset(&s_stats, 0, sizeof(s_stats));
+        s_stats.list_len = list_len;
+        s_cursor = provision_list_start;
+        s_running_start_us = start_us;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    // nfc_provision_enter() checked that every entry fits.
+    size_t id_len = list_next(&s_cursor);
+    char *id = s_work.id;
+    if (id_len == 0) {
+        ESP_LOGW(TAG, "List exhausted — leaving provisioning mode");
+        if (end_session()) {
+            finish(NFC_PROVISION_DONE, "");
+        }
+        return;
+    }
+    memcpy(id, s_cursor, id_len);
+    id[id_len] = '\0';
+
+    uint8_t *current = s_work.current;
+    uint8_t *target = s_work.target;
+    char *existing = s_work.existing;
+
+    if (!read_window(scanner, picc, current)) {
+        s_stats.failed++;
+        ESP_LOGW(TAG, "Card read failed (not an NTAG?) — keep '%s' for next card", id);
+        finish(NFC_PROVISION_FAILED, id);
+        return;
+    }
+    if (ndef_parse_text(current, PROV_NDEF_WINDOW, existing, NFC_PAYLOAD_MAX_LEN)
+        && list_contains(existing)) {
+        s_stats.skipped++;
+        ESP_LOGW(TAG, "Card already provisioned as '%s' — skipped", existing);
+        finish(NFC_PROVISION_ALREADY, existing);
+        return;
+    }
+
+    size_t used = ndef_encode_text(id, target, PROV_NDEF_WINDOW);
+    if (used == 0) {
+        s_stats.failed++;
+        finish(NFC_PROVISION_FAILED, id);
+        return;
+    }
+
+    // Pages 5.. first, page 4 (TLV header) last; unchanged pages are skipped.
+    bool ok = true;
+    for (size_t off = RC522_NXP_PAGE_SIZE; ok && off < used; off += RC522_NXP_PAGE_SIZE) {
+        if (memcmp(&current[off], &target[off], RC522_NXP_PAGE_SIZE) != 0) {
+            ok = write_page(scanner, picc, PROV_FIRST_PAGE + off / RC522_NXP_PAGE_SIZE, &target[off]);
+        }
+    }
+    if (ok && memcmp(current, target, RC522_NXP_PAGE_SIZE) != 0) {
+        ok = write_page(scanner, picc, PROV_FIRST_PAGE, target);
+    }
+
+    // Verify: raw bytes and the parser's view must both match.
+    uint8_t *readback = s_work.readback;
+    if (ok) {
+        ok = read_window(scanner, picc, readback)
+          && memcmp(readback, target, used) == 0
+          && ndef_parse_text(readback, PROV_NDEF_WINDOW, existing, NFC_PAYLOAD_MAX_LEN)
+          && strcmp(existing, id) == 0;
+    }
+
+    if (!ok) {
+        s_stats.failed++;
+        update_rates();
+        ESP_LOGW(TAG, "'%s' failed to write/verify — retry with next card (err %.1f%%)",
+                 id, s_stats.error_rate * 100.0f);
+        finish(NFC_PROVISION_FAILED, id);
+        return;
+    }
+
+    s_stats.written++;
+    s_cursor += id_len;
+    s_stats.next_index++;
+    update_rates();
+    ESP_LOGI(TAG, "[%lu/%lu] '%s' written in %lld ms — %.1f cards/min, err %.1f%%",
+             (unsigned long)s_stats.next_index, (unsigned long)s_stats.list_len, id,
+             (long long)((esp_timer_get_time() - t0) / 1000),
+             s_stats.cards_per_min, s_stats.error_rate * 100.0f);
+    finish(NFC_PROVISION_WRITTEN, id);
+
+    const char *peek = s_cursor;
+    if (list_next(&peek) == 0) {
+        ESP_LOGI(TAG, "List complete: %lu written, %lu failed, %lu skipped",
+                 (unsigned long)s_stats.written, (unsigned long)s_stats.failed,
+                 (unsigned long)s_stats.skipped);
+        if (end_session()) {
+            finish(NFC_PROVISION_DONE, "");
+        }
+    }
+}
+
+void nfc_provision_set_callback(nfc_provision_callback_t cb)
+{
+    s_callback = cb;
+}
+
+esp_err_t nfc_provision_enter(void)
+{
+    // Check the whole list up front: an entry that cannot be written would
+    // otherwise end the session halfway through a batch.
+    uint32_t count = 0;
+    const char *p = provision_list_start;
+    for (size_t len = list_next(&p); len > 0; len = list_skip_entry(&p, len)) {
+        if (len > NFC_PAYLOAD_MAX_LEN) {
+            ESP_LOGE(TAG, "provision_list.txt entry %lu is %u chars, max %d — not entering provisioning mode",
+                     (unsigned long)count + 1, (unsigned)len, NFC_PAYLOAD_MAX_LEN);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        count++;
+    }
+    if (count == 0) {
+        ESP_LOGW(TAG, "provision_list.txt is empty");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    s_session++;
+    s_list_len = count;
+    s_session_start_us = now_us;
+    memset(&s_published, 0, sizeof(s_published));
+    s_published.list_len = count;
+    s_active = true;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Provisioning mode ON — %lu IDs queued", (unsigned long)count);
+    return ESP_OK;
+}
+
+void nfc_provision_exit(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool was_active = s_active;
+    s_active = false;
+    nfc_provision_stats_t stats = s_published;
+    portEXIT_CRITICAL(&s_lock);
+    if (!was_active) return;
+    ESP_LOGI(TAG, "Provisioning mode OFF — %lu written, %.1f cards/min, err %.1f%%",
+             (unsigned long)stats.written, stats.cards_per_min, stats.error_rate * 100.0f);
+}
+
+bool nfc_provision_is_active(void)
+{
+    return s_active;
+}
+
+void nfc_provision_get_stats(nfc_provision_stats_t *out)
+{
+    portENTER_CRITICAL(&s_lock);
+    *out = s_published;
+    portEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,69 @@
+/*
+ * NFC Provisioning Mode
+ * Batch-writes NDEF Text records from a preloaded ID list onto blank cards,
+ * verifies each by reading it back, and advances through the list.
+ */
+
+#ifndef _NFC_PROVISION_H_
+#define _NFC_PROVISION_H_
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include "rc522.h"
+#include "rc522_picc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    NFC_PROVISION_WRITTEN = 0,   // card written + verified, list advanced
+    NFC_PROVISION_ALREADY,       // card already carries an ID from the list, untouched
+    NFC_PROVISION_FAILED,        // write or verify failed; same ID retried on next card
+    NFC_PROVISION_DONE,          // list exhausted, mode left automatically
+} nfc_provision_result_t;
+
+// Session counters since the last nfc_provision_enter(), as of the last card.
+typedef struct {
+    uint32_t written;            // cards written and verified
+    uint32_t failed;             // cards where write or read-back failed
+    uint32_t skipped;            // cards that already held a list ID
+    uint32_t page_writes;        // 4-byte page writes issued
+    uint32_t page_write_errors;  // page writes the tag NAKed / timed out
+    uint32_t next_index;         // list position of the next ID to write
+    uint32_t list_len;
+    float cards_per_min;         // written cards over session wall time
+    float error_rate;            // failed / (written + failed)
+} nfc_provision_stats_t;
+
+// Invoked on the rc522 event task after every provisioning attempt.
+typedef void (*nfc_provision_callback_t)(nfc_provision_result_t result, const char *id);
+
+void nfc_provision_set_callback(nfc_provision_callback_t cb);
+
+/**
+ * Enter provisioning mode. While active, detected tags are written instead of
+ * typed over HID. Restarts the list and the session counters; the rc522 event
+ * task picks the new session up at its next card. Safe from any task, as is
+ * nfc_provision_exit().
+ *
+ * @return ESP_ERR_NOT_FOUND if the embedded list is empty,
+ *         ESP_ERR_INVALID_SIZE if an entry is longer than NFC_PAYLOAD_MAX_LEN
+ */
+esp_err_t nfc_provision_enter(void);
+void nfc_provision_exit(void);
+bool nfc_provision_is_active(void);
+void nfc_provision_get_stats(nfc_provision_stats_t *out);
+
+/**
+ * Internal — called by nfc_handler on the rc522 event task for each new
+ * placement while provisioning is active.
+ */
+void nfc_provision_handle_tag(rc522_handle_t scanner, rc522_picc_t *picc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NFC_PROVISION_H_ */
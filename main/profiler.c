@@ -0,0 +1,310 @@
+/*
+ * Sampling Profiler Module Implementation
+ * One gptimer per core, its alarm interrupt allocated on that core at
+ * level 1. A level-1 interrupt only ever preempts task code, and on entry
+ * the FreeRTOS Xtensa port stores the interrupted task's stack pointer —
+ * which then points at the saved exception frame — in the task's TCB as
+ * pxTopOfStack. The alarm callback reads PC and a0 from that frame. Both
+ * cores append to one ring with a relaxed fetch-add, so the ring keeps the
+ * newest samples; it is only read out once sampling has stopped.
+ *
+ * Interrupts are masked inside critical sections and while the flash cache
+ * is off (telemetry log writes), so those stretches show up as the first
+ * instruction after them, or not at all.
+ */
+
+#include <string.h>
+#include "profiler.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#if CONFIG_COSMO_PROFILER && defined(__XTENSA__)
+#define PROF_BACKEND        1
+#include "driver/gptimer.h"
+#include "esp_ipc.h"
+#include "esp_cpu.h"
+#include "xtensa_context.h"
+#else
+#define PROF_BACKEND        0
+#endif
+
+static const char *TAG = "PROF";
+
+#if PROF_BACKEND
+#define PROF_CAPACITY       CONFIG_COSMO_PROFILER_SAMPLES
+#define PROF_DEFAULT_HZ     CONFIG_COSMO_PROFILER_RATE_HZ
+#else
+#define PROF_CAPACITY       0
+#define PROF_DEFAULT_HZ     0
+#endif
+#define PROF_MIN_HZ         10
+#define PROF_MAX_HZ         10000
+#define PROF_TIMER_HZ       1000000
+#define PROF_TASK_NONE      0xFF    // task table full
+
+_Static_assert(sizeof(prof_sample_t) == 12, "sample layout");
+_Static_assert(sizeof(prof_header_t) <= PROF_PAGE_WORDS * 4, "header page layout");
+_Static_assert(PROF_TASKS_MAX < PROF_TASK_NONE, "task index range");
+
+static volatile bool s_running = false;
+static uint32_t s_rate_hz = 0;
+static int64_t s_start_us = 0;
+static int64_t s_stop_us = 0;
+static uint32_t s_taken = 0;                // samples since start (fetch-add by both cores)
+static uint32_t s_task_misses = 0;
+static uint32_t s_cursor = 0;               // next dump page
+
+// Names of the tasks seen while sampling, indexed by prof_sample_t.task
+static char s_task_names[PROF_TASKS_MAX][PROF_TASK_NAME_LEN];
+static uint32_t s_task_count = 0;
+
+#if PROF_BACKEND
+_Static_assert((PROF_CAPACITY & (PROF_CAPACITY - 1)) == 0, "profiler ring size must be a power of two");
+
+// Handles are looked up lock-free; a new task is added under the lock and
+// published by the release store of the count.
+static TaskHandle_t s_task_handles[PROF_TASKS_MAX];
+static portMUX_TYPE s_task_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static EXT_RAM_BSS_ATTR prof_sample_t s_samples[PROF_CAPACITY];
+static gptimer_handle_t s_timers[portNUM_PROCESSORS];
+static bool s_timers_ready = false;
+
+static uint8_t task_index(TaskHandle_t task)
+{
+    uint32_t n = __atomic_load_n(&s_task_count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < n; i++) {
+        if (s_task_handles[i] == task) return (uint8_t)i;
+    }
+
+    uint8_t index = PROF_TASK_NONE;
+    portENTER_CRITICAL_ISR(&s_task_lock);
+    n = s_task_count;
+    for (uint32_t i = 0; i < n; i++) {
+        if (s_task_handles[i] == task) {
+            index = (uint8_t)i;
+            break;
+        }
+    }
+    if (index == PROF_TASK_NONE && n < PROF_TASKS_MAX) {
+        // The name is copied now: the task may be gone by the time of the dump.
+        s_task_handles[n] = task;
+        strncpy(s_task_names[n], pcTaskGetName(task), PROF_TASK_NAME_LEN);
+        __atomic_store_n(&s_task_count, n + 1, __ATOMIC_RELEASE);
+        index = (uint8_t)n;
+    } else if (index == PROF_TASK_NONE) {
+        s_task_misses++;
+    }
+    portEXIT_CRITICAL_ISR(&s_task_lock);
+    return index;
+}
+
+// a0 of a windowed call holds the window increment in its top two bits; the
+// call instruction is 3 bytes before the return address.
+static inline uint32_t call_site(uint32_t a0)
+{
+    return ((a0 & 0x3FFFFFFF) | 0x40000000) - 3;
+}
+
+static bool sample_cb(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *arg)
+{
+    prof_sample_t s = { .core = (uint8_t)esp_cpu_get_core_id() };
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    if (xPortInterruptedFromISRContext()) {
+        s.flags = PROF_SAMPLE_NESTED;
+    } else {
+        const XtExcFrame *frame = *(XtExcFrame *const *)task;     // pxTopOfStack
+        s.pc = frame->pc;
+        s.caller = frame->a0 != 0 ? call_site(frame->a0) : 0;
+    }
+    s.task = task_index(task);
+
+    uint32_t i = __atomic_fetch_add(&s_taken, 1, __ATOMIC_RELAXED);
+    s_samples[i & (PROF_CAPACITY - 1)] = s;
+    return false;
+}
+
+static esp_err_t s_arm_err = ESP_OK;
+
+// Runs on the target core (IPC task): the alarm interrupt is allocated on
+// the core that registers the callback.
+static void arm_on_core(void *arg)
+{
+    gptimer_handle_t timer = arg;
+    const gptimer_event_callbacks_t cbs = { .on_alarm = sample_cb };
+    s_arm_err = gptimer_register_event_callbacks(timer, &cbs, NULL);
+    if (s_arm_err == ESP_OK) {
+        s_arm_err = gptimer_enable(timer);
+    }
+}
+
+static esp_err_t timers_create(void)
+{
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        const gptimer_config_t cfg = {
+            .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+            .direction = GPTIMER_COUNT_UP,
+            .resolution_hz = PROF_TIMER_HZ,
+            .intr_priority = 1,
+        };
+        esp_err_t err = gptimer_new_timer(&cfg, &s_timers[core]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "No timer for core %d: %s", core, esp_err_to_name(err));
+            return err;
+        }
+        err = esp_ipc_call_blocking(core, arm_on_core, s_timers[core]);
+        if (err == ESP_OK) err = s_arm_err;
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Timer interrupt on core %d: %s", core, esp_err_to_name(err));
+            return err;
+        }
+    }
+    s_timers_ready = true;
+    return ESP_OK;
+}
+#endif
+
+esp_err_t profiler_start(uint32_t rate_hz)
+{
+#if PROF_BACKEND
+    if (s_running) {
+        profiler_stop();
+    }
+    if (!s_timers_ready) {
+        esp_err_t err = timers_create();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (rate_hz == 0) rate_hz = PROF_DEFAULT_HZ;
+    if (rate_hz < PROF_MIN_HZ) rate_hz = PROF_MIN_HZ;
+    if (rate_hz > PROF_MAX_HZ) rate_hz = PROF_MAX_HZ;
+    s_rate_hz = rate_hz;
+
+    s_taken = 0;
+    s_task_count = 0;
+    s_task_misses = 0;
+    s_cursor = 0;
+
+    const gptimer_alarm_config_t alarm = {
+        .alarm_count = PROF_TIMER_HZ / rate_hz,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true,
+    };
+    s_start_us = esp_timer_get_time();
+    s_running = true;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        gptimer_set_raw_count(s_timers[core], 0);
+        gptimer_set_alarm_action(s_timers[core], &alarm);
+        gptimer_start(s_timers[core]);
+    }
+    ESP_LOGI(TAG, "Sampling at %lu Hz per core, ring %d samples", (unsigned long)rate_hz, PROF_CAPACITY);
+    return ESP_OK;
+#else
+    (void)rate_hz;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void profiler_stop(void)
+{
+    if (!s_running) {
+        return;
+    }
+#if PROF_BACKEND
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        gptimer_stop(s_timers[core]);
+    }
+#endif
+    s_stop_us = esp_timer_get_time();
+    s_running = false;
+    s_cursor = 0;
+    ESP_LOGI(TAG, "Stopped: %lu samples in %lu ms, %lu tasks",
+             (unsigned long)s_taken, (unsigned long)((s_stop_us - s_start_us) / 1000),
+             (unsigned long)s_task_count);
+}
+
+bool profiler_is_running(void)
+{
+    return s_running;
+}
+
+static uint32_t samples_held(void)
+{
+#if PROF_BACKEND
+    uint32_t taken = __atomic_load_n(&s_taken, __ATOMIC_RELAXED);
+    return taken < PROF_CAPACITY ? taken : PROF_CAPACITY;
+#else
+    return 0;
+#endif
+}
+
+static void fill_header(prof_header_t *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->flags = (s_running ? PROF_FLAG_RUNNING : 0)
+             | (PROF_BACKEND ? PROF_FLAG_SUPPORTED : 0)
+             | (s_taken > samples_held() ? PROF_FLAG_WRAPPED : 0);
+    h->rate_hz = s_rate_hz;
+    h->taken = s_taken;
+    h->held = samples_held();
+    h->tasks = __atomic_load_n(&s_task_count, __ATOMIC_ACQUIRE);
+    int64_t end = s_running ? esp_timer_get_time() : s_stop_us;
+    h->duration_ms = s_start_us != 0 ? (uint32_t)((end - s_start_us) / 1000) : 0;
+    h->capacity = PROF_CAPACITY;
+    h->task_misses = s_task_misses;
+}
+
+// Pages: the header, one per task, then the samples oldest first.
+prof_page_t profiler_read_page(uint32_t *words, uint8_t *count)
+{
+    memset(words, 0, PROF_PAGE_WORDS * 4);
+    if (s_running || s_cursor == 0) {
+        prof_header_t h;
+        fill_header(&h);
+        memcpy(words, &h, sizeof(h));
+        *count = sizeof(h) / 4;
+        if (!s_running) s_cursor++;
+        return PROF_PAGE_HEADER;
+    }
+
+    uint32_t page = s_cursor - 1;
+    uint32_t tasks = __atomic_load_n(&s_task_count, __ATOMIC_ACQUIRE);
+    if (page < tasks) {
+        words[0] = page;
+        memcpy(&words[1], s_task_names[page], PROF_TASK_NAME_LEN);
+        *count = 1 + PROF_TASK_NAME_LEN / 4;
+        s_cursor++;
+        return PROF_PAGE_TASK;
+    }
+
+#if PROF_BACKEND
+    uint32_t held = samples_held();
+    uint32_t first = s_taken - held;
+    uint32_t done = (page - tasks) * PROF_SAMPLES_PER_PAGE;
+    if (done < held) {
+        uint32_t n = held - done < PROF_SAMPLES_PER_PAGE ? held - done : PROF_SAMPLES_PER_PAGE;
+        prof_sample_t *out = (prof_sample_t *)words;
+        for (uint32_t i = 0; i < n; i++) {
+            out[i] = s_samples[(first + done + i) & (PROF_CAPACITY - 1)];
+        }
+        *count = (uint8_t)(n * sizeof(prof_sample_t) / 4);
+        s_cursor++;
+        return PROF_PAGE_SAMPLES;
+    }
+#endif
+
+    *count = 0;
+    return PROF_PAGE_END;
+}
+
+void profiler_rewind(void)
+{
+    s_cursor = 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Sampling Profiler Module
+ * A general-purpose timer per core interrupts at a fixed rate and records
+ * the interrupted PC, its caller and the running task into a sample ring in
+ * PSRAM. Started and stopped at runtime and read out page by page over a HID
+ * feature report; tools/profile.py symbolizes the samples against the ELF
+ * and writes folded stacks for a flame graph.
+ */
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One sample. The caller is the return address in a0 of the interrupted
+// frame, i.e. the call site one level up.
+typedef struct {
+    uint32_t pc;
+    uint32_t caller;
+    uint8_t task;                   // index into the task table
+    uint8_t core;
+    uint8_t flags;                  // PROF_SAMPLE_*
+    uint8_t reserved;
+} prof_sample_t;
+
+#define PROF_SAMPLE_NESTED      0x01    // interrupted another ISR: pc / caller are 0
+
+#define PROF_TASK_NAME_LEN      16
+#define PROF_TASKS_MAX          32
+
+// Dump pages, one per read (byte 1 of the report)
+typedef enum {
+    PROF_PAGE_END = 0,              // past the last sample
+    PROF_PAGE_HEADER,               // prof_header_t
+    PROF_PAGE_TASK,                 // u32 index, then the name (16 bytes, NUL-padded)
+    PROF_PAGE_SAMPLES,              // up to PROF_SAMPLES_PER_PAGE prof_sample_t
+} prof_page_t;
+
+#define PROF_PAGE_WORDS         15
+#define PROF_SAMPLES_PER_PAGE   (PROF_PAGE_WORDS * 4 / sizeof(prof_sample_t))
+
+// Header flags
+#define PROF_FLAG_RUNNING       0x01
+#define PROF_FLAG_SUPPORTED     0x02    // built with a sampling backend
+#define PROF_FLAG_WRAPPED       0x04    // older samples were overwritten
+
+typedef struct {
+    uint32_t flags;
+    uint32_t rate_hz;               // per core
+    uint32_t taken;                 // samples since start, both cores
+    uint32_t held;                  // samples in the ring (the newest ones)
+    uint32_t tasks;
+    uint32_t duration_ms;           // start -> stop (or now, while running)
+    uint32_t capacity;
+    uint32_t task_misses;           // samples of tasks beyond PROF_TASKS_MAX
+} prof_header_t;
+
+/**
+ * Start sampling both cores at rate_hz (0 = CONFIG_COSMO_PROFILER_RATE_HZ).
+ * Clears the previous capture. The timers are created on first use.
+ *
+ * @return ESP_ERR_NOT_SUPPORTED when built without a sampling backend
+ */
+esp_err_t profiler_start(uint32_t rate_hz);
+
+/**
+ * Stop sampling. The capture stays readable until the next start.
+ */
+void profiler_stop(void);
+
+bool profiler_is_running(void);
+
+/**
+ * Fill the next dump page and advance the read cursor. While sampling only
+ * the header is returned and the cursor stays put.
+ *
+ * @param words  PROF_PAGE_WORDS words
+ * @param count  Words filled
+ * @return       Page type; PROF_PAGE_END once everything has been read
+ */
+prof_page_t profiler_read_page(uint32_t *words, uint8_t *count);
+
+/**
+ * Restart the dump at the header page
+ */
+void profiler_rewind(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PROFILER_H_ */
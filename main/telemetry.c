@@ -0,0 +1,130 @@
+/*
+ * Telemetry Module Implementation
+ * Counters are plain words updated with relaxed atomics; histograms are
+ * updated from task context under a spinlock so a reader never sees a
+ * sample counted in one field and not yet in another.
+ */
+
+#include <string.h>
+#include "telemetry.h"
+#include "health.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static uint32_t s_counters[TELEM_COUNTER_COUNT];
+
+static uint32_t s_retired[TELEM_COUNTER_COUNT];   // cleared by host resets so far
+static telemetry_hist_t s_hist[TELEM_LAT_COUNT];     // mean_us filled in on read
+static uint64_t s_hist_sum_us[TELEM_LAT_COUNT];
+static telemetry_period_t s_period[TELEM_LAT_COUNT];
+static int64_t s_window_start_us = 0;
+static portMUX_TYPE s_hist_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void IRAM_ATTR telemetry_count(telemetry_counter_t c)
+{
+    __atomic_fetch_add(&s_counters[c], 1, __ATOMIC_RELAXED);
+}
+
+void IRAM_ATTR telemetry_max(telemetry_counter_t c, uint32_t value)
+{
+    uint32_t cur = __atomic_load_n(&s_counters[c], __ATOMIC_RELAXED);
+    while (value > cur &&
+           !__atomic_compare_exchange_n(&s_counters[c], &cur, value, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static unsigned bucket_for(uint32_t us)
+{
+    unsigned k = 0;
+    for (uint32_t limit = 256; k < TELEM_HIST_BUCKETS - 1 && us >= limit; limit <<= 1) {
+        k++;
+    }
+    return k;
+}
+
+void telemetry_latency(telemetry_stage_t stage, int64_t start_us)
+{
+    if (stage >= TELEM_LAT_COUNT || start_us <= 0) return;
+    int64_t d = esp_timer_get_time() - start_us;
+    uint32_t us = d < 0 ? 0 : d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
+
+    telemetry_hist_t *h = &s_hist[stage];
+    portENTER_CRITICAL(&s_hist_lock);
+    h->count++;
+    s_hist_sum_us[stage] += us;
+    if (us > h->max_us) h->max_us = us;
+    h->buckets[bucket_for(us)]++;
+    telemetry_period_t *p = &s_period[stage];
+    p->count++;
+    p->sum_us += us;
+    if (us > p->max_us) p->max_us = us;
+    portEXIT_CRITICAL(&s_hist_lock);
+    health_latency(stage, us);
+}
+
+void telemetry_reset(void)
+{
+    portENTER_CRITICAL(&s_hist_lock);
+    memset(s_hist, 0, sizeof(s_hist));
+    memset(s_hist_sum_us, 0, sizeof(s_hist_sum_us));
+    portEXIT_CRITICAL(&s_hist_lock);
+    for (size_t i = 0; i < TELEM_COUNTER_COUNT; i++) {
+        uint32_t old = __atomic_exchange_n(&s_counters[i], 0, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&s_retired[i], old, __ATOMIC_RELAXED);
+    }
+    s_window_start_us = esp_timer_get_time();
+}
+
+void telemetry_read_counters(size_t first, uint32_t *out, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        size_t c = first + i;
+        if (c == TELEM_WINDOW_MS) {
+            out[i] = (uint32_t)((esp_timer_get_time() - s_window_start_us) / 1000);
+        } else if (c < TELEM_COUNTER_COUNT) {
+            out[i] = __atomic_load_n(&s_counters[c], __ATOMIC_RELAXED);
+        } else {
+            out[i] = 0;
+        }
+    }
+}
+
+void telemetry_read_hist(telemetry_stage_t stage, telemetry_hist_t *out)
+{
+    if (stage >= TELEM_LAT_COUNT) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    portENTER_CRITICAL(&s_hist_lock);
+    *out = s_hist[stage];
+    uint64_t sum_us = s_hist_sum_us[stage];
+    portEXIT_CRITICAL(&s_hist_lock);
+    out->mean_us = out->count ? (uint32_t)((sum_us + out->count / 2) / out->count) : 0;
+}
+
+void telemetry_read_lifetime(size_t first, uint32_t *out, size_t n)
+{
+    telemetry_read_counters(first, out, n);
+    for (size_t i = 0; i < n; i++) {
+        size_t c = first + i;
+        if (c != TELEM_WINDOW_MS && c != TELEM_INPUT_QUEUE_HWM && c != TELEM_NFC_QUEUE_HWM
+            && c < TELEM_COUNTER_COUNT) {
+            out[i] += __atomic_load_n(&s_retired[c], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void telemetry_take_period(telemetry_stage_t stage, telemetry_period_t *out)
+{
+    if (stage >= TELEM_LAT_COUNT) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    portENTER_CRITICAL(&s_hist_lock);
+    *out = s_period[stage];
+    memset(&s_period[stage], 0, sizeof(s_period[stage]));
+    portEXIT_CRITICAL(&s_hist_lock);
+}
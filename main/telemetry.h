@@ -0,0 +1,127 @@
+/*
+ * Telemetry Module
+ * Lock-free counters and latency histograms, read out over HID feature
+ * reports (see tusb_hid_example_main.c and docs/firmware/usb-hid.md).
+ */
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "input_handler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Counter indices. The order is the wire layout of the counter pages, so
+// only ever append.
+typedef enum {
+    TELEM_WINDOW_MS = 0,            // ms since the counters were last reset (filled on read)
+    TELEM_INPUT_EVENT_BASE,         // + (input_event_type_t - 1), one per event type
+    TELEM_INPUT_DEBOUNCED = TELEM_INPUT_EVENT_BASE + INPUT_EVENT_ENC2_SW_RELEASE,
+    TELEM_INPUT_ISR_DROPPED,        // GPIO edges lost to a full ISR ring
+    TELEM_INPUT_QUEUE_HWM,          // ISR ring high-water mark
+    TELEM_HID_REPORTS,              // keyboard reports submitted
+    TELEM_HID_REPORTS_DROPPED,      // not mounted or endpoint busy
+    TELEM_NFC_READS,                // new placements read (or looked up in the UID index)
+    TELEM_NFC_READ_ERRORS,          // SPI / PICC errors while reading pages
+    TELEM_NDEF_PARSE_FAILS,         // read fine but no usable Text record
+    TELEM_NFC_CACHE_HITS,           // re-entries suppressed by the presence table
+    TELEM_NFC_QUEUE_HWM,            // scanner -> dispatch queue high-water mark
+    TELEM_NFC_DROPPED,
+    TELEM_NFC_SUPERSEDED,
+    TELEM_LED_DROPPED,              // LED commands lost to a full queue
+    TELEM_EVLOG_DROPPED,            // event log records lost to a full ring
+    TELEM_INPUT_RESYNCS,            // line levels re-read after ISR ring overflows
+    TELEM_NFC_READ_ABORTS,          // tag left after part of its text was already typed
+    TELEM_HEALTH_SLO_MISSES,        // latency samples over their objective (health.h)
+    TELEM_HEALTH_STALLS,            // watched tasks flagged stuck
+    TELEM_NFC_INDEX_HITS,           // placements typed from the UID index (uid_index.h)
+    TELEM_COUNTER_COUNT
+} telemetry_counter_t;
+
+// Latency stages, each with its own histogram.
+typedef enum {
+    TELEM_LAT_INPUT = 0,            // GPIO edge processed -> HID report submitted
+    TELEM_LAT_NFC_READ,             // tag detected -> pages read and parsed
+    TELEM_LAT_NFC_QUEUE,            // handed off -> dispatch task picks it up
+    TELEM_LAT_NFC_TYPE,             // dispatch start -> string fully typed
+    TELEM_LAT_NFC_FIRST_CHAR,       // tag detected -> first character handed to HID
+    TELEM_LAT_NFC_DONE,             // tag detected -> whole line typed
+    TELEM_LAT_COUNT
+} telemetry_stage_t;
+
+// Bucket k counts samples below (256 us << k); the last bucket is open-ended.
+#define TELEM_HIST_BUCKETS  12
+
+// One stage's histogram as read out; the mean comes from a 64-bit sum of
+// microseconds kept alongside.
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint32_t mean_us;
+    uint32_t buckets[TELEM_HIST_BUCKETS];
+} telemetry_hist_t;
+
+// One stage's samples since the last telemetry_take_period(); kept apart
+// from the histograms so a host reset does not disturb it.
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+} telemetry_period_t;
+
+/**
+ * Count one event. Safe from any task or ISR, on either core; in IRAM, so
+ * also while the flash cache is off.
+ */
+void telemetry_count(telemetry_counter_t c);
+
+/**
+ * Raise a high-water counter to `value` if it is larger. Same context rules
+ * as telemetry_count().
+ */
+void telemetry_max(telemetry_counter_t c, uint32_t value);
+
+/**
+ * Record one latency sample (task context only) and check it against the
+ * stage's health objective
+ *
+ * @param stage   Stage the sample belongs to
+ * @param start_us esp_timer_get_time() when the stage began; ends now
+ */
+void telemetry_latency(telemetry_stage_t stage, int64_t start_us);
+
+/**
+ * Zero all counters and histograms and restart the window
+ */
+void telemetry_reset(void);
+
+/**
+ * Copy counters [first, first + n) into out (little-endian u32 on the wire)
+ */
+void telemetry_read_counters(size_t first, uint32_t *out, size_t n);
+
+/**
+ * Copy one stage histogram
+ */
+void telemetry_read_hist(telemetry_stage_t stage, telemetry_hist_t *out);
+
+/**
+ * Counters [first, first + n) since boot, including what host resets
+ * cleared. Window and high-water entries read as their current value.
+ */
+void telemetry_read_lifetime(size_t first, uint32_t *out, size_t n);
+
+/**
+ * Copy one stage's period statistics and start a new period
+ */
+void telemetry_take_period(telemetry_stage_t stage, telemetry_period_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TELEMETRY_H_ */
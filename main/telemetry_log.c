@@ -0,0 +1,327 @@
+/*
+ * Telemetry Log Module Implementation
+ * The partition is one circular log of fixed 64-byte records. The writer
+ * fills each 4 KB sector slot by slot and erases the next sector only when
+ * it gets there, so every sector is erased exactly once per lap of the
+ * partition: wear is spread evenly without a translation layer. At boot the
+ * newest record is found from the first record of each sector plus a scan
+ * of the newest sector. A torn write only costs its own slot: its CRC fails
+ * and it is skipped.
+ *
+ * Flash writes and erases stall both cores' caches, so the writer waits
+ * until nobody is turning a knob or holding a tag, and batches a whole
+ * period into one record.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "telemetry_log.h"
+#include "telemetry.h"
+#include "nfc_handler.h"
+#include "mem_report.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "TLOG";
+
+#define TLOG_PARTITION_LABEL    "telemlog"
+#define TLOG_PARTITION_SUBTYPE  0x40        // custom data subtype, see partitions.csv
+#define TLOG_PERIOD_US          ((int64_t)CONFIG_COSMO_TLOG_PERIOD_S * 1000000)
+#define TLOG_IDLE_MS            CONFIG_COSMO_TLOG_IDLE_MS
+#define TLOG_MAX_DEFER_US       (60 * 1000000)  // write anyway once this late
+#define TLOG_CHECK_MS           1000
+#define TLOG_SHUTDOWN_WAIT_MS   200
+#define TLOG_TASK_STACK         (3 * 1024)
+#define TLOG_TASK_PRIO          CONFIG_COSMO_PRIO_TLOG
+#define TLOG_TASK_CORE          CONFIG_COSMO_CORE_BG
+
+#define TLOG_ERASED_SEQ         0xFFFFFFFFu
+
+_Static_assert(sizeof(tlog_record_t) == 64, "record layout");
+
+static const esp_partition_t *s_part = NULL;
+static uint32_t s_slots = 0;                // records the partition holds
+static uint32_t s_per_sector = 0;
+
+// Writer state; s_lock serialises the writer task and the shutdown handler.
+static StaticSemaphore_t s_lock_buf;
+static SemaphoreHandle_t s_lock = NULL;
+static uint32_t s_next_slot = 0;
+static uint16_t s_boot = 0;
+static uint32_t s_prev[TELEM_COUNTER_COUNT];    // lifetime counters at the last snapshot
+static int64_t s_prev_us = 0;
+static volatile uint8_t s_restart_cause = TLOG_CAUSE_RESTART;
+
+// Newest record, read by tlog_read() from any task.
+static portMUX_TYPE s_newest_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_newest_slot = 0;
+static uint32_t s_newest_seq = 0;           // 0 = log empty
+
+static StaticTask_t s_task_tcb;
+static StackType_t s_task_stack[TLOG_TASK_STACK];
+static TaskHandle_t s_task = NULL;
+
+static uint32_t record_crc(const tlog_record_t *r)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)r, offsetof(tlog_record_t, crc));
+}
+
+static bool is_erased(const tlog_record_t *r)
+{
+    const uint32_t *w = (const uint32_t *)r;
+    for (size_t i = 0; i < sizeof(*r) / 4; i++) {
+        if (w[i] != 0xFFFFFFFFu) return false;
+    }
+    return true;
+}
+
+static bool read_slot(uint32_t slot, tlog_record_t *r)
+{
+    if (esp_partition_read(s_part, (size_t)slot * sizeof(*r), r, sizeof(*r)) != ESP_OK) {
+        return false;
+    }
+    return r->seq != TLOG_ERASED_SEQ && r->crc == record_crc(r);
+}
+
+// Find the newest record and the slot after it.
+static void scan(void)
+{
+    tlog_record_t r;
+    uint32_t best_sector = 0, best_seq = 0;
+    uint16_t best_boot = 0;
+    for (uint32_t sector = 0; sector < s_slots / s_per_sector; sector++) {
+        if (read_slot(sector * s_per_sector, &r) && r.seq >= best_seq) {
+            best_sector = sector;
+            best_seq = r.seq;
+            best_boot = r.boot;
+        }
+    }
+    if (best_seq == 0) {
+        s_next_slot = 0;        // empty or foreign data: start over at sector 0
+        return;
+    }
+
+    uint32_t first = best_sector * s_per_sector;
+    s_newest_slot = first;
+    s_newest_seq = best_seq;
+    s_boot = best_boot;
+    s_next_slot = (first + s_per_sector) % s_slots;     // sector full unless an erased slot shows up
+    for (uint32_t slot = first + 1; slot < first + s_per_sector; slot++) {
+        bool valid = read_slot(slot, &r);
+        if (!valid && is_erased(&r)) {
+            s_next_slot = slot;
+            break;
+        }
+        if (valid && r.seq > s_newest_seq) {
+            s_newest_slot = slot;
+            s_newest_seq = r.seq;
+            s_boot = r.boot;
+        }
+    }
+}
+
+// Caller holds s_lock.
+static void append(tlog_record_t *r)
+{
+    size_t offset = (size_t)s_next_slot * sizeof(*r);
+    if (s_next_slot % s_per_sector == 0) {
+        // Entering a sector: it holds the oldest records, one lap ago.
+        esp_err_t err = esp_partition_erase_range(s_part, offset, s_part->erase_size);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Erase at 0x%x failed: %s", (unsigned)offset, esp_err_to_name(err));
+            return;
+        }
+    }
+    r->seq = s_newest_seq + 1;
+    r->boot = s_boot;
+    r->crc = record_crc(r);
+    esp_err_t err = esp_partition_write(s_part, offset, r, sizeof(*r));
+    if (err != ESP_OK) {
+        // The slot is now neither erased nor valid; the next write skips it.
+        ESP_LOGW(TAG, "Write at 0x%x failed: %s", (unsigned)offset, esp_err_to_name(err));
+    } else {
+        portENTER_CRITICAL(&s_newest_lock);
+        s_newest_slot = s_next_slot;
+        s_newest_seq = r->seq;
+        portEXIT_CRITICAL(&s_newest_lock);
+        ESP_LOGD(TAG, "Record %lu (type %u) at slot %lu", (unsigned long)r->seq, r->type,
+                 (unsigned long)s_next_slot);
+    }
+    s_next_slot = (s_next_slot + 1) % s_slots;
+}
+
+static uint32_t avg_us(const telemetry_period_t *p)
+{
+    return p->count ? (uint32_t)(p->sum_us / p->count) : 0;
+}
+
+// Everything counted since the previous snapshot. Caller holds s_lock.
+static void snapshot(tlog_record_t *r, tlog_type_t type, uint8_t cause)
+{
+    uint32_t now[TELEM_COUNTER_COUNT], d[TELEM_COUNTER_COUNT];
+    telemetry_read_lifetime(0, now, TELEM_COUNTER_COUNT);
+    for (int i = 0; i < TELEM_COUNTER_COUNT; i++) {
+        d[i] = now[i] - s_prev[i];
+        s_prev[i] = now[i];
+    }
+#define EV(e) d[TELEM_INPUT_EVENT_BASE + (e) - 1]
+
+    telemetry_period_t input, nfc_read, nfc_type;
+    telemetry_take_period(TELEM_LAT_INPUT, &input);
+    telemetry_take_period(TELEM_LAT_NFC_READ, &nfc_read);
+    telemetry_take_period(TELEM_LAT_NFC_TYPE, &nfc_type);
+
+    int64_t t = esp_timer_get_time();
+    memset(r, 0, sizeof(*r));
+    r->type = type;
+    r->cause = cause;
+    r->uptime_s = (uint32_t)(t / 1000000);
+    r->period_s = (uint32_t)((t - s_prev_us + 500000) / 1000000);
+    r->detents = EV(INPUT_EVENT_ENC1_CW) + EV(INPUT_EVENT_ENC1_CCW)
+               + EV(INPUT_EVENT_ENC2_CW) + EV(INPUT_EVENT_ENC2_CCW);
+    r->presses = EV(INPUT_EVENT_BUTTON_PRESS) + EV(INPUT_EVENT_ENC1_SW_PRESS)
+               + EV(INPUT_EVENT_ENC2_SW_PRESS);
+    r->tags = d[TELEM_NFC_READS];
+    r->nfc_errors = d[TELEM_NFC_READ_ERRORS] + d[TELEM_NDEF_PARSE_FAILS];
+    r->hid_reports = d[TELEM_HID_REPORTS];
+    r->dropped = d[TELEM_HID_REPORTS_DROPPED] + d[TELEM_INPUT_ISR_DROPPED] + d[TELEM_NFC_DROPPED]
+               + d[TELEM_LED_DROPPED] + d[TELEM_EVLOG_DROPPED];
+    r->input_avg_us = avg_us(&input);
+    r->input_max_us = input.max_us;
+    r->nfc_read_avg_us = avg_us(&nfc_read);
+    r->nfc_read_max_us = nfc_read.max_us;
+    r->nfc_type_max_us = nfc_type.max_us;
+    s_prev_us = t;
+#undef EV
+}
+
+static void write_snapshot(tlog_type_t type, uint8_t cause)
+{
+    tlog_record_t r;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    snapshot(&r, type, cause);
+    append(&r);
+    xSemaphoreGive(s_lock);
+}
+
+static void write_boot_record(void)
+{
+    tlog_record_t r = {
+        .type = TLOG_TYPE_BOOT,
+        .cause = (uint8_t)esp_reset_reason(),
+        .uptime_s = (uint32_t)(esp_timer_get_time() / 1000000),
+    };
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    append(&r);
+    xSemaphoreGive(s_lock);
+    ESP_LOGI(TAG, "Boot %u, reset reason %u, record %lu", s_boot, r.cause, (unsigned long)r.seq);
+}
+
+// Runs inside esp_restart(), on whichever task called it.
+static void shutdown_handler(void)
+{
+    if (s_lock == NULL || xSemaphoreTake(s_lock, pdMS_TO_TICKS(TLOG_SHUTDOWN_WAIT_MS)) != pdTRUE) {
+        return;
+    }
+    tlog_record_t r;
+    snapshot(&r, TLOG_TYPE_SHUTDOWN, s_restart_cause);
+    append(&r);
+    xSemaphoreGive(s_lock);
+}
+
+static void tlog_task(void *arg)
+{
+    bool boot_pending = true;
+    int64_t next_due_us = esp_timer_get_time() + TLOG_PERIOD_US;
+
+    while (1) {
+        bool flush = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TLOG_CHECK_MS)) > 0;
+        int64_t now = esp_timer_get_time();
+        bool idle = nfc_handler_get_idle_time_ms() >= TLOG_IDLE_MS;
+
+        if (boot_pending && (idle || flush || now >= TLOG_MAX_DEFER_US)) {
+            write_boot_record();
+            boot_pending = false;
+        }
+        if (flush || (now >= next_due_us && (idle || now >= next_due_us + TLOG_MAX_DEFER_US))) {
+            write_snapshot(flush ? TLOG_TYPE_FLUSH : TLOG_TYPE_PERIOD, 0);
+            next_due_us = now + TLOG_PERIOD_US;
+        }
+    }
+}
+
+esp_err_t tlog_start(void)
+{
+    if (s_task != NULL) {
+        return ESP_OK;
+    }
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, TLOG_PARTITION_SUBTYPE,
+                                      TLOG_PARTITION_LABEL);
+    if (s_part == NULL || s_part->erase_size < sizeof(tlog_record_t)) {
+        ESP_LOGW(TAG, "No \"%s\" partition, telemetry log disabled", TLOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_per_sector = s_part->erase_size / sizeof(tlog_record_t);
+    s_slots = s_part->size / s_part->erase_size * s_per_sector;
+
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    scan();
+    s_boot++;
+    ESP_LOGI(TAG, "%lu KB, %lu records, newest #%lu, writing slot %lu",
+             (unsigned long)(s_part->size / 1024), (unsigned long)s_slots,
+             (unsigned long)s_newest_seq, (unsigned long)s_next_slot);
+
+    s_task = xTaskCreateStaticPinnedToCore(tlog_task, "tlog", TLOG_TASK_STACK, NULL,
+                                           TLOG_TASK_PRIO, s_task_stack, &s_task_tcb,
+                                           TLOG_TASK_CORE);
+    if (s_task == NULL) {
+        ESP_LOGE(TAG, "Failed to create telemetry log task");
+        return ESP_FAIL;
+    }
+    esp_register_shutdown_handler(shutdown_handler);
+    mem_report_add_static(MEM_MOD_DIAG, sizeof(s_lock_buf) + sizeof(s_prev)
+                                      + sizeof(s_task_tcb) + sizeof(s_task_stack));
+    return ESP_OK;
+}
+
+void tlog_flush(void)
+{
+    if (s_task != NULL) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+void tlog_set_restart_cause(tlog_cause_t cause)
+{
+    s_restart_cause = (uint8_t)cause;
+}
+
+tlog_type_t tlog_read(uint32_t back, tlog_record_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    portENTER_CRITICAL(&s_newest_lock);
+    uint32_t newest_slot = s_newest_slot;
+    uint32_t newest_seq = s_newest_seq;
+    portEXIT_CRITICAL(&s_newest_lock);
+    if (s_part == NULL || newest_seq == 0 || back >= s_slots || back >= newest_seq) {
+        return TLOG_TYPE_NONE;
+    }
+
+    uint32_t slot = (newest_slot + s_slots - back) % s_slots;
+    if (read_slot(slot, out)) {
+        // Older than the oldest surviving record is an erased or reused slot.
+        return out->seq <= newest_seq ? (tlog_type_t)out->type : TLOG_TYPE_NONE;
+    }
+    if (is_erased(out)) {
+        memset(out, 0, sizeof(*out));
+        return TLOG_TYPE_NONE;
+    }
+    return TLOG_TYPE_CORRUPT;
+}
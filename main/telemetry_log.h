@@ -0,0 +1,92 @@
+/*
+ * Telemetry Log Module
+ * Periodic usage / performance snapshots in a dedicated flash partition, so
+ * a unit's history survives restarts. Records are appended round-robin over
+ * the whole partition; readable over a HID feature report.
+ */
+
+#ifndef _TELEMETRY_LOG_H_
+#define _TELEMETRY_LOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    TLOG_TYPE_NONE = 0,             // erased slot / past the oldest record
+    TLOG_TYPE_BOOT,                 // cause = esp_reset_reason_t of this boot
+    TLOG_TYPE_PERIOD,               // periodic snapshot
+    TLOG_TYPE_FLUSH,                // snapshot requested by the host
+    TLOG_TYPE_SHUTDOWN,             // last snapshot before esp_restart(), cause = tlog_cause_t
+    TLOG_TYPE_CORRUPT = 0xFF,       // slot written but CRC does not match (read side only)
+} tlog_type_t;
+
+// Why the firmware restarted itself. Resets it did not see coming (power,
+// brownout, panic, watchdog) show up as the reset reason of the next boot.
+typedef enum {
+    TLOG_CAUSE_RESTART = 0,         // esp_restart() from anywhere else
+    TLOG_CAUSE_FORCED_RESTART,      // action button held 15 s
+    TLOG_CAUSE_STALL,               // + health_task_t: the health monitor found it stuck
+} tlog_cause_t;
+
+// One record, 16 little-endian words. Counts cover the period_s seconds
+// before uptime_s. Latencies are in us; averages are 0 without samples.
+typedef struct {
+    uint32_t seq;                   // record number, increments across boots
+    uint16_t boot;                  // boot count since the partition was erased
+    uint8_t type;                   // tlog_type_t
+    uint8_t cause;
+    uint32_t uptime_s;
+    uint32_t period_s;
+    uint32_t detents;               // both knobs, either direction
+    uint32_t presses;               // action button and knob switches
+    uint32_t tags;                  // new placements read
+    uint32_t nfc_errors;            // read errors and NDEF parse failures
+    uint32_t hid_reports;
+    uint32_t dropped;               // HID reports, ISR edges, tags, LED commands, log records
+    uint32_t input_avg_us;          // edge -> HID report
+    uint32_t input_max_us;
+    uint32_t nfc_read_avg_us;       // tag detected -> pages read and parsed
+    uint32_t nfc_read_max_us;
+    uint32_t nfc_type_max_us;       // whole string typed
+    uint32_t crc;                   // CRC-32 of the words above
+} tlog_record_t;
+
+#define TLOG_RECORD_WORDS   (sizeof(tlog_record_t) / 4 - 1)   // what goes on the wire
+
+/**
+ * Find the log partition, locate the newest record and start the writer
+ * task. The boot record is written once the device has been idle for a
+ * moment. Without the partition the log is disabled and ESP_ERR_NOT_FOUND
+ * is returned; nothing else depends on it.
+ */
+esp_err_t tlog_start(void);
+
+/**
+ * Ask the writer task for a snapshot now instead of at the next period
+ */
+void tlog_flush(void);
+
+/**
+ * Set the cause written in the shutdown record if the firmware restarts
+ * itself; call right before esp_restart()
+ */
+void tlog_set_restart_cause(tlog_cause_t cause);
+
+/**
+ * Read a record by age: 0 = newest, 1 = the one before, ...
+ *
+ * @return the record's type; TLOG_TYPE_NONE past the oldest one. Safe from
+ *         any task, does not wait for a write in progress.
+ */
+tlog_type_t tlog_read(uint32_t back, tlog_record_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TELEMETRY_LOG_H_ */
@@ -12,7 +12,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/param.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -23,6 +25,16 @@
 #include "input_handler.h"
 #include "led_indicator.h"
 #include "nfc_handler.h"
+#include "nfc_provision.h"
+#include "uid_index.h"
+#include "telemetry.h"
+#include "boot_trace.h"
+#include "mem_report.h"
+#include "event_log.h"
+#include "telemetry_log.h"
+#include "profiler.h"
+#include "health.h"
+#include "sdkconfig.h"
 
 static const char *TAG = "USB_HID";
 
@@ -34,6 +46,7 @@ static const char *TAG = "USB_HID";
 #define KEY_RIGHT_ARROW 0x4F  // HID_KEY_ARROW_RIGHT
 #define KEY_F1          0x3A  // HID_KEY_F1 — placeholder for ENC1 SW
 #define KEY_F2          0x3B  // HID_KEY_F2 — placeholder for ENC2 SW
+#define KEY_BACKSPACE   0x2A  // HID_KEY_BACKSPACE — erases a superseded NFC string
 
 // HID modifier byte
 #define HID_MOD_LSHIFT  0x02
@@ -41,17 +54,129 @@ static const char *TAG = "USB_HID";
 // Key pulse duration (ms) for rotary encoder events
 #define KEY_PULSE_MS    20
 
-// Per-character pulse duration when typing strings (NFC UID, etc.)
+// Background LED + NFC bring-up (see app_main)
+#define PERIPH_INIT_STACK   (4 * 1024)
+#define PERIPH_INIT_PRIO    (tskIDLE_PRIORITY + 1)
+#define PERIPH_INIT_CORE    CONFIG_COSMO_CORE_BG    // SPI / RMT interrupts follow it
+
+// TinyUSB task, next to the input task on the real-time core
+#define USB_TASK_PRIO       CONFIG_COSMO_PRIO_USB
+#define USB_TASK_CORE       CONFIG_COSMO_CORE_RT
+
+// USB status poll: fast until the first mount so the boot trace and the
+// initial report are not delayed, then relaxed.
+#define USB_POLL_BOOT_MS    10
+#define USB_POLL_MS         500
+#define USB_POLL_BOOT_WINDOW_US (10 * 1000 * 1000)  // charger only: stop fast polling
+
+// Per-character pulse duration when typing strings (NFC UID, etc.). This is
+// the safe rate used at boot and whenever the host stops acknowledging; the
+// host can negotiate a faster one through REPORT_ID_TYPING.
 #define STRING_KEY_DOWN_MS  15
 #define STRING_KEY_UP_MS    15
 
+// How long a typed report may sit on the IN endpoint before we assume the
+// host stopped polling and fall back to the safe rate.
+#define TYPING_ACK_TIMEOUT_MS   CONFIG_COSMO_HID_ACK_TIMEOUT_MS
+#define TYPING_MAX_MS           1000
+
+// Feature reports (vendor collection, no extra driver on the host). Every
+// one is 63 bytes after the report ID so it fits a single 64-byte control
+// transfer: [0] layout version, [1] page info, [2] word count, [3..] u32 LE.
+#define REPORT_ID_KEYBOARD          HID_ITF_PROTOCOL_KEYBOARD
+#define REPORT_ID_TELEM_COUNTERS    2   // 2..3: counter pages (telemetry.h order)
+#define REPORT_ID_TELEM_HIST        4   // 4..7: one latency histogram per stage 0..3
+#define REPORT_ID_CONTROL           8   // commands in, device state out
+#define REPORT_ID_TYPING            9   // typing rate: config in, config + achieved rate out
+#define REPORT_ID_MEMORY            10  // heap, task stack headroom, per-module RAM
+#define REPORT_ID_INPUT_EDGES       11  // 11..17: edge-interval histogram per input line
+#define REPORT_ID_TLOG              18  // persistent telemetry log, one record per read
+#define REPORT_ID_PROFILE           19  // sampling profiler: commands in, capture pages out
+#define REPORT_ID_TELEM_HIST_EXT    20  // 20..: histograms of the stages past 4..7
+#define REPORT_ID_LAST              (REPORT_ID_TELEM_HIST_EXT + TELEM_LAT_COUNT - TELEM_HIST_BASE_STAGES - 1)
+#define REPORT_ID_HEALTH            30  // health monitor: objectives in, misses and stalls out
+#define FEATURE_REPORT_LEN          63
+#define FEATURE_HEADER_LEN          3
+#define FEATURE_WORDS               ((FEATURE_REPORT_LEN - FEATURE_HEADER_LEN) / 4)
+#define TELEM_LAYOUT_VERSION        2   // 2: histogram word 2 is the mean in us, was a sum in ms
+
+#define TELEM_COUNTER_PAGES         (REPORT_ID_TELEM_HIST - REPORT_ID_TELEM_COUNTERS)
+#define TELEM_HIST_BASE_STAGES      (REPORT_ID_CONTROL - REPORT_ID_TELEM_HIST)
+
+_Static_assert(TELEM_COUNTER_COUNT <= TELEM_COUNTER_PAGES * FEATURE_WORDS,
+               "telemetry counters overflow the counter pages");
+_Static_assert(TELEM_LAT_COUNT >= TELEM_HIST_BASE_STAGES, "histogram report IDs 4..7 in use");
+_Static_assert(REPORT_ID_TELEM_HIST_EXT > REPORT_ID_PROFILE, "extra histograms overlap");
+_Static_assert(sizeof(telemetry_hist_t) == FEATURE_WORDS * 4,
+               "histogram page layout");
+_Static_assert(MEM_REPORT_WORDS <= FEATURE_WORDS, "memory report overflows a page");
+_Static_assert(BOOT_STAGE_COUNT + 1 <= FEATURE_WORDS, "boot trace overflows the control report");
+_Static_assert(sizeof(input_edge_stats_t) == FEATURE_WORDS * 4, "edge report layout");
+_Static_assert(REPORT_ID_INPUT_EDGES + INPUT_LINE_COUNT <= REPORT_ID_TLOG, "edge reports overlap");
+_Static_assert(TLOG_RECORD_WORDS == FEATURE_WORDS, "telemetry log record layout");
+_Static_assert(PROF_PAGE_WORDS == FEATURE_WORDS, "profiler page layout");
+_Static_assert(REPORT_ID_LAST < REPORT_ID_HEALTH, "extra histograms overlap the health report");
+_Static_assert(HEALTH_STATS_WORDS == FEATURE_WORDS, "health report layout");
+
+// Control report commands (first byte of a SET_REPORT on REPORT_ID_CONTROL)
+#define CONTROL_CMD_TELEM_RESET     0x01
+#define CONTROL_CMD_PROVISION_ENTER 0x10
+#define CONTROL_CMD_PROVISION_EXIT  0x11
+#define CONTROL_CMD_TLOG_FLUSH      0x20
+
+// Profiler commands (first byte of a SET_REPORT on REPORT_ID_PROFILE)
+#define PROFILE_CMD_STOP            0x00
+#define PROFILE_CMD_START           0x01    // then u16 LE rate per core in Hz, 0 = default
+#define PROFILE_CMD_REWIND          0x02
+
+// Control report state flags (byte 1 of GET_REPORT on REPORT_ID_CONTROL)
+#define CONTROL_FLAG_MOUNTED        0x01
+#define CONTROL_FLAG_PROVISIONING   0x02
+
+// Typing report state flags (byte 1 of GET_REPORT on REPORT_ID_TYPING)
+#define TYPING_FLAG_BACKED_OFF      0x01
+
 /************* TinyUSB descriptors ****************/
 
 #define TUSB_DESC_TOTAL_LEN (TUD_CONFIG_DESC_LEN + CFG_TUD_HID * TUD_HID_DESC_LEN)
 
-// HID report descriptor - keyboard only (no mouse)
+#define COSMO_FEATURE_REPORT(id) \
+    HID_REPORT_ID(id) \
+    HID_USAGE(id), \
+    HID_REPORT_COUNT(FEATURE_REPORT_LEN), \
+    HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE)
+
+// HID report descriptor - keyboard (no mouse) + vendor feature reports
 const uint8_t hid_report_descriptor[] = {
-    TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(HID_ITF_PROTOCOL_KEYBOARD)),
+    TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(REPORT_ID_KEYBOARD)),
+    HID_USAGE_PAGE_N(HID_USAGE_PAGE_VENDOR, 2),
+    HID_USAGE(0x01),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+        HID_LOGICAL_MIN(0x00),
+        HID_LOGICAL_MAX_N(0xff, 2),
+        HID_REPORT_SIZE(8),
+        COSMO_FEATURE_REPORT(REPORT_ID_TELEM_COUNTERS),
+        COSMO_FEATURE_REPORT(REPORT_ID_TELEM_COUNTERS + 1),
+        COSMO_FEATURE_REPORT(REPORT_ID_TELEM_HIST + TELEM_LAT_INPUT),
+        COSMO_FEATURE_REPORT(REPORT_ID_TELEM_HIST + TELEM_LAT_NFC_READ),
+        COSMO_FEATURE_REPORT(REPORT_ID_TELEM_HIST + TELEM_LAT_NFC_QUEUE),
+        COSMO_FEATURE_REPORT(REPORT_ID_TELEM_HIST + TELEM_LAT_NFC_TYPE),
+        COSMO_FEATURE_REPORT(REPORT_ID_CONTROL),
+        COSMO_FEATURE_REPORT(REPORT_ID_TYPING),
+        COSMO_FEATURE_REPORT(REPORT_ID_MEMORY),
+        COSMO_FEATURE_REPORT(REPORT_ID_INPUT_EDGES + INPUT_LINE_BUTTON),
+        COSMO_FEATURE_REPORT(REPORT_ID_INPUT_EDGES + INPUT_LINE_ENC1_A),
+        COSMO_FEATURE_REPORT(REPORT_ID_INPUT_EDGES + INPUT_LINE_ENC1_B),
+        COSMO_FEATURE_REPORT(REPORT_ID_INPUT_EDGES + INPUT_LINE_ENC1_SW),
+        COSMO_FEATURE_REPORT(REPORT_ID_INPUT_EDGES + INPUT_LINE_ENC2_A),
+        COSMO_FEATURE_REPORT(REPORT_ID_INPUT_EDGES + INPUT_LINE_ENC2_B),
+        COSMO_FEATURE_REPORT(REPORT_ID_INPUT_EDGES + INPUT_LINE_ENC2_SW),
+        COSMO_FEATURE_REPORT(REPORT_ID_TLOG),
+        COSMO_FEATURE_REPORT(REPORT_ID_PROFILE),
+        COSMO_FEATURE_REPORT(REPORT_ID_TELEM_HIST_EXT + TELEM_LAT_NFC_FIRST_CHAR - TELEM_HIST_BASE_STAGES),
+        COSMO_FEATURE_REPORT(REPORT_ID_TELEM_HIST_EXT + TELEM_LAT_NFC_DONE - TELEM_HIST_BASE_STAGES),
+        COSMO_FEATURE_REPORT(REPORT_ID_HEALTH),
+    HID_COLLECTION_END,
 };
 
 // String descriptor
@@ -69,7 +194,7 @@ static const uint8_t hid_configuration_descriptor[] = {
     TUD_CONFIG_DESCRIPTOR(1, 1, 0, TUSB_DESC_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
 
     // Interface number, string index, boot protocol, report descriptor len, EP In address, size & polling interval
-    TUD_HID_DESCRIPTOR(0, 4, false, sizeof(hid_report_descriptor), 0x81, 16, 10),
+    TUD_HID_DESCRIPTOR(0, 4, false, sizeof(hid_report_descriptor), 0x81, 16, CONFIG_COSMO_HID_POLL_INTERVAL_MS),
 };
 
 /********* TinyUSB HID callbacks ***************/
@@ -81,42 +206,213 @@ uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
     return hid_report_descriptor;
 }
 
-// Invoked when received GET_REPORT control request
+static void set_provisioning(bool on);
+static uint16_t typing_get_report(uint8_t *buffer);
+
+// Next telemetry log record REPORT_ID_TLOG returns (age, 0 = newest).
+// Only touched from the TinyUSB task.
+static uint32_t s_tlog_cursor = 0;
+static void typing_set_report(uint8_t const *buffer, uint16_t bufsize);
+
+static void profile_set_report(uint8_t const *buffer, uint16_t bufsize)
+{
+    if (bufsize < 1) {
+        return;
+    }
+    switch (buffer[0]) {
+    case PROFILE_CMD_STOP:
+        profiler_stop();
+        break;
+    case PROFILE_CMD_START: {
+        uint16_t rate_hz = bufsize >= 3 ? (uint16_t)(buffer[1] | buffer[2] << 8) : 0;
+        esp_err_t err = profiler_start(rate_hz);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Profiler start failed: %s", esp_err_to_name(err));
+        }
+        break;
+    }
+    case PROFILE_CMD_REWIND:
+        profiler_rewind();
+        break;
+    default:
+        ESP_LOGW(TAG, "Unknown profiler command 0x%02x", buffer[0]);
+        break;
+    }
+}
+
+// Latency stage whose histogram a report ID carries, or -1
+static int hist_stage(uint8_t report_id)
+{
+    if (report_id >= REPORT_ID_TELEM_HIST && report_id < REPORT_ID_CONTROL) {
+        return report_id - REPORT_ID_TELEM_HIST;
+    }
+    if (report_id >= REPORT_ID_TELEM_HIST_EXT && report_id <= REPORT_ID_LAST) {
+        return TELEM_HIST_BASE_STAGES + (report_id - REPORT_ID_TELEM_HIST_EXT);
+    }
+    return -1;
+}
+
+// Invoked when received GET_REPORT control request.
+// Runs on the TinyUSB task; only reads counters, never blocks.
 uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type,
                                uint8_t *buffer, uint16_t reqlen)
 {
     (void)instance;
-    (void)report_id;
-    (void)report_type;
-    (void)buffer;
-    (void)reqlen;
-    return 0;
+    if (report_type != HID_REPORT_TYPE_FEATURE || reqlen < FEATURE_REPORT_LEN) {
+        return 0;   // STALL
+    }
+
+    uint32_t words[FEATURE_WORDS] = {0};
+    memset(buffer, 0, FEATURE_REPORT_LEN);
+    buffer[0] = TELEM_LAYOUT_VERSION;
+
+    if (report_id >= REPORT_ID_TELEM_COUNTERS && report_id < REPORT_ID_TELEM_HIST) {
+        size_t first = (size_t)(report_id - REPORT_ID_TELEM_COUNTERS) * FEATURE_WORDS;
+        telemetry_read_counters(first, words, FEATURE_WORDS);
+        buffer[1] = (uint8_t)first;
+        buffer[2] = first < TELEM_COUNTER_COUNT
+                  ? (uint8_t)MIN(FEATURE_WORDS, TELEM_COUNTER_COUNT - first) : 0;
+    } else if (hist_stage(report_id) >= 0) {
+        telemetry_hist_t h;
+        telemetry_read_hist((telemetry_stage_t)hist_stage(report_id), &h);
+        memcpy(words, &h, sizeof(h));
+        buffer[1] = (uint8_t)hist_stage(report_id);
+        buffer[2] = FEATURE_WORDS;
+    } else if (report_id == REPORT_ID_CONTROL) {
+        // Words: boot stage timestamps in µs (boot_trace.h order), 0 = not
+        // reached, then power-on reset -> app_main in µs (0 = not a cold boot).
+        buffer[1] = (tud_mounted() ? CONTROL_FLAG_MOUNTED : 0)
+                  | (nfc_provision_is_active() ? CONTROL_FLAG_PROVISIONING : 0);
+        for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+            words[i] = boot_trace_get_us(i);
+        }
+        words[BOOT_STAGE_COUNT] = boot_trace_get_reset_us();
+        buffer[2] = BOOT_STAGE_COUNT + 1;
+    } else if (report_id == REPORT_ID_TYPING) {
+        return typing_get_report(buffer);
+    } else if (report_id == REPORT_ID_MEMORY) {
+        // Byte 1: bitmask of task slots in use (mem_report.h order).
+        buffer[1] = (uint8_t)mem_report_read(words);
+        buffer[2] = MEM_REPORT_WORDS;
+    } else if (report_id >= REPORT_ID_INPUT_EDGES && report_id < REPORT_ID_INPUT_EDGES + INPUT_LINE_COUNT) {
+        input_edge_stats_t st;
+        input_handler_read_edge_stats((input_line_t)(report_id - REPORT_ID_INPUT_EDGES), &st);
+        memcpy(words, &st, sizeof(st));
+        buffer[1] = report_id - REPORT_ID_INPUT_EDGES;
+        buffer[2] = FEATURE_WORDS;
+    } else if (report_id == REPORT_ID_TLOG) {
+        // Byte 1: record type (telemetry_log.h), 0 = past the oldest record.
+        // Each read steps one record back; SET_REPORT picks the start.
+        tlog_record_t rec;
+        tlog_type_t type = tlog_read(s_tlog_cursor, &rec);
+        if (type != TLOG_TYPE_NONE) s_tlog_cursor++;
+        memcpy(words, &rec, sizeof(words));
+        buffer[1] = type;
+        buffer[2] = type == TLOG_TYPE_NONE ? 0 : TLOG_RECORD_WORDS;
+    } else if (report_id == REPORT_ID_PROFILE) {
+        // Byte 1: page type (profiler.h). Each read returns the next page;
+        // while sampling, always the header.
+        buffer[1] = profiler_read_page(words, &buffer[2]);
+    } else if (report_id == REPORT_ID_HEALTH) {
+        // Byte 1: bitmask of the tasks stuck right now (health.h order).
+        health_stats_t st;
+        health_get_stats(&st);
+        memcpy(words, &st, sizeof(st));
+        buffer[1] = (uint8_t)health_stalled_mask();
+        buffer[2] = HEALTH_STATS_WORDS;
+    } else {
+        return 0;
+    }
+
+    memcpy(&buffer[FEATURE_HEADER_LEN], words, sizeof(words));
+    return FEATURE_REPORT_LEN;
 }
 
-// Invoked when received SET_REPORT control request
+// Invoked when received SET_REPORT control request.
+// Any SET_REPORT on a telemetry page resets all counters; the control report
+// carries a command byte.
 void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type,
                            uint8_t const *buffer, uint16_t bufsize)
 {
     (void)instance;
-    (void)report_id;
-    (void)report_type;
-    (void)buffer;
-    (void)bufsize;
+    if (report_type != HID_REPORT_TYPE_FEATURE) {
+        return;     // keyboard LED output report — nothing to show it on
+    }
+
+    if ((report_id >= REPORT_ID_TELEM_COUNTERS && report_id < REPORT_ID_TELEM_HIST)
+        || hist_stage(report_id) >= 0) {
+        telemetry_reset();
+        ESP_LOGI(TAG, "Telemetry reset by host");
+        return;
+    }
+    if (report_id >= REPORT_ID_INPUT_EDGES && report_id < REPORT_ID_INPUT_EDGES + INPUT_LINE_COUNT) {
+        input_handler_reset_edge_stats();
+        ESP_LOGI(TAG, "Input edge statistics reset by host");
+        return;
+    }
+    if (report_id == REPORT_ID_TYPING) {
+        typing_set_report(buffer, bufsize);
+        return;
+    }
+    if (report_id == REPORT_ID_TLOG) {
+        // u32 LE: age of the first record to read, 0 = newest
+        uint32_t back = 0;
+        memcpy(&back, buffer, MIN(bufsize, sizeof(back)));
+        s_tlog_cursor = back;
+        return;
+    }
+    if (report_id == REPORT_ID_PROFILE) {
+        profile_set_report(buffer, bufsize);
+        return;
+    }
+    if (report_id == REPORT_ID_HEALTH) {
+        // u32 LE per objective (health_slo_t order), us, 0 = off; a short
+        // report leaves the rest off. Also clears the health statistics.
+        uint32_t slo_us[HEALTH_SLO_COUNT] = {0};
+        memcpy(slo_us, buffer, MIN(bufsize, sizeof(slo_us)));
+        health_set_slos(slo_us);
+        return;
+    }
+    if (report_id != REPORT_ID_CONTROL || bufsize < 1) {
+        return;
+    }
+
+    switch (buffer[0]) {
+    case CONTROL_CMD_TELEM_RESET:
+        telemetry_reset();
+        input_handler_reset_edge_stats();
+        ESP_LOGI(TAG, "Telemetry reset by host");
+        break;
+    case CONTROL_CMD_PROVISION_ENTER:
+        set_provisioning(true);
+        break;
+    case CONTROL_CMD_PROVISION_EXIT:
+        set_provisioning(false);
+        break;
+    case CONTROL_CMD_TLOG_FLUSH:
+        tlog_flush();
+        break;
+    default:
+        ESP_LOGW(TAG, "Unknown control command 0x%02x", buffer[0]);
+        break;
+    }
 }
 
 /********* HID Key State + Reporting ***************/
 
 // Multi-key HID state. Two FreeRTOS tasks write here concurrently:
 //   - input_handler_task: button + encoder events
-//   - RC522 event task:   NFC tag scans -> string injection
+//   - nfc_dispatch task:  NFC tag scans -> string injection
 // All access goes through s_hid_mutex; the helpers below take/give it
 // internally so callers don't need to think about locking.
 //
 // `keys_*` operate on the array (held-key set). `hid_*` are the public
 // actions (down / up / pulse / type-char) that wrap report submission.
 static SemaphoreHandle_t s_hid_mutex = NULL;
+static StaticSemaphore_t s_hid_mutex_buf;
 static uint8_t s_pressed_keys[6] = {0};
 static uint8_t s_modifier = 0;
+static volatile bool s_report_stale = false;  // last state change hit a busy endpoint
 
 // Add keycode to the pressed-set. No-op if already present.
 // Returns false on rollover (>6 keys held) — caller can ignore safely.
@@ -145,12 +441,21 @@ static void keys_remove(uint8_t keycode)
     }
 }
 
-// Submit current modifier + pressed-set as a HID report.
+// Submit current modifier + pressed-set as a HID report. Returns false if it
+// was not queued (not mounted / endpoint busy).
 // MUST be called with s_hid_mutex held.
-static void hid_report_locked(void)
+static bool hid_report_locked(void)
 {
-    if (!tud_mounted()) return;
-    tud_hid_keyboard_report(HID_ITF_PROTOCOL_KEYBOARD, s_modifier, s_pressed_keys);
+    if (!tud_mounted() ||
+        !tud_hid_keyboard_report(REPORT_ID_KEYBOARD, s_modifier, s_pressed_keys)) {
+        // Busy endpoint: tud_hid_report_complete_cb resends the state.
+        s_report_stale = tud_mounted();
+        telemetry_count(TELEM_HID_REPORTS_DROPPED);
+        return false;
+    }
+    s_report_stale = false;
+    telemetry_count(TELEM_HID_REPORTS);
+    return true;
 }
 
 // Press a key (idempotent). Holds across subsequent reports until hid_key_up().
@@ -172,34 +477,270 @@ static void hid_key_up(uint8_t keycode)
 }
 
 // Pulse a key (down -> KEY_PULSE_MS -> up). Used for rotary encoder detents.
-static void hid_key_pulse(uint8_t keycode)
+// event_us is when the detent was seen, for the input latency histogram.
+static void hid_key_pulse(uint8_t keycode, int64_t event_us)
 {
     hid_key_down(keycode);
+    telemetry_latency(TELEM_LAT_INPUT, event_us);
     vTaskDelay(pdMS_TO_TICKS(KEY_PULSE_MS));
     hid_key_up(keycode);
 }
 
-// Type one ASCII char as a press+release with optional modifier OR'd in.
-// Releases the lock between press and release so user input can interleave
-// between characters of an NFC string injection.
-static void hid_type_char(uint8_t modifier, uint8_t keycode)
+/********* String Typing Rate ***************/
+
+// Typing timing, negotiated by the host over REPORT_ID_TYPING. Written on the
+// TinyUSB task, read on the typing (NFC dispatch) task.
+typedef struct {
+    uint16_t key_down_ms;       // hold each character this long
+    uint16_t key_up_ms;         // gap after a release before the next press
+    uint16_t string_gap_ms;     // pause after a whole string
+    uint16_t report_interval_ms;// minimum spacing between two reports
+    uint16_t lease_s;           // fall back unless renewed within this, 0 = never
+} typing_config_t;
+
+typedef struct {
+    uint32_t chars_per_s_x10;   // achieved over the last string
+    uint32_t last_chars;
+    uint32_t last_us;
+    uint32_t ack_us_avg;        // report submitted -> taken by the host
+    uint32_t ack_us_max;
+    uint32_t ack_timeouts;
+    uint32_t lease_expiries;
+    uint32_t last_reports;      // keyboard reports the last string took
+} typing_stats_t;
+
+static const typing_config_t TYPING_SAFE = {
+    .key_down_ms = STRING_KEY_DOWN_MS,
+    .key_up_ms = STRING_KEY_UP_MS,
+};
+
+static portMUX_TYPE s_typing_lock = portMUX_INITIALIZER_UNLOCKED;
+static typing_config_t s_typing_cfg = TYPING_SAFE;
+static int64_t s_typing_lease_until_us = 0;     // 0 = no lease running
+static bool s_typing_backed_off = false;
+static typing_stats_t s_typing_stats = {0};
+static uint64_t s_ack_us_sum = 0;
+static uint32_t s_ack_count = 0;
+
+// The key the typing task is holding (0 = none), the modifier it was typed
+// with, and the modifier state to restore when it goes up. Only the NFC
+// dispatch task types.
+static uint8_t s_typed_key = 0;
+static uint8_t s_typed_mod = 0;
+static uint8_t s_typed_prev_mod = 0;
+static uint32_t s_typed_reports = 0;
+
+// Report-complete signal from TinyUSB, and a µs timer for sub-tick waits
+// (the FreeRTOS tick is 10 ms, coarser than a negotiated key time).
+static SemaphoreHandle_t s_report_done = NULL;
+static StaticSemaphore_t s_report_done_buf;
+static esp_timer_handle_t s_typing_timer = NULL;
+static TaskHandle_t s_typing_waiter = NULL;
+
+// Invoked when the host has taken a report off the IN endpoint.
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len)
 {
-    xSemaphoreTake(s_hid_mutex, portMAX_DELAY);
-    uint8_t prev_mod = s_modifier;
-    s_modifier = prev_mod | modifier;
-    keys_add(keycode);
-    hid_report_locked();
-    xSemaphoreGive(s_hid_mutex);
+    (void)instance;
+    (void)report;
+    (void)len;
+    boot_trace_mark(BOOT_STAGE_MOUNT_REPORT);    // the first completion is the mount report
+    xSemaphoreGive(s_report_done);
 
-    vTaskDelay(pdMS_TO_TICKS(STRING_KEY_DOWN_MS));
+    // A knob or button change that found the endpoint busy (typically with
+    // a typed NFC character) goes out now rather than riding on the next
+    // typed report, so its latency does not depend on the typing rate. If
+    // the mutex is taken, its holder is about to send the current state.
+    if (s_report_stale && xSemaphoreTake(s_hid_mutex, 0) == pdTRUE) {
+        if (s_report_stale) {
+            hid_report_locked();
+        }
+        xSemaphoreGive(s_hid_mutex);
+    }
+}
+
+static void typing_timer_cb(void *arg)
+{
+    xTaskNotifyGive(s_typing_waiter);
+}
+
+static void typing_sleep_until(int64_t deadline_us)
+{
+    int64_t wait_us = deadline_us - esp_timer_get_time();
+    if (wait_us <= 0) return;
+    s_typing_waiter = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+    esp_timer_start_once(s_typing_timer, (uint64_t)wait_us);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+static void typing_back_off(const char *why)
+{
+    portENTER_CRITICAL(&s_typing_lock);
+    bool was_safe = s_typing_backed_off || memcmp(&s_typing_cfg, &TYPING_SAFE, sizeof(TYPING_SAFE)) == 0;
+    s_typing_cfg = TYPING_SAFE;
+    s_typing_lease_until_us = 0;
+    s_typing_backed_off = true;
+    portEXIT_CRITICAL(&s_typing_lock);
+    if (!was_safe) {
+        ESP_LOGW(TAG, "Typing rate back to safe %u/%u ms: %s", STRING_KEY_DOWN_MS, STRING_KEY_UP_MS, why);
+    }
+}
+
+// Current config, applying lease expiry first.
+static typing_config_t typing_config(void)
+{
+    bool expired = false;
+    portENTER_CRITICAL(&s_typing_lock);
+    if (s_typing_lease_until_us != 0 && esp_timer_get_time() > s_typing_lease_until_us) {
+        expired = true;
+    }
+    portEXIT_CRITICAL(&s_typing_lock);
+    if (expired) {
+        s_typing_stats.lease_expiries++;
+        typing_back_off("host did not renew the lease");
+    }
+
+    portENTER_CRITICAL(&s_typing_lock);
+    typing_config_t cfg = s_typing_cfg;
+    portEXIT_CRITICAL(&s_typing_lock);
+    return cfg;
+}
+
+// Wait for the host to take the report just submitted at sent_us.
+static bool typing_wait_ack(int64_t sent_us)
+{
+    if (xSemaphoreTake(s_report_done, pdMS_TO_TICKS(TYPING_ACK_TIMEOUT_MS)) != pdTRUE) {
+        s_typing_stats.ack_timeouts++;
+        typing_back_off("host stopped taking reports");
+        return false;
+    }
+    uint32_t us = (uint32_t)(esp_timer_get_time() - sent_us);
+    s_ack_us_sum += us;
+    s_ack_count++;
+    s_typing_stats.ack_us_avg = (uint32_t)(s_ack_us_sum / s_ack_count);
+    if (us > s_typing_stats.ack_us_max) s_typing_stats.ack_us_max = us;
+    return true;
+}
+
+// Submit one typing report once the endpoint is free; returns when the host
+// has taken it (or the ack timed out). The report releases the held typed
+// key if `release` is set and presses keycode (modifier OR'd in) if it is
+// non-zero. Knob reports from the input task may complete in between, which
+// only makes the wait a little shorter.
+static void typing_submit(bool release, uint8_t modifier, uint8_t keycode)
+{
+    if (tud_mounted() && !tud_hid_ready()) {
+        xSemaphoreTake(s_report_done, pdMS_TO_TICKS(TYPING_ACK_TIMEOUT_MS));
+    }
+    xSemaphoreTake(s_report_done, 0);   // drop a stale completion
+    health_beat(HEALTH_TASK_NFC_DISPATCH);
 
     xSemaphoreTake(s_hid_mutex, portMAX_DELAY);
-    keys_remove(keycode);
-    s_modifier = prev_mod;
-    hid_report_locked();
+    if (release) {
+        keys_remove(s_typed_key);
+        s_modifier = s_typed_prev_mod;
+        s_typed_key = 0;
+    }
+    if (keycode != 0) {
+        s_typed_prev_mod = s_modifier;
+        s_modifier |= modifier;
+        keys_add(keycode);
+        s_typed_key = keycode;
+        s_typed_mod = modifier;
+    }
+    bool sent = hid_report_locked();
     xSemaphoreGive(s_hid_mutex);
+    s_typed_reports++;
+
+    if (sent) {
+        typing_wait_ack(esp_timer_get_time());
+    }
+}
+
+// Release the typed key, if one is held, then keep the key-up gap. Ends a
+// string, and any pause in typing: a key left down would auto-repeat.
+static void hid_type_release(void)
+{
+    if (s_typed_key == 0) {
+        return;
+    }
+    typing_config_t cfg = typing_config();
+    int64_t t0 = esp_timer_get_time();
+    typing_submit(true, 0, 0);
+    typing_sleep_until(t0 + (int64_t)MAX(cfg.key_up_ms, cfg.report_interval_ms) * 1000);
+}
+
+// Type one key with an optional modifier OR'd in and leave it down for the
+// key-down time. The previous key goes up in the same report, so the host
+// sees one key released and the next pressed and a string costs about one
+// report per character. A separate release goes first only when sharing
+// the report would be wrong: the same key again (the host would see no new
+// press) or a different modifier (the modifier byte would apply to both
+// keys). The lock is released between reports, so user input can
+// interleave between characters of an NFC string injection.
+static void hid_type_char(uint8_t modifier, uint8_t keycode)
+{
+    if (s_typed_key != 0 && (s_typed_key == keycode || s_typed_mod != modifier)) {
+        hid_type_release();
+    }
+    typing_config_t cfg = typing_config();
+    int64_t t0 = esp_timer_get_time();
+    typing_submit(s_typed_key != 0, modifier, keycode);
+    typing_sleep_until(t0 + (int64_t)MAX(cfg.key_down_ms, cfg.report_interval_ms) * 1000);
+}
+
+// GET_REPORT(REPORT_ID_TYPING): [1] flags, [2] word count, then u32 LE:
+// active config (5 words), then typing_stats_t.
+static uint16_t typing_get_report(uint8_t *buffer)
+{
+    typing_config_t cfg;
+    portENTER_CRITICAL(&s_typing_lock);
+    cfg = s_typing_cfg;
+    buffer[1] = s_typing_backed_off ? TYPING_FLAG_BACKED_OFF : 0;
+    portEXIT_CRITICAL(&s_typing_lock);
+
+    uint32_t words[FEATURE_WORDS] = {
+        cfg.key_down_ms, cfg.key_up_ms, cfg.string_gap_ms, cfg.report_interval_ms, cfg.lease_s,
+    };
+    _Static_assert(5 + sizeof(typing_stats_t) / 4 <= FEATURE_WORDS, "typing report layout");
+    memcpy(&words[5], &s_typing_stats, sizeof(s_typing_stats));
+    buffer[2] = 5 + sizeof(typing_stats_t) / 4;
+    memcpy(&buffer[FEATURE_HEADER_LEN], words, sizeof(words));
+    return FEATURE_REPORT_LEN;
+}
+
+// SET_REPORT(REPORT_ID_TYPING): u16 LE key_down_ms, key_up_ms, string_gap_ms,
+// report_interval_ms, lease_s. Re-sending the same config renews the lease.
+static void typing_set_report(uint8_t const *buffer, uint16_t bufsize)
+{
+    if (bufsize < 10) {
+        ESP_LOGW(TAG, "Typing config too short (%u bytes)", bufsize);
+        return;
+    }
+    typing_config_t cfg = {
+        .key_down_ms        = buffer[0] | (buffer[1] << 8),
+        .key_up_ms          = buffer[2] | (buffer[3] << 8),
+        .string_gap_ms      = buffer[4] | (buffer[5] << 8),
+        .report_interval_ms = buffer[6] | (buffer[7] << 8),
+        .lease_s            = buffer[8] | (buffer[9] << 8),
+    };
+    if (cfg.key_down_ms > TYPING_MAX_MS || cfg.key_up_ms > TYPING_MAX_MS ||
+        cfg.string_gap_ms > TYPING_MAX_MS || cfg.report_interval_ms > TYPING_MAX_MS) {
+        ESP_LOGW(TAG, "Typing config rejected: a time exceeds %d ms", TYPING_MAX_MS);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_typing_lock);
+    bool changed = memcmp(&cfg, &s_typing_cfg, sizeof(cfg)) != 0 || s_typing_backed_off;
+    s_typing_cfg = cfg;
+    s_typing_lease_until_us = cfg.lease_s ? esp_timer_get_time() + (int64_t)cfg.lease_s * 1000000 : 0;
+    s_typing_backed_off = false;
+    portEXIT_CRITICAL(&s_typing_lock);
 
-    vTaskDelay(pdMS_TO_TICKS(STRING_KEY_UP_MS));
+    if (changed) {
+        ESP_LOGI(TAG, "Typing rate set by host: down %u / up %u / gap %u / interval %u ms, lease %u s",
+                 cfg.key_down_ms, cfg.key_up_ms, cfg.string_gap_ms, cfg.report_interval_ms, cfg.lease_s);
+    }
 }
 
 // Translate ASCII to HID (modifier, keycode). Returns false if char not supported.
@@ -254,130 +795,361 @@ static bool ascii_to_hid(char c, uint8_t *modifier, uint8_t *keycode)
     return false;
 }
 
+// Type one ASCII char. Returns false (and types nothing) if it is unsupported.
+static bool type_ascii(char c)
+{
+    uint8_t mod, kc;
+    if (!ascii_to_hid(c, &mod, &kc)) {
+        return false;
+    }
+    hid_type_char(mod, kc);
+    return true;
+}
+
+// Achieved rate of one string, for the typing report. reports_start is
+// s_typed_reports when the string started.
+static void typing_record_string(size_t typed, int64_t start_us, uint32_t reports_start)
+{
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+    if (typed > 0 && us > 0) {
+        s_typing_stats.last_chars = typed;
+        s_typing_stats.last_reports = s_typed_reports - reports_start;
+        s_typing_stats.last_us = us;
+        s_typing_stats.chars_per_s_x10 = (uint32_t)((uint64_t)typed * 10000000 / us);
+    }
+}
+
 // Type a null-terminated string via HID keyboard. Skips unsupported chars.
-static void send_string(const char *str)
+// If should_stop is non-NULL it is polled before every character; typing ends
+// early when it returns true. Returns the number of characters actually typed;
+// *complete is set if the whole string went out, its last character included
+// (for a line, the Enter that submitted it).
+static size_t send_string(const char *str, bool (*should_stop)(void), bool *complete)
 {
-    for (const char *p = str; *p; p++) {
-        uint8_t mod, kc;
-        if (!ascii_to_hid(*p, &mod, &kc)) {
-            continue;
+    size_t typed = 0;
+    const char *p = str;
+    for (; *p; p++) {
+        if (should_stop != NULL && should_stop()) {
+            break;
+        }
+        if (type_ascii(*p)) {
+            typed++;
         }
-        hid_type_char(mod, kc);
     }
+    hid_type_release();
+    *complete = *p == '\0';
+    return typed;
 }
 
 /********* Input Event Handling ***************/
 
+// Provisioning chord: both encoder knobs held, then the action button pressed.
+// The chord is not typed: F1 and F2 are released at once, and the releases
+// still to come from the three switches are swallowed.
+static bool s_enc1_sw_held = false;
+static bool s_enc2_sw_held = false;
+static uint8_t s_chord_swallow = 0;     // CHORD_* releases not to send
+
+#define CHORD_BUTTON    (1u << 0)
+#define CHORD_ENC1_SW   (1u << 1)
+#define CHORD_ENC2_SW   (1u << 2)
+
+static const led_pattern_t LED_PROVISIONING = {
+    .type = LED_PATTERN_PULSE, .red = 128, .green = 0, .blue = 128, .period_ms = 1500,
+};
+
+// Entered from the button chord or the host's control feature report.
+static void set_provisioning(bool on)
+{
+    if (on == nfc_provision_is_active()) {
+        return;
+    }
+    if (!on) {
+        nfc_provision_exit();
+        led_indicator_clear(LED_LAYER_STATUS);
+    } else if (nfc_provision_enter() == ESP_OK) {
+        led_indicator_play(LED_LAYER_STATUS, &LED_PROVISIONING);
+    }
+}
+
 // Callback for input events from input_handler module.
 // Each event maps to a *single* keycode press or release, so combinations like
 // "hold ENC1_SW (F1) and rotate ENC1 (Up)" produce the correct F1+Up combo.
 static void on_input_event(const input_event_t *event)
 {
+    evlog_put(EVLOG_INPUT, event->type, 0, 0);
+
     switch (event->type) {
     case INPUT_EVENT_BUTTON_PRESS:
-        ESP_LOGI(TAG, "BTN -> ENTER (pressed)");
-        led_indicator_red();
+        if (s_enc1_sw_held && s_enc2_sw_held) {
+            set_provisioning(!nfc_provision_is_active());
+            xSemaphoreTake(s_hid_mutex, portMAX_DELAY);
+            keys_remove(KEY_F1);
+            keys_remove(KEY_F2);
+            hid_report_locked();
+            xSemaphoreGive(s_hid_mutex);
+            s_chord_swallow = CHORD_BUTTON | CHORD_ENC1_SW | CHORD_ENC2_SW;
+            return;
+        }
+        led_indicator_solid(LED_LAYER_BUTTON, 255, 0, 0);
         hid_key_down(KEY_ENTER);
         break;
 
     case INPUT_EVENT_BUTTON_RELEASE:
-        ESP_LOGI(TAG, "BTN -> ENTER (released)");
-        led_indicator_off();
+        if (s_chord_swallow & CHORD_BUTTON) {
+            s_chord_swallow &= ~CHORD_BUTTON;
+            return;
+        }
+        led_indicator_clear(LED_LAYER_BUTTON);
         hid_key_up(KEY_ENTER);
         break;
 
     case INPUT_EVENT_ENC1_CW:
-        ESP_LOGI(TAG, "ENC1 CW -> UP");
-        hid_key_pulse(KEY_UP_ARROW);
+        hid_key_pulse(KEY_UP_ARROW, event->time_us);
         break;
 
     case INPUT_EVENT_ENC1_CCW:
-        ESP_LOGI(TAG, "ENC1 CCW -> DOWN");
-        hid_key_pulse(KEY_DOWN_ARROW);
+        hid_key_pulse(KEY_DOWN_ARROW, event->time_us);
         break;
 
     case INPUT_EVENT_ENC1_SW_PRESS:
-        ESP_LOGI(TAG, "ENC1 SW -> F1 (pressed)");
+        s_enc1_sw_held = true;
         hid_key_down(KEY_F1);
         break;
 
     case INPUT_EVENT_ENC1_SW_RELEASE:
-        ESP_LOGI(TAG, "ENC1 SW -> F1 (released)");
+        s_enc1_sw_held = false;
+        if (s_chord_swallow & CHORD_ENC1_SW) {
+            s_chord_swallow &= ~CHORD_ENC1_SW;
+            return;
+        }
         hid_key_up(KEY_F1);
         break;
 
     case INPUT_EVENT_ENC2_CW:
-        ESP_LOGI(TAG, "ENC2 CW -> RIGHT");
-        hid_key_pulse(KEY_RIGHT_ARROW);
+        hid_key_pulse(KEY_RIGHT_ARROW, event->time_us);
         break;
 
     case INPUT_EVENT_ENC2_CCW:
-        ESP_LOGI(TAG, "ENC2 CCW -> LEFT");
-        hid_key_pulse(KEY_LEFT_ARROW);
+        hid_key_pulse(KEY_LEFT_ARROW, event->time_us);
         break;
 
     case INPUT_EVENT_ENC2_SW_PRESS:
-        ESP_LOGI(TAG, "ENC2 SW -> F2 (pressed)");
+        s_enc2_sw_held = true;
         hid_key_down(KEY_F2);
         break;
 
     case INPUT_EVENT_ENC2_SW_RELEASE:
-        ESP_LOGI(TAG, "ENC2 SW -> F2 (released)");
+        s_enc2_sw_held = false;
+        if (s_chord_swallow & CHORD_ENC2_SW) {
+            s_chord_swallow &= ~CHORD_ENC2_SW;
+            return;
+        }
         hid_key_up(KEY_F2);
         break;
 
     default:
         break;
     }
+
+    // Presses and releases are a single report; pulses were timed above.
+    switch (event->type) {
+    case INPUT_EVENT_ENC1_CW:
+    case INPUT_EVENT_ENC1_CCW:
+    case INPUT_EVENT_ENC2_CW:
+    case INPUT_EVENT_ENC2_CCW:
+        break;
+    default:
+        telemetry_latency(TELEM_LAT_INPUT, event->time_us);
+        break;
+    }
 }
 
 // NFC tag scan callback — typed protocol depends on what's on the tag:
 //   - NDEF Text payload present → "<payload>\n" (raw payload, no prefix)
 //   - No NDEF / unparseable     → "NFC:<UID>\n" (UID fallback for diagnostics)
-static void on_nfc_tag(const char *payload, const char *uid_hex)
+// Runs on the NFC dispatch task. The payload is typed as the scanner reads
+// it; if the tag leaves mid-read, what was typed is erased with Backspace
+// and the UID line follows, the same result as a failed read of the whole
+// tag. If a newer tag supersedes this one mid-string
+// (CONFIG_COSMO_NFC_BUSY_SUPERSEDE), the partial string is erased before
+// the newer one is typed, so the host never sees a mix.
+static char s_nfc_line[64];     // only the NFC dispatch task types tags
+_Static_assert(sizeof(s_nfc_line) >= NFC_PAYLOAD_MAX_LEN + 1 && sizeof(s_nfc_line) > sizeof("NFC:\n") + 20,
+               "NFC line buffer");
+
+static void erase_typed(size_t typed)
 {
-    char buf[64];
-    int n;
-    if (payload != NULL) {
-        n = snprintf(buf, sizeof(buf), "%s\n", payload);
-    } else {
-        n = snprintf(buf, sizeof(buf), "NFC:%s\n", uid_hex);
+    while (typed-- > 0) {
+        hid_type_char(0, KEY_BACKSPACE);
     }
-    if (n <= 0 || n >= (int)sizeof(buf)) {
-        ESP_LOGW(TAG, "NFC HID buffer overflow, uid=%s", uid_hex);
-        return;
+    hid_type_release();
+}
+
+static void on_nfc_tag(const char *uid_hex, int64_t detected_us)
+{
+    int64_t start_us = esp_timer_get_time();
+    uint32_t reports_start = s_typed_reports;
+    size_t len = 0, typed = 0;
+    bool submitted = false;     // Enter went out: the line is the host's now
+    nfc_text_t text = NFC_TEXT_CHAR;
+    char c;
+
+    led_indicator_solid(LED_LAYER_NFC, 0, 0, 255);
+    while (!nfc_handler_is_superseded()) {
+        // Keep the last key down for the next one's report only if that
+        // character is already here, not while the scanner reads a page.
+        if (!nfc_handler_char_ready()) {
+            hid_type_release();
+        }
+        if ((text = nfc_handler_next_char(&c)) != NFC_TEXT_CHAR) {
+            break;
+        }
+        s_nfc_line[len++] = c;
+        if (len == 1) {
+            telemetry_latency(TELEM_LAT_NFC_FIRST_CHAR, detected_us);
+        }
+        typed += type_ascii(c);
+    }
+
+    if (text == NFC_TEXT_END) {
+        // Last chance to erase instead: a newer tag may have come in while
+        // the final character was held.
+        if (!nfc_handler_is_superseded()) {
+            s_nfc_line[len++] = '\n';
+            typed += type_ascii('\n');
+            submitted = true;
+        }
+    } else if (text != NFC_TEXT_CHAR) {
+        if (text == NFC_TEXT_ABORTED) {
+            evlog_put(EVLOG_NFC_READ_ABORTED, (uint16_t)typed, 0, 0);
+            erase_typed(typed);
+        }
+        if (len == 0) {
+            telemetry_latency(TELEM_LAT_NFC_FIRST_CHAR, detected_us);
+        }
+        len = (size_t)snprintf(s_nfc_line, sizeof(s_nfc_line), "NFC:%s\n", uid_hex);
+        typed = send_string(s_nfc_line, nfc_handler_is_superseded, &submitted);
     }
 
-    // Strip trailing newline for cleaner log line
-    char log_buf[64];
-    strncpy(log_buf, buf, sizeof(log_buf) - 1);
-    log_buf[sizeof(log_buf) - 1] = '\0';
-    size_t L = strlen(log_buf);
-    if (L > 0 && log_buf[L - 1] == '\n') log_buf[L - 1] = '\0';
-    ESP_LOGI(TAG, "NFC -> typing '%s\\n'", log_buf);
+    hid_type_release();
 
-    led_indicator_blue();
-    send_string(buf);
-    led_indicator_off();
+    // Never erase a submitted line: the Backspaces would land in whatever
+    // field the host focused after the Enter.
+    if (!submitted && nfc_handler_is_superseded()) {
+        evlog_put(EVLOG_NFC_SUPERSEDED, (uint16_t)typed, 0, 0);
+        erase_typed(typed);
+    } else {
+        telemetry_latency(TELEM_LAT_NFC_DONE, detected_us);
+        typing_record_string(typed, start_us, reports_start);
+        // Log without the trailing newline
+        evlog_put_bytes(EVLOG_NFC_TYPING, s_nfc_line, len - 1);
+    }
+    led_indicator_clear(LED_LAYER_NFC);
+
+    // The gap is a deliberate wait, up to TYPING_MAX_MS: no progress is due.
+    health_idle(HEALTH_TASK_NFC_DISPATCH);
+    typing_config_t cfg = typing_config();
+    typing_sleep_until(esp_timer_get_time() + (int64_t)cfg.string_gap_ms * 1000);
+}
+
+// Provisioning result — flash the outcome over the mode pulse.
+static void on_nfc_provision(nfc_provision_result_t result, const char *id)
+{
+    switch (result) {
+    case NFC_PROVISION_WRITTEN: led_indicator_flash(LED_LAYER_NFC, 0, 255, 0, 150); break;
+    case NFC_PROVISION_ALREADY: led_indicator_flash(LED_LAYER_NFC, 0, 0, 255, 150); break;
+    case NFC_PROVISION_FAILED:  led_indicator_flash(LED_LAYER_NFC, 255, 0, 0, 150); break;
+    case NFC_PROVISION_DONE:    led_indicator_clear(LED_LAYER_STATUS); break;
+    }
 }
 
 /********* Main Application ***************/
 
+// LED and NFC bring-up, off the critical path. Probing the RC522 can stall
+// for a while when the module is absent; inputs and USB are already live by
+// then, and LED / NFC calls made before their init are harmless no-ops.
+static void periph_init_task(void *arg)
+{
+    ESP_ERROR_CHECK(led_indicator_init());
+    boot_trace_mark(BOOT_STAGE_LED_READY);
+    // Brief startup indication
+    led_indicator_flash(LED_LAYER_STATUS, 0, 255, 0, 200);
+
+    // Initialize NFC handler (RC522 on SPI2). Optional peripheral — if the
+    // module is disconnected or unresponsive, log and continue so input/HID
+    // still work. Aborting here would leave the device in a reboot loop.
+    esp_err_t nfc_err = nfc_handler_init();
+    if (nfc_err == ESP_OK) {
+        // Card UID -> ID table for blank / legacy cards. Also optional:
+        // without it those cards type NFC:<UID> as before.
+        esp_err_t index_err = uid_index_init();
+        if (index_err != ESP_OK && index_err != ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "UID index unusable (0x%x)", index_err);
+        }
+        nfc_handler_set_callback(on_nfc_tag);
+        nfc_provision_set_callback(on_nfc_provision);
+        nfc_err = nfc_handler_start();
+        if (nfc_err != ESP_OK) {
+            ESP_LOGW(TAG, "NFC start failed (0x%x) — continuing without NFC", nfc_err);
+        }
+    } else {
+        ESP_LOGW(TAG, "NFC init failed (0x%x) — continuing without NFC", nfc_err);
+    }
+    boot_trace_mark(BOOT_STAGE_NFC_READY);
+
+    // Persistent telemetry log. Also optional: without its partition (an
+    // old partition table) the counters just stay RAM-only.
+    esp_err_t tlog_err = tlog_start();
+    if (tlog_err != ESP_OK && tlog_err != ESP_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "Telemetry log start failed (0x%x)", tlog_err);
+    }
+
+    mem_report_task_exit(MEM_TASK_PERIPH_INIT);
+    vTaskDelete(NULL);
+}
+
+static StaticTask_t s_periph_init_tcb;
+static StackType_t s_periph_init_stack[PERIPH_INIT_STACK];
+
 void app_main(void)
 {
+    boot_trace_mark(BOOT_STAGE_APP_MAIN);
     ESP_LOGI(TAG, "Cosmo Pager Radio - USB HID Keyboard");
+    ESP_LOGI(TAG, "Cores: USB + input on %d, NFC + LED on %d", USB_TASK_CORE, PERIPH_INIT_CORE);
+    if (xPortGetCoreID() != USB_TASK_CORE) {
+        // GPIO / USB interrupts are installed below, on this core.
+        ESP_LOGW(TAG, "app_main runs on core %d, not the USB/input core %d — "
+                 "their interrupts will be serviced here", xPortGetCoreID(), USB_TASK_CORE);
+    }
+
+    // Hot paths log through the event ring from here on.
+    ESP_ERROR_CHECK(evlog_start());
 
     // HID state mutex must exist before any task can submit a report.
-    s_hid_mutex = xSemaphoreCreateMutex();
+    s_hid_mutex = xSemaphoreCreateMutexStatic(&s_hid_mutex_buf);
     if (s_hid_mutex == NULL) {
         ESP_LOGE(TAG, "Failed to create HID mutex");
         abort();
     }
+    s_report_done = xSemaphoreCreateBinaryStatic(&s_report_done_buf);
+    size_t heap_mark = mem_report_heap_begin();
+    const esp_timer_create_args_t typing_timer_args = { .callback = typing_timer_cb, .name = "typing" };
+    if (s_report_done == NULL || esp_timer_create(&typing_timer_args, &s_typing_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create typing pacing primitives");
+        abort();
+    }
+    mem_report_add_task(MEM_TASK_MAIN, xTaskGetCurrentTaskHandle(), CONFIG_ESP_MAIN_TASK_STACK_SIZE);
+    mem_report_add_static(MEM_MOD_HID, sizeof(s_hid_mutex_buf) + sizeof(s_report_done_buf)
+                                     + sizeof(s_periph_init_tcb) + sizeof(s_periph_init_stack)
+                                     + sizeof(s_nfc_line));
 
     // Initialize USB
     ESP_LOGI(TAG, "USB initialization");
     tinyusb_config_t tusb_cfg = TINYUSB_DEFAULT_CONFIG();
 
+    tusb_cfg.task.priority = USB_TASK_PRIO;
+    tusb_cfg.task.xCoreID = USB_TASK_CORE;
     tusb_cfg.descriptor.device = NULL;
     tusb_cfg.descriptor.full_speed_config = hid_configuration_descriptor;
     tusb_cfg.descriptor.string = hid_string_descriptor;
@@ -386,51 +1158,66 @@ void app_main(void)
     tusb_cfg.descriptor.high_speed_config = hid_configuration_descriptor;
 #endif
 
+    // TinyUSB allocates its task and endpoint buffers once, here.
     ESP_ERROR_CHECK(tinyusb_driver_install(&tusb_cfg));
+    mem_report_heap_end(MEM_MOD_HID, heap_mark);
+    boot_trace_mark(BOOT_STAGE_USB_INSTALLED);
     ESP_LOGI(TAG, "USB initialization DONE");
 
-    // Initialize LED indicator
-    ESP_ERROR_CHECK(led_indicator_init());
-
-    // Initialize input handler
+    // Initialize input handler — armed as soon as USB is, so the first knob
+    // turn after enumeration is never lost to peripheral bring-up.
     ESP_ERROR_CHECK(input_handler_init());
     input_handler_set_callback(on_input_event);
     input_handler_start();
+    boot_trace_mark(BOOT_STAGE_INPUT_ARMED);
 
-    // Initialize NFC handler (RC522 on SPI2). Optional peripheral — if the
-    // module is disconnected or unresponsive, log and continue so input/HID
-    // still work. Aborting here would leave the device in a reboot loop.
-    esp_err_t nfc_err = nfc_handler_init();
-    if (nfc_err == ESP_OK) {
-        nfc_handler_set_callback(on_nfc_tag);
-        nfc_err = nfc_handler_start();
-        if (nfc_err != ESP_OK) {
-            ESP_LOGW(TAG, "NFC start failed (0x%x) — continuing without NFC", nfc_err);
-        }
-    } else {
-        ESP_LOGW(TAG, "NFC init failed (0x%x) — continuing without NFC", nfc_err);
+    // Watches the input and USB tasks from here on, the NFC tasks once
+    // periph_init has started them.
+    if (health_start() != ESP_OK) {
+        ESP_LOGW(TAG, "Health monitor not running");
     }
 
-    // Brief startup indication
-    led_indicator_green();
-    vTaskDelay(pdMS_TO_TICKS(200));
-    led_indicator_off();
+    TaskHandle_t periph_init = xTaskCreateStaticPinnedToCore(periph_init_task, "periph_init",
+                                                             PERIPH_INIT_STACK, NULL, PERIPH_INIT_PRIO,
+                                                             s_periph_init_stack, &s_periph_init_tcb,
+                                                             PERIPH_INIT_CORE);
+    if (periph_init == NULL) {
+        ESP_LOGE(TAG, "Failed to create peripheral init task");
+        abort();
+    }
+    mem_report_add_task(MEM_TASK_PERIPH_INIT, periph_init, PERIPH_INIT_STACK);
 
     // Main loop - monitor USB connection status
     bool was_mounted = false;
+    bool mem_logged = false;
     while (1) {
         bool is_mounted = tud_mounted();
 
         if (is_mounted && !was_mounted) {
             ESP_LOGI(TAG, "USB connected");
-            led_indicator_blue();
-            vTaskDelay(pdMS_TO_TICKS(100));
-            led_indicator_off();
+            boot_trace_mark(BOOT_STAGE_USB_MOUNTED);
+            // The current key state, usually nothing held: a re-enumerated
+            // host has dropped its key state, and a switch still held
+            // comes back as held. On the first mount this is the first
+            // report the host takes, which ends the boot trace.
+            xSemaphoreTake(s_hid_mutex, portMAX_DELAY);
+            hid_report_locked();
+            xSemaphoreGive(s_hid_mutex);
+            led_indicator_flash(LED_LAYER_STATUS, 0, 0, 255, 100);
         } else if (!is_mounted && was_mounted) {
             ESP_LOGW(TAG, "USB disconnected");
         }
 
         was_mounted = is_mounted;
-        vTaskDelay(pdMS_TO_TICKS(500));
+        bool booted = boot_trace_log_once();
+        if (booted && !mem_logged) {
+            // Every task exists and every library has allocated by now;
+            // from here on the heap should not move.
+            mem_report_mark_steady();
+            mem_report_log();
+            mem_logged = true;
+        }
+        bool booting = !booted && esp_timer_get_time() < USB_POLL_BOOT_WINDOW_US;
+        vTaskDelay(pdMS_TO_TICKS(booting ? USB_POLL_BOOT_MS : USB_POLL_MS));
     }
 }
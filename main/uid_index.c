@@ -0,0 +1,166 @@
+/*
+ * UID Index Implementation
+ * Image layout (little-endian), written by tools/uidmap.py:
+ *
+ *   header   uid_index_header_t, 32 bytes
+ *   entries  count x uid_index_entry_t, 16 bytes each, sorted by key
+ *   text     the IDs back to back, no terminators; cards sharing an ID
+ *            share its bytes
+ *
+ * A key is the UID length followed by the UID zero-padded to 10 bytes, so
+ * one memcmp orders and matches 4-, 7- and 10-byte UIDs alike. The image is
+ * checked once at boot (CRC, order, every entry's text in bounds) and then
+ * trusted: a lookup is a binary search over the mapped entries, about 14
+ * compares for ten thousand cards, all served from the flash cache.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "uid_index.h"
+#include "nfc_handler.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "UID_INDEX";
+
+#define UID_INDEX_PARTITION_LABEL   "uidmap"
+#define UID_INDEX_PARTITION_SUBTYPE 0x41    // custom data subtype, see partitions.csv
+#define UID_INDEX_MAGIC             0x58444955u     // "UIDX"
+#define UID_INDEX_VERSION           1
+#define UID_INDEX_KEY_LEN           (1 + UID_INDEX_UID_MAX)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_size;            // sizeof(uid_index_entry_t)
+    uint32_t count;
+    uint32_t text_size;
+    uint32_t crc;                   // CRC-32 of the entries and the text
+    uint32_t reserved[3];
+} uid_index_header_t;
+
+typedef struct {
+    uint8_t key[UID_INDEX_KEY_LEN];
+    uint8_t text_len;
+    uint32_t text_off;              // from the start of the text area
+} __attribute__((packed)) uid_index_entry_t;
+
+_Static_assert(sizeof(uid_index_header_t) == 32, "header layout");
+_Static_assert(sizeof(uid_index_entry_t) == 16, "entry layout");
+
+// Set once by uid_index_init(), read-only afterwards.
+static const uid_index_entry_t *s_entries = NULL;
+static const char *s_text = NULL;
+static uint32_t s_count = 0;
+static esp_partition_mmap_handle_t s_map;
+
+static void make_key(uint8_t key[UID_INDEX_KEY_LEN], const uint8_t *uid, uint8_t uid_len)
+{
+    memset(key, 0, UID_INDEX_KEY_LEN);
+    key[0] = uid_len;
+    memcpy(&key[1], uid, uid_len);
+}
+
+// Everything lookups rely on without checking again.
+static bool entries_valid(const uid_index_entry_t *entries, uint32_t count, uint32_t text_size)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        const uid_index_entry_t *e = &entries[i];
+        if (e->key[0] == 0 || e->key[0] > UID_INDEX_UID_MAX
+            || e->text_len == 0 || e->text_len > NFC_PAYLOAD_MAX_LEN
+            || e->text_off > text_size || e->text_len > text_size - e->text_off) {
+            ESP_LOGE(TAG, "Entry %lu is malformed", (unsigned long)i);
+            return false;
+        }
+        if (i > 0 && memcmp(entries[i - 1].key, e->key, UID_INDEX_KEY_LEN) >= 0) {
+            ESP_LOGE(TAG, "Entry %lu is out of order", (unsigned long)i);
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t uid_index_init(void)
+{
+    if (s_entries != NULL) {
+        return ESP_OK;
+    }
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, UID_INDEX_PARTITION_SUBTYPE,
+                                                           UID_INDEX_PARTITION_LABEL);
+    if (part == NULL) {
+        ESP_LOGI(TAG, "No \"%s\" partition, UID index disabled", UID_INDEX_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uid_index_header_t hdr;
+    esp_err_t err = esp_partition_read(part, 0, &hdr, sizeof(hdr));
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (hdr.magic != UID_INDEX_MAGIC) {
+        ESP_LOGI(TAG, "\"%s\" partition is empty, UID index disabled", UID_INDEX_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint64_t body = (uint64_t)hdr.count * sizeof(uid_index_entry_t) + hdr.text_size;
+    if (hdr.version != UID_INDEX_VERSION || hdr.entry_size != sizeof(uid_index_entry_t)
+        || hdr.count == 0 || sizeof(hdr) + body > part->size) {
+        ESP_LOGE(TAG, "Unsupported or oversized index (version %u, %lu cards)", hdr.version,
+                 (unsigned long)hdr.count);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Map only what the image uses; the MMU pages stay mapped for good.
+    const void *map = NULL;
+    err = esp_partition_mmap(part, 0, sizeof(hdr) + (size_t)body, ESP_PARTITION_MMAP_DATA, &map, &s_map);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot map the index (0x%x)", err);
+        return err;
+    }
+    const uint8_t *base = (const uint8_t *)map + sizeof(hdr);
+    const uid_index_entry_t *entries = (const uid_index_entry_t *)base;
+    if (esp_rom_crc32_le(0, base, (uint32_t)body) != hdr.crc
+        || !entries_valid(entries, hdr.count, hdr.text_size)) {
+        ESP_LOGE(TAG, "Index image is corrupt, UID index disabled");
+        esp_partition_munmap(s_map);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    s_text = (const char *)(base + hdr.count * sizeof(uid_index_entry_t));
+    s_count = hdr.count;
+    s_entries = entries;
+    ESP_LOGI(TAG, "%lu cards, %lu bytes mapped", (unsigned long)s_count,
+             (unsigned long)(sizeof(hdr) + body));
+    return ESP_OK;
+}
+
+bool uid_index_lookup(const uint8_t *uid, uint8_t uid_len, const char **text, uint8_t *text_len)
+{
+    if (s_entries == NULL || uid_len == 0 || uid_len > UID_INDEX_UID_MAX) {
+        return false;
+    }
+    uint8_t key[UID_INDEX_KEY_LEN];
+    make_key(key, uid, uid_len);
+
+    uint32_t lo = 0, hi = s_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int c = memcmp(s_entries[mid].key, key, UID_INDEX_KEY_LEN);
+        if (c == 0) {
+            *text = s_text + s_entries[mid].text_off;
+            *text_len = s_entries[mid].text_len;
+            return true;
+        }
+        if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return false;
+}
+
+uint32_t uid_index_count(void)
+{
+    return s_count;
+}
@@ -0,0 +1,46 @@
+/*
+ * UID Index
+ * Read-only table in the `uidmap` flash partition that maps card UIDs to the
+ * ID to type, so blank or legacy cards type their product ID instead of
+ * NFC:<UID> without an NDEF write. Built offline with tools/uidmap.py and
+ * searched in place through a memory mapping: no copy, no heap.
+ */
+
+#ifndef _UID_INDEX_H_
+#define _UID_INDEX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UID_INDEX_UID_MAX   10      // longest ISO 14443-3 UID (triple size)
+
+/**
+ * Find the partition, check the image and map it. Without the partition, or
+ * with an empty or invalid image, lookups just miss: ESP_ERR_NOT_FOUND /
+ * ESP_ERR_INVALID_CRC / ESP_ERR_INVALID_SIZE are returned for the log and
+ * nothing else depends on it.
+ */
+esp_err_t uid_index_init(void);
+
+/**
+ * Look a UID up. On a hit, *text points into the mapped flash (not
+ * NUL-terminated) and *text_len is its length, at most NFC_PAYLOAD_MAX_LEN.
+ * Binary search, safe from any task once uid_index_init() has returned.
+ */
+bool uid_index_lookup(const uint8_t *uid, uint8_t uid_len, const char **text, uint8_t *text_len);
+
+/**
+ * Number of cards in the mapped index, 0 if there is none
+ */
+uint32_t uid_index_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UID_INDEX_H_ */
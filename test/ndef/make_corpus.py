@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Regenerate the NDEF parser seed corpus.
+
+Each seed is the NTAG user-memory area (page 4 onwards) exactly as the
+firmware sees it through rc522_nxp_read(): 144 bytes for NTAG213, 504 bytes
+for NTAG215. The layouts mirror page dumps of cards written with NFC Tools
+on iPhone / Android (see TODO.md 2026-05-07 / 05-15), plus the edge cases
+the parser has to reject cleanly.
+
+    python3 make_corpus.py            # writes ./corpus/*.bin
+"""
+
+import os
+import struct
+
+NTAG213_USER = 144
+NTAG215_USER = 504
+
+
+def text_payload(text, lang=b"en", utf16=False):
+    status = len(lang) | (0x80 if utf16 else 0)
+    return bytes([status]) + lang + text
+
+
+def record(rtype, payload, short=True, rid=None, tnf=0x01, mb_me=0xC0):
+    hdr = mb_me | tnf
+    if short:
+        hdr |= 0x10
+    if rid is not None:
+        hdr |= 0x08
+    out = bytes([hdr, len(rtype)])
+    out += bytes([len(payload)]) if short else struct.pack(">I", len(payload))
+    if rid is not None:
+        out += bytes([len(rid)])
+    out += rtype
+    if rid is not None:
+        out += rid
+    return out + payload
+
+
+def tlv(tag, value):
+    if len(value) < 0xFF:
+        return bytes([tag, len(value)]) + value
+    return bytes([tag, 0xFF]) + struct.pack(">H", len(value)) + value
+
+
+def image(size, *tlvs):
+    body = b"".join(tlvs) + b"\xFE"
+    assert len(body) <= size, "seed does not fit tag"
+    return body + b"\x00" * (size - len(body))
+
+
+LOCK_CTRL = tlv(0x01, bytes([0xA0, 0x10, 0x44]))
+
+SEEDS = {
+    # Production cards (TODO.md 2026-05-15: 04A38B6A220289 -> "004", 0463DA47220289 -> "002").
+    "ntag215_004.bin": image(NTAG215_USER, tlv(0x03, record(b"T", text_payload(b"004")))),
+    "ntag215_002.bin": image(NTAG215_USER, tlv(0x03, record(b"T", text_payload(b"002")))),
+    # First end-to-end card, 2026-05-07.
+    "ntag213_112358.bin": image(NTAG213_USER, tlv(0x03, record(b"T", text_payload(b"112358")))),
+    # Android writers sometimes emit a Lock Control TLV ahead of the NDEF TLV.
+    "ntag213_lockctl.bin": image(NTAG213_USER, LOCK_CTRL,
+                                 tlv(0x03, record(b"T", text_payload(b"track-42")))),
+    # Long record (4-byte payload length) inside a 3-byte (0xFF) TLV length.
+    "ntag215_long_record.bin": image(NTAG215_USER, tlv(0x03, record(
+        b"T", text_payload(b"R01-" + b"x" * 280), short=False))),
+    # ID field present (IL flag).
+    "ntag213_with_id.bin": image(NTAG213_USER, tlv(0x03, record(
+        b"T", text_payload(b"R02"), rid=b"id1"))),
+    # Longer than NFC_PAYLOAD_MAX_LEN — exercised truncation path.
+    "ntag215_truncated.bin": image(NTAG215_USER, tlv(0x03, record(
+        b"T", text_payload(b"COSMO-RADIO-PARALLEL-UNIVERSE-STATION-42")))),
+    # Factory-blank NTAG: empty NDEF message.
+    "ntag213_blank.bin": image(NTAG213_USER, tlv(0x03, b"")),
+    # URI record — parser must reject (not a Text record).
+    "ntag215_uri.bin": image(NTAG215_USER, tlv(0x03, record(b"U", b"\x04example.com"))),
+    # UTF-16 Text — rejected.
+    "ntag213_utf16.bin": image(NTAG213_USER, tlv(0x03, record(
+        b"T", text_payload("004".encode("utf-16-be"), utf16=True)))),
+}
+
+
+def main():
+    out_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), "corpus")
+    os.makedirs(out_dir, exist_ok=True)
+    for name, data in sorted(SEEDS.items()):
+        with open(os.path.join(out_dir, name), "wb") as f:
+            f.write(data)
+        print(f"{name:28s} {len(data):4d} bytes")
+
+
+if __name__ == "__main__":
+    main()
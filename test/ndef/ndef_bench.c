@@ -0,0 +1,151 @@
+/*
+ * Throughput benchmark for ndef_parse_text().
+ *
+ * Usage: ndef_bench [--window N] corpus files or directories...
+ *
+ * For each input, parses it repeatedly for ~200 ms and reports µs per tag and
+ * MB/s of tag bytes. A directory stands for the files in it, in name order,
+ * as libFuzzer reads a corpus directory. --window N limits the parsed length (the firmware reads
+ * 48 bytes; default is the whole file). Compare runs before/after a parser
+ * change on the same machine — absolute numbers are host-dependent.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "ndef_parser.h"
+
+#define BENCH_MAX_TEXT_LEN 32        // NFC_PAYLOAD_MAX_LEN
+#define BENCH_TARGET_NS    200000000LL
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+typedef struct {
+    double bytes;
+    double ns;
+    double tags;
+} bench_total_t;
+
+static uint8_t *load(const char *path, size_t *len)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return NULL;
+    if (!S_ISREG(st.st_mode)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    size_t sz = (size_t)st.st_size;
+    uint8_t *buf = malloc(sz > 0 ? sz : 1);
+    if (buf != NULL && fread(buf, 1, sz, f) != sz) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    *len = sz;
+    return buf;
+}
+
+static int bench_file(const char *path, size_t window, bench_total_t *total)
+{
+    size_t len;
+    uint8_t *buf = load(path, &len);
+    if (buf == NULL) {
+        perror(path);
+        return 1;
+    }
+    if (window > 0 && window < len) len = window;
+
+    char out[BENCH_MAX_TEXT_LEN + 1];
+    volatile bool ok = false;
+    int64_t iters = 0;
+    int64_t start = now_ns(), elapsed;
+    do {
+        for (int k = 0; k < 1000; k++) {
+            ok = ndef_parse_text(buf, len, out, BENCH_MAX_TEXT_LEN);
+        }
+        iters += 1000;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_TARGET_NS);
+
+    double us_per = (double)elapsed / 1000.0 / (double)iters;
+    double mbps = (double)len * (double)iters / ((double)elapsed / 1e9) / 1e6;
+    const char *name = strrchr(path, '/');
+    printf("%-28s %6zu %4s %10lld %10.4f %10.1f\n", name ? name + 1 : path,
+           len, ok ? "yes" : "no", (long long)iters, us_per, mbps);
+
+    total->bytes += (double)len * (double)iters;
+    total->ns += (double)elapsed;
+    total->tags += (double)iters;
+    free(buf);
+    return 0;
+}
+
+static int not_hidden(const struct dirent *e)
+{
+    return e->d_name[0] != '.';
+}
+
+static int bench_dir(const char *dir, size_t window, bench_total_t *total)
+{
+    struct dirent **names;
+    int n = scandir(dir, &names, not_hidden, alphasort);
+    if (n < 0) {
+        perror(dir);
+        return 1;
+    }
+    int rc = 0;
+    for (int i = 0; i < n; i++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]->d_name);
+        struct stat st;
+        if (rc == 0 && stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            rc = bench_file(path, window, total);
+        }
+        free(names[i]);
+    }
+    free(names);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    size_t window = 0;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "--window") == 0) {
+        window = (size_t)strtoul(argv[2], NULL, 10);
+        first = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "usage: %s [--window N] corpus/ | corpus/*.bin\n", argv[0]);
+        return 2;
+    }
+
+    printf("%-28s %6s %4s %10s %10s %10s\n", "input", "bytes", "ok", "iters", "us/tag", "MB/s");
+
+    bench_total_t total = {0};
+    for (int a = first; a < argc; a++) {
+        struct stat st;
+        bool is_dir = stat(argv[a], &st) == 0 && S_ISDIR(st.st_mode);
+        int rc = is_dir ? bench_dir(argv[a], window, &total) : bench_file(argv[a], window, &total);
+        if (rc != 0) return rc;
+    }
+    if (total.tags == 0) {
+        fprintf(stderr, "no input files\n");
+        return 1;
+    }
+
+    printf("%-28s %6s %4s %10.0f %10.4f %10.1f\n", "TOTAL", "", "", total.tags,
+           total.ns / 1000.0 / total.tags, total.bytes / (total.ns / 1e9) / 1e6);
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * libFuzzer target for ndef_parse_text() and ndef_find_text().
+ *
+ * Input is raw NTAG user memory (page 4 onwards), same as the firmware reads.
+ * Besides letting ASan/UBSan catch out-of-bounds reads, it checks the
+ * parser's output contract on every input, and that feeding the window
+ * piece by piece through ndef_find_text() ends where ndef_parse_text() does.
+ *
+ * Built without -fsanitize=fuzzer (NDEF_FUZZ_REPLAY), main() replays files
+ * given on the command line, or a single input from stdin for AFL.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ndef_parser.h"
+
+// Mirror of NFC_PAYLOAD_MAX_LEN in main/nfc_handler.h (that header needs ESP-IDF).
+#define FUZZ_MAX_TEXT_LEN 32
+
+// Grow the available prefix the way the firmware reads (`step` bytes at a
+// time): the first decisive answer must never change, and its text must be
+// what the one-shot parser returns.
+static void check_incremental(const uint8_t *buf, size_t window, size_t step)
+{
+    char want[FUZZ_MAX_TEXT_LEN + 1];
+    bool parsed = ndef_parse_text(buf, window, want, FUZZ_MAX_TEXT_LEN);
+
+    ndef_find_t first = NDEF_FIND_MORE;
+    size_t off = 0, len = 0;
+    for (size_t avail = 0; ; avail = avail + step < window ? avail + step : window) {
+        size_t o = 0, n = 0;
+        ndef_find_t r = ndef_find_text(buf, avail, window, FUZZ_MAX_TEXT_LEN, &o, &n);
+        if (first == NDEF_FIND_MORE) {
+            first = r;
+            off = o;
+            len = n;
+        } else if (r != first || (r == NDEF_FIND_TEXT && (o != off || n != len))) {
+            abort();
+        }
+        if (avail == window) break;
+    }
+    if (first == NDEF_FIND_MORE) abort();   // a whole window always decides
+
+    if (first == NDEF_FIND_NONE) {
+        if (parsed) abort();
+        return;
+    }
+    if (len == 0 || len > FUZZ_MAX_TEXT_LEN || off > window || len > window - off) abort();
+    const uint8_t *nul = memchr(&buf[off], 0, len);
+    size_t text_len = nul != NULL ? (size_t)(nul - &buf[off]) : len;
+    if (parsed != (text_len > 0)) abort();
+    if (parsed && (strlen(want) != text_len || memcmp(want, &buf[off], text_len) != 0)) abort();
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    // Exact-size heap copy so any read past `size` trips ASan, even when the
+    // fuzzer hands us a pointer into a larger buffer.
+    uint8_t *buf = malloc(size ? size : 1);
+    if (buf == NULL) return 0;
+    memcpy(buf, data, size);
+
+    // Sentinel byte after the output buffer catches writes past max + 1.
+    char out[FUZZ_MAX_TEXT_LEN + 2];
+    out[FUZZ_MAX_TEXT_LEN + 1] = 0x5A;
+
+    if (ndef_parse_text(buf, size, out, FUZZ_MAX_TEXT_LEN)) {
+        size_t n = strnlen(out, FUZZ_MAX_TEXT_LEN + 1);
+        if (n == 0 || n > FUZZ_MAX_TEXT_LEN) abort();
+    }
+    if (out[FUZZ_MAX_TEXT_LEN + 1] != 0x5A) abort();
+
+    // The firmware only ever passes the first 48 bytes; parse that window too
+    // so truncated-read behaviour is covered by the same input.
+    if (size > 48) {
+        ndef_parse_text(buf, 48, out, FUZZ_MAX_TEXT_LEN);
+    }
+
+    // The firmware streams that window one 16-byte READ at a time.
+    check_incremental(buf, size < 48 ? size : 48, 16);
+    check_incremental(buf, size, 1);
+
+    free(buf);
+    return 0;
+}
+
+#ifdef NDEF_FUZZ_REPLAY
+static int run_file(FILE *f, const char *name)
+{
+    uint8_t *data = NULL;
+    size_t len = 0, cap = 0;
+    for (;;) {
+        if (len == cap) {
+            cap = cap ? cap * 2 : 1024;
+            uint8_t *grown = realloc(data, cap);
+            if (grown == NULL) { free(data); return 1; }
+            data = grown;
+        }
+        size_t n = fread(data + len, 1, cap - len, f);
+        if (n == 0) break;
+        len += n;
+    }
+    LLVMFuzzerTestOneInput(data, len);
+    printf("ok  %-40s %zu bytes\n", name, len);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        return run_file(stdin, "<stdin>");
+    }
+    for (int i = 1; i < argc; i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (f == NULL) {
+            perror(argv[i]);
+            return 1;
+        }
+        int rc = run_file(f, argv[i]);
+        fclose(f);
+        if (rc != 0) return rc;
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Kernel configuration for the simulator, read by both kernel backends
+ * (kernel/ and the FreeRTOS POSIX port).
+ * Priorities and queue behaviour follow ESP-IDF's defaults; the tick is
+ * 1 kHz instead of the firmware's 100 Hz so sim timing is finer than the
+ * hardware, never coarser.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <assert.h>
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_TIME_SLICING                  1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+#define configUSE_IDLE_HOOK                     0
+#define configUSE_TICK_HOOK                     0
+#define configTICK_RATE_HZ                      1000
+#define configMAX_PRIORITIES                    25
+#define configMINIMAL_STACK_SIZE                4096    // words; must clear PTHREAD_STACK_MIN
+#define configSTACK_DEPTH_TYPE                  uint32_t
+#define configMAX_TASK_NAME_LEN                 16
+#define configTICK_TYPE_WIDTH_IN_BITS           TICK_TYPE_WIDTH_32_BITS
+#define configIDLE_SHOULD_YIELD                 1
+#define configUSE_TASK_NOTIFICATIONS            1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   1
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             1
+#define configUSE_COUNTING_SEMAPHORES           1
+#define configQUEUE_REGISTRY_SIZE               0
+#define configUSE_QUEUE_SETS                    0
+#define configUSE_TRACE_FACILITY                1
+#define configUSE_STATS_FORMATTING_FUNCTIONS    0
+#define configCHECK_FOR_STACK_OVERFLOW          0   // not checked; a high-water mark of 0 means overflow
+#define configUSE_MALLOC_FAILED_HOOK            0
+
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configTOTAL_HEAP_SIZE                   (8 * 1024 * 1024)   // heap_4, stands in for ESP-IDF heap_caps
+#define configAPPLICATION_ALLOCATED_HEAP        0
+
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               1
+#define configTIMER_QUEUE_LENGTH                10
+#define configTIMER_TASK_STACK_DEPTH            configMINIMAL_STACK_SIZE
+
+#define configUSE_CO_ROUTINES                   0
+
+#define INCLUDE_vTaskPrioritySet                1
+#define INCLUDE_uxTaskPriorityGet               1
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_xTaskDelayUntil                 1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_xTaskGetIdleTaskHandle          1
+#define INCLUDE_eTaskGetState                   1
+#define INCLUDE_xTimerPendFunctionCall          1
+
+#define configASSERT(x)                         assert(x)
+
+#endif /* FREERTOS_CONFIG_H */
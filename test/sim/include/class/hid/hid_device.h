@@ -0,0 +1,91 @@
+#pragma once
+
+// TinyUSB HID device API subset. Descriptor macros emit the same bytes as
+// TinyUSB's so the sim host can read bInterval from the config descriptor.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CFG_TUD_HID 1
+
+typedef enum {
+    HID_REPORT_TYPE_INVALID = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE,
+} hid_report_type_t;
+
+#define HID_ITF_PROTOCOL_KEYBOARD   1
+
+#define TU_U16_LOW(x)   ((uint8_t)((x) & 0xff))
+#define TU_U16_HIGH(x)  ((uint8_t)(((x) >> 8) & 0xff))
+
+// Report descriptor items
+#define HID_USAGE_PAGE_DESKTOP      0x01
+#define HID_USAGE_PAGE_VENDOR       0xFF00
+#define HID_COLLECTION_APPLICATION  0x01
+#define HID_DATA                    (0 << 0)
+#define HID_CONSTANT                (1 << 0)
+#define HID_ARRAY                   (0 << 1)
+#define HID_VARIABLE                (1 << 1)
+#define HID_ABSOLUTE                (0 << 2)
+
+#define HID_REPORT_ID(x)            0x85, (x),
+#define HID_USAGE_PAGE(x)           0x05, (x)
+#define HID_USAGE_PAGE_N(x, n)      0x06, TU_U16_LOW(x), TU_U16_HIGH(x)
+#define HID_USAGE(x)                0x09, (x)
+#define HID_USAGE_MIN(x)            0x19, (x)
+#define HID_USAGE_MAX(x)            0x29, (x)
+#define HID_COLLECTION(x)           0xA1, (x)
+#define HID_COLLECTION_END          0xC0
+#define HID_LOGICAL_MIN(x)          0x15, (x)
+#define HID_LOGICAL_MAX(x)          0x25, (x)
+#define HID_LOGICAL_MAX_N(x, n)     0x26, TU_U16_LOW(x), TU_U16_HIGH(x)
+#define HID_REPORT_SIZE(x)          0x75, (x)
+#define HID_REPORT_COUNT(x)         0x95, (x)
+#define HID_INPUT(x)                0x81, (x)
+#define HID_OUTPUT(x)               0x91, (x)
+#define HID_FEATURE(x)              0xB1, (x)
+
+// Boot-compatible keyboard: modifiers, reserved byte, LEDs out, 6 keys.
+#define TUD_HID_REPORT_DESC_KEYBOARD(...) \
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP), HID_USAGE(0x06), \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION), __VA_ARGS__ \
+        HID_USAGE_PAGE(0x07), HID_USAGE_MIN(224), HID_USAGE_MAX(231), \
+        HID_LOGICAL_MIN(0), HID_LOGICAL_MAX(1), \
+        HID_REPORT_COUNT(8), HID_REPORT_SIZE(1), HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+        HID_REPORT_COUNT(1), HID_REPORT_SIZE(8), HID_INPUT(HID_CONSTANT), \
+        HID_USAGE_PAGE(0x08), HID_USAGE_MIN(1), HID_USAGE_MAX(5), \
+        HID_REPORT_COUNT(5), HID_REPORT_SIZE(1), HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+        HID_REPORT_COUNT(1), HID_REPORT_SIZE(3), HID_OUTPUT(HID_CONSTANT), \
+        HID_USAGE_PAGE(0x07), HID_USAGE_MIN(0), HID_LOGICAL_MAX_N(255, 2), HID_USAGE_MAX(255), \
+        HID_REPORT_COUNT(6), HID_REPORT_SIZE(8), HID_INPUT(HID_DATA | HID_ARRAY | HID_ABSOLUTE), \
+    HID_COLLECTION_END
+
+// Configuration descriptors
+#define TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP  (1 << 5)
+#define TUD_CONFIG_DESC_LEN     9
+#define TUD_HID_DESC_LEN        (9 + 9 + 7)
+
+#define TUD_CONFIG_DESCRIPTOR(num, itf_count, stridx, total_len, attr, power_ma) \
+    9, 0x02, TU_U16_LOW(total_len), TU_U16_HIGH(total_len), itf_count, num, stridx, \
+    (uint8_t)(0x80 | (attr)), (power_ma) / 2
+
+#define TUD_HID_DESCRIPTOR(itfnum, stridx, boot_protocol, report_desc_len, epin, epsize, ep_interval) \
+    9, 0x04, itfnum, 0, 1, 0x03, (uint8_t)((boot_protocol) ? 1 : 0), boot_protocol, stridx, \
+    9, 0x21, TU_U16_LOW(0x0111), TU_U16_HIGH(0x0111), 0, 1, 0x22, \
+    TU_U16_LOW(report_desc_len), TU_U16_HIGH(report_desc_len), \
+    7, 0x05, epin, 0x03, TU_U16_LOW(epsize), TU_U16_HIGH(epsize), ep_interval
+
+// Device API
+bool tud_hid_ready(void);
+bool tud_hid_report(uint8_t report_id, const void *report, uint16_t len);
+bool tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, const uint8_t keycode[6]);
+
+// Callbacks implemented by the firmware
+uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance);
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type,
+                               uint8_t *buffer, uint16_t reqlen);
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type,
+                           uint8_t const *buffer, uint16_t bufsize);
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len);
@@ -0,0 +1,10 @@
+#pragma once
+
+// TinyUSB device-stack internals the firmware uses: a call deferred onto
+// the TinyUSB task (sim_usb.c runs it on the virtual host task).
+
+#include <stdbool.h>
+
+typedef void (*osal_task_func_t)(void *param);
+
+void usbd_defer_func(osal_task_func_t func, void *param, bool in_isr);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+
+typedef enum {
+    ESP_LOG_NONE, ESP_LOG_ERROR, ESP_LOG_WARN, ESP_LOG_INFO, ESP_LOG_DEBUG, ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+// Set from the sim command line (-q / -v).
+extern esp_log_level_t sim_log_level;
+
+uint32_t esp_log_timestamp(void);
+#define esp_log_level_set(tag, level) ((void)(tag), (void)(level))
+void sim_log_lock(void);
+void sim_log_unlock(void);
+
+#define SIM_LOG(level, letter, tag, fmt, ...) do {                              \
+        if (sim_log_level >= (level)) {                                         \
+            sim_log_lock();                                                     \
+            printf(letter " (%lu) %s: " fmt "\n", (unsigned long)esp_log_timestamp(), \
+                   (tag), ##__VA_ARGS__);                                       \
+            sim_log_unlock();                                                   \
+        }                                                                       \
+    } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) SIM_LOG(ESP_LOG_ERROR,   "E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) SIM_LOG(ESP_LOG_WARN,    "W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) SIM_LOG(ESP_LOG_INFO,    "I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) SIM_LOG(ESP_LOG_DEBUG,   "D", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) SIM_LOG(ESP_LOG_VERBOSE, "V", tag, fmt, ##__VA_ARGS__)
+#define ESP_EARLY_LOGI ESP_LOGI
+#define ESP_EARLY_LOGW ESP_LOGW
+#define ESP_DRAM_LOGW  ESP_LOGW
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// No ROM or bootloader in the sim: the RTC timer starts with the run.
+uint64_t esp_rtc_get_time_us(void);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "esp_err.h"
+
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+    ESP_RST_USB,
+    ESP_RST_JTAG,
+} esp_reset_reason_t;
+
+typedef void (*shutdown_handler_t)(void);
+
+// Runs the registered shutdown handlers, then ends the sim with a non-zero
+// status (a reboot would lose the run).
+void esp_restart(void) __attribute__((noreturn));
+
+// Every sim run is a power-on, also when --flash FILE carries the log over.
+esp_reset_reason_t esp_reset_reason(void);
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler);
@@ -0,0 +1,40 @@
+/*
+ * ESP-IDF includes the kernel as "freertos/FreeRTOS.h" and adds a few SMP
+ * extensions on top of it. Map those onto the vanilla kernel API.
+ */
+#pragma once
+
+#include "sdkconfig.h"
+#include <FreeRTOS.h>
+#include <stdbool.h>
+
+// Critical sections take a spinlock argument on ESP-IDF; the sim kernels have
+// a single global one. The lock is still passed along so it counts as used.
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+
+void sim_critical_enter(int unused, ...);
+void sim_critical_exit(int unused, ...);
+
+#undef portENTER_CRITICAL
+#undef portEXIT_CRITICAL
+#define portENTER_CRITICAL(...)     sim_critical_enter(0, ##__VA_ARGS__)
+#define portEXIT_CRITICAL(...)      sim_critical_exit(0, ##__VA_ARGS__)
+#define portENTER_CRITICAL_ISR(...) sim_critical_enter(0, ##__VA_ARGS__)
+#define portEXIT_CRITICAL_ISR(...)  sim_critical_exit(0, ##__VA_ARGS__)
+
+// ESP-IDF accepts portYIELD_FROM_ISR() with or without an argument. Sim
+// "ISRs" run on the scenario task, so a plain yield is right either way.
+#undef portYIELD_FROM_ISR
+#define portYIELD_FROM_ISR(...)     vPortYield()
+
+// Single core: affinity is accepted and ignored.
+#define tskNO_AFFINITY              0x7FFFFFFF
+#define xPortGetCoreID()            0
+
+// The ESP-IDF main task's stack comes from its own sdkconfig, not Kconfig in
+// main/. Far larger here: host libc (printf) runs on task stacks. Depths on
+// the sim kernels are in words, not bytes.
+#ifndef CONFIG_ESP_MAIN_TASK_STACK_SIZE
+#define CONFIG_ESP_MAIN_TASK_STACK_SIZE     (32 * 1024)
+#endif
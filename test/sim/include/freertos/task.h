@@ -0,0 +1,11 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include <task.h>
+
+// ESP-IDF sizes stacks in bytes, the vanilla kernel in words; passing the
+// byte count through only makes sim stacks bigger.
+#define xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, core) \
+    xTaskCreate((fn), (name), (stack), (arg), (prio), (handle))
+#define xTaskCreateStaticPinnedToCore(fn, name, stack, arg, prio, stack_buf, tcb, core) \
+    xTaskCreateStatic((fn), (name), (stack), (arg), (prio), (stack_buf), (tcb))
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "rc522.h"
+
+#define RC522_NXP_PAGE_SIZE 4
+#define RC522_NXP_READ_SIZE 16
+
+esp_err_t rc522_nxp_read(rc522_handle_t rc522, rc522_picc_t *picc, uint8_t page, uint8_t *out);
+esp_err_t rc522_nxp_write(rc522_handle_t rc522, rc522_picc_t *picc, uint8_t page, const uint8_t *data);
@@ -0,0 +1,35 @@
+#pragma once
+
+// Subset of abobija/rc522 v3 that the firmware uses, backed by the sim's
+// virtual tag field (sim_rc522.c).
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "rc522_picc.h"
+
+typedef struct rc522_driver_handle *rc522_driver_handle_t;
+typedef struct rc522 *rc522_handle_t;
+
+typedef struct {
+    rc522_driver_handle_t driver;
+    uint32_t poll_interval_ms;
+    size_t task_stack_size;
+    uint32_t task_priority;
+    SemaphoreHandle_t task_mutex;
+} rc522_config_t;
+
+enum {
+    RC522_EVENT_ANY = -1,
+    RC522_EVENT_NONE,
+    RC522_EVENT_PICC_STATE_CHANGED,
+};
+
+esp_err_t rc522_driver_install(rc522_driver_handle_t driver);
+esp_err_t rc522_create(const rc522_config_t *config, rc522_handle_t *out);
+esp_err_t rc522_register_events(rc522_handle_t rc522, int32_t event, esp_event_handler_t handler, void *arg);
+esp_err_t rc522_start(rc522_handle_t rc522);
+esp_err_t rc522_pause(rc522_handle_t rc522);
+esp_err_t rc522_destroy(rc522_handle_t rc522);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+#define RC522_PICC_UID_SIZE_MAX 10
+
+typedef struct {
+    uint8_t value[RC522_PICC_UID_SIZE_MAX];
+    uint8_t length;
+} rc522_picc_uid_t;
+
+typedef enum {
+    RC522_PICC_STATE_IDLE = 0,
+    RC522_PICC_STATE_READY,
+    RC522_PICC_STATE_ACTIVE,
+    RC522_PICC_STATE_ACTIVE_H,
+} rc522_picc_state_t;
+
+typedef enum {
+    RC522_PICC_TYPE_UNKNOWN = 0,
+    RC522_PICC_TYPE_MIFARE_UL,
+} rc522_picc_type_t;
+
+typedef struct {
+    rc522_picc_uid_t uid;
+    uint16_t atqa;
+    uint8_t sak;
+    rc522_picc_type_t type;
+    rc522_picc_state_t state;
+} rc522_picc_t;
+
+typedef struct {
+    rc522_picc_t *picc;
+    rc522_picc_state_t old_state;
+} rc522_picc_state_changed_event_t;
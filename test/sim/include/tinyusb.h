@@ -0,0 +1,29 @@
+#pragma once
+
+// esp_tinyusb + TinyUSB device API subset, backed by the sim's virtual
+// host (sim_usb.c).
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define TUD_OPT_HIGH_SPEED 0
+
+typedef struct {
+    struct {
+        const void *device;
+        const uint8_t *full_speed_config;
+        const uint8_t *high_speed_config;
+        const char **string;
+        int string_count;
+    } descriptor;
+    struct {
+        size_t size;
+        uint8_t priority;
+        int xCoreID;
+    } task;
+} tinyusb_config_t;
+
+esp_err_t tinyusb_driver_install(const tinyusb_config_t *config);
+
+bool tud_mounted(void);
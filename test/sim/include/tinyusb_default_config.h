@@ -0,0 +1,5 @@
+#pragma once
+
+#include "tinyusb.h"
+
+#define TINYUSB_DEFAULT_CONFIG() { .task = { .size = 4096, .priority = 5, .xCoreID = 0 } }
@@ -0,0 +1,64 @@
+/*
+ * Host-thread kernel for the simulator: the subset of the FreeRTOS API the
+ * firmware and the sim use, implemented on pthreads (sim_kernel.c). Selected
+ * with -DSIM_KERNEL=pthread, the default; see test/sim/README.md for how it
+ * differs from the FreeRTOS POSIX port.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FreeRTOSConfig.h"
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef unsigned long StackType_t;
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS      ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define tskIDLE_PRIORITY        ((UBaseType_t)0U)
+
+// Opaque storage for statically created objects; sim_kernel.c checks that
+// its structures fit.
+typedef struct {
+    void *reserved[40];
+} StaticTask_t;
+
+typedef struct {
+    void *reserved[24];
+} StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+// Only one task runs at a time, so a critical section just defers task
+// switches until the outermost exit; it nests.
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+void vPortYield(void);
+#define portENTER_CRITICAL()    vPortEnterCritical()
+#define portEXIT_CRITICAL()     vPortExitCritical()
+#define portYIELD_FROM_ISR(x)   vPortYield()
+#define taskENTER_CRITICAL()    portENTER_CRITICAL()
+#define taskEXIT_CRITICAL()     portEXIT_CRITICAL()
+
+// Kernel objects created at run time are charged to a configTOTAL_HEAP_SIZE
+// budget, as heap_4 would; blocks are not carved from one arena, so the
+// largest free block is simply what is left.
+typedef struct {
+    size_t xAvailableHeapSpaceInBytes;
+    size_t xSizeOfLargestFreeBlockInBytes;
+    size_t xMinimumEverFreeBytesRemaining;
+    size_t xNumberOfSuccessfulAllocations;
+    size_t xNumberOfSuccessfulFrees;
+} HeapStats_t;
+
+void *pvPortMalloc(size_t size);
+void vPortFree(void *ptr);
+size_t xPortGetFreeHeapSize(void);
+size_t xPortGetMinimumEverFreeHeapSize(void);
+void vPortGetHeapStats(HeapStats_t *stats);
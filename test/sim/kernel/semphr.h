@@ -0,0 +1,17 @@
+#pragma once
+
+#include "queue.h"
+
+// Semaphores are queues of zero-size items, as in FreeRTOS. Mutexes have no
+// priority inheritance.
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+
+#define xSemaphoreTake(sem, wait)           xQueueReceive((sem), NULL, (wait))
+#define xSemaphoreGive(sem)                 xQueueSend((sem), NULL, 0)
+#define xSemaphoreGiveFromISR(sem, woken)   xQueueSendFromISR((sem), NULL, (woken))
@@ -0,0 +1,789 @@
+/*
+ * Host-thread kernel: every task is a pthread running on the stack it was
+ * given, but only one of them runs at a time. A single kernel lock guards all
+ * task, queue and notification state, and the task holding the run token
+ * (s_current) is always the highest-priority ready one, round-robin within a
+ * priority at each tick, as on a single-core FreeRTOS.
+ *
+ * Switching is cooperative at the kernel boundary: a task that becomes ready
+ * takes over at the running task's next kernel call (send, give, notify,
+ * delay, critical-section exit, yield), not in the middle of plain code.
+ * Firmware and sim code reach the kernel every few microseconds of host time,
+ * well inside the 1 ms tick, so this reads like preemption at tick
+ * resolution. Interrupting plain code with a signal would stop a task inside
+ * libc (stdio, malloc) with its locks held.
+ *
+ * vTaskStartScheduler() turns the calling thread into the tick: it wakes
+ * timed-out waiters at each tick boundary and hands the token over when no
+ * task holds it. Stacks are painted before a task starts so
+ * uxTaskGetStackHighWaterMark() reports real usage of the host build.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#define STACK_PAINT     0xA5
+
+typedef enum {
+    TASK_READY,         // runnable; the one in s_current is running
+    TASK_BLOCKED,       // waiting on an object, a deadline, or both
+    TASK_DELETED,
+} task_state_t;
+
+struct sim_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t prio;
+    uint8_t *stack;             // lowest address; host stacks grow down
+    size_t stack_bytes;
+    struct sim_task *next;      // s_tasks list
+    pthread_cond_t run;         // signalled when this task becomes s_current
+    task_state_t state;
+    uint64_t ready_seq;         // FIFO order within a priority
+    TickType_t slice_start;     // tick this task last got the token
+    const void *blocked_on;     // queue, notification, or NULL for a plain delay
+    TickType_t wake;            // deadline tick while blocked, if timed
+    bool timed;
+    bool timed_out;
+    uint32_t notify_value;
+    bool notify_pending;
+};
+
+struct sim_queue {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *storage;
+};
+
+_Static_assert(sizeof(struct sim_task) <= sizeof(StaticTask_t), "StaticTask_t too small");
+_Static_assert(sizeof(struct sim_queue) <= sizeof(StaticQueue_t), "StaticQueue_t too small");
+
+static pthread_mutex_t s_kernel = PTHREAD_MUTEX_INITIALIZER;
+static struct sim_task *s_tasks;
+static struct sim_task *s_current;
+static uint64_t s_ready_seq;
+static bool s_started;
+
+// Per task, so only ever read by the task itself.
+static __thread struct sim_task *t_self;
+static __thread int t_critical_depth;
+static __thread int t_suspend_depth;
+
+static pthread_once_t s_epoch_once = PTHREAD_ONCE_INIT;
+static struct timespec s_epoch;
+
+/********* time ***************/
+
+static void epoch_init(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_epoch);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    pthread_once(&s_epoch_once, epoch_init);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t ns = (int64_t)(now.tv_sec - s_epoch.tv_sec) * 1000000000 + (now.tv_nsec - s_epoch.tv_nsec);
+    return (TickType_t)(ns / (1000000000 / configTICK_RATE_HZ));
+}
+
+// Absolute CLOCK_MONOTONIC time at which tick `tick` begins.
+static struct timespec tick_start(TickType_t tick)
+{
+    int64_t ns = (int64_t)tick * (1000000000 / configTICK_RATE_HZ);
+    struct timespec ts = s_epoch;
+    ts.tv_sec += ns / 1000000000;
+    ts.tv_nsec += ns % 1000000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    return ts;
+}
+
+static bool tick_reached(TickType_t now, TickType_t tick)
+{
+    return (int32_t)(now - tick) >= 0;
+}
+
+/********* heap ***************/
+
+// Each block carries its charged size in front of it.
+#define HEAP_HEADER     16
+
+static pthread_mutex_t s_heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t s_heap_free = configTOTAL_HEAP_SIZE;
+static size_t s_heap_min_free = configTOTAL_HEAP_SIZE;
+static size_t s_heap_allocs;
+static size_t s_heap_frees;
+
+void *pvPortMalloc(size_t size)
+{
+    size_t charged = HEAP_HEADER + ((size + 7) & ~(size_t)7);
+    pthread_mutex_lock(&s_heap_lock);
+    bool fits = charged <= s_heap_free;
+    if (fits) {
+        s_heap_free -= charged;
+        if (s_heap_free < s_heap_min_free) {
+            s_heap_min_free = s_heap_free;
+        }
+        s_heap_allocs++;
+    }
+    pthread_mutex_unlock(&s_heap_lock);
+    if (!fits) {
+        return NULL;
+    }
+    uint8_t *block = malloc(charged);
+    if (block == NULL) {
+        abort();
+    }
+    memcpy(block, &charged, sizeof(charged));
+    return block + HEAP_HEADER;
+}
+
+void vPortFree(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    uint8_t *block = (uint8_t *)ptr - HEAP_HEADER;
+    size_t charged;
+    memcpy(&charged, block, sizeof(charged));
+    free(block);
+    pthread_mutex_lock(&s_heap_lock);
+    s_heap_free += charged;
+    s_heap_frees++;
+    pthread_mutex_unlock(&s_heap_lock);
+}
+
+size_t xPortGetFreeHeapSize(void)
+{
+    pthread_mutex_lock(&s_heap_lock);
+    size_t free_bytes = s_heap_free;
+    pthread_mutex_unlock(&s_heap_lock);
+    return free_bytes;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+    pthread_mutex_lock(&s_heap_lock);
+    size_t min_free = s_heap_min_free;
+    pthread_mutex_unlock(&s_heap_lock);
+    return min_free;
+}
+
+void vPortGetHeapStats(HeapStats_t *stats)
+{
+    pthread_mutex_lock(&s_heap_lock);
+    stats->xAvailableHeapSpaceInBytes = s_heap_free;
+    stats->xSizeOfLargestFreeBlockInBytes = s_heap_free;
+    stats->xMinimumEverFreeBytesRemaining = s_heap_min_free;
+    stats->xNumberOfSuccessfulAllocations = s_heap_allocs;
+    stats->xNumberOfSuccessfulFrees = s_heap_frees;
+    pthread_mutex_unlock(&s_heap_lock);
+}
+
+/********* scheduling ***************/
+
+// All of the below run with s_kernel held.
+
+static void make_ready(struct sim_task *t)
+{
+    t->state = TASK_READY;
+    t->blocked_on = NULL;
+    t->ready_seq = ++s_ready_seq;
+}
+
+// Highest priority first, then whichever has waited longest.
+static struct sim_task *pick_next(void)
+{
+    struct sim_task *best = NULL;
+    for (struct sim_task *t = s_tasks; t != NULL; t = t->next) {
+        if (t->state == TASK_READY
+                && (best == NULL || t->prio > best->prio
+                    || (t->prio == best->prio && t->ready_seq < best->ready_seq))) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static void dispatch(struct sim_task *t)
+{
+    s_current = t;
+    if (t != NULL) {
+        t->slice_start = xTaskGetTickCount();
+        pthread_cond_signal(&t->run);
+    }
+}
+
+static void wait_for_token(struct sim_task *self)
+{
+    while (s_current != self) {
+        pthread_cond_wait(&self->run, &s_kernel);
+    }
+}
+
+// The calling task has stopped being runnable, or has requeued itself:
+// hand the token to whoever is next and wait until it comes back.
+static void switch_out(struct sim_task *self)
+{
+    dispatch(pick_next());
+    if (self->state != TASK_DELETED) {
+        wait_for_token(self);
+    }
+}
+
+// A kernel call that may have made something more important ready. Inside a
+// critical section or with the scheduler suspended the switch waits for the
+// matching exit, as a pended yield does.
+static void preempt_check(bool yield)
+{
+    struct sim_task *self = t_self;
+    if (self == NULL || !s_started || t_critical_depth > 0 || t_suspend_depth > 0) {
+        return;
+    }
+    configASSERT(s_current == self);
+    struct sim_task *next = pick_next();
+    if (next == NULL || next == self) {
+        return;
+    }
+    bool slice_over = self->slice_start != xTaskGetTickCount();
+    if (next->prio > self->prio || (next->prio == self->prio && (yield || slice_over))) {
+        make_ready(self);
+        switch_out(self);
+    }
+}
+
+// Block the calling task on `on` until woken or until `deadline`. False on
+// timeout, and straight away for a zero wait or a caller that is not a task.
+static bool block_on(const void *on, TickType_t wait, TickType_t deadline)
+{
+    struct sim_task *self = t_self;
+    if (wait == 0 || self == NULL || !s_started) {
+        return false;
+    }
+    configASSERT(s_current == self && t_critical_depth == 0 && t_suspend_depth == 0);
+    bool timed = wait != portMAX_DELAY;
+    if (timed && tick_reached(xTaskGetTickCount(), deadline)) {
+        return false;
+    }
+    self->state = TASK_BLOCKED;
+    self->blocked_on = on;
+    self->timed = timed;
+    self->wake = deadline;
+    self->timed_out = false;
+    switch_out(self);
+    return !self->timed_out;
+}
+
+static void wake_waiters(const void *on)
+{
+    if (on == NULL) {
+        return;
+    }
+    for (struct sim_task *t = s_tasks; t != NULL; t = t->next) {
+        if (t->state == TASK_BLOCKED && t->blocked_on == on) {
+            make_ready(t);
+        }
+    }
+}
+
+// Whether anything woken outranks the running task, for the FromISR calls.
+static BaseType_t higher_ready(void)
+{
+    struct sim_task *next = pick_next();
+    return next != NULL && s_current != NULL && next->prio > s_current->prio ? pdTRUE : pdFALSE;
+}
+
+static TickType_t deadline_after(TickType_t wait)
+{
+    return xTaskGetTickCount() + (wait == portMAX_DELAY ? 0 : wait);
+}
+
+/********* critical sections ***************/
+
+// Only the token holder runs, so a critical section just holds the token:
+// no switch happens until the outermost exit.
+void vPortEnterCritical(void)
+{
+    t_critical_depth++;
+}
+
+void vPortExitCritical(void)
+{
+    configASSERT(t_critical_depth > 0);
+    if (--t_critical_depth == 0) {
+        pthread_mutex_lock(&s_kernel);
+        preempt_check(false);
+        pthread_mutex_unlock(&s_kernel);
+    }
+}
+
+void vPortYield(void)
+{
+    pthread_mutex_lock(&s_kernel);
+    preempt_check(true);
+    pthread_mutex_unlock(&s_kernel);
+}
+
+void vTaskSuspendAll(void)
+{
+    t_suspend_depth++;
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    configASSERT(t_suspend_depth > 0);
+    if (--t_suspend_depth == 0) {
+        pthread_mutex_lock(&s_kernel);
+        preempt_check(false);
+        pthread_mutex_unlock(&s_kernel);
+    }
+    return pdFALSE;
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    if (t_suspend_depth > 0) {
+        return taskSCHEDULER_SUSPENDED;
+    }
+    pthread_mutex_lock(&s_kernel);
+    bool started = s_started;
+    pthread_mutex_unlock(&s_kernel);
+    return started ? taskSCHEDULER_RUNNING : taskSCHEDULER_NOT_STARTED;
+}
+
+/********* tasks ***************/
+
+static void *task_entry(void *param)
+{
+    struct sim_task *task = param;
+    t_self = task;
+    pthread_mutex_lock(&s_kernel);
+    wait_for_token(task);
+    pthread_mutex_unlock(&s_kernel);
+    task->fn(task->arg);
+    fprintf(stderr, "sim kernel: task \"%s\" returned from its function\n", task->name);
+    abort();
+}
+
+static bool task_start(struct sim_task *task, TaskFunction_t fn, const char *name, void *arg,
+                       UBaseType_t prio, uint8_t *stack, size_t stack_bytes)
+{
+    memset(task, 0, sizeof(*task));
+    task->fn = fn;
+    task->arg = arg;
+    snprintf(task->name, sizeof(task->name), "%s", name != NULL ? name : "");
+    task->prio = prio < configMAX_PRIORITIES ? prio : configMAX_PRIORITIES - 1;
+    task->stack = stack;
+    task->stack_bytes = stack_bytes;
+    pthread_cond_init(&task->run, NULL);
+    memset(stack, STACK_PAINT, stack_bytes);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int err = pthread_attr_setstack(&attr, stack, stack_bytes);
+    if (err == 0) {
+        err = pthread_create(&task->thread, &attr, task_entry, task);
+    }
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        fprintf(stderr, "sim kernel: cannot start task \"%s\" with a %zu-byte stack: %s\n", task->name,
+                stack_bytes, strerror(err));
+        return false;
+    }
+    pthread_setname_np(task->thread, task->name);
+
+    // A new task that outranks its creator runs straight away.
+    pthread_mutex_lock(&s_kernel);
+    task->next = s_tasks;
+    s_tasks = task;
+    make_ready(task);
+    preempt_check(false);
+    pthread_mutex_unlock(&s_kernel);
+    return true;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, configSTACK_DEPTH_TYPE depth, void *arg,
+                       UBaseType_t prio, TaskHandle_t *handle)
+{
+    size_t stack_bytes = (size_t)depth * sizeof(StackType_t);
+    struct sim_task *task = pvPortMalloc(sizeof(*task));
+    uint8_t *stack = pvPortMalloc(stack_bytes);
+    if (task == NULL || stack == NULL) {
+        vPortFree(stack);
+        vPortFree(task);
+        return pdFAIL;
+    }
+    // Set before the task can run: it may start, and preempt us, inside
+    // task_start().
+    if (handle != NULL) {
+        *handle = task;
+    }
+    if (!task_start(task, fn, name, arg, prio, stack, stack_bytes)) {
+        if (handle != NULL) {
+            *handle = NULL;
+        }
+        vPortFree(stack);
+        vPortFree(task);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, configSTACK_DEPTH_TYPE depth, void *arg,
+                               UBaseType_t prio, StackType_t *stack, StaticTask_t *tcb)
+{
+    struct sim_task *task = (struct sim_task *)tcb;
+    if (!task_start(task, fn, name, arg, prio, (uint8_t *)stack, (size_t)depth * sizeof(StackType_t))) {
+        return NULL;
+    }
+    return task;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    // Deleting another task would need cancellation points in the firmware;
+    // nothing does it. The TCB and stack stay allocated, like a task the
+    // idle task has not cleaned up yet.
+    configASSERT(task == NULL || task == t_self);
+    pthread_mutex_lock(&s_kernel);
+    t_self->state = TASK_DELETED;
+    switch_out(t_self);
+    pthread_mutex_unlock(&s_kernel);
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    pthread_mutex_lock(&s_kernel);
+    if (ticks == 0) {
+        preempt_check(true);
+    } else {
+        block_on(NULL, ticks, xTaskGetTickCount() + ticks);
+    }
+    pthread_mutex_unlock(&s_kernel);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return t_self;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    struct sim_task *t = task != NULL ? task : t_self;
+    size_t untouched = 0;
+    while (untouched < t->stack_bytes && t->stack[untouched] == STACK_PAINT) {
+        untouched++;
+    }
+    return (UBaseType_t)(untouched / sizeof(StackType_t));
+}
+
+void vTaskStartScheduler(void)
+{
+    pthread_once(&s_epoch_once, epoch_init);
+    pthread_cond_t tick;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&tick, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_lock(&s_kernel);
+    s_started = true;
+    dispatch(pick_next());
+    for (;;) {
+        TickType_t now = xTaskGetTickCount();
+        for (struct sim_task *t = s_tasks; t != NULL; t = t->next) {
+            if (t->state == TASK_BLOCKED && t->timed && tick_reached(now, t->wake)) {
+                t->timed_out = true;
+                make_ready(t);
+            }
+        }
+        // A running task picks up anything that outranks it at its next
+        // kernel call; only an idle CPU is handed over from here.
+        if (s_current == NULL) {
+            dispatch(pick_next());
+        }
+        struct timespec next_tick = tick_start(now + 1);
+        while (pthread_cond_timedwait(&tick, &s_kernel, &next_tick) != ETIMEDOUT) {
+        }
+    }
+}
+
+/********* notifications ***************/
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait)
+{
+    struct sim_task *t = t_self;
+    TickType_t deadline = deadline_after(wait);
+    pthread_mutex_lock(&s_kernel);
+    while (t->notify_value == 0 && block_on(&t->notify_value, wait, deadline)) {
+    }
+    uint32_t value = t->notify_value;
+    if (value != 0) {
+        t->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    t->notify_pending = false;
+    pthread_mutex_unlock(&s_kernel);
+    return value;
+}
+
+static BaseType_t notify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    BaseType_t ret = pdPASS;
+    switch (action) {
+    case eSetBits:
+        task->notify_value |= value;
+        break;
+    case eIncrement:
+        task->notify_value++;
+        break;
+    case eSetValueWithOverwrite:
+        task->notify_value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->notify_pending) {
+            ret = pdFAIL;
+        } else {
+            task->notify_value = value;
+        }
+        break;
+    case eNoAction:
+        break;
+    }
+    task->notify_pending = true;
+    wake_waiters(&task->notify_value);
+    return ret;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    pthread_mutex_lock(&s_kernel);
+    BaseType_t ret = notify(task, value, action);
+    preempt_check(false);
+    pthread_mutex_unlock(&s_kernel);
+    return ret;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken)
+{
+    pthread_mutex_lock(&s_kernel);
+    BaseType_t ret = notify(task, value, action);
+    if (woken != NULL && higher_ready()) {
+        *woken = pdTRUE;
+    }
+    pthread_mutex_unlock(&s_kernel);
+    return ret;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t wait)
+{
+    struct sim_task *t = t_self;
+    TickType_t deadline = deadline_after(wait);
+    pthread_mutex_lock(&s_kernel);
+    if (!t->notify_pending) {
+        t->notify_value &= ~clear_on_entry;
+    }
+    while (!t->notify_pending && block_on(&t->notify_value, wait, deadline)) {
+    }
+    bool received = t->notify_pending;
+    if (value != NULL) {
+        *value = t->notify_value;
+    }
+    if (received) {
+        t->notify_value &= ~clear_on_exit;
+        t->notify_pending = false;
+    }
+    pthread_mutex_unlock(&s_kernel);
+    return received ? pdTRUE : pdFALSE;
+}
+
+/********* queues and semaphores ***************/
+
+static void queue_init(struct sim_queue *q, UBaseType_t length, UBaseType_t item_size, uint8_t *storage)
+{
+    memset(q, 0, sizeof(*q));
+    q->length = length;
+    q->item_size = item_size;
+    q->storage = storage;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    // One block, queue then storage, as the kernel allocates it.
+    struct sim_queue *q = pvPortMalloc(sizeof(*q) + length * item_size);
+    if (q == NULL) {
+        return NULL;
+    }
+    queue_init(q, length, item_size, item_size != 0 ? (uint8_t *)(q + 1) : NULL);
+    return q;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                 StaticQueue_t *buffer)
+{
+    struct sim_queue *q = (struct sim_queue *)buffer;
+    queue_init(q, length, item_size, storage);
+    return q;
+}
+
+// Waiters on both ends block on the queue itself and recheck once woken;
+// the highest-priority one runs first and gets the item.
+static BaseType_t queue_send(QueueHandle_t q, const void *item, TickType_t wait, bool to_front)
+{
+    TickType_t deadline = deadline_after(wait);
+    while (q->count == q->length) {
+        if (!block_on(q, wait, deadline)) {
+            return pdFAIL;
+        }
+    }
+    UBaseType_t slot;
+    if (to_front) {
+        q->head = (q->head + q->length - 1) % q->length;
+        slot = q->head;
+    } else {
+        slot = (q->head + q->count) % q->length;
+    }
+    if (q->item_size != 0) {
+        memcpy(q->storage + slot * q->item_size, item, q->item_size);
+    }
+    q->count++;
+    wake_waiters(q);
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait)
+{
+    pthread_mutex_lock(&s_kernel);
+    BaseType_t ret = queue_send(queue, item, wait, false);
+    preempt_check(false);
+    pthread_mutex_unlock(&s_kernel);
+    return ret;
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t wait)
+{
+    pthread_mutex_lock(&s_kernel);
+    BaseType_t ret = queue_send(queue, item, wait, true);
+    preempt_check(false);
+    pthread_mutex_unlock(&s_kernel);
+    return ret;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken)
+{
+    pthread_mutex_lock(&s_kernel);
+    BaseType_t ret = queue_send(queue, item, 0, false);
+    if (woken != NULL && higher_ready()) {
+        *woken = pdTRUE;
+    }
+    pthread_mutex_unlock(&s_kernel);
+    return ret;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    TickType_t deadline = deadline_after(wait);
+    pthread_mutex_lock(&s_kernel);
+    while (q->count == 0) {
+        if (!block_on(q, wait, deadline)) {
+            pthread_mutex_unlock(&s_kernel);
+            return pdFAIL;
+        }
+    }
+    if (q->item_size != 0 && item != NULL) {
+        memcpy(item, q->storage + q->head * q->item_size, q->item_size);
+    }
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    wake_waiters(q);
+    preempt_check(false);
+    pthread_mutex_unlock(&s_kernel);
+    return pdPASS;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&s_kernel);
+    q->count = 0;
+    q->head = 0;
+    wake_waiters(q);
+    preempt_check(false);
+    pthread_mutex_unlock(&s_kernel);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&s_kernel);
+    UBaseType_t count = q->count;
+    pthread_mutex_unlock(&s_kernel);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    pthread_mutex_lock(&s_kernel);
+    UBaseType_t spaces = q->length - q->count;
+    pthread_mutex_unlock(&s_kernel);
+    return spaces;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+    return xQueueCreateStatic(1, 0, NULL, buffer);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t sem = xQueueCreate(1, 0);
+    if (sem != NULL) {
+        xSemaphoreGive(sem);
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    SemaphoreHandle_t sem = xQueueCreateStatic(1, 0, NULL, buffer);
+    xSemaphoreGive(sem);
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    SemaphoreHandle_t sem = xQueueCreate(max, 0);
+    while (sem != NULL && initial-- > 0) {
+        xSemaphoreGive(sem);
+    }
+    return sem;
+}
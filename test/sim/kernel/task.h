@@ -0,0 +1,44 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct sim_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite,
+} eNotifyAction;
+
+#define taskSCHEDULER_SUSPENDED     ((BaseType_t)0)
+#define taskSCHEDULER_NOT_STARTED   ((BaseType_t)1)
+#define taskSCHEDULER_RUNNING       ((BaseType_t)2)
+
+// Depths are in StackType_t words, as on every FreeRTOS port. Tasks created
+// before vTaskStartScheduler() wait for it; after that, one that outranks
+// its creator runs straight away.
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, configSTACK_DEPTH_TYPE depth, void *arg,
+                       UBaseType_t prio, TaskHandle_t *handle);
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, configSTACK_DEPTH_TYPE depth, void *arg,
+                               UBaseType_t prio, StackType_t *stack, StaticTask_t *tcb);
+void vTaskDelete(TaskHandle_t task);    // only NULL (the calling task) is supported
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t wait);
+
+// Suspending the scheduler defers any switch until the outermost resume;
+// the sim uses it to keep log lines whole.
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+BaseType_t xTaskGetSchedulerState(void);
+void vTaskStartScheduler(void);     // never returns
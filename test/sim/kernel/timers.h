@@ -0,0 +1,4 @@
+#pragma once
+
+// Software timers are not used: esp_timer is simulated in sim_esp.c.
+#include "FreeRTOS.h"
@@ -0,0 +1,107 @@
+/*
+ * Cosmo Radio simulator — control surface of the stand-in drivers.
+ * The scenario runner drives these; the firmware never sees them.
+ */
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Mirror of the pin map in main/input_handler.c (V4, knob harness swapped).
+#define SIM_GPIO_BUTTON     1
+#define SIM_GPIO_ENC1_A     42
+#define SIM_GPIO_ENC1_B     41
+#define SIM_GPIO_ENC1_SW    40
+#define SIM_GPIO_ENC2_A     17
+#define SIM_GPIO_ENC2_B     18
+#define SIM_GPIO_ENC2_SW    8
+
+// Physical inputs the latency tracker pairs with the HID key they produce.
+typedef enum {
+    SIM_SRC_BUTTON = 0,     // Enter
+    SIM_SRC_ENC1,           // Up / Down
+    SIM_SRC_ENC2,           // Right / Left
+    SIM_SRC_ENC1_SW,        // F1
+    SIM_SRC_ENC2_SW,        // F2
+    SIM_SRC_COUNT
+} sim_source_t;
+
+/* sim_gpio.c */
+void sim_gpio_set(int pin, int level);          // fires the edge ISR if armed
+int  sim_gpio_get(int pin);
+void sim_gpio_print_stats(void);                // time spent in edge ISRs
+
+/* sim_usb.c — virtual host */
+void sim_usb_mount(bool mounted);
+void sim_usb_set_poll_ms(uint32_t ms);          // 0 = use the descriptor's bInterval
+uint32_t sim_usb_poll_ms(void);                 // interval the host polls at now
+void sim_usb_stall(bool stalled);               // stop taking IN reports
+void sim_usb_hang(uint32_t ms);                 // TinyUSB task stuck: no reports taken, no deferred calls
+void sim_usb_block_next_submit(uint32_t ms);    // next report submission blocks its caller
+void sim_usb_mark_input(sim_source_t src);      // a physical input happened now
+uint16_t sim_usb_get_feature(uint8_t report_id, uint8_t *buf, uint16_t len);
+void sim_usb_set_feature(uint8_t report_id, const uint8_t *buf, uint16_t len);
+size_t sim_usb_take_text(char *out, size_t cap);  // typed text since last take
+void sim_usb_print_stats(void);
+uint32_t sim_usb_max_latency_us(sim_source_t src, uint32_t *count);
+void sim_usb_reset_latency(void);
+void sim_usb_key_stats(uint32_t *reports, uint32_t *presses, uint32_t *mixed);
+void sim_usb_reset_keys(void);
+bool sim_usb_open_sink(const char *path);       // report log, one line per report
+bool sim_usb_open_uinput(void);                 // mirror keys to a real virtual keyboard
+
+/* sim_mfrc522.c — MFRC522 register model and the NTAG21x tags in its field */
+#define SIM_GPIO_NFC_IRQ    5                   // MFRC522 IRQ pin, mirrored by the model
+
+typedef enum { SIM_NTAG213 = 0, SIM_NTAG215, SIM_NTAG216 } sim_ntag_t;
+
+void sim_rc522_set_absent(bool absent);         // no chip on the bus: every register reads 0
+void sim_field_set_type(sim_ntag_t type);       // for tags placed from now on (default NTAG213)
+void sim_field_set_leave_after(int reads);      // tags placed from now on leave at READ n + 1; -1 = never
+bool sim_field_place(const uint8_t *uid, uint8_t uid_len, const char *ndef_text);  // replaces the field
+bool sim_field_add(const uint8_t *uid, uint8_t uid_len, const char *ndef_text);    // joins it (anticollision)
+void sim_field_remove(const uint8_t *uid, uint8_t uid_len);     // NULL: all tags
+
+/* sim_rc522.c — rc522 driver stand-in on top of the register model */
+typedef enum {
+    SIM_RC522_OP_POLL = 0,      // scan that found nothing
+    SIM_RC522_OP_SELECT,        // wake + anticollision + select of a new tag
+    SIM_RC522_OP_PRESENCE,      // HLTA + WUPA + reselect of the current tag
+    SIM_RC522_OP_READ,          // rc522_nxp_read, one 16-byte READ
+    SIM_RC522_OP_WRITE,         // rc522_nxp_write
+    SIM_RC522_OP_COUNT
+} sim_rc522_op_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_transactions;
+    uint32_t max_bus_us;        // SCLK time
+    uint64_t sum_transactions;
+    uint64_t sum_chip_ns;       // bus + air + chip processing
+} sim_rc522_cost_t;
+
+const char *sim_rc522_op_name(sim_rc522_op_t op);
+void sim_rc522_get_cost(sim_rc522_op_t op, sim_rc522_cost_t *out);
+void sim_rc522_reset_costs(void);
+void sim_field_print_stats(void);
+
+/* sim_led.c */
+void sim_led_set_verbose(bool verbose);
+void sim_led_print_stats(void);
+
+/* sim_flash.c */
+bool sim_flash_open(const char *path);          // load partitions from FILE, save back at exit
+bool sim_flash_load_part(const char *label, const char *path);  // one partition from an image file
+void sim_flash_print_stats(void);
+
+/* sim_esp.c */
+void sim_esp_timer_init(void);
+
+/* sim_scenario.c */
+bool sim_scenario_load(const char *path);
+void sim_scenario_task(void *arg);              // runs the script, then exits the process
+
+#endif /* _SIM_H_ */
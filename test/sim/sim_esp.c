@@ -0,0 +1,293 @@
+/*
+ * ESP-IDF system services for the sim: log, esp_timer, restart and shutdown
+ * handlers, ROM CRC, heap_caps.
+ *
+ * POSIX port caveat: a task preempted inside libc (printf, malloc) while
+ * holding a libc lock deadlocks the next task that needs it, so everything
+ * here that touches libc does so with the scheduler suspended.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_rom_crc.h"
+#include "esp_rtc_time.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sim.h"
+
+#define SIM_TIMER_MAX       16
+#define SIM_TIMER_STACK     (16 * 1024)
+#define SIM_TIMER_PRIO      (configMAX_PRIORITIES - 3)  // ESP-IDF esp_timer task is 22/25
+
+esp_log_level_t sim_log_level = ESP_LOG_INFO;
+
+static int64_t s_epoch_ns = 0;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    if (s_epoch_ns == 0) {
+        s_epoch_ns = now_ns();
+    }
+    return (now_ns() - s_epoch_ns) / 1000;
+}
+
+uint64_t esp_rtc_get_time_us(void)
+{
+    return (uint64_t)esp_timer_get_time();
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void sim_log_lock(void)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) vTaskSuspendAll();
+}
+
+void sim_log_unlock(void)
+{
+    fflush(stdout);
+    if (xTaskGetSchedulerState() == taskSCHEDULER_SUSPENDED) (void)xTaskResumeAll();
+}
+
+void sim_critical_enter(int unused, ...)
+{
+    vPortEnterCritical();
+}
+
+void sim_critical_exit(int unused, ...)
+{
+    vPortExitCritical();
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                return "ESP_OK";
+    case ESP_FAIL:              return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:   return "ESP_ERR_INVALID_CRC";
+    default:                    return "UNKNOWN ERROR";
+    }
+}
+
+#define SIM_SHUTDOWN_HANDLERS   4
+
+static shutdown_handler_t s_shutdown[SIM_SHUTDOWN_HANDLERS];
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler)
+{
+    for (int i = 0; i < SIM_SHUTDOWN_HANDLERS; i++) {
+        if (s_shutdown[i] == handler) return ESP_ERR_INVALID_STATE;
+        if (s_shutdown[i] == NULL) {
+            s_shutdown[i] = handler;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
+
+void esp_restart(void)
+{
+    // Last registered first, as ESP-IDF does.
+    for (int i = SIM_SHUTDOWN_HANDLERS - 1; i >= 0; i--) {
+        if (s_shutdown[i] != NULL) s_shutdown[i]();
+    }
+    sim_log_lock();
+    printf("SIM: esp_restart() — firmware asked for a reboot, ending run\n");
+    fflush(stdout);
+    exit(2);
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+/********* heap_caps ***************/
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return xPortGetFreeHeapSize();
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    (void)caps;
+    return xPortGetMinimumEverFreeHeapSize();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void)caps;
+    HeapStats_t stats;
+    vPortGetHeapStats(&stats);
+    return stats.xSizeOfLargestFreeBlockInBytes;
+}
+
+/********* esp_timer ***************/
+
+// Timers live in a fixed pool; one task fires them in expiry order.
+struct esp_timer {
+    bool used;
+    bool armed;
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t expiry_us;
+    uint64_t period_us;     // 0 = one-shot
+};
+
+static struct esp_timer s_timers[SIM_TIMER_MAX];
+static TaskHandle_t s_timer_task = NULL;
+
+static void timer_task(void *arg)
+{
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        int64_t next = INT64_MAX;
+        struct esp_timer *due = NULL;
+
+        taskENTER_CRITICAL();
+        for (int i = 0; i < SIM_TIMER_MAX; i++) {
+            struct esp_timer *t = &s_timers[i];
+            if (!t->used || !t->armed) continue;
+            if (t->expiry_us <= now && (due == NULL || t->expiry_us < due->expiry_us)) due = t;
+            if (t->expiry_us < next) next = t->expiry_us;
+        }
+        esp_timer_cb_t cb = NULL;
+        void *cb_arg = NULL;
+        if (due != NULL) {
+            cb = due->callback;
+            cb_arg = due->arg;
+            if (due->period_us) {
+                due->expiry_us += (int64_t)due->period_us;
+            } else {
+                due->armed = false;
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if (cb != NULL) {
+            cb(cb_arg);
+            continue;
+        }
+
+        TickType_t wait = portMAX_DELAY;
+        if (next != INT64_MAX) {
+            int64_t ms = (next - now + 999) / 1000;
+            wait = ms > 0 ? pdMS_TO_TICKS(ms) : 1;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+void sim_esp_timer_init(void)
+{
+    (void)esp_timer_get_time();     // pin the epoch
+    xTaskCreate(timer_task, "esp_timer", SIM_TIMER_STACK, NULL, SIM_TIMER_PRIO, &s_timer_task);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    if (args == NULL || args->callback == NULL || out == NULL) return ESP_ERR_INVALID_ARG;
+    taskENTER_CRITICAL();
+    for (int i = 0; i < SIM_TIMER_MAX; i++) {
+        if (!s_timers[i].used) {
+            s_timers[i] = (struct esp_timer){ .used = true, .callback = args->callback, .arg = args->arg };
+            *out = &s_timers[i];
+            taskEXIT_CRITICAL();
+            return ESP_OK;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return ESP_ERR_NO_MEM;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t t, uint64_t after_us, uint64_t period_us)
+{
+    if (t == NULL || !t->used) return ESP_ERR_INVALID_ARG;
+    taskENTER_CRITICAL();
+    if (t->armed) {
+        taskEXIT_CRITICAL();
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->expiry_us = esp_timer_get_time() + (int64_t)after_us;
+    t->period_us = period_us;
+    t->armed = true;
+    taskEXIT_CRITICAL();
+    if (s_timer_task != NULL) xTaskNotifyGive(s_timer_task);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return timer_arm(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL || !timer->used) return ESP_ERR_INVALID_ARG;
+    taskENTER_CRITICAL();
+    bool was_armed = timer->armed;
+    timer->armed = false;
+    taskEXIT_CRITICAL();
+    return was_armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL || !timer->used) return ESP_ERR_INVALID_ARG;
+    taskENTER_CRITICAL();
+    if (timer->armed) {
+        taskEXIT_CRITICAL();
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->used = false;
+    taskEXIT_CRITICAL();
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer != NULL && timer->armed;
+}
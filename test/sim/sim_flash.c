@@ -0,0 +1,171 @@
+/*
+ * Flash partitions for the sim: RAM images with NOR semantics, optionally
+ * loaded from and saved back to a file (--flash FILE) so the persistent
+ * telemetry log carries over from one run to the next. A scenario can also
+ * preload one partition from an image file (the UID index).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_partition.h"
+#include "esp_log.h"
+#include "sim.h"
+
+static const char *TAG = "SIM_FLASH";
+
+#define SIM_FLASH_SECTOR    4096
+
+// Static, not malloc'd: the firmware tasks reach these with the scheduler
+// running (see the libc caveat in sim_esp.c).
+static uint8_t s_telemlog[1024 * 1024];
+static uint8_t s_uidmap[1024 * 1024];
+
+// Mirror of the data partitions in partitions.csv that the firmware opens.
+static esp_partition_t s_parts[] = {
+    { .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x40, .address = 0x310000,
+      .size = sizeof(s_telemlog), .erase_size = SIM_FLASH_SECTOR, .label = "telemlog" },
+    { .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x41, .address = 0x410000,
+      .size = sizeof(s_uidmap), .erase_size = SIM_FLASH_SECTOR, .label = "uidmap" },
+};
+#define SIM_PART_COUNT  (sizeof(s_parts) / sizeof(s_parts[0]))
+
+static uint8_t *const s_image[SIM_PART_COUNT] = { s_telemlog, s_uidmap };
+static bool s_ready[SIM_PART_COUNT];
+static const char *s_file = NULL;
+static uint32_t s_writes = 0, s_erases = 0;
+
+static int index_of(const esp_partition_t *part)
+{
+    for (size_t i = 0; i < SIM_PART_COUNT; i++) {
+        if (part == &s_parts[i]) return (int)i;
+    }
+    return -1;
+}
+
+static uint8_t *image(int i)
+{
+    if (!s_ready[i]) {
+        memset(s_image[i], 0xFF, s_parts[i].size);     // factory-fresh flash
+        s_ready[i] = true;
+    }
+    return s_image[i];
+}
+
+static void save(void)
+{
+    FILE *f = fopen(s_file, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "SIM: cannot write flash image %s\n", s_file);
+        return;
+    }
+    for (size_t i = 0; i < SIM_PART_COUNT; i++) {
+        fwrite(image(i), 1, s_parts[i].size, f);
+    }
+    fclose(f);
+}
+
+bool sim_flash_open(const char *path)
+{
+    s_file = path;
+    FILE *f = fopen(path, "rb");
+    if (f != NULL) {
+        for (size_t i = 0; i < SIM_PART_COUNT; i++) {
+            if (fread(image(i), 1, s_parts[i].size, f) != s_parts[i].size) {
+                memset(image(i), 0xFF, s_parts[i].size);   // short or foreign file: blank
+            }
+        }
+        fclose(f);
+    }
+    return atexit(save) == 0;
+}
+
+bool sim_flash_load_part(const char *label, const char *path)
+{
+    for (size_t i = 0; i < SIM_PART_COUNT; i++) {
+        if (strcmp(label, s_parts[i].label) != 0) continue;
+        FILE *f = fopen(path, "rb");
+        if (f == NULL) return false;
+        // What the file does not cover stays erased, as after write_partition.
+        memset(image(i), 0xFF, s_parts[i].size);
+        size_t n = fread(s_image[i], 1, s_parts[i].size, f);
+        bool ok = n > 0 && !ferror(f);
+        fclose(f);
+        return ok;
+    }
+    return false;
+}
+
+void sim_flash_print_stats(void)
+{
+    printf("\n== Flash ==\nwrites %lu, sector erases %lu\n", (unsigned long)s_writes,
+           (unsigned long)s_erases);
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype, const char *label)
+{
+    for (size_t i = 0; i < SIM_PART_COUNT; i++) {
+        if (s_parts[i].type == type && s_parts[i].subtype == subtype
+            && (label == NULL || strcmp(label, s_parts[i].label) == 0)) {
+            return &s_parts[i];
+        }
+    }
+    return NULL;
+}
+
+static bool in_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    return offset <= part->size && size <= part->size - offset;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size)
+{
+    int i = index_of(part);
+    if (i < 0 || !in_range(part, offset, size)) return ESP_ERR_INVALID_ARG;
+    memcpy(dst, image(i) + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size)
+{
+    int i = index_of(part);
+    if (i < 0 || !in_range(part, offset, size)) return ESP_ERR_INVALID_ARG;
+    uint8_t *dst = image(i) + offset;
+    const uint8_t *p = src;
+    for (size_t k = 0; k < size; k++) {
+        if (p[k] & ~dst[k]) {
+            ESP_LOGW(TAG, "%s: write sets bits at 0x%zx without an erase", part->label, offset + k);
+        }
+        dst[k] &= p[k];
+    }
+    s_writes++;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    int i = index_of(part);
+    if (i < 0 || !in_range(part, offset, size) || offset % part->erase_size || size % part->erase_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(image(i) + offset, 0xFF, size);
+    s_erases += size / part->erase_size;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *part, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    int i = index_of(part);
+    if (i < 0 || !in_range(part, offset, size)) return ESP_ERR_INVALID_ARG;
+    *out_ptr = image(i) + offset;
+    *out_handle = (esp_partition_mmap_handle_t)i;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    (void)handle;
+}
@@ -0,0 +1,156 @@
+/*
+ * GPIO stand-in: pin levels set by the scenario, edge ISRs called inline on
+ * the scenario task (neither sim kernel has real interrupts; FromISR APIs
+ * work from task context).
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sim.h"
+
+#define SIM_GPIO_COUNT 49
+
+typedef struct {
+    int level;
+    gpio_int_type_t intr;
+    bool intr_enabled;
+    gpio_isr_t handler;
+    void *arg;
+} sim_pin_t;
+
+static sim_pin_t s_pins[SIM_GPIO_COUNT];
+static bool s_isr_service = false;
+static bool s_levels_init = false;
+
+// Time spent inside edge ISRs, host clock
+static uint32_t s_isr_calls = 0;
+static uint64_t s_isr_ns = 0;
+static uint64_t s_isr_max_ns = 0;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void levels_init(void)
+{
+    if (s_levels_init) return;
+    for (int i = 0; i < SIM_GPIO_COUNT; i++) {
+        s_pins[i].level = 1;    // inputs idle high on their pull-ups
+    }
+    s_levels_init = true;
+}
+
+static bool valid(gpio_num_t pin)
+{
+    return pin >= 0 && pin < SIM_GPIO_COUNT;
+}
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    levels_init();
+    for (int pin = 0; pin < SIM_GPIO_COUNT; pin++) {
+        if (cfg->pin_bit_mask & (1ULL << pin)) {
+            s_pins[pin].intr = cfg->intr_type;
+            s_pins[pin].intr_enabled = cfg->intr_type != GPIO_INTR_DISABLE;
+        }
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin)
+{
+    levels_init();
+    return valid(pin) ? s_pins[pin].level : 0;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    if (!valid(pin)) return ESP_ERR_INVALID_ARG;
+    s_pins[pin].level = level ? 1 : 0;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int flags)
+{
+    (void)flags;
+    if (s_isr_service) return ESP_ERR_INVALID_STATE;
+    s_isr_service = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t handler, void *arg)
+{
+    if (!valid(pin) || !s_isr_service) return ESP_ERR_INVALID_STATE;
+    s_pins[pin].handler = handler;
+    s_pins[pin].arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type)
+{
+    if (!valid(pin)) return ESP_ERR_INVALID_ARG;
+    s_pins[pin].intr = type;
+    s_pins[pin].intr_enabled = type != GPIO_INTR_DISABLE;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t pin)
+{
+    if (!valid(pin)) return ESP_ERR_INVALID_ARG;
+    s_pins[pin].intr_enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin)
+{
+    if (!valid(pin)) return ESP_ERR_INVALID_ARG;
+    s_pins[pin].intr_enabled = false;
+    return ESP_OK;
+}
+
+void sim_gpio_set(int pin, int level)
+{
+    levels_init();
+    if (!valid(pin)) return;
+    sim_pin_t *p = &s_pins[pin];
+    level = level ? 1 : 0;
+    if (p->level == level) return;
+    p->level = level;
+
+    bool fire = false;
+    switch (p->intr) {
+    case GPIO_INTR_ANYEDGE:     fire = true; break;
+    case GPIO_INTR_POSEDGE:     fire = level == 1; break;
+    case GPIO_INTR_NEGEDGE:     fire = level == 0; break;
+    case GPIO_INTR_LOW_LEVEL:   fire = level == 0; break;
+    case GPIO_INTR_HIGH_LEVEL:  fire = level == 1; break;
+    default: break;
+    }
+    if (fire && p->intr_enabled && p->handler != NULL && s_isr_service) {
+        uint64_t t0 = now_ns();
+        p->handler(p->arg);
+        uint64_t d = now_ns() - t0;
+        s_isr_calls++;
+        s_isr_ns += d;
+        if (d > s_isr_max_ns) s_isr_max_ns = d;
+    }
+}
+
+int sim_gpio_get(int pin)
+{
+    return gpio_get_level(pin);
+}
+
+void sim_gpio_print_stats(void)
+{
+    printf("== GPIO ==\n");
+    printf("edge ISRs %u, avg %.2f us, max %.2f us (host time)\n", (unsigned)s_isr_calls,
+           s_isr_calls ? s_isr_ns / 1000.0 / s_isr_calls : 0.0, s_isr_max_ns / 1000.0);
+}
@@ -0,0 +1,80 @@
+/*
+ * led_strip stand-in: keeps the pixel buffer and counts refreshes. With
+ * --led every refresh that changes the strip is logged.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "led_strip.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+static const char *TAG = "SIM_LED";
+
+#define SIM_LED_MAX 512
+
+struct led_strip_t {
+    uint32_t count;
+    uint8_t pixels[SIM_LED_MAX * 3];
+    uint8_t shown[SIM_LED_MAX * 3];
+};
+
+static struct led_strip_t s_strip;
+static bool s_verbose = false;
+static uint32_t s_refreshes, s_changes;
+
+void sim_led_set_verbose(bool verbose)
+{
+    s_verbose = verbose;
+}
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config,
+                                   const led_strip_rmt_config_t *rmt_config,
+                                   led_strip_handle_t *ret_strip)
+{
+    if (led_config->max_leds == 0 || led_config->max_leds > SIM_LED_MAX) return ESP_ERR_INVALID_ARG;
+    s_strip.count = led_config->max_leds;
+    ESP_LOGI(TAG, "Strip: %lu pixels on GPIO%d%s", (unsigned long)s_strip.count,
+             led_config->strip_gpio_num, rmt_config->flags.with_dma ? " (DMA)" : "");
+    *ret_strip = &s_strip;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index,
+                              uint32_t red, uint32_t green, uint32_t blue)
+{
+    if (index >= strip->count) return ESP_ERR_INVALID_ARG;
+    strip->pixels[index * 3] = (uint8_t)red;
+    strip->pixels[index * 3 + 1] = (uint8_t)green;
+    strip->pixels[index * 3 + 2] = (uint8_t)blue;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_refresh(led_strip_handle_t strip)
+{
+    s_refreshes++;
+    size_t len = strip->count * 3;
+    if (memcmp(strip->shown, strip->pixels, len) == 0) return ESP_OK;
+    memcpy(strip->shown, strip->pixels, len);
+    s_changes++;
+    if (s_verbose) {
+        // First pixel is enough to follow the onboard LED.
+        ESP_LOGI(TAG, "#%02x%02x%02x%s", strip->shown[0], strip->shown[1], strip->shown[2],
+                 strip->count > 1 ? " ..." : "");
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_clear(led_strip_handle_t strip)
+{
+    memset(strip->pixels, 0, strip->count * 3);
+    return led_strip_refresh(strip);
+}
+
+void sim_led_print_stats(void)
+{
+    printf("\n== LED strip ==\n");
+    printf("%lu pixels, refreshes %lu, of which changed the strip %lu\n",
+           (unsigned long)s_strip.count, (unsigned long)s_refreshes, (unsigned long)s_changes);
+}
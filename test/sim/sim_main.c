@@ -0,0 +1,119 @@
+/*
+ * Cosmo Radio simulator entry point: the real main/ component on a host
+ * FreeRTOS kernel (see SIM_KERNEL), driven by a scenario script.
+ *
+ *   cosmo_sim [-q|-v] [--no-nfc] [--led] [--sink FILE] [--flash FILE] [--uinput] SCENARIO
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sim.h"
+
+#define SIM_MAIN_STACK      CONFIG_ESP_MAIN_TASK_STACK_SIZE  // app_main runs at priority 1, as on ESP-IDF
+#define SIM_SCENARIO_STACK  (32 * 1024)
+#define SIM_SCENARIO_PRIO   (configMAX_PRIORITIES - 2)  // stimuli land on time, like real edges
+
+// EMBED_TXTFILES equivalent: the file contents plus a NUL, end symbol after it.
+__asm__(".section .rodata\n"
+        ".global _binary_provision_list_txt_start\n"
+        "_binary_provision_list_txt_start:\n"
+        ".incbin \"" SIM_PROVISION_LIST "\"\n"
+        ".byte 0\n"
+        ".global _binary_provision_list_txt_end\n"
+        "_binary_provision_list_txt_end:\n"
+        ".previous\n");
+
+extern void app_main(void);
+
+static void main_task(void *arg)
+{
+    app_main();
+    vTaskDelete(NULL);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-q|-v] [--no-nfc] [--led] [--sink FILE] [--flash FILE] [--uinput] SCENARIO\n"
+            "  -q / -v     firmware log level WARN / DEBUG (default INFO)\n"
+            "  --no-nfc    no RC522 on the bus: the probe stalls, then fails\n"
+            "  --led       log every LED strip change\n"
+            "  --sink FILE write every HID report the host takes to FILE\n"
+            "  --flash FILE keep the flash partitions in FILE across runs\n"
+            "  --uinput    also replay the reports on a Linux uinput keyboard\n",
+            argv0);
+}
+
+int main(int argc, char **argv)
+{
+    const char *scenario = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            sim_log_level = ESP_LOG_WARN;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            sim_log_level = ESP_LOG_DEBUG;
+        } else if (strcmp(argv[i], "--no-nfc") == 0) {
+            sim_rc522_set_absent(true);
+        } else if (strcmp(argv[i], "--led") == 0) {
+            sim_led_set_verbose(true);
+        } else if (strcmp(argv[i], "--sink") == 0 && i + 1 < argc) {
+            if (!sim_usb_open_sink(argv[++i])) {
+                fprintf(stderr, "cannot open sink %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--flash") == 0 && i + 1 < argc) {
+            if (!sim_flash_open(argv[++i])) {
+                fprintf(stderr, "cannot use flash image %s\n", argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--uinput") == 0) {
+            if (!sim_usb_open_uinput()) {
+                fprintf(stderr, "uinput unavailable (built without SIM_UINPUT, or no access to /dev/uinput)\n");
+                return 2;
+            }
+        } else if (argv[i][0] != '-' && scenario == NULL) {
+            scenario = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (scenario == NULL) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!sim_scenario_load(scenario)) {
+        fprintf(stderr, "cannot read scenario %s\n", scenario);
+        return 2;
+    }
+
+    sim_esp_timer_init();
+    xTaskCreate(main_task, "main", SIM_MAIN_STACK, NULL, 1, NULL);
+    xTaskCreate(sim_scenario_task, "scenario", SIM_SCENARIO_STACK, NULL, SIM_SCENARIO_PRIO, NULL);
+    vTaskStartScheduler();
+    return 1;   // only reached if the scheduler could not start
+}
+
+#if configSUPPORT_STATIC_ALLOCATION
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *depth)
+{
+    static StaticTask_t s_tcb;
+    static StackType_t s_stack[configMINIMAL_STACK_SIZE];
+    *tcb = &s_tcb;
+    *stack = s_stack;
+    *depth = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack, configSTACK_DEPTH_TYPE *depth)
+{
+    static StaticTask_t s_tcb;
+    static StackType_t s_stack[configTIMER_TASK_STACK_DEPTH];
+    *tcb = &s_tcb;
+    *stack = s_stack;
+    *depth = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
@@ -0,0 +1,816 @@
+/*
+ * MFRC522 register-level model and the NTAG21x tags in its RF field.
+ *
+ * The chip side has the register file, the 64-byte FIFO, the command set the
+ * rc522 drivers use (Idle, Mem, CalcCRC, Transmit, Receive, Transceive,
+ * SoftReset), the timer, both IRQ registers and the IRQ pin, mirrored on
+ * GPIO5 as on the V4 board. Frames go out at 106 kbit/s; answers come back
+ * after the ISO 14443-3 frame delay plus the tag's own processing time.
+ *
+ * The field side holds up to SIM_FIELD_MAX NTAG213/215/216 with the
+ * ISO 14443-3 state machine (IDLE / READY per cascade level / ACTIVE /
+ * HALT), bit-oriented anticollision with real collisions between tags, and
+ * the NTAG commands READ, FAST_READ, WRITE, GET_VERSION, READ_SIG and HLTA.
+ *
+ * Time is the chip's own clock, advanced by bus traffic only, so the cost
+ * of a driver operation comes out in transactions and bus microseconds
+ * independent of how fast the host runs.
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "ndef_parser.h"
+#include "sim.h"
+#include "sim_mfrc522.h"
+
+#define SIM_FIELD_MAX       4
+#define NTAG_PAGES_MAX      231
+#define NTAG_PAGE_SIZE      4
+
+#define FC_HZ               13560000ull
+#define BIT_NS              9440        // 128 / fc: one bit at 106 kbit/s
+#define FDT_NS              87000       // frame delay time, PCD -> PICC answer
+#define RESET_NS            40000       // oscillator start-up after SoftReset
+#define CRC_NS_PER_BYTE     600
+#define NTAG_WRITE_NS       4100000     // EEPROM programming before the ACK
+
+#define NTAG_ACK            0x0A
+#define NTAG_NAK_ARG        0x00
+#define NTAG_NAK_CRC        0x01
+
+/********* field: NTAG21x ***************/
+
+typedef enum { TAG_IDLE, TAG_READY, TAG_ACTIVE, TAG_HALT } tag_state_t;
+
+typedef struct {
+    uint16_t pages;                 // total, user area is pages 4 .. pages - 6
+    uint8_t cc_size;                // capability container: user bytes / 8
+    uint8_t version_size;           // GET_VERSION storage size byte
+} ntag_info_t;
+
+static const ntag_info_t NTAG_INFO[] = {
+    [SIM_NTAG213] = { .pages = 45,  .cc_size = 0x12, .version_size = 0x0F },
+    [SIM_NTAG215] = { .pages = 135, .cc_size = 0x3E, .version_size = 0x11 },
+    [SIM_NTAG216] = { .pages = 231, .cc_size = 0x6D, .version_size = 0x13 },
+};
+
+typedef struct {
+    bool present;
+    const ntag_info_t *info;
+    uint8_t uid[10];
+    uint8_t uid_len;                // 4, 7 or 10: one to three cascade levels
+    tag_state_t state;
+    uint8_t level;                  // cascade level while READY
+    bool halted;                    // woken by WUPA: falls back to HALT, not IDLE
+    int reads_left;                 // leaves the field at the next READ when 0; -1 = stays
+    uint8_t mem[NTAG_PAGES_MAX * NTAG_PAGE_SIZE];
+} sim_tag_t;
+
+static sim_tag_t s_tags[SIM_FIELD_MAX];
+static sim_ntag_t s_next_type = SIM_NTAG213;
+static int s_next_reads = -1;
+static bool s_absent = false;
+
+// An answer as it leaves the tag: bits LSB first, byte by byte.
+typedef struct {
+    uint8_t data[NTAG_PAGES_MAX * NTAG_PAGE_SIZE + 2];
+    uint16_t bits;
+    int coll;                       // first colliding bit, -1 = none
+    uint32_t busy_ns;               // tag processing before it answers
+    bool any;
+} answer_t;
+
+static uint16_t crc_a(const uint8_t *data, size_t len, uint16_t crc)
+{
+    for (size_t i = 0; i < len; i++) {
+        uint8_t ch = data[i] ^ (uint8_t)crc;
+        ch ^= (uint8_t)(ch << 4);
+        crc = (crc >> 8) ^ ((uint16_t)ch << 8) ^ ((uint16_t)ch << 3) ^ (ch >> 4);
+    }
+    return crc;
+}
+
+static bool crc_a_ok(const uint8_t *frame, size_t len)
+{
+    if (len < 3) return false;
+    uint16_t crc = crc_a(frame, len - 2, 0x6363);
+    return frame[len - 2] == (uint8_t)crc && frame[len - 1] == (uint8_t)(crc >> 8);
+}
+
+static void answer_bytes(answer_t *a, const uint8_t *data, size_t len, bool with_crc)
+{
+    memcpy(a->data, data, len);
+    if (with_crc) {
+        uint16_t crc = crc_a(data, len, 0x6363);
+        a->data[len++] = (uint8_t)crc;
+        a->data[len++] = (uint8_t)(crc >> 8);
+    }
+    a->bits = (uint16_t)(len * 8);
+    a->any = true;
+}
+
+static void answer_nibble(answer_t *a, uint8_t value)
+{
+    a->data[0] = value & 0x0F;
+    a->bits = 4;
+    a->any = true;
+}
+
+static uint8_t tag_levels(const sim_tag_t *t)
+{
+    return t->uid_len == 4 ? 1 : t->uid_len == 7 ? 2 : 3;
+}
+
+// The 5-byte CLn the tag answers with at cascade level `level`: three UID
+// bytes behind the cascade tag 0x88 on every level but the last, then BCC.
+static void tag_cln(const sim_tag_t *t, uint8_t level, uint8_t out[5])
+{
+    bool last = level + 1 == tag_levels(t);
+    const uint8_t *u = &t->uid[level * 3];
+    if (last) {
+        memcpy(out, u, 4);
+    } else {
+        out[0] = 0x88;
+        memcpy(&out[1], u, 3);
+    }
+    out[4] = out[0] ^ out[1] ^ out[2] ^ out[3];
+}
+
+static void tag_drop(sim_tag_t *t)
+{
+    t->state = t->halted ? TAG_HALT : TAG_IDLE;
+}
+
+static void tag_frame(sim_tag_t *t, const uint8_t *f, size_t len, uint8_t last_bits, answer_t *a)
+{
+    uint16_t pages = t->info->pages;
+
+    // Short frame: REQA / WUPA
+    if (len == 1 && last_bits == 7) {
+        uint8_t cmd = f[0] & 0x7F;
+        if ((cmd == 0x26 && t->state == TAG_IDLE)
+            || (cmd == 0x52 && (t->state == TAG_IDLE || t->state == TAG_HALT))) {
+            t->halted = t->state == TAG_HALT;
+            t->state = TAG_READY;
+            t->level = 0;
+            static const uint8_t ATQA[2] = { 0x44, 0x00 };
+            answer_bytes(a, ATQA, sizeof(ATQA), false);
+        } else if (t->state == TAG_READY) {
+            tag_drop(t);
+        }
+        return;
+    }
+
+    if (t->state == TAG_READY) {
+        uint8_t sel = 0x93 + 2 * t->level;
+        if (len < 2 || f[0] != sel) {
+            tag_drop(t);
+            return;
+        }
+        uint8_t cln[5];
+        tag_cln(t, t->level, cln);
+        uint8_t nvb = f[1];
+        if (nvb == 0x70 && len == 9 && last_bits == 0) {
+            // SELECT
+            if (!crc_a_ok(f, len) || memcmp(&f[2], cln, 5) != 0) {
+                tag_drop(t);
+                return;
+            }
+            uint8_t sak;
+            if (t->level + 1 < tag_levels(t)) {
+                t->level++;
+                sak = 0x04;             // UID not complete
+            } else {
+                t->state = TAG_ACTIVE;
+                sak = 0x00;             // NTAG21x
+            }
+            answer_bytes(a, &sak, 1, true);
+            return;
+        }
+        // ANTICOLLISION: answer with the rest of CLn if the known bits match
+        int known = ((nvb >> 4) - 2) * 8 + (nvb & 0x0F);
+        size_t sent_bits = (len - 1) * 8 + (last_bits ? last_bits : 8);
+        if (known < 0 || known >= 40 || sent_bits != (size_t)known + 16) {
+            tag_drop(t);
+            return;
+        }
+        for (int b = 0; b < known; b++) {
+            if (((f[2 + b / 8] ^ cln[b / 8]) >> (b % 8)) & 1) return;
+        }
+        memset(a->data, 0, 6);
+        for (int b = known; b < 40; b++) {
+            int o = b - known;
+            a->data[o / 8] |= ((cln[b / 8] >> (b % 8)) & 1) << (o % 8);
+        }
+        a->bits = (uint16_t)(40 - known);
+        a->any = true;
+        return;
+    }
+
+    if (t->state != TAG_ACTIVE || last_bits != 0) return;
+    if (!crc_a_ok(f, len)) {
+        answer_nibble(a, NTAG_NAK_CRC);
+        tag_drop(t);
+        return;
+    }
+    switch (f[0]) {
+    case 0x30:      // READ: four pages, wrapping to page 0
+        if (t->reads_left == 0) {
+            t->present = false;         // pulled away: the READ goes unanswered
+            return;
+        }
+        if (t->reads_left > 0) t->reads_left--;
+        if (len == 4 && f[1] < pages) {
+            uint8_t out[16];
+            for (int i = 0; i < 16; i++) {
+                out[i] = t->mem[(f[1] * NTAG_PAGE_SIZE + i) % (pages * NTAG_PAGE_SIZE)];
+            }
+            answer_bytes(a, out, sizeof(out), true);
+            return;
+        }
+        break;
+    case 0x3A:      // FAST_READ start..end
+        if (len == 5 && f[1] <= f[2] && f[2] < pages) {
+            answer_bytes(a, &t->mem[f[1] * NTAG_PAGE_SIZE], (f[2] - f[1] + 1) * NTAG_PAGE_SIZE, true);
+            return;
+        }
+        break;
+    case 0xA2:      // WRITE one user page
+        if (len == 8 && f[1] >= 4 && f[1] < pages - 5) {
+            memcpy(&t->mem[f[1] * NTAG_PAGE_SIZE], &f[2], NTAG_PAGE_SIZE);
+            answer_nibble(a, NTAG_ACK);
+            a->busy_ns = NTAG_WRITE_NS;
+            return;
+        }
+        break;
+    case 0x60:      // GET_VERSION
+        if (len == 3) {
+            const uint8_t version[8] = { 0x00, 0x04, 0x04, 0x02, 0x01, 0x00, t->info->version_size, 0x03 };
+            answer_bytes(a, version, sizeof(version), true);
+            return;
+        }
+        break;
+    case 0x3C:      // READ_SIG: no real signature in the model
+        if (len == 4 && f[1] == 0x00) {
+            static const uint8_t sig[32] = { 0 };
+            answer_bytes(a, sig, sizeof(sig), true);
+            return;
+        }
+        break;
+    case 0x50:      // HLTA: no answer
+        if (len == 4 && f[1] == 0x00) {
+            t->state = TAG_HALT;
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    answer_nibble(a, NTAG_NAK_ARG);
+    tag_drop(t);
+}
+
+// Every powered tag hears the frame; overlapping answers OR together on the
+// air and the first bit where they differ is a collision.
+static void field_frame(const uint8_t *f, size_t len, uint8_t last_bits, answer_t *out)
+{
+    static answer_t one;
+    out->bits = 0;
+    out->coll = -1;
+    out->busy_ns = 0;
+    out->any = false;
+    taskENTER_CRITICAL();
+    for (int i = 0; i < SIM_FIELD_MAX; i++) {
+        if (!s_tags[i].present) continue;
+        one.bits = 0;
+        one.busy_ns = 0;
+        one.any = false;
+        tag_frame(&s_tags[i], f, len, last_bits, &one);
+        if (!one.any) continue;
+        if (!out->any) {
+            memcpy(out->data, one.data, (one.bits + 7) / 8);
+            out->bits = one.bits;
+            out->busy_ns = one.busy_ns;
+            out->any = true;
+            continue;
+        }
+        uint16_t common = out->bits < one.bits ? out->bits : one.bits;
+        for (int b = 0; b < common && out->coll < 0; b++) {
+            if (((out->data[b / 8] ^ one.data[b / 8]) >> (b % 8)) & 1) out->coll = b;
+        }
+        if (out->coll < 0 && one.bits != out->bits) out->coll = common;
+        for (int k = 0; k < (common + 7) / 8; k++) out->data[k] |= one.data[k];
+    }
+    taskEXIT_CRITICAL();
+}
+
+static void field_power_off(void)
+{
+    taskENTER_CRITICAL();
+    for (int i = 0; i < SIM_FIELD_MAX; i++) {
+        s_tags[i].state = TAG_IDLE;
+        s_tags[i].halted = false;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void sim_rc522_set_absent(bool absent)
+{
+    s_absent = absent;
+}
+
+void sim_field_set_type(sim_ntag_t type)
+{
+    s_next_type = type;
+}
+
+void sim_field_set_leave_after(int reads)
+{
+    s_next_reads = reads;
+}
+
+bool sim_field_add(const uint8_t *uid, uint8_t uid_len, const char *ndef_text)
+{
+    if (uid_len != 4 && uid_len != 7 && uid_len != 10) return false;
+    const ntag_info_t *info = &NTAG_INFO[s_next_type];
+    static uint8_t mem[NTAG_PAGES_MAX * NTAG_PAGE_SIZE];
+    memset(mem, 0, sizeof(mem));
+    if (ndef_text != NULL
+        && ndef_encode_text(ndef_text, &mem[4 * NTAG_PAGE_SIZE], (info->pages - 9) * NTAG_PAGE_SIZE) == 0) {
+        return false;
+    }
+    // Manufacturer pages as on a real 7-byte UID tag; shorter or longer UIDs
+    // only matter for anticollision.
+    uint8_t u[7] = { 0 };
+    memcpy(u, uid, uid_len < 7 ? uid_len : 7);
+    const uint8_t head[16] = {
+        u[0], u[1], u[2], 0x88 ^ u[0] ^ u[1] ^ u[2],
+        u[3], u[4], u[5], u[6],
+        u[3] ^ u[4] ^ u[5] ^ u[6], 0x48, 0x00, 0x00,
+        0xE1, 0x10, info->cc_size, 0x00,
+    };
+    memcpy(mem, head, sizeof(head));
+    uint8_t *cfg = &mem[(info->pages - 5) * NTAG_PAGE_SIZE];
+    const uint8_t tail[20] = {
+        0x00, 0x00, 0x00, 0xBD,     // dynamic lock
+        0x04, 0x00, 0x00, 0xFF,     // CFG0: AUTH0 = FF, no password
+        0x00, 0x05, 0x00, 0x00,     // CFG1
+        0xFF, 0xFF, 0xFF, 0xFF,     // PWD
+        0x00, 0x00, 0x00, 0x00,     // PACK
+    };
+    memcpy(cfg, tail, sizeof(tail));
+
+    taskENTER_CRITICAL();
+    sim_tag_t *slot = NULL;
+    for (int i = 0; i < SIM_FIELD_MAX && slot == NULL; i++) {
+        if (!s_tags[i].present) slot = &s_tags[i];
+    }
+    if (slot != NULL) {
+        slot->info = info;
+        memcpy(slot->uid, uid, uid_len);
+        slot->uid_len = uid_len;
+        slot->state = TAG_IDLE;
+        slot->halted = false;
+        slot->reads_left = s_next_reads;
+        memcpy(slot->mem, mem, info->pages * NTAG_PAGE_SIZE);
+        slot->present = true;
+    }
+    taskEXIT_CRITICAL();
+    return slot != NULL;
+}
+
+void sim_field_remove(const uint8_t *uid, uint8_t uid_len)
+{
+    taskENTER_CRITICAL();
+    for (int i = 0; i < SIM_FIELD_MAX; i++) {
+        if (uid == NULL || (s_tags[i].uid_len == uid_len && memcmp(s_tags[i].uid, uid, uid_len) == 0)) {
+            s_tags[i].present = false;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+bool sim_field_place(const uint8_t *uid, uint8_t uid_len, const char *ndef_text)
+{
+    sim_field_remove(NULL, 0);
+    return sim_field_add(uid, uid_len, ndef_text);
+}
+
+/********* chip: MFRC522 ***************/
+
+static const uint8_t REG_DEFAULTS[64] = {
+    [MFRC522_REG_COMMAND] = 0x20, [MFRC522_REG_COM_IEN] = 0x80, [MFRC522_REG_COM_IRQ] = 0x14,
+    [MFRC522_REG_STATUS1] = 0x21, [MFRC522_REG_WATER_LEVEL] = 0x08, [MFRC522_REG_CONTROL] = 0x10,
+    [MFRC522_REG_COLL] = 0x80, [MFRC522_REG_MODE] = 0x3F, [MFRC522_REG_TX_CONTROL] = 0x80,
+    [0x16] = 0x10, [0x17] = 0x84, [0x18] = 0x84, [0x19] = 0x4D, [0x1C] = 0x62,
+    [MFRC522_REG_CRC_RESULT_H] = 0xFF, [MFRC522_REG_CRC_RESULT_L] = 0xFF,
+    [0x24] = 0x26, [0x26] = 0x48, [0x27] = 0x88, [0x28] = 0x20, [0x29] = 0x20,
+    [MFRC522_REG_VERSION] = 0x92,
+};
+
+static uint8_t s_reg[64];
+static uint8_t s_fifo[MFRC522_FIFO_SIZE];
+static uint8_t s_fifo_len;
+static uint8_t s_mem[25];           // Mem command buffer
+static uint64_t s_now_ns;
+static uint32_t s_clock_hz = 1000000;
+static bool s_inited = false;
+
+// The one command in flight.
+static struct {
+    uint64_t reset_done;            // SoftReset: PowerDown reads 1 until then
+    uint64_t tx_done;               // frame leaves the antenna
+    uint64_t rx_done;               // answer complete in the FIFO
+    uint64_t timer_done;            // timer expiry; 0 = stopped
+    uint64_t crc_done;
+    uint64_t started;
+    bool tx_pending, rx_pending, crc_pending;
+    answer_t answer;
+    uint16_t crc;
+} s_op;
+
+// Completions not yet seen by the host, for the notice latency.
+static uint64_t s_unseen_com, s_unseen_div;
+static int s_irq_level = 1;
+
+static sim_mfrc522_stats_t s_stats;
+
+static void chip_reset(void)
+{
+    memcpy(s_reg, REG_DEFAULTS, sizeof(s_reg));
+    s_fifo_len = 0;
+    memset(&s_op, 0, sizeof(s_op));
+    s_unseen_com = s_unseen_div = 0;
+}
+
+static void chip_init(void)
+{
+    if (s_inited) return;
+    chip_reset();
+    s_inited = true;
+}
+
+void sim_mfrc522_set_clock(uint32_t hz)
+{
+    if (hz > 0) s_clock_hz = hz;
+}
+
+uint64_t sim_mfrc522_now_ns(void)
+{
+    return s_now_ns;
+}
+
+void sim_mfrc522_get_stats(sim_mfrc522_stats_t *out)
+{
+    *out = s_stats;
+}
+
+static void fifo_push(uint8_t b)
+{
+    if (s_fifo_len < MFRC522_FIFO_SIZE) {
+        s_fifo[s_fifo_len++] = b;
+    } else {
+        s_reg[MFRC522_REG_ERROR] |= MFRC522_ERR_BUFFER_OVFL;
+        s_reg[MFRC522_REG_COM_IRQ] |= MFRC522_IRQ_ERR;
+    }
+}
+
+static uint8_t fifo_pop(void)
+{
+    if (s_fifo_len == 0) return 0;
+    uint8_t b = s_fifo[0];
+    memmove(s_fifo, s_fifo + 1, --s_fifo_len);
+    return b;
+}
+
+static uint64_t timer_period_ns(void)
+{
+    uint32_t prescaler = ((s_reg[MFRC522_REG_T_MODE] & 0x0F) << 8) | s_reg[MFRC522_REG_T_PRESCALER];
+    uint32_t reload = (s_reg[MFRC522_REG_T_RELOAD_H] << 8) | s_reg[MFRC522_REG_T_RELOAD_L];
+    return (uint64_t)(2 * prescaler + 1) * (reload + 1) * 1000000000ull / FC_HZ;
+}
+
+static uint8_t command(void)
+{
+    return s_reg[MFRC522_REG_COMMAND] & 0x0F;
+}
+
+static void set_command(uint8_t cmd)
+{
+    s_reg[MFRC522_REG_COMMAND] = (s_reg[MFRC522_REG_COMMAND] & 0xF0) | cmd;
+}
+
+static void raise_com(uint8_t bits, uint64_t at)
+{
+    s_reg[MFRC522_REG_COM_IRQ] |= bits;
+    if (s_unseen_com == 0) s_unseen_com = at;
+}
+
+static void irq_pin_update(void)
+{
+    bool active = (s_reg[MFRC522_REG_COM_IRQ] & s_reg[MFRC522_REG_COM_IEN] & 0x7F)
+                  || (s_reg[MFRC522_REG_DIV_IRQ] & s_reg[MFRC522_REG_DIV_IEN] & 0x14);
+    int level = (s_reg[MFRC522_REG_COM_IEN] & 0x80) ? !active : active;
+    if (level != s_irq_level) {
+        s_irq_level = level;
+        if (active) s_stats.irq_asserts++;
+        sim_gpio_set(SIM_GPIO_NFC_IRQ, level);
+    }
+}
+
+// Put the answer into the FIFO as the receiver would: the first bit at
+// RxAlign of the first byte, CRC checked and dropped with RxCRCEn.
+static void deliver_answer(void)
+{
+    answer_t *a = &s_op.answer;
+    uint8_t align = (s_reg[MFRC522_REG_BIT_FRAMING] >> 4) & 0x07;
+    uint16_t bits = a->bits;
+    if ((s_reg[MFRC522_REG_RX_MODE] & MFRC522_CRC_EN) && align == 0 && bits >= 24 && bits % 8 == 0) {
+        if (!crc_a_ok(a->data, bits / 8)) s_reg[MFRC522_REG_ERROR] |= MFRC522_ERR_CRC;
+        bits -= 16;
+    }
+    uint16_t total = align + bits;
+    uint8_t byte = 0;
+    for (uint16_t p = align; p < total; p++) {
+        uint16_t b = p - align;
+        bool value = (a->data[b / 8] >> (b % 8)) & 1;
+        if (a->coll >= 0 && b > a->coll && !(s_reg[MFRC522_REG_COLL] & 0x80)) value = false;
+        byte |= (uint8_t)value << (p % 8);
+        if (p % 8 == 7 || p + 1 == total) {
+            fifo_push(byte);
+            byte = 0;
+        }
+    }
+    if (s_reg[MFRC522_REG_ERROR] & MFRC522_ERR_BUFFER_OVFL) s_stats.overflows++;
+    s_reg[MFRC522_REG_CONTROL] = (s_reg[MFRC522_REG_CONTROL] & ~0x07) | (total % 8);
+    if (a->coll >= 0) {
+        uint16_t pos = align + a->coll + 1;
+        s_reg[MFRC522_REG_ERROR] |= MFRC522_ERR_COLL;
+        s_reg[MFRC522_REG_COLL] = (s_reg[MFRC522_REG_COLL] & 0x80)
+                                  | (pos > 32 ? MFRC522_COLL_POS_NOT_VALID : (pos & 0x1F));
+        s_stats.collisions++;
+    }
+    uint8_t irq = MFRC522_IRQ_RX;
+    if (s_reg[MFRC522_REG_ERROR]) irq |= MFRC522_IRQ_ERR;
+    if (command() != MFRC522_CMD_TRANSCEIVE) {
+        irq |= MFRC522_IRQ_IDLE;
+        set_command(MFRC522_CMD_IDLE);
+    }
+    raise_com(irq, s_op.rx_done);
+}
+
+// Catch the chip up with its clock: everything that finished by s_now_ns.
+static void chip_update(void)
+{
+    if (s_op.reset_done && s_now_ns >= s_op.reset_done) {
+        s_op.reset_done = 0;
+        s_reg[MFRC522_REG_COMMAND] &= ~MFRC522_COMMAND_POWER_DOWN;
+    }
+    if (s_op.tx_pending && s_now_ns >= s_op.tx_done) {
+        s_op.tx_pending = false;
+        uint8_t irq = MFRC522_IRQ_TX;
+        if (command() == MFRC522_CMD_TRANSMIT) {
+            irq |= MFRC522_IRQ_IDLE;
+            set_command(MFRC522_CMD_IDLE);
+            s_op.rx_pending = false;
+            s_stats.air_ns += s_op.tx_done - s_op.started;
+        } else if (s_reg[MFRC522_REG_T_MODE] & MFRC522_T_AUTO) {
+            s_op.timer_done = s_op.tx_done + timer_period_ns();
+        }
+        raise_com(irq, s_op.tx_done);
+    }
+    if (s_op.rx_pending && s_now_ns >= s_op.rx_done
+        && (s_op.timer_done == 0 || s_op.rx_done <= s_op.timer_done)) {
+        s_op.rx_pending = false;
+        s_op.timer_done = 0;        // the timer stops at the first received bit
+        s_stats.air_ns += s_op.rx_done - s_op.started;
+        deliver_answer();
+    }
+    if (s_op.timer_done && s_now_ns >= s_op.timer_done) {
+        if (s_op.rx_pending || command() == MFRC522_CMD_TRANSCEIVE) {
+            s_stats.timeouts++;
+            s_stats.air_ns += s_op.timer_done - s_op.started;
+        }
+        s_op.rx_pending = false;
+        raise_com(MFRC522_IRQ_TIMER, s_op.timer_done);
+        s_op.timer_done = 0;
+    }
+    if (s_op.crc_pending && s_now_ns >= s_op.crc_done) {
+        s_op.crc_pending = false;
+        s_reg[MFRC522_REG_CRC_RESULT_L] = (uint8_t)s_op.crc;
+        s_reg[MFRC522_REG_CRC_RESULT_H] = (uint8_t)(s_op.crc >> 8);
+        s_reg[MFRC522_REG_DIV_IRQ] |= MFRC522_DIV_IRQ_CRC;
+        if (s_unseen_div == 0) s_unseen_div = s_op.crc_done;
+    }
+    irq_pin_update();
+}
+
+static void start_frame(void)
+{
+    uint8_t frame[MFRC522_FIFO_SIZE + 2];
+    size_t len = s_fifo_len;
+    memcpy(frame, s_fifo, len);
+    s_fifo_len = 0;
+    uint8_t last_bits = s_reg[MFRC522_REG_BIT_FRAMING] & 0x07;
+    if ((s_reg[MFRC522_REG_TX_MODE] & MFRC522_CRC_EN) && last_bits == 0 && len > 0) {
+        uint16_t crc = crc_a(frame, len, 0x6363);
+        frame[len++] = (uint8_t)crc;
+        frame[len++] = (uint8_t)(crc >> 8);
+    }
+    s_reg[MFRC522_REG_ERROR] = 0;
+    s_reg[MFRC522_REG_COLL] = (s_reg[MFRC522_REG_COLL] & 0x80) | MFRC522_COLL_POS_NOT_VALID;
+    s_stats.frames++;
+
+    // 9 bits a byte with parity (a short frame has none), plus SOF / EOF
+    uint32_t tx_bits = (len == 1 && last_bits == 7) ? 7 : (len - (last_bits ? 1 : 0)) * 9 + last_bits;
+    s_op.started = s_now_ns;
+    s_op.tx_done = s_now_ns + (uint64_t)(tx_bits + 2) * BIT_NS;
+    s_op.tx_pending = true;
+    s_op.timer_done = 0;
+
+    answer_t *a = &s_op.answer;
+    bool antenna = s_reg[MFRC522_REG_TX_CONTROL] & 0x03;
+    a->any = false;
+    a->coll = -1;
+    if (antenna && len > 0) field_frame(frame, len, last_bits, a);
+    s_op.rx_pending = a->any;
+    if (a->any) {
+        uint32_t rx_bits = a->bits + a->bits / 8 + 2;
+        s_op.rx_done = s_op.tx_done + FDT_NS + a->busy_ns + (uint64_t)rx_bits * BIT_NS;
+    }
+}
+
+static void write_command(uint8_t value)
+{
+    uint8_t cmd = value & 0x0F;
+    s_reg[MFRC522_REG_COMMAND] = value & 0x30;
+    if (value & MFRC522_COMMAND_POWER_DOWN) return;
+    s_op.tx_pending = s_op.rx_pending = s_op.crc_pending = false;
+    switch (cmd) {
+    case MFRC522_CMD_IDLE:
+        break;
+    case MFRC522_CMD_SOFT_RESET:
+        chip_reset();
+        s_reg[MFRC522_REG_COMMAND] |= MFRC522_COMMAND_POWER_DOWN;
+        s_op.reset_done = s_now_ns + RESET_NS;
+        break;
+    case MFRC522_CMD_CALC_CRC: {
+        static const uint16_t PRESET[4] = { 0x0000, 0x6363, 0xA671, 0xFFFF };
+        s_op.crc = crc_a(s_fifo, s_fifo_len, PRESET[s_reg[MFRC522_REG_MODE] & 0x03]);
+        s_op.crc_done = s_now_ns + (uint64_t)s_fifo_len * CRC_NS_PER_BYTE;
+        s_op.crc_pending = true;
+        s_fifo_len = 0;
+        set_command(cmd);       // runs until the host writes Idle
+        break;
+    }
+    case MFRC522_CMD_TRANSMIT:
+        set_command(cmd);
+        start_frame();
+        break;
+    case MFRC522_CMD_TRANSCEIVE:
+    case MFRC522_CMD_RECEIVE:
+        set_command(cmd);       // Transceive sends on StartSend; nothing arrives unasked
+        break;
+    case MFRC522_CMD_MEM:
+        if (s_fifo_len > 0) {
+            memcpy(s_mem, s_fifo, s_fifo_len < sizeof(s_mem) ? s_fifo_len : sizeof(s_mem));
+            s_fifo_len = 0;
+        } else {
+            for (size_t i = 0; i < sizeof(s_mem); i++) fifo_push(s_mem[i]);
+        }
+        raise_com(MFRC522_IRQ_IDLE, s_now_ns);
+        break;
+    case MFRC522_CMD_MF_AUTHENT:
+        // MIFARE Classic crypto is out of scope; NTAG21x never needs it.
+        s_reg[MFRC522_REG_ERROR] |= MFRC522_ERR_PROTOCOL;
+        raise_com(MFRC522_IRQ_ERR | MFRC522_IRQ_IDLE, s_now_ns);
+        break;
+    default:
+        raise_com(MFRC522_IRQ_IDLE, s_now_ns);
+        break;
+    }
+}
+
+static void note_seen(uint64_t *unseen)
+{
+    if (*unseen == 0) return;
+    uint64_t waited = s_now_ns - *unseen;
+    s_stats.events++;
+    s_stats.notice_ns += waited;
+    if (waited > s_stats.notice_max_ns) s_stats.notice_max_ns = waited;
+    *unseen = 0;
+}
+
+static uint8_t reg_read(uint8_t reg)
+{
+    switch (reg) {
+    case MFRC522_REG_FIFO_DATA:
+        return fifo_pop();
+    case MFRC522_REG_FIFO_LEVEL:
+        return s_fifo_len;
+    case MFRC522_REG_COM_IRQ:
+        note_seen(&s_unseen_com);
+        return s_reg[reg] & 0x7F;
+    case MFRC522_REG_DIV_IRQ:
+        note_seen(&s_unseen_div);
+        return s_reg[reg] & 0x7F;
+    case MFRC522_REG_STATUS1: {
+        bool irq = (s_reg[MFRC522_REG_COM_IRQ] & s_reg[MFRC522_REG_COM_IEN] & 0x7F)
+                   || (s_reg[MFRC522_REG_DIV_IRQ] & s_reg[MFRC522_REG_DIV_IEN] & 0x14);
+        uint8_t water = s_reg[MFRC522_REG_WATER_LEVEL] & 0x3F;
+        return (s_reg[MFRC522_REG_CRC_RESULT_H] == 0 && s_reg[MFRC522_REG_CRC_RESULT_L] == 0 ? 0x40 : 0)
+               | (!s_op.crc_pending ? 0x20 : 0) | (irq ? 0x10 : 0) | (s_op.timer_done ? 0x08 : 0)
+               | (MFRC522_FIFO_SIZE - s_fifo_len <= water ? 0x02 : 0) | (s_fifo_len <= water ? 0x01 : 0);
+    }
+    case MFRC522_REG_T_COUNTER_H:
+    case MFRC522_REG_T_COUNTER_L: {
+        uint64_t left = s_op.timer_done > s_now_ns ? s_op.timer_done - s_now_ns : 0;
+        uint32_t prescaler = ((s_reg[MFRC522_REG_T_MODE] & 0x0F) << 8) | s_reg[MFRC522_REG_T_PRESCALER];
+        uint32_t ticks = (uint32_t)(left * FC_HZ / 1000000000ull / (2 * prescaler + 1));
+        return reg == MFRC522_REG_T_COUNTER_H ? (uint8_t)(ticks >> 8) : (uint8_t)ticks;
+    }
+    default:
+        return s_reg[reg];
+    }
+}
+
+static void reg_write(uint8_t reg, uint8_t value)
+{
+    switch (reg) {
+    case MFRC522_REG_COMMAND:
+        write_command(value);
+        break;
+    case MFRC522_REG_COM_IRQ:
+    case MFRC522_REG_DIV_IRQ:
+        if (value & 0x80) s_reg[reg] |= value & 0x7F;
+        else s_reg[reg] &= ~value;
+        break;
+    case MFRC522_REG_FIFO_DATA:
+        fifo_push(value);
+        break;
+    case MFRC522_REG_FIFO_LEVEL:
+        if (value & MFRC522_FIFO_FLUSH) {
+            s_fifo_len = 0;
+            s_reg[MFRC522_REG_ERROR] &= ~MFRC522_ERR_BUFFER_OVFL;
+        }
+        break;
+    case MFRC522_REG_BIT_FRAMING:
+        s_reg[reg] = value;
+        if ((value & MFRC522_START_SEND) && command() == MFRC522_CMD_TRANSCEIVE
+            && !s_op.tx_pending && !s_op.rx_pending) {
+            start_frame();
+        }
+        break;
+    case MFRC522_REG_TX_CONTROL:
+        if ((s_reg[reg] & 0x03) && !(value & 0x03)) field_power_off();
+        s_reg[reg] = value;
+        break;
+    case MFRC522_REG_CONTROL:
+        if (value & 0x80) s_op.timer_done = 0;                                  // TStopNow
+        if (value & 0x40) s_op.timer_done = s_now_ns + timer_period_ns();       // TStartNow
+        break;
+    case MFRC522_REG_COLL:
+        s_reg[reg] = (s_reg[reg] & 0x7F) | (value & 0x80);
+        break;
+    case MFRC522_REG_ERROR:
+    case MFRC522_REG_STATUS1:
+    case MFRC522_REG_CRC_RESULT_H:
+    case MFRC522_REG_CRC_RESULT_L:
+    case MFRC522_REG_VERSION:
+        break;      // read-only
+    default:
+        s_reg[reg] = value;
+        break;
+    }
+}
+
+void sim_mfrc522_transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+    chip_init();
+    const uint64_t byte_ns = 8000000000ull / s_clock_hz;
+    s_stats.transactions++;
+    s_stats.bytes += len;
+    s_stats.bus_ns += len * byte_ns;
+    if (len == 0) return;
+
+    // Address byte
+    s_now_ns += byte_ns;
+    chip_update();
+    bool read = tx[0] & 0x80;
+    uint8_t reg = (tx[0] >> 1) & 0x3F;
+    if (rx != NULL) rx[0] = 0;
+    for (size_t i = 1; i < len; i++) {
+        s_now_ns += byte_ns;
+        chip_update();
+        if (read) {
+            // The register addressed by the previous byte comes out now.
+            uint8_t value = s_absent ? 0x00 : reg_read(reg);
+            if (rx != NULL) rx[i] = value;
+            reg = (tx[i] >> 1) & 0x3F;
+        } else if (!s_absent) {
+            reg_write(reg, tx[i]);
+        }
+    }
+    chip_update();
+}
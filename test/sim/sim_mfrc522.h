@@ -0,0 +1,124 @@
+/*
+ * Register-level MFRC522 model — the bus side shared by the chip model
+ * (sim_mfrc522.c) and the stand-in rc522 driver on top of it (sim_rc522.c).
+ * Names and bits follow the NXP MFRC522 datasheet, section 9.
+ */
+
+#ifndef _SIM_MFRC522_H_
+#define _SIM_MFRC522_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Registers
+#define MFRC522_REG_COMMAND         0x01
+#define MFRC522_REG_COM_IEN         0x02
+#define MFRC522_REG_DIV_IEN         0x03
+#define MFRC522_REG_COM_IRQ         0x04
+#define MFRC522_REG_DIV_IRQ         0x05
+#define MFRC522_REG_ERROR           0x06
+#define MFRC522_REG_STATUS1         0x07
+#define MFRC522_REG_STATUS2         0x08
+#define MFRC522_REG_FIFO_DATA       0x09
+#define MFRC522_REG_FIFO_LEVEL      0x0A
+#define MFRC522_REG_WATER_LEVEL     0x0B
+#define MFRC522_REG_CONTROL         0x0C
+#define MFRC522_REG_BIT_FRAMING     0x0D
+#define MFRC522_REG_COLL            0x0E
+#define MFRC522_REG_MODE            0x11
+#define MFRC522_REG_TX_MODE         0x12
+#define MFRC522_REG_RX_MODE         0x13
+#define MFRC522_REG_TX_CONTROL      0x14
+#define MFRC522_REG_TX_ASK          0x15
+#define MFRC522_REG_CRC_RESULT_H    0x21
+#define MFRC522_REG_CRC_RESULT_L    0x22
+#define MFRC522_REG_T_MODE          0x2A
+#define MFRC522_REG_T_PRESCALER     0x2B
+#define MFRC522_REG_T_RELOAD_H      0x2C
+#define MFRC522_REG_T_RELOAD_L      0x2D
+#define MFRC522_REG_T_COUNTER_H     0x2E
+#define MFRC522_REG_T_COUNTER_L     0x2F
+#define MFRC522_REG_VERSION         0x37
+
+// CommandReg
+#define MFRC522_CMD_IDLE            0x00
+#define MFRC522_CMD_MEM             0x01
+#define MFRC522_CMD_RANDOM_ID       0x02
+#define MFRC522_CMD_CALC_CRC        0x03
+#define MFRC522_CMD_TRANSMIT        0x04
+#define MFRC522_CMD_NO_CHANGE       0x07
+#define MFRC522_CMD_RECEIVE         0x08
+#define MFRC522_CMD_TRANSCEIVE      0x0C
+#define MFRC522_CMD_MF_AUTHENT      0x0E
+#define MFRC522_CMD_SOFT_RESET      0x0F
+#define MFRC522_COMMAND_POWER_DOWN  0x10
+#define MFRC522_COMMAND_RCV_OFF     0x20
+
+// ComIrqReg / ComIEnReg (bit 7: Set1 / IRqInv)
+#define MFRC522_IRQ_SET             0x80
+#define MFRC522_IRQ_TX              0x40
+#define MFRC522_IRQ_RX              0x20
+#define MFRC522_IRQ_IDLE            0x10
+#define MFRC522_IRQ_HI_ALERT        0x08
+#define MFRC522_IRQ_LO_ALERT        0x04
+#define MFRC522_IRQ_ERR             0x02
+#define MFRC522_IRQ_TIMER           0x01
+// DivIrqReg / DivIEnReg
+#define MFRC522_DIV_IRQ_MFIN_ACT    0x10
+#define MFRC522_DIV_IRQ_CRC         0x04
+
+// ErrorReg
+#define MFRC522_ERR_WR              0x80
+#define MFRC522_ERR_TEMP            0x40
+#define MFRC522_ERR_BUFFER_OVFL     0x10
+#define MFRC522_ERR_COLL            0x08
+#define MFRC522_ERR_CRC             0x04
+#define MFRC522_ERR_PARITY          0x02
+#define MFRC522_ERR_PROTOCOL        0x01
+
+// Other bits
+#define MFRC522_FIFO_FLUSH          0x80    // FIFOLevelReg
+#define MFRC522_START_SEND          0x80    // BitFramingReg
+#define MFRC522_COLL_POS_NOT_VALID  0x20    // CollReg
+#define MFRC522_CRC_EN              0x80    // TxModeReg / RxModeReg
+#define MFRC522_T_AUTO              0x80    // TModeReg
+#define MFRC522_FIFO_SIZE           64
+
+/**
+ * One SPI transaction with CS held low, in the MFRC522 address format:
+ * byte 0 is (reg << 1) with bit 7 set for a read; a read returns each
+ * register in the following rx byte, a write stores every following tx
+ * byte to the same register (FIFO bursts). Advances the chip clock by the
+ * SCLK time at the configured rate.
+ */
+void sim_mfrc522_transfer(const uint8_t *tx, uint8_t *rx, size_t len);
+
+/**
+ * SCLK rate the bus time is charged at (the driver's clock_speed_hz)
+ */
+void sim_mfrc522_set_clock(uint32_t hz);
+
+/**
+ * Chip time in ns. It only moves with bus traffic: a polling driver
+ * pays for waiting in transactions, as it does on the real bus.
+ */
+uint64_t sim_mfrc522_now_ns(void);
+
+typedef struct {
+    uint32_t transactions;          // CS-low SPI transactions
+    uint32_t bytes;
+    uint64_t bus_ns;                // SCLK time
+    uint32_t frames;                // frames sent into the field
+    uint64_t air_ns;                // frame out -> answer in, or timer expiry
+    uint32_t timeouts;              // frames nobody answered (TimerIRq)
+    uint32_t collisions;
+    uint32_t overflows;             // answers longer than the FIFO
+    uint32_t irq_asserts;           // IRQ pin going active (needs ComIEn/DivIEn bits)
+    uint32_t events;                // Rx / Timer / CRC completions seen by the host
+    uint64_t notice_ns;             // completion -> first IRQ register read showing it, summed
+    uint64_t notice_max_ns;
+} sim_mfrc522_stats_t;
+
+void sim_mfrc522_get_stats(sim_mfrc522_stats_t *out);
+
+#endif /* _SIM_MFRC522_H_ */
@@ -0,0 +1,528 @@
+/*
+ * rc522 stand-in: the subset of abobija/rc522 the firmware calls, written
+ * against the MFRC522 register model (sim_mfrc522.c) the way a polling SPI
+ * driver talks to the real chip — FIFO loads, CalcCRC, Transceive with
+ * StartSend, ComIrqReg polling, anticollision over all cascade levels.
+ *
+ * The scanner task polls the field every poll_interval_ms while started and
+ * raises PICC_STATE_CHANGED (ACTIVE on arrival, IDLE on departure) from its
+ * own task, like the library's event loop. A selected tag is checked for
+ * presence with HLTA + WUPA + reselect. Whatever chip time an operation
+ * took is slept off afterwards, so firmware timing follows the bus.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "rc522.h"
+#include "driver/rc522_spi.h"
+#include "picc/rc522_nxp.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sim.h"
+#include "sim_mfrc522.h"
+
+static const char *TAG = "SIM_RC522";
+
+#define SIM_SCAN_STACK      (16 * 1024)
+#define SIM_SCAN_PRIO       3
+#define SIM_PROBE_STALL_MS  1000    // absent reader: probe times out after this
+#define SIM_IRQ_WAIT_NS     40000000ull     // give up on a command after 40 ms of chip time
+
+// Timer: 25 us ticks (prescaler 0xA9), 200 ticks = 5 ms covers an NTAG
+// WRITE (4.1 ms programming) and is what an empty poll waits.
+#define TIMER_PRESCALER     0xA9
+#define TIMER_RELOAD        200
+
+#define PICC_REQA           0x26
+#define PICC_WUPA           0x52
+#define PICC_READ           0x30
+#define PICC_WRITE          0xA2
+#define PICC_HLTA           0x50
+#define PICC_ACK            0x0A
+
+struct rc522_driver_handle {
+    uint32_t clock_hz;
+};
+
+struct rc522 {
+    rc522_config_t config;
+    esp_event_handler_t handler;
+    void *handler_arg;
+    volatile bool running;
+    TaskHandle_t task;
+};
+
+static struct rc522_driver_handle s_driver;
+static struct rc522 s_scanner;
+static SemaphoreHandle_t s_bus;
+static StaticSemaphore_t s_bus_buf;
+static uint64_t s_paid_ns;          // chip time already slept off
+
+static rc522_picc_t s_picc;
+static uint32_t s_polls, s_arrivals, s_departures, s_reads, s_writes, s_errors;
+static sim_rc522_cost_t s_cost[SIM_RC522_OP_COUNT];
+
+static const char *const OP_NAMES[SIM_RC522_OP_COUNT] = {
+    [SIM_RC522_OP_POLL] = "poll",
+    [SIM_RC522_OP_SELECT] = "select",
+    [SIM_RC522_OP_PRESENCE] = "presence",
+    [SIM_RC522_OP_READ] = "read",
+    [SIM_RC522_OP_WRITE] = "write",
+};
+
+/********* cost accounting ***************/
+
+typedef struct {
+    sim_mfrc522_stats_t stats;
+    uint64_t now_ns;
+} cost_mark_t;
+
+static void cost_begin(cost_mark_t *m)
+{
+    sim_mfrc522_get_stats(&m->stats);
+    m->now_ns = sim_mfrc522_now_ns();
+}
+
+static void cost_end(const cost_mark_t *m, sim_rc522_op_t op)
+{
+    sim_mfrc522_stats_t now;
+    sim_mfrc522_get_stats(&now);
+    uint32_t transactions = now.transactions - m->stats.transactions;
+    uint32_t bus_us = (uint32_t)((now.bus_ns - m->stats.bus_ns) / 1000);
+    sim_rc522_cost_t *c = &s_cost[op];
+    c->count++;
+    c->sum_transactions += transactions;
+    c->sum_chip_ns += sim_mfrc522_now_ns() - m->now_ns;
+    if (transactions > c->max_transactions) c->max_transactions = transactions;
+    if (bus_us > c->max_bus_us) c->max_bus_us = bus_us;
+}
+
+const char *sim_rc522_op_name(sim_rc522_op_t op)
+{
+    return op < SIM_RC522_OP_COUNT ? OP_NAMES[op] : NULL;
+}
+
+void sim_rc522_get_cost(sim_rc522_op_t op, sim_rc522_cost_t *out)
+{
+    taskENTER_CRITICAL();
+    *out = s_cost[op];
+    taskEXIT_CRITICAL();
+}
+
+void sim_rc522_reset_costs(void)
+{
+    taskENTER_CRITICAL();
+    memset(s_cost, 0, sizeof(s_cost));
+    taskEXIT_CRITICAL();
+}
+
+/********* register access ***************/
+
+static uint8_t reg_read(uint8_t reg)
+{
+    uint8_t tx[2] = { 0x80 | (reg << 1), 0x00 }, rx[2];
+    sim_mfrc522_transfer(tx, rx, sizeof(tx));
+    return rx[1];
+}
+
+static void reg_write(uint8_t reg, uint8_t value)
+{
+    uint8_t tx[2] = { reg << 1, value };
+    sim_mfrc522_transfer(tx, NULL, sizeof(tx));
+}
+
+static void fifo_write(const uint8_t *data, uint8_t len)
+{
+    uint8_t tx[1 + MFRC522_FIFO_SIZE];
+    tx[0] = MFRC522_REG_FIFO_DATA << 1;
+    memcpy(&tx[1], data, len);
+    sim_mfrc522_transfer(tx, NULL, 1u + len);
+}
+
+static void fifo_read(uint8_t *out, uint8_t len)
+{
+    uint8_t tx[1 + MFRC522_FIFO_SIZE], rx[1 + MFRC522_FIFO_SIZE];
+    memset(tx, 0x80 | (MFRC522_REG_FIFO_DATA << 1), len);
+    tx[len] = 0x00;
+    sim_mfrc522_transfer(tx, rx, 1u + len);
+    memcpy(out, &rx[1], len);
+}
+
+// Sleep off the chip time spent since the last call.
+static void bus_settle(void)
+{
+    uint64_t owed = sim_mfrc522_now_ns() - s_paid_ns;
+    uint32_t ms = (uint32_t)(owed / 1000000);
+    if (ms > 0) {
+        s_paid_ns += (uint64_t)ms * 1000000;
+        vTaskDelay(pdMS_TO_TICKS(ms));
+    }
+}
+
+static esp_err_t wait_irq(uint8_t reg, uint8_t done, uint8_t timeout, uint8_t *got)
+{
+    uint64_t deadline = sim_mfrc522_now_ns() + SIM_IRQ_WAIT_NS;
+    while (sim_mfrc522_now_ns() < deadline) {
+        uint8_t irq = reg_read(reg);
+        if (irq & done) {
+            if (got) *got = irq;
+            return ESP_OK;
+        }
+        if (irq & timeout) return ESP_ERR_TIMEOUT;
+    }
+    ESP_LOGW(TAG, "Chip did not finish (reg 0x%02x)", reg);
+    return ESP_FAIL;
+}
+
+static esp_err_t pcd_crc(const uint8_t *data, uint8_t len, uint8_t out[2])
+{
+    reg_write(MFRC522_REG_COMMAND, MFRC522_CMD_IDLE);
+    reg_write(MFRC522_REG_DIV_IRQ, MFRC522_DIV_IRQ_CRC);
+    reg_write(MFRC522_REG_FIFO_LEVEL, MFRC522_FIFO_FLUSH);
+    fifo_write(data, len);
+    reg_write(MFRC522_REG_COMMAND, MFRC522_CMD_CALC_CRC);
+    esp_err_t ret = wait_irq(MFRC522_REG_DIV_IRQ, MFRC522_DIV_IRQ_CRC, 0, NULL);
+    reg_write(MFRC522_REG_COMMAND, MFRC522_CMD_IDLE);
+    if (ret != ESP_OK) return ret;
+    out[0] = reg_read(MFRC522_REG_CRC_RESULT_L);
+    out[1] = reg_read(MFRC522_REG_CRC_RESULT_H);
+    return ESP_OK;
+}
+
+typedef struct {
+    uint8_t len;                    // bytes in the FIFO
+    uint8_t last_bits;              // valid bits in the last one, 0 = all
+    uint8_t coll_pos;               // 1-based bit of the first collision, 0 = none
+} pcd_rx_t;
+
+// One frame out, the answer back. rx_align: bit of the first FIFO byte the
+// answer starts at (anticollision continues a partial byte).
+static esp_err_t pcd_transceive(const uint8_t *tx, uint8_t tx_len, uint8_t tx_last_bits, uint8_t rx_align,
+                                uint8_t *rx, uint8_t rx_cap, pcd_rx_t *info)
+{
+    uint8_t framing = (uint8_t)((rx_align << 4) | tx_last_bits);
+    reg_write(MFRC522_REG_COMMAND, MFRC522_CMD_IDLE);
+    reg_write(MFRC522_REG_COM_IRQ, 0x7F);
+    reg_write(MFRC522_REG_FIFO_LEVEL, MFRC522_FIFO_FLUSH);
+    fifo_write(tx, tx_len);
+    reg_write(MFRC522_REG_BIT_FRAMING, framing);
+    reg_write(MFRC522_REG_COMMAND, MFRC522_CMD_TRANSCEIVE);
+    reg_write(MFRC522_REG_BIT_FRAMING, framing | MFRC522_START_SEND);
+    esp_err_t ret = wait_irq(MFRC522_REG_COM_IRQ, MFRC522_IRQ_RX | MFRC522_IRQ_IDLE, MFRC522_IRQ_TIMER, NULL);
+    reg_write(MFRC522_REG_BIT_FRAMING, framing);
+    if (ret != ESP_OK) return ret;
+
+    uint8_t err = reg_read(MFRC522_REG_ERROR);
+    if (err & (MFRC522_ERR_BUFFER_OVFL | MFRC522_ERR_PARITY | MFRC522_ERR_PROTOCOL)) {
+        s_errors++;
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    uint8_t n = reg_read(MFRC522_REG_FIFO_LEVEL);
+    if (n > rx_cap) return ESP_ERR_INVALID_SIZE;
+    fifo_read(rx, n);
+    info->len = n;
+    info->last_bits = reg_read(MFRC522_REG_CONTROL) & 0x07;
+    info->coll_pos = 0;
+    if (err & MFRC522_ERR_COLL) {
+        uint8_t coll = reg_read(MFRC522_REG_COLL);
+        if (coll & MFRC522_COLL_POS_NOT_VALID) return ESP_ERR_INVALID_RESPONSE;
+        info->coll_pos = (coll & 0x1F) ? (coll & 0x1F) : 32;
+    }
+    return ESP_OK;
+}
+
+// HLTA expects no answer: Transmit only, no waiting out the timer.
+static void pcd_halt(void)
+{
+    uint8_t frame[4] = { PICC_HLTA, 0x00 };
+    if (pcd_crc(frame, 2, &frame[2]) != ESP_OK) return;
+    reg_write(MFRC522_REG_COM_IRQ, 0x7F);
+    reg_write(MFRC522_REG_FIFO_LEVEL, MFRC522_FIFO_FLUSH);
+    fifo_write(frame, sizeof(frame));
+    reg_write(MFRC522_REG_BIT_FRAMING, 0);
+    reg_write(MFRC522_REG_COMMAND, MFRC522_CMD_TRANSMIT);
+    wait_irq(MFRC522_REG_COM_IRQ, MFRC522_IRQ_IDLE, 0, NULL);
+}
+
+/********* ISO 14443-3 ***************/
+
+static esp_err_t picc_wake(uint8_t cmd, uint16_t *atqa)
+{
+    uint8_t rx[2];
+    pcd_rx_t info;
+    esp_err_t ret = pcd_transceive(&cmd, 1, 7, 0, rx, sizeof(rx), &info);
+    if (ret != ESP_OK) return ret;
+    if (info.len != 2 || info.last_bits != 0) return ESP_ERR_INVALID_RESPONSE;
+    *atqa = (uint16_t)(rx[0] | (rx[1] << 8));
+    return ESP_OK;
+}
+
+// Anticollision and select through every cascade level. On a collision the
+// branch with a 1 is taken, so with several tags in the field the same one
+// wins each time.
+static esp_err_t picc_select(rc522_picc_uid_t *uid, uint8_t *sak_out)
+{
+    uid->length = 0;
+    for (uint8_t level = 0; level < 3; level++) {
+        uint8_t sel = 0x93 + 2 * level;
+        uint8_t cln[5] = { 0 };
+        int known = 0;
+        while (known < 40) {
+            uint8_t frame[7] = { sel, (uint8_t)(((2 + known / 8) << 4) | (known % 8)) };
+            uint8_t partial = known % 8 ? 1 : 0;
+            memcpy(&frame[2], cln, known / 8 + partial);
+            uint8_t rx[6];
+            pcd_rx_t info;
+            esp_err_t ret = pcd_transceive(frame, (uint8_t)(2 + known / 8 + partial), known % 8,
+                                           known % 8, rx, sizeof(rx), &info);
+            if (ret != ESP_OK) return ret;
+            int first = known / 8;
+            for (int i = 0; i < info.len && first + i < 5; i++) cln[first + i] |= rx[i];
+            if (info.coll_pos == 0) {
+                known = 40;
+                break;
+            }
+            int bit = first * 8 + info.coll_pos - 1;
+            if (bit < known || bit >= 40) return ESP_ERR_INVALID_RESPONSE;
+            cln[bit / 8] &= (uint8_t)((2u << (bit % 8)) - 1);
+            cln[bit / 8] |= (uint8_t)(1u << (bit % 8));
+            known = bit + 1;
+        }
+        if ((cln[0] ^ cln[1] ^ cln[2] ^ cln[3]) != cln[4]) return ESP_ERR_INVALID_CRC;
+
+        uint8_t frame[9] = { sel, 0x70 };
+        memcpy(&frame[2], cln, 5);
+        if (pcd_crc(frame, 7, &frame[7]) != ESP_OK) return ESP_FAIL;
+        uint8_t rx[3], crc[2];
+        pcd_rx_t info;
+        esp_err_t ret = pcd_transceive(frame, sizeof(frame), 0, 0, rx, sizeof(rx), &info);
+        if (ret != ESP_OK) return ret;
+        if (info.len != 3 || pcd_crc(rx, 1, crc) != ESP_OK || memcmp(crc, &rx[1], 2) != 0) {
+            return ESP_ERR_INVALID_CRC;
+        }
+        uint8_t sak = rx[0];
+        if (sak & 0x04) {
+            memcpy(&uid->value[uid->length], &cln[1], 3);
+            uid->length += 3;
+            continue;
+        }
+        memcpy(&uid->value[uid->length], cln, 4);
+        uid->length += 4;
+        *sak_out = sak;
+        return ESP_OK;
+    }
+    return ESP_ERR_INVALID_RESPONSE;
+}
+
+static bool picc_fetch(uint8_t wake_cmd, rc522_picc_uid_t *uid, uint16_t *atqa, uint8_t *sak)
+{
+    return picc_wake(wake_cmd, atqa) == ESP_OK && picc_select(uid, sak) == ESP_OK;
+}
+
+/********* scanner ***************/
+
+static void fire(rc522_picc_state_t old_state)
+{
+    rc522_picc_state_changed_event_t ev = { .picc = &s_picc, .old_state = old_state };
+    if (s_scanner.handler != NULL) {
+        s_scanner.handler(s_scanner.handler_arg, "RC522", RC522_EVENT_PICC_STATE_CHANGED, &ev);
+    }
+}
+
+static void scan_task(void *arg)
+{
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(s_scanner.config.poll_interval_ms));
+        if (!s_scanner.running) continue;
+        s_polls++;
+
+        rc522_picc_uid_t uid;
+        uint16_t atqa = 0;
+        uint8_t sak = 0;
+        cost_mark_t mark;
+        xSemaphoreTake(s_bus, portMAX_DELAY);
+        cost_begin(&mark);
+        bool was_active = s_picc.state != RC522_PICC_STATE_IDLE;
+        if (was_active) pcd_halt();
+        bool found = picc_fetch(was_active ? PICC_WUPA : PICC_REQA, &uid, &atqa, &sak);
+        cost_end(&mark, !found ? SIM_RC522_OP_POLL : was_active ? SIM_RC522_OP_PRESENCE : SIM_RC522_OP_SELECT);
+        xSemaphoreGive(s_bus);
+        bus_settle();
+
+        bool same = found && was_active && uid.length == s_picc.uid.length
+                    && memcmp(uid.value, s_picc.uid.value, uid.length) == 0;
+        if (same) continue;
+        if (was_active) {
+            rc522_picc_state_t old = s_picc.state;
+            s_picc.state = RC522_PICC_STATE_IDLE;
+            s_departures++;
+            fire(old);
+        }
+        if (found) {
+            s_picc.uid = uid;
+            s_picc.atqa = atqa;
+            s_picc.sak = sak;
+            s_picc.type = RC522_PICC_TYPE_MIFARE_UL;
+            s_picc.state = RC522_PICC_STATE_ACTIVE;
+            s_arrivals++;
+            fire(RC522_PICC_STATE_IDLE);
+        }
+    }
+}
+
+esp_err_t rc522_spi_create(const rc522_spi_config_t *config, rc522_driver_handle_t *out)
+{
+    uint32_t clock_hz = config->dev_config.clock_speed_hz ? config->dev_config.clock_speed_hz : 5000000;
+    sim_mfrc522_set_clock(clock_hz);
+    uint8_t version = reg_read(MFRC522_REG_VERSION);
+    if (version != 0x91 && version != 0x92) {
+        // A missing reader shows up as SPI timeouts during the version probe.
+        ESP_LOGW(TAG, "No reader on the bus (version 0x%02x), probe stalls %d ms", version, SIM_PROBE_STALL_MS);
+        vTaskDelay(pdMS_TO_TICKS(SIM_PROBE_STALL_MS));
+        return ESP_ERR_TIMEOUT;
+    }
+    s_driver.clock_hz = clock_hz;
+    *out = &s_driver;
+    return ESP_OK;
+}
+
+esp_err_t rc522_driver_install(rc522_driver_handle_t driver)
+{
+    if (driver != &s_driver) return ESP_ERR_INVALID_ARG;
+    if (s_bus == NULL) s_bus = xSemaphoreCreateMutexStatic(&s_bus_buf);
+    reg_write(MFRC522_REG_COMMAND, MFRC522_CMD_SOFT_RESET);
+    uint64_t deadline = sim_mfrc522_now_ns() + SIM_IRQ_WAIT_NS;
+    while (reg_read(MFRC522_REG_COMMAND) & MFRC522_COMMAND_POWER_DOWN) {
+        if (sim_mfrc522_now_ns() > deadline) return ESP_ERR_TIMEOUT;
+    }
+    reg_write(MFRC522_REG_T_MODE, MFRC522_T_AUTO | (TIMER_PRESCALER >> 8));
+    reg_write(MFRC522_REG_T_PRESCALER, TIMER_PRESCALER & 0xFF);
+    reg_write(MFRC522_REG_T_RELOAD_H, TIMER_RELOAD >> 8);
+    reg_write(MFRC522_REG_T_RELOAD_L, TIMER_RELOAD & 0xFF);
+    reg_write(MFRC522_REG_TX_ASK, 0x40);        // 100 % ASK
+    reg_write(MFRC522_REG_MODE, 0x3D);          // CRC preset 0x6363
+    reg_write(MFRC522_REG_TX_CONTROL, reg_read(MFRC522_REG_TX_CONTROL) | 0x03);   // antenna on
+    bus_settle();
+    return ESP_OK;
+}
+
+esp_err_t rc522_create(const rc522_config_t *config, rc522_handle_t *out)
+{
+    if (s_scanner.task != NULL) return ESP_ERR_INVALID_STATE;
+    s_scanner.config = *config;
+    if (s_scanner.config.poll_interval_ms == 0) s_scanner.config.poll_interval_ms = 125;
+    UBaseType_t prio = config->task_priority ? config->task_priority : SIM_SCAN_PRIO;
+    if (xTaskCreate(scan_task, "rc522_task", SIM_SCAN_STACK, NULL, prio, &s_scanner.task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    *out = &s_scanner;
+    return ESP_OK;
+}
+
+esp_err_t rc522_register_events(rc522_handle_t rc522, int32_t event, esp_event_handler_t handler, void *arg)
+{
+    (void)event;
+    rc522->handler = handler;
+    rc522->handler_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t rc522_start(rc522_handle_t rc522)
+{
+    rc522->running = true;
+    return ESP_OK;
+}
+
+esp_err_t rc522_pause(rc522_handle_t rc522)
+{
+    rc522->running = false;
+    return ESP_OK;
+}
+
+esp_err_t rc522_destroy(rc522_handle_t rc522)
+{
+    rc522->running = false;
+    return ESP_OK;
+}
+
+esp_err_t rc522_nxp_read(rc522_handle_t rc522, rc522_picc_t *picc, uint8_t page, uint8_t *out)
+{
+    (void)rc522;
+    if (picc->state == RC522_PICC_STATE_IDLE) return ESP_ERR_INVALID_STATE;
+    cost_mark_t mark;
+    xSemaphoreTake(s_bus, portMAX_DELAY);
+    cost_begin(&mark);
+    uint8_t frame[4] = { PICC_READ, page };
+    uint8_t rx[18], crc[2];
+    pcd_rx_t info;
+    esp_err_t ret = pcd_crc(frame, 2, &frame[2]);
+    if (ret == ESP_OK) ret = pcd_transceive(frame, sizeof(frame), 0, 0, rx, sizeof(rx), &info);
+    if (ret == ESP_OK && (info.len != sizeof(rx) || info.last_bits != 0)) {
+        ret = ESP_ERR_INVALID_RESPONSE;     // 4-bit NAK: page out of range
+    }
+    if (ret == ESP_OK && (pcd_crc(rx, 16, crc) != ESP_OK || memcmp(crc, &rx[16], 2) != 0)) {
+        ret = ESP_ERR_INVALID_CRC;
+    }
+    if (ret == ESP_OK) {
+        memcpy(out, rx, RC522_NXP_READ_SIZE);
+        s_reads++;
+    }
+    cost_end(&mark, SIM_RC522_OP_READ);
+    xSemaphoreGive(s_bus);
+    bus_settle();
+    return ret;
+}
+
+esp_err_t rc522_nxp_write(rc522_handle_t rc522, rc522_picc_t *picc, uint8_t page, const uint8_t *data)
+{
+    (void)rc522;
+    if (picc->state == RC522_PICC_STATE_IDLE) return ESP_ERR_INVALID_STATE;
+    cost_mark_t mark;
+    xSemaphoreTake(s_bus, portMAX_DELAY);
+    cost_begin(&mark);
+    uint8_t frame[8] = { PICC_WRITE, page };
+    memcpy(&frame[2], data, RC522_NXP_PAGE_SIZE);
+    uint8_t rx[1];
+    pcd_rx_t info;
+    esp_err_t ret = pcd_crc(frame, 6, &frame[6]);
+    if (ret == ESP_OK) ret = pcd_transceive(frame, sizeof(frame), 0, 0, rx, sizeof(rx), &info);
+    if (ret == ESP_OK && (info.len != 1 || info.last_bits != 4 || (rx[0] & 0x0F) != PICC_ACK)) {
+        ret = ESP_ERR_INVALID_RESPONSE;
+    }
+    if (ret == ESP_OK) s_writes++;
+    cost_end(&mark, SIM_RC522_OP_WRITE);
+    xSemaphoreGive(s_bus);
+    bus_settle();
+    return ret;
+}
+
+void sim_field_print_stats(void)
+{
+    sim_mfrc522_stats_t st;
+    sim_mfrc522_get_stats(&st);
+    printf("\n== RC522 ==\n");
+    printf("%s, SPI %lu kHz; polls %lu, arrivals %lu, departures %lu, page reads %lu, page writes %lu, errors %lu\n",
+           s_driver.clock_hz ? "reader present" : "reader absent", (unsigned long)(s_driver.clock_hz / 1000),
+           (unsigned long)s_polls, (unsigned long)s_arrivals, (unsigned long)s_departures,
+           (unsigned long)s_reads, (unsigned long)s_writes, (unsigned long)s_errors);
+    printf("bus: %lu transactions, %lu bytes, %.3f ms SCLK; field: %lu frames, %.3f ms on air, "
+           "%lu timeouts, %lu collisions, %lu FIFO overflows\n",
+           (unsigned long)st.transactions, (unsigned long)st.bytes, st.bus_ns / 1e6,
+           (unsigned long)st.frames, st.air_ns / 1e6, (unsigned long)st.timeouts,
+           (unsigned long)st.collisions, (unsigned long)st.overflows);
+    if (st.events > 0) {
+        printf("completion -> host notices: avg %.1f us, max %.1f us over %lu events; IRQ pin asserted %lu times\n",
+               st.notice_ns / 1e3 / st.events, st.notice_max_ns / 1e3, (unsigned long)st.events,
+               (unsigned long)st.irq_asserts);
+    }
+    printf("%-9s %7s %10s %10s %12s %12s\n", "op", "count", "avg xfers", "max xfers", "max bus us", "avg chip ms");
+    for (int op = 0; op < SIM_RC522_OP_COUNT; op++) {
+        const sim_rc522_cost_t *c = &s_cost[op];
+        if (c->count == 0) continue;
+        printf("%-9s %7lu %10.1f %10lu %12lu %12.3f\n", OP_NAMES[op], (unsigned long)c->count,
+               (double)c->sum_transactions / c->count, (unsigned long)c->max_transactions,
+               (unsigned long)c->max_bus_us, c->sum_chip_ns / 1e6 / c->count);
+    }
+}
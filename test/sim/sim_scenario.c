@@ -0,0 +1,620 @@
+/*
+ * Scenario runner: a plain-text script of timed stimuli and checks.
+ *
+ *   # comment
+ *   wait <ms>
+ *   host mount | unmount | interval <ms> | stall | resume
+ *   usb hang <ms> | block <ms>             (TinyUSB task stuck / next report submission blocks)
+ *   button down | up | press [hold_ms]
+ *   enc <1|2> <cw|ccw> [detents] [step_ms]
+ *   sw <1|2> down | up
+ *   chatter <line> <edges>                 (toggle a line back to back, microseconds apart)
+ *   tag place <uid_hex> [text...]          (no text: blank tag, firmware types the UID)
+ *   tag add <uid_hex> [text...]            (another tag in the field: anticollision)
+ *   tag remove [uid_hex]                   (all tags, or just this one)
+ *   tag type <213|215|216>                 (NTAG variant of the tags placed next)
+ *   tag leave-after <reads|never>          (tags placed next leave the field mid-read)
+ *   burst <count> <hold_ms> <gap_ms>       (distinct tags "burst-<n>" in a row)
+ *   get <report_id>                        (feature report, hex dump)
+ *   set <report_id> <hex bytes...>
+ *   expect <text>                          (typed since the last expect; \n = Enter)
+ *   expect nothing <ms>                    (nothing more typed for that long)
+ *   latency reset | save | <input> <max_ms>   (worst input->report time so far, per input)
+ *   latency <input> +<ms|poll>             (worst case within that much of the one saved)
+ *   counter <name> <min> [max]             (firmware telemetry counter within bounds)
+ *   stage <name> <max_ms>                  (worst sample of a firmware latency stage)
+ *   rc522 reset | <op> <max_xfers> <max_bus_us>   (worst driver operation cost so far)
+ *   stats
+ *
+ * The whole file is read before the scheduler starts, so the runner task
+ * itself never touches stdio except through the log lock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "telemetry.h"
+#include "mem_report.h"
+#include "sim.h"
+
+static const char *TAG = "SIM";
+
+#define SCRIPT_MAX          (64 * 1024)
+#define SCRIPT_LINES        2048
+#define EXPECT_TIMEOUT_MS   3000
+#define TYPED_MAX           4096
+#define DEFAULT_HOLD_MS     50
+#define DEFAULT_STEP_MS     10      // per quadrature edge: 40 ms a detent, a brisk hand turn
+#define EVENT_SETTLE_MS     20      // let queued edges and integrators finish before a counter check
+
+static char s_script[SCRIPT_MAX];
+static char *s_lines[SCRIPT_LINES];
+static int s_line_no[SCRIPT_LINES];
+static int s_line_count = 0;
+static const char *s_path = "";
+
+static char s_typed[TYPED_MAX];
+static size_t s_typed_len = 0;
+static int s_failures = 0;
+static uint32_t s_saved_latency_us[SIM_SRC_COUNT];  // `latency save`
+static uint32_t s_saved_latency_count[SIM_SRC_COUNT];
+
+// "flash <partition> <image>": the image path is relative to the script.
+static bool preload_partition(const char *args)
+{
+    char label[17], file[256], full[512];
+    if (sscanf(args, "%16s %255s", label, file) != 2) return false;
+    const char *slash = strrchr(s_path, '/');
+    if (file[0] == '/' || slash == NULL) {
+        snprintf(full, sizeof(full), "%s", file);
+    } else {
+        snprintf(full, sizeof(full), "%.*s/%s", (int)(slash - s_path), s_path, file);
+    }
+    return sim_flash_load_part(label, full);
+}
+
+bool sim_scenario_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return false;
+    size_t n = fread(s_script, 1, SCRIPT_MAX - 1, f);
+    fclose(f);
+    s_script[n] = '\0';
+    s_path = path;
+
+    int line = 0;
+    for (char *p = s_script; p != NULL && *p != '\0';) {
+        char *next = strchr(p, '\n');
+        if (next != NULL) *next++ = '\0';
+        line++;
+        char *hash = strchr(p, '#');
+        if (hash != NULL) *hash = '\0';
+        while (*p == ' ' || *p == '\t') p++;
+        size_t len = strlen(p);
+        while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t' || p[len - 1] == '\r')) p[--len] = '\0';
+        if (strncmp(p, "flash ", 6) == 0) {
+            // Flash contents are there before the firmware boots, so this
+            // applies now, wherever the line is.
+            if (!preload_partition(p + 6)) {
+                fprintf(stderr, "%s:%d: cannot preload partition\n", path, line);
+                return false;
+            }
+        } else if (len > 0 && s_line_count < SCRIPT_LINES) {
+            s_lines[s_line_count] = p;
+            s_line_no[s_line_count] = line;
+            s_line_count++;
+        }
+        p = next;
+    }
+    return true;
+}
+
+/********* stimuli ***************/
+
+static void delay_ms(uint32_t ms)
+{
+    if (ms > 0) vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+static void press_pin(int pin, sim_source_t src, bool down)
+{
+    if (down) sim_usb_mark_input(src);
+    sim_gpio_set(pin, down ? 0 : 1);
+}
+
+// One detent from rest (A = B = 1). The firmware fires on the first edge
+// out of 11: CW drops B first (11 -> 10), CCW drops A first (11 -> 01).
+static void encoder_detent(int enc, bool cw, uint32_t step_ms)
+{
+    int a = enc == 1 ? SIM_GPIO_ENC1_A : SIM_GPIO_ENC2_A;
+    int b = enc == 1 ? SIM_GPIO_ENC1_B : SIM_GPIO_ENC2_B;
+    int first = cw ? b : a;
+    int second = cw ? a : b;
+
+    sim_usb_mark_input(enc == 1 ? SIM_SRC_ENC1 : SIM_SRC_ENC2);
+    sim_gpio_set(first, 0);
+    delay_ms(step_ms);
+    sim_gpio_set(second, 0);
+    delay_ms(step_ms);
+    sim_gpio_set(first, 1);
+    delay_ms(step_ms);
+    sim_gpio_set(second, 1);
+    delay_ms(step_ms);
+}
+
+// Contact bounce: the line flips `edges` times as fast as the ISR can take
+// it. An odd count leaves it at the other level.
+static bool chatter(const char *name, int edges)
+{
+    static const struct { const char *name; int pin; int src; } LINES[] = {
+        { "button", SIM_GPIO_BUTTON, SIM_SRC_BUTTON },
+        { "sw1", SIM_GPIO_ENC1_SW, SIM_SRC_ENC1_SW },
+        { "sw2", SIM_GPIO_ENC2_SW, SIM_SRC_ENC2_SW },
+        { "enc1a", SIM_GPIO_ENC1_A, SIM_SRC_ENC1 },
+        { "enc1b", SIM_GPIO_ENC1_B, SIM_SRC_ENC1 },
+        { "enc2a", SIM_GPIO_ENC2_A, SIM_SRC_ENC2 },
+        { "enc2b", SIM_GPIO_ENC2_B, SIM_SRC_ENC2 },
+    };
+    for (size_t i = 0; i < sizeof(LINES) / sizeof(LINES[0]); i++) {
+        if (strcmp(name, LINES[i].name) != 0) continue;
+        int level = sim_gpio_get(LINES[i].pin);
+        if (level == 1) sim_usb_mark_input((sim_source_t)LINES[i].src);
+        for (int e = 0; e < edges; e++) {
+            level = !level;
+            sim_gpio_set(LINES[i].pin, level);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool parse_hex(const char *s, uint8_t *out, size_t cap, size_t *len)
+{
+    size_t n = 0;
+    while (s[0] != '\0' && s[1] != '\0' && n < cap) {
+        unsigned v;
+        if (sscanf(s, "%2x", &v) != 1) return false;
+        out[n++] = (uint8_t)v;
+        s += 2;
+    }
+    *len = n;
+    return s[0] == '\0' && n > 0;
+}
+
+/********* checks ***************/
+
+static void unescape(const char *in, char *out, size_t cap)
+{
+    size_t n = 0;
+    for (; *in != '\0' && n < cap - 1; in++) {
+        if (in[0] == '\\' && in[1] == 'n') {
+            out[n++] = '\n';
+            in++;
+        } else {
+            out[n++] = *in;
+        }
+    }
+    out[n] = '\0';
+}
+
+static bool expect_typed(const char *want)
+{
+    int64_t deadline = esp_timer_get_time() + EXPECT_TIMEOUT_MS * 1000LL;
+    for (;;) {
+        s_typed_len += sim_usb_take_text(&s_typed[s_typed_len], sizeof(s_typed) - s_typed_len);
+        if (strstr(s_typed, want) != NULL) {
+            s_typed_len = 0;
+            s_typed[0] = '\0';
+            return true;
+        }
+        if (esp_timer_get_time() > deadline) return false;
+        delay_ms(10);
+    }
+}
+
+static void hex_dump(uint8_t id, const uint8_t *buf, uint16_t len)
+{
+    sim_log_lock();
+    printf("SIM: feature report %u (%u bytes):", id, len);
+    for (uint16_t i = 0; i < len; i++) {
+        printf("%s%02x", (i % 16) == 0 ? "\n  " : " ", buf[i]);
+    }
+    printf("\n");
+    sim_log_unlock();
+}
+
+static const char *const COUNTER_NAMES[TELEM_COUNTER_COUNT] = {
+    [TELEM_WINDOW_MS] = "window_ms",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_BUTTON_PRESS - 1] = "btn_press",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_BUTTON_RELEASE - 1] = "btn_release",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_ENC1_CW - 1] = "enc1_cw",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_ENC1_CCW - 1] = "enc1_ccw",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_ENC1_SW_PRESS - 1] = "enc1_sw_press",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_ENC1_SW_RELEASE - 1] = "enc1_sw_release",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_ENC2_CW - 1] = "enc2_cw",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_ENC2_CCW - 1] = "enc2_ccw",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_ENC2_SW_PRESS - 1] = "enc2_sw_press",
+    [TELEM_INPUT_EVENT_BASE + INPUT_EVENT_ENC2_SW_RELEASE - 1] = "enc2_sw_release",
+    [TELEM_INPUT_DEBOUNCED] = "input_debounced",
+    [TELEM_INPUT_ISR_DROPPED] = "input_isr_dropped",
+    [TELEM_INPUT_QUEUE_HWM] = "input_queue_hwm",
+    [TELEM_HID_REPORTS] = "hid_reports",
+    [TELEM_HID_REPORTS_DROPPED] = "hid_reports_dropped",
+    [TELEM_NFC_READS] = "nfc_reads",
+    [TELEM_NFC_READ_ERRORS] = "nfc_read_errors",
+    [TELEM_NDEF_PARSE_FAILS] = "ndef_parse_fails",
+    [TELEM_NFC_CACHE_HITS] = "nfc_cache_hits",
+    [TELEM_NFC_QUEUE_HWM] = "nfc_queue_hwm",
+    [TELEM_NFC_DROPPED] = "nfc_dropped",
+    [TELEM_NFC_SUPERSEDED] = "nfc_superseded",
+    [TELEM_LED_DROPPED] = "led_dropped",
+    [TELEM_EVLOG_DROPPED] = "evlog_dropped",
+    [TELEM_INPUT_RESYNCS] = "input_resyncs",
+    [TELEM_NFC_READ_ABORTS] = "nfc_read_aborts",
+    [TELEM_HEALTH_SLO_MISSES] = "health_slo_misses",
+    [TELEM_HEALTH_STALLS] = "health_stalls",
+    [TELEM_NFC_INDEX_HITS] = "nfc_index_hits",
+};
+
+static const char *const STAGE_NAMES[TELEM_LAT_COUNT] = {
+    "input", "nfc_read", "nfc_queue", "nfc_type", "nfc_first", "nfc_done",
+};
+
+// Upper edge (ms) of the bucket holding the q-th sample.
+static double hist_quantile_ms(const telemetry_hist_t *h, double q)
+{
+    if (h->count == 0) return 0;
+    uint32_t rank = (uint32_t)(q * (h->count - 1)) + 1, seen = 0;
+    for (int k = 0; k < TELEM_HIST_BUCKETS - 1; k++) {
+        seen += h->buckets[k];
+        if (seen >= rank) return (256u << k) / 1000.0;
+    }
+    return h->max_us / 1000.0;
+}
+
+static void print_stats(void)
+{
+    vTaskSuspendAll();
+    sim_usb_print_stats();
+    sim_gpio_print_stats();
+    sim_field_print_stats();
+    sim_led_print_stats();
+    sim_flash_print_stats();
+
+    uint32_t counters[TELEM_COUNTER_COUNT];
+    telemetry_read_counters(0, counters, TELEM_COUNTER_COUNT);
+    printf("\n== Firmware telemetry ==\n");
+    for (int i = 0; i < TELEM_COUNTER_COUNT; i++) {
+        printf("%-18s %10lu%s", COUNTER_NAMES[i], (unsigned long)counters[i], (i % 3) == 2 ? "\n" : "   ");
+    }
+    printf("\n%-10s %7s %9s %9s %9s %9s\n", "stage", "count", "avg ms", "p50 <=ms", "p99 <=ms", "max ms");
+    for (int s = 0; s < TELEM_LAT_COUNT; s++) {
+        telemetry_hist_t h;
+        telemetry_read_hist((telemetry_stage_t)s, &h);
+        printf("%-10s %7lu %9.3f %9.3f %9.3f %9.3f\n", STAGE_NAMES[s], (unsigned long)h.count,
+               h.mean_us / 1000.0,
+               hist_quantile_ms(&h, 0.5), hist_quantile_ms(&h, 0.99), h.max_us / 1000.0);
+    }
+
+    static const char *const TASKS[MEM_TASK_COUNT] = {
+        "main", "input", "led", "nfc_dispatch", "nfc_sched", "periph_init",
+    };
+    static const char *const MODULES[MEM_MOD_COUNT] = { "hid", "input", "led", "nfc", "diag" };
+    uint32_t mem[MEM_REPORT_WORDS];
+    uint32_t present = mem_report_read(mem);
+    printf("\n== Firmware memory (report 10) ==\n");
+    printf("heap free %lu, min free %lu, largest %lu, at boot end %lu\n",
+           (unsigned long)mem[0], (unsigned long)mem[1], (unsigned long)mem[2], (unsigned long)mem[3]);
+    printf("stack free:");
+    for (int t = 0; t < MEM_TASK_COUNT; t++) {
+        if (present & (1u << t)) printf(" %s=%lu", TASKS[t], (unsigned long)mem[MEM_REPORT_HEAP_WORDS + t]);
+    }
+    printf("\nmodule RAM:");
+    for (int m = 0; m < MEM_MOD_COUNT; m++) {
+        printf(" %s=%lu", MODULES[m], (unsigned long)mem[MEM_REPORT_HEAP_WORDS + MEM_TASK_COUNT + m]);
+    }
+    printf("\n");
+    fflush(stdout);
+    (void)xTaskResumeAll();
+}
+
+static int stage_by_name(const char *name)
+{
+    for (int i = 0; i < TELEM_LAT_COUNT; i++) {
+        if (strcmp(name, STAGE_NAMES[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static int counter_by_name(const char *name)
+{
+    for (int i = 0; i < TELEM_COUNTER_COUNT; i++) {
+        if (COUNTER_NAMES[i] != NULL && strcmp(name, COUNTER_NAMES[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/********* runner ***************/
+
+// Same names as the host latency table in `stats`.
+static int source_by_name(const char *name)
+{
+    static const char *const NAMES[SIM_SRC_COUNT] = {
+        "button", "enc1", "enc2", "enc1_sw", "enc2_sw",
+    };
+    for (int i = 0; i < SIM_SRC_COUNT; i++) {
+        if (strcmp(name, NAMES[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static int rc522_op_by_name(const char *name)
+{
+    for (int i = 0; i < SIM_RC522_OP_COUNT; i++) {
+        if (strcmp(name, sim_rc522_op_name((sim_rc522_op_t)i)) == 0) return i;
+    }
+    return -1;
+}
+
+// Undo the word split from argv[first] to the end of the line (free text).
+static const char *join_args(char **argv, int argc, int first)
+{
+    char *end = argv[argc - 1] + strlen(argv[argc - 1]);
+    for (char *p = argv[first]; p < end; p++) {
+        if (*p == '\0') *p = ' ';
+    }
+    return argv[first];
+}
+
+static bool run_line(char *line)
+{
+    char *argv[40];
+    int argc = 0;
+    for (char *p = line; *p != '\0' && argc < 40;) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0') break;
+        argv[argc++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t') p++;
+        if (*p != '\0') *p++ = '\0';
+    }
+    if (argc == 0) return true;
+    const char *cmd = argv[0];
+
+    if (strcmp(cmd, "wait") == 0 && argc == 2) {
+        delay_ms(atoi(argv[1]));
+    } else if (strcmp(cmd, "host") == 0 && argc >= 2) {
+        if (strcmp(argv[1], "mount") == 0) sim_usb_mount(true);
+        else if (strcmp(argv[1], "unmount") == 0) sim_usb_mount(false);
+        else if (strcmp(argv[1], "stall") == 0) sim_usb_stall(true);
+        else if (strcmp(argv[1], "resume") == 0) sim_usb_stall(false);
+        else if (strcmp(argv[1], "interval") == 0 && argc == 3) sim_usb_set_poll_ms(atoi(argv[2]));
+        else return false;
+    } else if (strcmp(cmd, "usb") == 0 && argc == 3) {
+        if (strcmp(argv[1], "hang") == 0) sim_usb_hang((uint32_t)atoi(argv[2]));
+        else if (strcmp(argv[1], "block") == 0) sim_usb_block_next_submit((uint32_t)atoi(argv[2]));
+        else return false;
+    } else if (strcmp(cmd, "button") == 0 && argc >= 2) {
+        if (strcmp(argv[1], "down") == 0) press_pin(SIM_GPIO_BUTTON, SIM_SRC_BUTTON, true);
+        else if (strcmp(argv[1], "up") == 0) press_pin(SIM_GPIO_BUTTON, SIM_SRC_BUTTON, false);
+        else if (strcmp(argv[1], "press") == 0) {
+            press_pin(SIM_GPIO_BUTTON, SIM_SRC_BUTTON, true);
+            delay_ms(argc >= 3 ? atoi(argv[2]) : DEFAULT_HOLD_MS);
+            press_pin(SIM_GPIO_BUTTON, SIM_SRC_BUTTON, false);
+        } else return false;
+    } else if (strcmp(cmd, "enc") == 0 && argc >= 3) {
+        int enc = atoi(argv[1]);
+        if (enc != 1 && enc != 2) return false;
+        bool cw = strcmp(argv[2], "cw") == 0;
+        if (!cw && strcmp(argv[2], "ccw") != 0) return false;
+        int detents = argc >= 4 ? atoi(argv[3]) : 1;
+        uint32_t step = argc >= 5 ? (uint32_t)atoi(argv[4]) : DEFAULT_STEP_MS;
+        for (int i = 0; i < detents; i++) encoder_detent(enc, cw, step);
+    } else if (strcmp(cmd, "sw") == 0 && argc == 3) {
+        int enc = atoi(argv[1]);
+        if (enc != 1 && enc != 2) return false;
+        int pin = enc == 1 ? SIM_GPIO_ENC1_SW : SIM_GPIO_ENC2_SW;
+        sim_source_t src = enc == 1 ? SIM_SRC_ENC1_SW : SIM_SRC_ENC2_SW;
+        if (strcmp(argv[2], "down") == 0) press_pin(pin, src, true);
+        else if (strcmp(argv[2], "up") == 0) press_pin(pin, src, false);
+        else return false;
+    } else if (strcmp(cmd, "chatter") == 0 && argc == 3) {
+        if (!chatter(argv[1], atoi(argv[2]))) return false;
+    } else if (strcmp(cmd, "tag") == 0 && argc >= 2) {
+        uint8_t uid[10];
+        size_t uid_len = 0;
+        if (argc >= 3 && strcmp(argv[1], "type") != 0 && strcmp(argv[1], "leave-after") != 0
+            && !parse_hex(argv[2], uid, sizeof(uid), &uid_len)) {
+            return false;
+        }
+        const char *text = argc >= 4 ? join_args(argv, argc, 3) : NULL;
+        if (strcmp(argv[1], "remove") == 0) {
+            sim_field_remove(argc >= 3 ? uid : NULL, (uint8_t)uid_len);
+        } else if (strcmp(argv[1], "place") == 0 && argc >= 3) {
+            if (!sim_field_place(uid, (uint8_t)uid_len, text)) return false;
+        } else if (strcmp(argv[1], "add") == 0 && argc >= 3) {
+            if (!sim_field_add(uid, (uint8_t)uid_len, text)) return false;
+        } else if (strcmp(argv[1], "type") == 0 && argc == 3) {
+            int type = atoi(argv[2]);
+            if (type == 213) sim_field_set_type(SIM_NTAG213);
+            else if (type == 215) sim_field_set_type(SIM_NTAG215);
+            else if (type == 216) sim_field_set_type(SIM_NTAG216);
+            else return false;
+        } else if (strcmp(argv[1], "leave-after") == 0 && argc == 3) {
+            sim_field_set_leave_after(strcmp(argv[2], "never") == 0 ? -1 : atoi(argv[2]));
+        } else return false;
+    } else if (strcmp(cmd, "burst") == 0 && argc == 4) {
+        int count = atoi(argv[1]);
+        uint32_t hold = atoi(argv[2]), gap = atoi(argv[3]);
+        for (int i = 0; i < count; i++) {
+            uint8_t uid[7] = { 0x04, 0xB0, 0x57, (uint8_t)(i >> 8), (uint8_t)i, 0x5A, 0x80 };
+            char text[24];
+            snprintf(text, sizeof(text), "burst-%d", i);
+            sim_field_place(uid, sizeof(uid), text);
+            delay_ms(hold);
+            sim_field_remove(NULL, 0);
+            delay_ms(gap);
+        }
+    } else if (strcmp(cmd, "get") == 0 && argc == 2) {
+        uint8_t buf[64] = { 0 };
+        uint8_t id = (uint8_t)atoi(argv[1]);
+        uint16_t len = sim_usb_get_feature(id, buf, sizeof(buf));
+        hex_dump(id, buf, len);
+    } else if (strcmp(cmd, "set") == 0 && argc >= 2) {
+        uint8_t buf[64];
+        size_t len = 0;
+        for (int i = 2; i < argc && len < sizeof(buf); i++) {
+            size_t n;
+            if (!parse_hex(argv[i], &buf[len], sizeof(buf) - len, &n)) return false;
+            len += n;
+        }
+        sim_usb_set_feature((uint8_t)atoi(argv[1]), buf, (uint16_t)len);
+    } else if (strcmp(cmd, "expect") == 0 && argc == 3 && strcmp(argv[1], "nothing") == 0) {
+        delay_ms((uint32_t)atoi(argv[2]));
+        s_typed_len += sim_usb_take_text(&s_typed[s_typed_len], sizeof(s_typed) - s_typed_len);
+        if (s_typed_len == 0) {
+            ESP_LOGI(TAG, "expect nothing: ok");
+        } else {
+            ESP_LOGE(TAG, "expect nothing: FAILED, host saw \"%s\"", s_typed);
+            s_failures++;
+        }
+        s_typed_len = 0;
+        s_typed[0] = '\0';
+    } else if (strcmp(cmd, "expect") == 0 && argc >= 2) {
+        const char *arg = join_args(argv, argc, 1);
+        char want[256];
+        unescape(arg, want, sizeof(want));
+        if (expect_typed(want)) {
+            ESP_LOGI(TAG, "expect \"%s\": ok", arg);
+        } else {
+            ESP_LOGE(TAG, "expect \"%s\": FAILED, host saw \"%s\"", arg, s_typed);
+            s_failures++;
+        }
+    } else if (strcmp(cmd, "latency") == 0 && argc == 2 && strcmp(argv[1], "reset") == 0) {
+        sim_usb_reset_latency();
+    } else if (strcmp(cmd, "latency") == 0 && argc == 2 && strcmp(argv[1], "save") == 0) {
+        for (int i = 0; i < SIM_SRC_COUNT; i++) {
+            s_saved_latency_us[i] = sim_usb_max_latency_us((sim_source_t)i, &s_saved_latency_count[i]);
+        }
+    } else if (strcmp(cmd, "latency") == 0 && argc == 3 && argv[2][0] == '+') {
+        int src = source_by_name(argv[1]);
+        if (src < 0) return false;
+        double margin_ms = strcmp(argv[2], "+poll") == 0 ? sim_usb_poll_ms() : atof(argv[2] + 1);
+        uint32_t count;
+        uint32_t max_us = sim_usb_max_latency_us((sim_source_t)src, &count);
+        double saved_ms = s_saved_latency_us[src] / 1000.0;
+        if (count > 0 && s_saved_latency_count[src] > 0 && max_us / 1000.0 <= saved_ms + margin_ms) {
+            ESP_LOGI(TAG, "latency %s: max %.3f ms over %lu reports, saved %.3f ms %s, ok", argv[1],
+                     max_us / 1000.0, (unsigned long)count, saved_ms, argv[2]);
+        } else {
+            ESP_LOGE(TAG, "latency %s: FAILED, max %.3f ms over %lu reports, saved %.3f ms over %lu %s",
+                     argv[1], max_us / 1000.0, (unsigned long)count, saved_ms,
+                     (unsigned long)s_saved_latency_count[src], argv[2]);
+            s_failures++;
+        }
+    } else if (strcmp(cmd, "latency") == 0 && argc == 3) {
+        int src = source_by_name(argv[1]);
+        if (src < 0) return false;
+        uint32_t count;
+        uint32_t max_us = sim_usb_max_latency_us((sim_source_t)src, &count);
+        double limit_ms = atof(argv[2]);
+        if (count > 0 && max_us / 1000.0 <= limit_ms) {
+            ESP_LOGI(TAG, "latency %s: max %.3f ms over %lu reports, ok", argv[1],
+                     max_us / 1000.0, (unsigned long)count);
+        } else {
+            ESP_LOGE(TAG, "latency %s: FAILED, max %.3f ms over %lu reports (limit %s ms)", argv[1],
+                     max_us / 1000.0, (unsigned long)count, argv[2]);
+            s_failures++;
+        }
+    } else if (strcmp(cmd, "reports") == 0 && argc == 2 && strcmp(argv[1], "reset") == 0) {
+        sim_usb_reset_keys();
+    } else if (strcmp(cmd, "reports") == 0 && argc == 2) {
+        uint32_t reports, presses, mixed;
+        sim_usb_key_stats(&reports, &presses, &mixed);
+        double per_press = presses ? (double)reports / presses : 0.0;
+        if (presses > 0 && per_press <= atof(argv[1]) && mixed == 0) {
+            ESP_LOGI(TAG, "reports: %lu for %lu key presses (%.2f each), ok", (unsigned long)reports,
+                     (unsigned long)presses, per_press);
+        } else {
+            ESP_LOGE(TAG, "reports: FAILED, %lu for %lu key presses (%.2f each, limit %s), "
+                     "%lu modifier changes during a key swap", (unsigned long)reports,
+                     (unsigned long)presses, per_press, argv[1], (unsigned long)mixed);
+            s_failures++;
+        }
+    } else if (strcmp(cmd, "counter") == 0 && (argc == 3 || argc == 4)) {
+        int c = counter_by_name(argv[1]);
+        if (c < 0) return false;
+        delay_ms(EVENT_SETTLE_MS);
+        uint32_t value;
+        telemetry_read_counters(c, &value, 1);
+        unsigned long lo = strtoul(argv[2], NULL, 0);
+        unsigned long hi = argc == 4 ? strtoul(argv[3], NULL, 0) : ULONG_MAX;
+        if (value >= lo && value <= hi) {
+            ESP_LOGI(TAG, "counter %s = %lu, ok", argv[1], (unsigned long)value);
+        } else {
+            ESP_LOGE(TAG, "counter %s: FAILED, %lu not in [%s, %s]", argv[1], (unsigned long)value,
+                     argv[2], argc == 4 ? argv[3] : "inf");
+            s_failures++;
+        }
+    } else if (strcmp(cmd, "stage") == 0 && argc == 3) {
+        int s = stage_by_name(argv[1]);
+        if (s < 0) return false;
+        delay_ms(EVENT_SETTLE_MS);
+        telemetry_hist_t h;
+        telemetry_read_hist((telemetry_stage_t)s, &h);
+        double max_ms = atof(argv[2]);
+        if (h.count > 0 && h.max_us <= max_ms * 1000) {
+            ESP_LOGI(TAG, "stage %s: worst %.3f ms over %lu samples, ok", argv[1], h.max_us / 1000.0,
+                     (unsigned long)h.count);
+        } else {
+            ESP_LOGE(TAG, "stage %s: FAILED, worst %.3f ms (limit %s) over %lu samples", argv[1],
+                     h.max_us / 1000.0, argv[2], (unsigned long)h.count);
+            s_failures++;
+        }
+    } else if (strcmp(cmd, "rc522") == 0 && argc == 2 && strcmp(argv[1], "reset") == 0) {
+        sim_rc522_reset_costs();
+    } else if (strcmp(cmd, "rc522") == 0 && argc == 4) {
+        int op = rc522_op_by_name(argv[1]);
+        if (op < 0) return false;
+        sim_rc522_cost_t cost;
+        sim_rc522_get_cost((sim_rc522_op_t)op, &cost);
+        unsigned long max_xfers = strtoul(argv[2], NULL, 0), max_us = strtoul(argv[3], NULL, 0);
+        if (cost.count > 0 && cost.max_transactions <= max_xfers && cost.max_bus_us <= max_us) {
+            ESP_LOGI(TAG, "rc522 %s: worst %lu transactions, %lu us bus over %lu, ok", argv[1],
+                     (unsigned long)cost.max_transactions, (unsigned long)cost.max_bus_us,
+                     (unsigned long)cost.count);
+        } else {
+            ESP_LOGE(TAG, "rc522 %s: FAILED, worst %lu transactions, %lu us bus over %lu (limit %s, %s)",
+                     argv[1], (unsigned long)cost.max_transactions, (unsigned long)cost.max_bus_us,
+                     (unsigned long)cost.count, argv[2], argv[3]);
+            s_failures++;
+        }
+    } else if (strcmp(cmd, "stats") == 0) {
+        print_stats();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void sim_scenario_task(void *arg)
+{
+    ESP_LOGI(TAG, "Scenario %s: %d steps", s_path, s_line_count);
+    for (int i = 0; i < s_line_count; i++) {
+        int line_no = s_line_no[i];
+        if (!run_line(s_lines[i])) {
+            ESP_LOGE(TAG, "%s:%d: bad command", s_path, line_no);
+            s_failures++;
+        }
+    }
+
+    vTaskSuspendAll();
+    printf("\nSIM: %s — %s (%d failure%s)\n", s_path, s_failures ? "FAIL" : "PASS",
+           s_failures, s_failures == 1 ? "" : "s");
+    fflush(stdout);
+    exit(s_failures ? 1 : 0);
+}
@@ -0,0 +1,558 @@
+/*
+ * TinyUSB stand-in: a virtual USB host that enumerates the device, polls the
+ * keyboard IN endpoint every bInterval, and records what it receives.
+ *
+ * Every report the firmware submits is timestamped; when a report presses a
+ * key that a physical input produces (Enter, arrows, F1/F2) it is paired with
+ * the oldest unmatched input of that kind, giving input-to-report latency.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tinyusb.h"
+#include "class/hid/hid_device.h"
+#include "device/usbd_pvt.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "sim.h"
+
+#ifdef SIM_HAVE_UINPUT
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+#endif
+
+static const char *TAG = "SIM_USB";
+
+#define SIM_HOST_STACK      (16 * 1024)
+#define SIM_HOST_PRIO       (configMAX_PRIORITIES - 5)  // same slot as the TinyUSB task
+#define SIM_ENUM_MS         50      // attach -> configured
+#define SIM_LAT_SAMPLES     4096
+#define SIM_INPUT_FIFO      256
+#define SIM_TEXT_MAX        4096
+#define SIM_DEFER_DEPTH     16      // CFG_TUD_TASK_QUEUE_SZ
+
+#define HID_KEY_ENTER       0x28
+#define HID_KEY_BACKSPACE   0x2A
+#define HID_KEY_F1          0x3A
+#define HID_KEY_F2          0x3B
+#define HID_KEY_RIGHT       0x4F
+#define HID_KEY_LEFT        0x50
+#define HID_KEY_DOWN        0x51
+#define HID_KEY_UP          0x52
+#define HID_MOD_SHIFT       0x22    // either shift
+
+typedef struct {
+    int64_t fifo[SIM_INPUT_FIFO];
+    unsigned head, tail;            // tail == head: empty
+    uint32_t samples_us[SIM_LAT_SAMPLES];
+    uint32_t count;
+    uint32_t unmatched;             // reports with no pending input
+    uint64_t sum_us;
+    uint32_t max_us;
+} sim_latency_t;
+
+static const char *const SOURCE_NAMES[SIM_SRC_COUNT] = {
+    "button", "enc1", "enc2", "enc1_sw", "enc2_sw",
+};
+
+static bool s_installed = false;
+static volatile bool s_mounted = false;
+static volatile bool s_stalled = false;
+static uint32_t s_binterval_ms = 10;
+static uint32_t s_poll_override_ms = 0;
+
+// Device-side faults: the TinyUSB task stops running until s_hang_until_us,
+// and the next report submission blocks its caller for s_block_next_ms.
+static volatile int64_t s_hang_until_us = 0;
+static volatile uint32_t s_block_next_ms = 0;
+
+typedef struct {
+    osal_task_func_t func;
+    void *param;
+} sim_defer_t;
+
+static QueueHandle_t s_defer_queue = NULL;
+
+static uint8_t s_pending[8];
+static volatile bool s_has_pending = false;
+static int64_t s_pending_us = 0;
+static uint8_t s_host_keys[8];      // last report the host took
+
+static sim_latency_t s_latency[SIM_SRC_COUNT];
+static uint32_t s_reports = 0;
+// Since sim_usb_reset_keys(): reports, key presses, and reports that changed
+// the modifier while swapping one key for another, which a host may apply
+// to the wrong key.
+static uint32_t s_key_reports = 0, s_key_presses = 0, s_key_mixed = 0;
+static uint32_t s_rejected_busy = 0;
+static uint64_t s_take_wait_sum_us = 0;
+static uint32_t s_take_wait_max_us = 0;
+
+static char s_text[SIM_TEXT_MAX];
+static size_t s_text_len = 0;
+
+static FILE *s_sink = NULL;
+
+/********* input -> report pairing ***************/
+
+void sim_usb_mark_input(sim_source_t src)
+{
+    if (src >= SIM_SRC_COUNT) return;
+    sim_latency_t *l = &s_latency[src];
+    taskENTER_CRITICAL();
+    unsigned next = (l->head + 1) % SIM_INPUT_FIFO;
+    if (next != l->tail) {
+        l->fifo[l->head] = esp_timer_get_time();
+        l->head = next;
+    }
+    taskEXIT_CRITICAL();
+}
+
+static void pair_input(sim_source_t src, int64_t report_us)
+{
+    sim_latency_t *l = &s_latency[src];
+    if (l->tail == l->head) {
+        l->unmatched++;
+        return;
+    }
+    int64_t input_us = l->fifo[l->tail];
+    l->tail = (l->tail + 1) % SIM_INPUT_FIFO;
+    uint32_t us = (uint32_t)(report_us - input_us);
+    if (l->count < SIM_LAT_SAMPLES) l->samples_us[l->count] = us;
+    l->count++;
+    l->sum_us += us;
+    if (us > l->max_us) l->max_us = us;
+}
+
+static int source_for_key(uint8_t key)
+{
+    switch (key) {
+    case HID_KEY_ENTER: return SIM_SRC_BUTTON;
+    case HID_KEY_UP:
+    case HID_KEY_DOWN:  return SIM_SRC_ENC1;
+    case HID_KEY_RIGHT:
+    case HID_KEY_LEFT:  return SIM_SRC_ENC2;
+    case HID_KEY_F1:    return SIM_SRC_ENC1_SW;
+    case HID_KEY_F2:    return SIM_SRC_ENC2_SW;
+    default:            return -1;
+    }
+}
+
+/********* typed text ***************/
+
+static char key_to_ascii(uint8_t key, bool shift)
+{
+    if (key >= 0x04 && key <= 0x1D) return (char)((shift ? 'A' : 'a') + key - 0x04);
+    if (key >= 0x1E && key <= 0x26) {
+        if (shift && key == 0x20) return '#';
+        return (char)('1' + key - 0x1E);
+    }
+    switch (key) {
+    case 0x27: return '0';
+    case HID_KEY_ENTER: return '\n';
+    case 0x2D: return shift ? '_' : '-';
+    case 0x33: return shift ? ':' : ';';
+    case 0x37: return '.';
+    case 0x38: return '/';
+    default: return 0;
+    }
+}
+
+static void text_key(uint8_t key, bool shift)
+{
+    if (key == HID_KEY_BACKSPACE) {
+        if (s_text_len > 0) s_text_len--;
+        return;
+    }
+    char c = key_to_ascii(key, shift);
+    if (c != 0 && s_text_len < SIM_TEXT_MAX - 1) {
+        s_text[s_text_len++] = c;
+    }
+}
+
+size_t sim_usb_take_text(char *out, size_t cap)
+{
+    taskENTER_CRITICAL();
+    size_t n = s_text_len < cap - 1 ? s_text_len : cap - 1;
+    memcpy(out, s_text, n);
+    out[n] = '\0';
+    s_text_len = 0;
+    taskEXIT_CRITICAL();
+    return n;
+}
+
+/********* uinput mirror ***************/
+
+#ifdef SIM_HAVE_UINPUT
+static int s_uinput_fd = -1;
+
+static int hid_to_linux(uint8_t key)
+{
+    static const uint16_t letters[26] = {
+        KEY_A, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H, KEY_I, KEY_J, KEY_K, KEY_L, KEY_M,
+        KEY_N, KEY_O, KEY_P, KEY_Q, KEY_R, KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X, KEY_Y, KEY_Z,
+    };
+    static const uint16_t digits[10] = {
+        KEY_1, KEY_2, KEY_3, KEY_4, KEY_5, KEY_6, KEY_7, KEY_8, KEY_9, KEY_0,
+    };
+    if (key >= 0x04 && key <= 0x1D) return letters[key - 0x04];
+    if (key >= 0x1E && key <= 0x27) return digits[key - 0x1E];
+    switch (key) {
+    case HID_KEY_ENTER:     return KEY_ENTER;
+    case HID_KEY_BACKSPACE: return KEY_BACKSPACE;
+    case 0x2D:              return KEY_MINUS;
+    case 0x33:              return KEY_SEMICOLON;
+    case 0x37:              return KEY_DOT;
+    case 0x38:              return KEY_SLASH;
+    case HID_KEY_F1:        return KEY_F1;
+    case HID_KEY_F2:        return KEY_F2;
+    case HID_KEY_RIGHT:     return KEY_RIGHT;
+    case HID_KEY_LEFT:      return KEY_LEFT;
+    case HID_KEY_DOWN:      return KEY_DOWN;
+    case HID_KEY_UP:        return KEY_UP;
+    default:                return -1;
+    }
+}
+
+static void uinput_emit(int type, int code, int value)
+{
+    struct input_event ev = { .type = type, .code = code, .value = value };
+    (void)write(s_uinput_fd, &ev, sizeof(ev));
+}
+
+bool sim_usb_open_uinput(void)
+{
+    s_uinput_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+    if (s_uinput_fd < 0) return false;
+    ioctl(s_uinput_fd, UI_SET_EVBIT, EV_KEY);
+    for (int k = 0; k < 256; k++) {
+        int code = hid_to_linux((uint8_t)k);
+        if (code >= 0) ioctl(s_uinput_fd, UI_SET_KEYBIT, code);
+    }
+    ioctl(s_uinput_fd, UI_SET_KEYBIT, KEY_LEFTSHIFT);
+    struct uinput_setup setup = { .id = { .bustype = BUS_USB, .vendor = 0x303a, .product = 0x4004 } };
+    snprintf(setup.name, sizeof(setup.name), "Cosmo Radio (sim)");
+    if (ioctl(s_uinput_fd, UI_DEV_SETUP, &setup) < 0 || ioctl(s_uinput_fd, UI_DEV_CREATE) < 0) {
+        close(s_uinput_fd);
+        s_uinput_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+static void uinput_report(const uint8_t *prev, const uint8_t *cur)
+{
+    if (s_uinput_fd < 0) return;
+    if ((prev[0] ^ cur[0]) & HID_MOD_SHIFT) {
+        uinput_emit(EV_KEY, KEY_LEFTSHIFT, (cur[0] & HID_MOD_SHIFT) ? 1 : 0);
+    }
+    // Releases before presses, as the kernel's HID core reports a key array:
+    // a report that swaps one typed key for the next is an up, then a down.
+    for (int i = 2; i < 8; i++) {
+        if (prev[i] && !memchr(&cur[2], prev[i], 6)) {
+            int code = hid_to_linux(prev[i]);
+            if (code >= 0) uinput_emit(EV_KEY, code, 0);
+        }
+    }
+    for (int i = 2; i < 8; i++) {
+        if (cur[i] && !memchr(&prev[2], cur[i], 6)) {
+            int code = hid_to_linux(cur[i]);
+            if (code >= 0) uinput_emit(EV_KEY, code, 1);
+        }
+    }
+    uinput_emit(EV_SYN, SYN_REPORT, 0);
+}
+#else
+bool sim_usb_open_uinput(void)
+{
+    return false;
+}
+
+static void uinput_report(const uint8_t *prev, const uint8_t *cur)
+{
+    (void)prev;
+    (void)cur;
+}
+#endif
+
+bool sim_usb_open_sink(const char *path)
+{
+    s_sink = fopen(path, "w");
+    if (s_sink == NULL) return false;
+    fprintf(s_sink, "# host_ms submit_ms mod keys[6]\n");
+    return true;
+}
+
+/********* virtual host ***************/
+
+// The host took the pending report off the IN endpoint.
+static void host_take(void)
+{
+    uint8_t report[8];
+    int64_t submit_us;
+    taskENTER_CRITICAL();
+    memcpy(report, s_pending, sizeof(report));
+    submit_us = s_pending_us;
+    s_has_pending = false;
+    taskEXIT_CRITICAL();
+
+    int64_t now = esp_timer_get_time();
+    uint32_t wait_us = (uint32_t)(now - submit_us);
+    s_take_wait_sum_us += wait_us;
+    if (wait_us > s_take_wait_max_us) s_take_wait_max_us = wait_us;
+    s_reports++;
+
+    bool shift = (report[0] & HID_MOD_SHIFT) != 0;
+    bool pressed = false, released = false;
+    for (int i = 2; i < 8; i++) {
+        uint8_t k = report[i];
+        if (s_host_keys[i] != 0 && memchr(&report[2], s_host_keys[i], 6) == NULL) released = true;
+        if (k == 0 || memchr(&s_host_keys[2], k, 6) != NULL) continue;   // not newly pressed
+        pressed = true;
+        s_key_presses++;
+        text_key(k, shift);
+        int src = source_for_key(k);
+        if (src >= 0) pair_input((sim_source_t)src, submit_us);
+    }
+    s_key_reports++;
+    if (pressed && released && report[0] != s_host_keys[0]) s_key_mixed++;
+
+    vTaskSuspendAll();
+    uinput_report(s_host_keys, report);
+    if (s_sink != NULL) {
+        fprintf(s_sink, "%.3f %.3f %02x %02x %02x %02x %02x %02x %02x\n",
+                now / 1000.0, submit_us / 1000.0, report[0],
+                report[2], report[3], report[4], report[5], report[6], report[7]);
+    }
+    (void)xTaskResumeAll();
+
+    memcpy(s_host_keys, report, sizeof(report));
+    tud_hid_report_complete_cb(0, report, sizeof(report));
+}
+
+static void host_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(SIM_ENUM_MS));
+    if (!s_mounted) {
+        s_mounted = true;
+    }
+    for (;;) {
+        uint32_t poll = s_poll_override_ms ? s_poll_override_ms : s_binterval_ms;
+        vTaskDelay(pdMS_TO_TICKS(poll ? poll : 1));
+        while (esp_timer_get_time() < s_hang_until_us) {
+            vTaskDelay(1);
+        }
+        sim_defer_t d;
+        while (xQueueReceive(s_defer_queue, &d, 0) == pdTRUE) {
+            d.func(d.param);
+        }
+        if (s_mounted && !s_stalled && s_has_pending) {
+            host_take();
+        }
+    }
+}
+
+// bInterval of the first interrupt IN endpoint in the config descriptor.
+static uint32_t parse_binterval(const uint8_t *cfg)
+{
+    if (cfg == NULL || cfg[1] != 0x02) return 10;
+    uint16_t total = cfg[2] | (cfg[3] << 8);
+    for (uint16_t off = 0; off + 1 < total && cfg[off] != 0; off += cfg[off]) {
+        const uint8_t *d = &cfg[off];
+        if (d[1] == 0x05 && (d[2] & 0x80) && (d[3] & 0x03) == 0x03) {
+            return d[6] ? d[6] : 1;
+        }
+    }
+    return 10;
+}
+
+esp_err_t tinyusb_driver_install(const tinyusb_config_t *config)
+{
+    if (s_installed) return ESP_ERR_INVALID_STATE;
+    s_binterval_ms = parse_binterval(config->descriptor.full_speed_config);
+    s_installed = true;
+    s_defer_queue = xQueueCreate(SIM_DEFER_DEPTH, sizeof(sim_defer_t));
+    if (s_defer_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(host_task, "sim_host", SIM_HOST_STACK, NULL, SIM_HOST_PRIO, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Virtual host attached, bInterval %lu ms", (unsigned long)s_binterval_ms);
+    return ESP_OK;
+}
+
+bool tud_mounted(void)
+{
+    return s_mounted;
+}
+
+bool tud_hid_ready(void)
+{
+    return s_mounted && !s_has_pending;
+}
+
+// The virtual host task stands in for the TinyUSB task, so deferred calls
+// run there, between polls.
+void usbd_defer_func(osal_task_func_t func, void *param, bool in_isr)
+{
+    sim_defer_t d = { func, param };
+    if (in_isr) {
+        xQueueSendFromISR(s_defer_queue, &d, NULL);
+    } else {
+        xQueueSend(s_defer_queue, &d, portMAX_DELAY);
+    }
+}
+
+bool tud_hid_report(uint8_t report_id, const void *report, uint16_t len)
+{
+    (void)report_id;
+    uint32_t block_ms = __atomic_exchange_n(&s_block_next_ms, 0, __ATOMIC_RELAXED);
+    if (block_ms != 0) {
+        vTaskDelay(pdMS_TO_TICKS(block_ms));
+    }
+    if (!tud_hid_ready() || len > sizeof(s_pending)) {
+        s_rejected_busy++;
+        return false;
+    }
+    taskENTER_CRITICAL();
+    memset(s_pending, 0, sizeof(s_pending));
+    memcpy(s_pending, report, len);
+    s_pending_us = esp_timer_get_time();
+    s_has_pending = true;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+bool tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, const uint8_t keycode[6])
+{
+    uint8_t report[8] = { modifier, 0 };
+    if (keycode != NULL) memcpy(&report[2], keycode, 6);
+    return tud_hid_report(report_id, report, sizeof(report));
+}
+
+/********* scenario controls ***************/
+
+void sim_usb_mount(bool mounted)
+{
+    s_mounted = mounted;
+    if (!mounted) {
+        s_has_pending = false;
+        memset(s_host_keys, 0, sizeof(s_host_keys));
+    }
+}
+
+void sim_usb_set_poll_ms(uint32_t ms)
+{
+    s_poll_override_ms = ms;
+}
+
+uint32_t sim_usb_poll_ms(void)
+{
+    return s_poll_override_ms ? s_poll_override_ms : s_binterval_ms;
+}
+
+void sim_usb_stall(bool stalled)
+{
+    s_stalled = stalled;
+}
+
+void sim_usb_hang(uint32_t ms)
+{
+    s_hang_until_us = esp_timer_get_time() + (int64_t)ms * 1000;
+}
+
+void sim_usb_block_next_submit(uint32_t ms)
+{
+    s_block_next_ms = ms;
+}
+
+uint16_t sim_usb_get_feature(uint8_t report_id, uint8_t *buf, uint16_t len)
+{
+    return tud_hid_get_report_cb(0, report_id, HID_REPORT_TYPE_FEATURE, buf, len);
+}
+
+void sim_usb_set_feature(uint8_t report_id, const uint8_t *buf, uint16_t len)
+{
+    tud_hid_set_report_cb(0, report_id, HID_REPORT_TYPE_FEATURE, buf, len);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+uint32_t sim_usb_max_latency_us(sim_source_t src, uint32_t *count)
+{
+    if (src >= SIM_SRC_COUNT) return 0;
+    taskENTER_CRITICAL();
+    uint32_t max_us = s_latency[src].max_us;
+    *count = s_latency[src].count;
+    taskEXIT_CRITICAL();
+    return max_us;
+}
+
+// Forget the samples but keep the pending inputs, so a report already on
+// its way still pairs with the input that caused it.
+void sim_usb_reset_latency(void)
+{
+    taskENTER_CRITICAL();
+    for (int i = 0; i < SIM_SRC_COUNT; i++) {
+        sim_latency_t *l = &s_latency[i];
+        l->count = 0;
+        l->unmatched = 0;
+        l->sum_us = 0;
+        l->max_us = 0;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void sim_usb_key_stats(uint32_t *reports, uint32_t *presses, uint32_t *mixed)
+{
+    taskENTER_CRITICAL();
+    *reports = s_key_reports;
+    *presses = s_key_presses;
+    *mixed = s_key_mixed;
+    taskEXIT_CRITICAL();
+}
+
+void sim_usb_reset_keys(void)
+{
+    taskENTER_CRITICAL();
+    s_key_reports = s_key_presses = s_key_mixed = 0;
+    taskEXIT_CRITICAL();
+}
+
+void sim_usb_print_stats(void)
+{
+    printf("\n== USB host ==\n");
+    printf("reports taken %lu, rejected (endpoint busy / unmounted) %lu, "
+           "submit->take avg %.2f ms max %.2f ms\n",
+           (unsigned long)s_reports, (unsigned long)s_rejected_busy,
+           s_reports ? s_take_wait_sum_us / 1000.0 / s_reports : 0.0, s_take_wait_max_us / 1000.0);
+    printf("key presses %lu in %lu reports (%.2f per press), modifier changed during a key swap %lu\n",
+           (unsigned long)s_key_presses, (unsigned long)s_key_reports,
+           s_key_presses ? (double)s_key_reports / s_key_presses : 0.0, (unsigned long)s_key_mixed);
+
+    printf("%-8s %7s %9s %9s %9s %9s %9s\n",
+           "input", "count", "avg ms", "p50 ms", "p99 ms", "max ms", "unmatched");
+    for (int i = 0; i < SIM_SRC_COUNT; i++) {
+        sim_latency_t *l = &s_latency[i];
+        if (l->count == 0 && l->unmatched == 0) continue;
+        uint32_t n = l->count < SIM_LAT_SAMPLES ? l->count : SIM_LAT_SAMPLES;
+        qsort(l->samples_us, n, sizeof(uint32_t), cmp_u32);
+        double p50 = n ? l->samples_us[n / 2] / 1000.0 : 0;
+        double p99 = n ? l->samples_us[(n * 99) / 100 < n ? (n * 99) / 100 : n - 1] / 1000.0 : 0;
+        printf("%-8s %7lu %9.3f %9.3f %9.3f %9.3f %9lu\n", SOURCE_NAMES[i], (unsigned long)l->count,
+               l->count ? l->sum_us / 1000.0 / l->count : 0.0, p50, p99, l->max_us / 1000.0,
+               (unsigned long)l->unmatched);
+    }
+    if (s_sink != NULL) fflush(s_sink);
+}
@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+"""
+Drive the firmware's sampling profiler over HID and turn a capture into
+folded stacks for a flame graph.
+
+    tools/profile.py start [--rate 997]
+    tools/profile.py stop
+    tools/profile.py dump --raw capture.json                  # stops sampling first
+    tools/profile.py fold --raw capture.json --elf build/cosmo_radio.elf -o profile.folded
+    tools/profile.py record --seconds 10 --elf build/cosmo_radio.elf -o profile.folded
+
+`record` is start, wait, stop, dump and fold in one go. The folded output
+("core0;nfc_dispatch;send_string;hid_type_char 42" per line) goes straight
+into flamegraph.pl, inferno-flamegraph or speedscope.
+
+The device is found as the hidraw node with Espressif's VID (needs read /
+write access to /dev/hidraw*, e.g. a udev rule); --device overrides it.
+Samples carry the interrupted PC and its call site, so every stack is two
+frames deep under its core and task. Symbols come from the toolchain's
+addr2line (xtensa-esp32s3-elf-addr2line, or --addr2line).
+"""
+
+import argparse
+import fcntl
+import glob
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import time
+from collections import Counter
+
+ESPRESSIF_VID = 0x303A
+REPORT_ID_PROFILE = 19
+FEATURE_REPORT_LEN = 63             # after the report ID
+
+CMD_STOP, CMD_START, CMD_REWIND = 0x00, 0x01, 0x02
+PAGE_END, PAGE_HEADER, PAGE_TASK, PAGE_SAMPLES = 0, 1, 2, 3
+
+FLAG_RUNNING, FLAG_SUPPORTED, FLAG_WRAPPED = 0x01, 0x02, 0x04
+SAMPLE_NESTED = 0x01
+
+HEADER_FIELDS = ["flags", "rate_hz", "taken", "held", "tasks", "duration_ms", "capacity", "task_misses"]
+SAMPLE = struct.Struct("<IIBBBB")   # prof_sample_t
+
+# linux/hidraw.h: _IOC(_IOC_WRITE | _IOC_READ, 'H', nr, len)
+def _hidioc(nr, length):
+    return (3 << 30) | (length << 16) | (ord("H") << 8) | nr
+
+
+def find_device():
+    for node in sorted(glob.glob("/sys/class/hidraw/hidraw*")):
+        try:
+            with open(os.path.join(node, "device", "uevent")) as f:
+                uevent = f.read()
+        except OSError:
+            continue
+        for line in uevent.splitlines():
+            # HID_ID=0003:0000303A:00004004
+            if line.startswith("HID_ID=") and int(line.split(":")[1], 16) == ESPRESSIF_VID:
+                return "/dev/" + os.path.basename(node)
+    sys.exit("no Espressif HID device found (use --device /dev/hidrawN)")
+
+
+class Device:
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR)
+
+    def set(self, payload):
+        buf = bytearray([REPORT_ID_PROFILE]) + bytes(payload)
+        buf += bytes(1 + FEATURE_REPORT_LEN - len(buf))
+        fcntl.ioctl(self.fd, _hidioc(0x06, len(buf)), buf)
+
+    def get(self):
+        buf = bytearray(1 + FEATURE_REPORT_LEN)
+        buf[0] = REPORT_ID_PROFILE
+        fcntl.ioctl(self.fd, _hidioc(0x07, len(buf)), buf)
+        # [0] report ID, [1] layout version, [2] page type, [3] word count, [4..] u32 LE
+        return buf[2], bytes(buf[4:4 + 4 * buf[3]])
+
+
+def header_of(data):
+    words = struct.unpack(f"<{len(data) // 4}I", data)
+    return dict(zip(HEADER_FIELDS, words))
+
+
+def dump(dev):
+    dev.set([CMD_STOP])
+    dev.set([CMD_REWIND])
+    page, data = dev.get()
+    if page != PAGE_HEADER:
+        sys.exit(f"unexpected first page type {page}")
+    header = header_of(data)
+    if not header["flags"] & FLAG_SUPPORTED:
+        sys.exit("firmware built without the profiler (COSMO_PROFILER)")
+
+    tasks, samples = {}, []
+    started = time.monotonic()
+    while True:
+        page, data = dev.get()
+        if page == PAGE_END:
+            break
+        if page == PAGE_TASK:
+            index = struct.unpack_from("<I", data)[0]
+            tasks[index] = data[4:].split(b"\0")[0].decode(errors="replace")
+        elif page == PAGE_SAMPLES:
+            for off in range(0, len(data), SAMPLE.size):
+                pc, caller, task, core, flags, _ = SAMPLE.unpack_from(data, off)
+                samples.append([pc, caller, task, core, flags])
+            if len(samples) % 5000 < 5:
+                print(f"\r{len(samples)}/{header['held']} samples", end="", file=sys.stderr)
+        else:
+            sys.exit(f"unexpected page type {page}")
+    print(f"\r{len(samples)} samples, {len(tasks)} tasks in {time.monotonic() - started:.1f} s",
+          file=sys.stderr)
+    return {"header": header, "tasks": {str(k): v for k, v in tasks.items()}, "samples": samples}
+
+
+class Symbolizer:
+    def __init__(self, elf, tool):
+        self.elf, self.tool, self.cache = elf, tool, {0: "[unknown]"}
+
+    def resolve(self, addrs):
+        todo = sorted(a for a in set(addrs) if a not in self.cache)
+        if not todo:
+            return
+        if not self.elf:
+            self.cache.update((a, f"0x{a:08x}") for a in todo)
+            return
+        out = subprocess.run([self.tool, "-f", "-e", self.elf],
+                             input="\n".join(f"0x{a:x}" for a in todo), capture_output=True,
+                             text=True, check=True).stdout.splitlines()
+        # Two lines per address: function, then file:line
+        for a, fn in zip(todo, out[0::2]):
+            self.cache[a] = f"0x{a:08x}" if fn == "??" else fn
+
+    def __getitem__(self, addr):
+        return self.cache[addr]
+
+
+def fold(capture, sym, per_core=True, with_caller=True):
+    tasks = capture["tasks"]
+    samples = capture["samples"]
+    sym.resolve([s[0] for s in samples] + [s[1] for s in samples])
+    stacks = Counter()
+    for pc, caller, task, core, flags in samples:
+        frames = [f"core{core}"] if per_core else []
+        frames.append(tasks.get(str(task), "[tasks full]"))
+        if flags & SAMPLE_NESTED:
+            frames.append("[interrupt]")
+        else:
+            if with_caller and caller:
+                frames.append(sym[caller])
+            frames.append(sym[pc])
+        stacks[";".join(f.replace(";", ":").replace(" ", "_") for f in frames)] += 1
+    return stacks
+
+
+def print_summary(capture, stacks, per_core):
+    h = capture["header"]
+    total = sum(stacks.values()) or 1
+    print(f"{h['held']} samples ({h['taken']} taken) over {h['duration_ms'] / 1000:.1f} s at "
+          f"{h['rate_hz']} Hz per core" + (", ring wrapped: oldest samples lost" if h["flags"] & FLAG_WRAPPED else ""))
+    if h["task_misses"]:
+        print(f"{h['task_misses']} samples from tasks past the task table")
+    by_task, by_func = Counter(), Counter()
+    for stack, n in stacks.items():
+        frames = stack.split(";")
+        by_task[";".join(frames[:2 if per_core else 1])] += n
+        by_func[frames[-1]] += n
+    print(f"\n{'core;task' if per_core else 'task':<32}{'samples':>9}{'%':>7}")
+    for name, n in by_task.most_common():
+        print(f"{name[:32]:<32}{n:>9}{100 * n / total:>7.1f}")
+    print(f"\n{'function (self)':<48}{'samples':>9}{'%':>7}")
+    for name, n in by_func.most_common(20):
+        print(f"{name[:48]:<48}{n:>9}{100 * n / total:>7.1f}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("command", choices=["start", "stop", "dump", "fold", "record"])
+    ap.add_argument("--device", help="hidraw node (default: first Espressif device)")
+    ap.add_argument("--rate", type=int, default=0, help="samples per second per core (0 = firmware default)")
+    ap.add_argument("--seconds", type=float, default=10, help="record: how long to sample")
+    ap.add_argument("--raw", help="capture file (JSON): written by dump / record, read by fold")
+    ap.add_argument("--elf", help="firmware ELF for symbols (without it addresses stay hex)")
+    ap.add_argument("--addr2line", default=None, help="addr2line to use (default: xtensa-esp32s3-elf-addr2line)")
+    ap.add_argument("-o", "--output", help="folded stacks output (default: stdout summary only)")
+    ap.add_argument("--merge-cores", action="store_true", help="do not split stacks by core")
+    ap.add_argument("--no-caller", action="store_true", help="leaf function only, no call site frame")
+    args = ap.parse_args()
+
+    capture = None
+    if args.command == "fold":
+        if not args.raw:
+            sys.exit("fold needs --raw")
+        with open(args.raw) as f:
+            capture = json.load(f)
+    else:
+        dev = Device(args.device or find_device())
+        if args.command in ("start", "record"):
+            dev.set([CMD_START, args.rate & 0xFF, args.rate >> 8])
+            page, data = dev.get()
+            h = header_of(data)
+            if not h["flags"] & FLAG_SUPPORTED:
+                sys.exit("firmware built without the profiler (COSMO_PROFILER)")
+            print(f"sampling at {h['rate_hz']} Hz per core", file=sys.stderr)
+            if args.command == "start":
+                return
+            time.sleep(args.seconds)
+        if args.command == "stop":
+            dev.set([CMD_STOP])
+            return
+        capture = dump(dev)
+        if args.raw:
+            with open(args.raw, "w") as f:
+                json.dump(capture, f)
+        if args.command == "dump":
+            return
+
+    tool = args.addr2line or shutil.which("xtensa-esp32s3-elf-addr2line") or "addr2line"
+    stacks = fold(capture, Symbolizer(args.elf, tool), not args.merge_cores, not args.no_caller)
+    print_summary(capture, stacks, not args.merge_cores)
+    if args.output:
+        with open(args.output, "w") as f:
+            for stack, n in sorted(stacks.items()):
+                f.write(f"{stack} {n}\n")
+        print(f"\nFolded stacks written to {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""
+Size and boot-time report for a firmware build, with a baseline check.
+
+    tools/size_report.py build-release
+    tools/size_report.py build-release --boot-log monitor.txt
+    tools/size_report.py build-release --write-baseline tools/size_baseline.json
+    tools/size_report.py build-release --baseline tools/size_baseline.json   # exit 1 if it grew
+
+Reads the linker map (<build>/<project>.map) directly, so it does not depend
+on the esp-idf-size version: every input section is charged to the component
+(archive) it came from and to a memory type by its output section. The boot
+time comes from the BOOT timeline the firmware logs once per boot
+(main/boot_trace.c), captured with `idf.py monitor | tee monitor.txt`.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+from collections import defaultdict
+
+# Output sections -> memory type (ESP32-S3 linker script names).
+# DRAM .bss / .noinit take RAM but no space in the image.
+SECTION_TYPES = [
+    (re.compile(r"^\.iram0\."), "iram"),
+    (re.compile(r"^\.dram0\.(bss|noinit)|^\.noinit"), "dram_bss"),
+    (re.compile(r"^\.dram0\."), "dram_data"),
+    (re.compile(r"^\.flash\.text"), "flash_code"),
+    (re.compile(r"^\.flash\.rodata_noload"), None),
+    (re.compile(r"^\.flash\."), "flash_data"),
+    (re.compile(r"^\.rtc"), "rtc"),
+]
+COLUMNS = ["flash_code", "flash_data", "iram", "dram_data", "dram_bss", "rtc"]
+IN_IMAGE = ["flash_code", "flash_data", "iram", "dram_data", "rtc"]
+
+FACTORY_BYTES = 3 * 1024 * 1024     # partitions.csv
+DEFAULT_TOLERANCE = 0.01            # 1 %
+
+OUT_SECTION = re.compile(r"^(\.\S+)\s+0x[0-9a-f]+\s+0x[0-9a-f]+")
+IN_SECTION = re.compile(r"^ (\.\S+|COMMON)(?:\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*))?$")
+IN_SECTION_CONT = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S.*)$")
+MEMORY_REGION = re.compile(r"^(\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)(\s+\S+)?$")
+
+
+def section_type(name):
+    for pattern, kind in SECTION_TYPES:
+        if pattern.search(name):
+            return kind
+    return None
+
+
+def component_of(source):
+    """esp-idf/main/libmain.a(x.c.obj) -> main; /.../libc.a(...) -> libc"""
+    m = re.search(r"([^/\\]+)\.a\(", source)
+    if m:
+        name = m.group(1)
+        name = name[3:] if name.startswith("lib") else name
+        # esp-idf/<component>/lib<component>.a: keep managed component prefixes
+        d = re.search(r"esp-idf[/\\]([^/\\]+)[/\\][^/\\]+\.a\(", source)
+        return d.group(1) if d else name
+    return "(" + os.path.basename(source).split(".")[0] + ")"
+
+
+def parse_map(path):
+    sizes = defaultdict(lambda: defaultdict(int))   # component -> type -> bytes
+    files = defaultdict(lambda: defaultdict(int))   # component/object -> type -> bytes
+    regions = {}
+    kind = None
+    pending = None          # input section whose address line wraps
+    in_memory = False
+    with open(path, errors="replace") as f:
+        for raw in f:
+            line = raw.rstrip("\n")
+            if line.startswith("Memory Configuration"):
+                in_memory = True
+                continue
+            if in_memory:
+                if line.startswith("Linker script and memory map"):
+                    in_memory = False
+                    continue
+                m = MEMORY_REGION.match(line)
+                if m and m.group(1) != "Name":
+                    regions[m.group(1)] = int(m.group(3), 16)
+                continue
+
+            m = OUT_SECTION.match(line) or re.match(r"^(\.\S+)\s*$", line)
+            if m and not line.startswith(" "):
+                kind = section_type(m.group(1))
+                pending = None
+                continue
+            m = IN_SECTION.match(line)
+            if m:
+                if m.group(2) is None:
+                    pending = m.group(1)        # long name: numbers on the next line
+                    continue
+                size, source = int(m.group(3), 16), m.group(4)
+            elif pending:
+                m = IN_SECTION_CONT.match(line)
+                pending = None
+                if not m:
+                    continue
+                size, source = int(m.group(2), 16), m.group(3)
+            else:
+                continue
+            if kind is None or size == 0 or source.startswith("*fill*"):
+                continue
+            comp = component_of(source)
+            sizes[comp][kind] += size
+            obj = re.search(r"\(([^)]+)\)$", source)
+            files[comp + "/" + (obj.group(1) if obj else os.path.basename(source))][kind] += size
+    return sizes, files, regions
+
+
+def find_map(build):
+    desc = os.path.join(build, "project_description.json")
+    if os.path.exists(desc):
+        with open(desc) as f:
+            name = json.load(f).get("project_name")
+        if name and os.path.exists(os.path.join(build, name + ".map")):
+            return os.path.join(build, name + ".map"), os.path.join(build, name + ".bin")
+    maps = [p for p in os.listdir(build) if p.endswith(".map") and "bootloader" not in p]
+    if len(maps) != 1:
+        sys.exit(f"{build}: no unique <project>.map (found {maps or 'none'})")
+    base = os.path.join(build, maps[0][:-4])
+    return base + ".map", base + ".bin"
+
+
+def parse_boot_log(path):
+    """Last boot in the capture: power-on reset -> app_main and first report, in ms."""
+    boot = {}
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = re.search(r"BOOT:\s+([\d.]+) ms\s+power-on reset -> app_main", line)
+            if m:
+                boot = {"reset_to_app_main_ms": float(m.group(1))}
+            m = re.search(r"BOOT: Time to first report: ([\d.]+) ms", line)
+            if m:
+                boot["app_main_to_first_report_ms"] = float(m.group(1))
+    return boot
+
+
+def kb(n):
+    return f"{n / 1024:8.1f}"
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("build", help="build directory (idf.py -B ...)")
+    ap.add_argument("--boot-log", help="serial capture containing the BOOT timeline")
+    ap.add_argument("--files", metavar="COMPONENT", action="append", default=[],
+                    help="also break COMPONENT down per object file (repeatable)")
+    ap.add_argument("--top", type=int, default=25, help="components to list (default 25)")
+    ap.add_argument("--baseline", help="compare against this baseline; exit 1 past the tolerance")
+    ap.add_argument("--tolerance", type=float, default=DEFAULT_TOLERANCE,
+                    help="allowed growth as a fraction (default 0.01)")
+    ap.add_argument("--write-baseline", metavar="FILE", help="save this build as the baseline")
+    args = ap.parse_args()
+
+    map_path, bin_path = find_map(args.build)
+    sizes, files, regions = parse_map(map_path)
+    totals = defaultdict(int)
+    for comp in sizes.values():
+        for k, v in comp.items():
+            totals[k] += v
+    image = os.path.getsize(bin_path) if os.path.exists(bin_path) else sum(totals[k] for k in IN_IMAGE)
+
+    print(f"Image {os.path.basename(bin_path)}: {image:,} bytes "
+          f"({100 * image / FACTORY_BYTES:.1f} % of the {FACTORY_BYTES >> 20} MB factory partition)")
+    iram_cap = sum(v for k, v in regions.items() if k.startswith("iram0_0_seg"))
+    dram_cap = sum(v for k, v in regions.items() if k.startswith("dram0_0_seg"))
+    dram = totals["dram_data"] + totals["dram_bss"]
+    print(f"IRAM {totals['iram']:,} bytes" + (f" of {iram_cap:,} ({100 * totals['iram'] / iram_cap:.1f} %)" if iram_cap else ""))
+    print(f"DRAM {dram:,} bytes (data {totals['dram_data']:,} + bss {totals['dram_bss']:,})"
+          + (f" of {dram_cap:,} ({100 * dram / dram_cap:.1f} %)" if dram_cap else ""))
+    print(f"Flash code {totals['flash_code']:,}, flash data {totals['flash_data']:,}, RTC {totals['rtc']:,}")
+
+    def table(rows, title):
+        print(f"\n{title:<32}" + "".join(f"{c:>11}" for c in COLUMNS) + f"{'image KB':>11}")
+        for name, t in rows:
+            print(f"{name[:32]:<32}" + "".join(f"{kb(t[c]):>11}" for c in COLUMNS)
+                  + f"{kb(sum(t[c] for c in IN_IMAGE)):>11}")
+
+    ranked = sorted(sizes.items(), key=lambda kv: -sum(kv[1][c] for c in IN_IMAGE + ["dram_bss"]))
+    table(ranked[:args.top], "component (KB)")
+    for comp in args.files:
+        rows = sorted(((k.split("/", 1)[1], v) for k, v in files.items() if k.startswith(comp + "/")),
+                      key=lambda kv: -sum(kv[1].values()))
+        table(rows, f"{comp} per file (KB)")
+
+    boot = parse_boot_log(args.boot_log) if args.boot_log else {}
+    if args.boot_log:
+        if "reset_to_app_main_ms" in boot:
+            print(f"\nBoot: power-on reset -> app_main {boot['reset_to_app_main_ms']:.1f} ms", end="")
+            if "app_main_to_first_report_ms" in boot:
+                print(f", app_main -> first HID report {boot['app_main_to_first_report_ms']:.1f} ms", end="")
+            print()
+        else:
+            print(f"\nBoot: no power-on timeline in {args.boot_log} (capture a cold boot)")
+
+    current = {
+        "image": image, "iram": totals["iram"], "dram": dram,
+        "components": {c: sum(t[k] for k in IN_IMAGE + ["dram_bss"]) for c, t in sizes.items()},
+        **boot,
+    }
+    if args.write_baseline:
+        with open(args.write_baseline, "w") as f:
+            json.dump(current, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"\nBaseline written to {args.write_baseline}")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            base = json.load(f)
+        failed = False
+        print(f"\nAgainst {args.baseline} (tolerance {100 * args.tolerance:.1f} %):")
+        for key in ["image", "iram", "dram", "reset_to_app_main_ms", "app_main_to_first_report_ms"]:
+            if key not in base or key not in current:
+                continue
+            was, now = base[key], current[key]
+            grew = now > was * (1 + args.tolerance)
+            failed |= grew
+            print(f"  {key:<28} {was:>12,} -> {now:>12,}  {now - was:+,}{'  OVER' if grew else ''}")
+        moved = sorted(((c, v - base["components"].get(c, 0)) for c, v in current["components"].items()),
+                       key=lambda kv: -abs(kv[1]))
+        for comp, delta in moved[:8]:
+            if delta:
+                print(f"  {comp:<28} {delta:+,} bytes")
+        if failed:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+Build the UID index image for the `uidmap` partition (main/uid_index.c).
+
+    tools/uidmap.py build cards.csv -o uidmap.bin
+    tools/uidmap.py dump uidmap.bin
+    parttool.py -p /dev/ttyACM0 write_partition --partition-name uidmap --input uidmap.bin
+
+The CSV has one card per line: the UID in hex (separators ':', '-' and
+spaces are ignored), then the ID to type for it, e.g.
+
+    04A38B6A220289,004
+    04:63:DA:47:22:02:89,002
+
+Blank lines and lines starting with '#' are skipped, and so is a first line
+reading `uid,...`. IDs follow the same rules as provision_list.txt: at most
+32 characters out of [A-Za-z0-9#:-_./].
+"""
+
+import argparse
+import csv
+import re
+import struct
+import sys
+import zlib
+
+MAGIC = 0x58444955          # "UIDX"
+VERSION = 1
+HEADER = struct.Struct("<IHHIII12x")
+ENTRY = struct.Struct("<11sBI")
+UID_MAX = 10
+PAYLOAD_MAX = 32            # NFC_PAYLOAD_MAX_LEN
+PARTITION_SIZE = 1024 * 1024    # partitions.csv
+PAYLOAD_OK = re.compile(r"^[A-Za-z0-9#:\-_./]+$")
+
+
+def uid_key(uid):
+    """Length byte, then the UID zero-padded: sorts and compares as main/uid_index.c does."""
+    return bytes([len(uid)]) + uid + bytes(UID_MAX - len(uid))
+
+
+def parse_csv(path):
+    cards = {}
+    with open(path, newline="") as f:
+        for lineno, row in enumerate(csv.reader(f), 1):
+            if not row or not row[0].strip() or row[0].lstrip().startswith("#"):
+                continue
+            if lineno == 1 and row[0].strip().lower() == "uid":
+                continue
+            where = "%s:%d" % (path, lineno)
+            if len(row) != 2:
+                sys.exit("%s: expected uid,id" % where)
+            hex_uid = re.sub(r"[\s:\-]", "", row[0])
+            try:
+                uid = bytes.fromhex(hex_uid)
+            except ValueError:
+                sys.exit("%s: bad UID %r" % (where, row[0]))
+            if not 1 <= len(uid) <= UID_MAX:
+                sys.exit("%s: UID must be 1..%d bytes" % (where, UID_MAX))
+            text = row[1].strip()
+            if not text or len(text) > PAYLOAD_MAX or not PAYLOAD_OK.match(text):
+                sys.exit("%s: ID %r is empty, longer than %d or not typable" % (where, text, PAYLOAD_MAX))
+            if uid in cards and cards[uid] != text:
+                sys.exit("%s: UID %s already maps to %r" % (where, uid.hex().upper(), cards[uid]))
+            cards[uid] = text
+    return cards
+
+
+def build(cards):
+    pool = bytearray()
+    offsets = {}
+    entries = bytearray()
+    for uid in sorted(cards, key=uid_key):
+        text = cards[uid].encode("ascii")
+        if text not in offsets:         # cards sharing an ID share its bytes
+            offsets[text] = len(pool)
+            pool += text
+        entries += ENTRY.pack(uid_key(uid), len(text), offsets[text])
+    body = bytes(entries) + bytes(pool)
+    header = HEADER.pack(MAGIC, VERSION, ENTRY.size, len(cards), len(pool), zlib.crc32(body))
+    return header + body
+
+
+def dump(image):
+    if len(image) < HEADER.size:
+        sys.exit("image too short")
+    magic, version, entry_size, count, text_size, crc = HEADER.unpack_from(image)
+    if magic != MAGIC or version != VERSION or entry_size != ENTRY.size:
+        sys.exit("not a version %d UID index" % VERSION)
+    body = image[HEADER.size:HEADER.size + count * ENTRY.size + text_size]
+    if len(body) != count * ENTRY.size + text_size or zlib.crc32(body) != crc:
+        sys.exit("truncated or corrupt (CRC mismatch)")
+    pool = body[count * ENTRY.size:]
+    for i in range(count):
+        key, text_len, text_off = ENTRY.unpack_from(body, i * ENTRY.size)
+        uid = key[1:1 + key[0]]
+        print("%s,%s" % (uid.hex().upper(), pool[text_off:text_off + text_len].decode("ascii")))
+    print("# %d cards, %d bytes" % (count, HEADER.size + len(body)), file=sys.stderr)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("command", choices=["build", "dump"])
+    ap.add_argument("input", help="build: CSV of uid,id; dump: index image")
+    ap.add_argument("-o", "--output", help="build: image to write")
+    ap.add_argument("--partition-size", type=lambda s: int(s, 0), default=PARTITION_SIZE,
+                    help="build: fail if the image does not fit (default: %(default)d)")
+    args = ap.parse_args()
+
+    if args.command == "dump":
+        with open(args.input, "rb") as f:
+            dump(f.read())
+        return
+    if not args.output:
+        ap.error("build needs -o")
+    cards = parse_csv(args.input)
+    image = build(cards)
+    if len(image) > args.partition_size:
+        sys.exit("%d cards take %d bytes, the partition holds %d" % (len(cards), len(image), args.partition_size))
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print("%d cards, %d bytes (%.1f%% of the partition)"
+          % (len(cards), len(image), 100.0 * len(image) / args.partition_size))
+
+
+if __name__ == "__main__":
+    main()